@@ -57,8 +57,13 @@ public:
       double pitch = mInputs[kVoiceControlPitch].endValue;
       double pitchBend = mInputs[kVoiceControlPitchBend].endValue;
 
-      // or write the entire control ramp to a buffer, like this, to get sample-accurate ramps:
-      mInputs[kVoiceControlTimbre].Write(mTimbreBuffer.Get(), startIdx, nFrames);
+      // or write the entire control ramp to a buffer, like this, to get sample-accurate ramps.
+      // most of the time a ramp is constant for the whole block, and the buffer can be skipped:
+      const ControlRamp& timbre = mInputs[kVoiceControlTimbre];
+      const bool timbreIsConstant = timbre.IsConstant();
+      
+      if (!timbreIsConstant)
+        timbre.Write(mTimbreBuffer.Get(), startIdx, nFrames);
       
       // convert from "1v/oct" pitch space to frequency in Hertz
       double osc1Freq = 440. * pow(2., pitch + pitchBend + inputs[kModLFO][0]);
@@ -66,7 +71,7 @@ public:
       // make sound output for each output channel
       for(auto i = startIdx; i < startIdx + nFrames; i++)
       {
-        float noise = mTimbreBuffer.Get()[i] * Rand();
+        float noise = (timbreIsConstant ? static_cast<float>(timbre.endValue) : mTimbreBuffer.Get()[i]) * Rand();
         // an MPE synth can use pressure here in addition to gain
         outputs[0][i] += (mOSC.Process(osc1Freq) + noise) * mAMPEnv.Process(inputs[kModSustainSmoother][i]) * mGain;
         outputs[1][i] = outputs[0][i];
@@ -214,7 +219,7 @@ public:
   MidiSynth mSynth { VoiceAllocator::kPolyModePoly, MidiSynth::kDefaultBlockSize };
   WDL_TypedBuf<T> mModulationsData; // Sample data for global modulations (e.g. smoothed sustain)
   WDL_PtrList<T> mModulations; // Ptrlist for global modulations
-  LogParamSmooth<T, kNumModulations> mParamSmoother;
+  LogParamSmoothBank<T, kNumModulations> mParamSmoother;
   sample mParamsToSmooth[kNumModulations];
   LFO<T> mLFO;
 };
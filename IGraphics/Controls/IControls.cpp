@@ -1144,7 +1144,7 @@ void IVPlotControl::Draw(IGraphics& g)
         mPoints[i] = static_cast<float>(v);
       }
       
-      g.DrawData(mPlots[p].color, plotsRECT, mPoints.data(), static_cast<int>(mPoints.size()), nullptr, &mBlend, mTrackSize);
+      g.DrawData(mPlots[p].color, plotsRECT, mPoints.data(), static_cast<int>(mPoints.size()), nullptr, &mBlend, mTrackSize, false, true);
     }
 
     if (mStyle.drawFrame)
@@ -60,7 +60,7 @@ public:
     for (int c=0; c<mBuf.nChans; c++)
     {
       // drawdata expects normalized values and buffer contains unnormalized, so draw in the top half
-      g.DrawData(GetColor(kFG), r.FracRectVertical(0.5, true), mBuf.vals[c].data(), mBufferSize, nullptr, &mBlend, mTrackSize);
+      g.DrawData(GetColor(kFG), r.FracRectVertical(0.5, true), mBuf.vals[c].data(), mBufferSize, nullptr, &mBlend, mTrackSize, false, true);
     }
   }
   
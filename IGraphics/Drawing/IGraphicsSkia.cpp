@@ -1,6 +1,15 @@
 #include <cmath>
 #include <map>
 
+#ifdef IGRAPHICS_CPU
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#endif
+
 #include "IGraphicsSkia.h"
 
 #pragma warning( push )
@@ -160,6 +169,113 @@ struct IGraphicsSkia::Font
   sk_sp<SkTypeface> mTypeface;
 };
 
+#ifdef IGRAPHICS_CPU
+/** A fixed set of worker threads that rasterise the tiles of a frame, with the UI thread working alongside them */
+class IGraphicsSkia::TilePool
+{
+public:
+  TilePool(int nThreads)
+  {
+    for (auto i = 1; i < nThreads; i++)
+      mThreads.emplace_back([this]() { WorkerLoop(); });
+  }
+
+  ~TilePool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQuit = true;
+    }
+
+    mWakeCV.notify_all();
+
+    for (auto& thread : mThreads)
+      thread.join();
+  }
+
+  int NThreads() const { return static_cast<int>(mThreads.size()) + 1; }
+
+  /** Call func for each tile index, on any of the threads, and return once all the tiles are done */
+  void Process(int nTiles, const std::function<void(int)>& func)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mFunc = &func;
+      mNumTiles = nTiles;
+      mNextTile = 0;
+      mTilesDone = 0;
+      mGeneration++;
+    }
+
+    mWakeCV.notify_all();
+    Work(func, nTiles);
+
+    // workers that picked up this frame late must be done with func too, before it goes out of scope
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCV.wait(lock, [this]() { return mTilesDone == mNumTiles && mActiveWorkers == 0; });
+    mFunc = nullptr;
+  }
+
+private:
+  void WorkerLoop()
+  {
+    uint64_t generation = 0;
+
+    while (true)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWakeCV.wait(lock, [&]() { return mQuit || (mGeneration != generation && mFunc); });
+
+      if (mQuit)
+        return;
+
+      generation = mGeneration;
+      const std::function<void(int)>& func = *mFunc;
+      const int nTiles = mNumTiles;
+      mActiveWorkers++;
+      lock.unlock();
+
+      Work(func, nTiles);
+
+      lock.lock();
+      mActiveWorkers--;
+
+      if (mTilesDone == mNumTiles && mActiveWorkers == 0)
+        mDoneCV.notify_one();
+    }
+  }
+
+  void Work(const std::function<void(int)>& func, int nTiles)
+  {
+    int done = 0;
+
+    for (int tile = mNextTile++; tile < nTiles; tile = mNextTile++, done++)
+      func(tile);
+
+    if (done)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mTilesDone += done;
+
+      if (mTilesDone == mNumTiles)
+        mDoneCV.notify_one();
+    }
+  }
+
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mWakeCV;
+  std::condition_variable mDoneCV;
+  const std::function<void(int)>* mFunc = nullptr;
+  std::atomic<int> mNextTile{0};
+  int mNumTiles = 0;
+  int mTilesDone = 0;
+  int mActiveWorkers = 0;
+  uint64_t mGeneration = 0;
+  bool mQuit = false;
+};
+#endif
+
 // Fonts
 StaticStorage<IGraphicsSkia::Font> IGraphicsSkia::sFontCache;
 
@@ -539,14 +655,120 @@ void IGraphicsSkia::BeginFrame()
     mMTLDrawable = (void*) drawable;
     assert(mScreenSurface);
   }
+#elif defined IGRAPHICS_CPU
+  if (mTilePool)
+  {
+    mRecordingCanvas = mRecorder->beginRecording(SkRect::MakeIWH(mSurface->width(), mSurface->height()));
+    mRecordingCanvas->save();
+    mCanvas = mRecordingCanvas;
+  }
 #endif
 
   IGraphics::BeginFrame();
 }
 
+#ifdef IGRAPHICS_CPU
+void IGraphicsSkia::GetFramePixelRects(std::vector<SkIRect>& rects) const
+{
+  const float scale = GetBackingPixelScale();
+  const SkIRect surfaceBounds = SkIRect::MakeWH(mSurface->width(), mSurface->height());
+  const IRECTList& regions = GetFrameRegions();
+
+  rects.clear();
+
+  for (auto i = 0; i < regions.Size(); i++)
+  {
+    const IRECT r = regions.Get(i).GetScaled(scale);
+    SkIRect rect = SkIRect::MakeLTRB(static_cast<int>(std::floor(r.L)), static_cast<int>(std::floor(r.T)),
+                                     static_cast<int>(std::ceil(r.R)), static_cast<int>(std::ceil(r.B)));
+
+    if (rect.intersect(surfaceBounds))
+      rects.push_back(rect);
+  }
+}
+
+void IGraphicsSkia::SetParallelRasterization(int nThreads, int tileSize)
+{
+  if (nThreads <= 0)
+    nThreads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+  mRasterTileSize = std::max(tileSize, 16);
+
+  if (nThreads == 1)
+  {
+    mTilePool = nullptr;
+    mRecorder = nullptr;
+  }
+  else if (!mTilePool || mTilePool->NThreads() != nThreads)
+  {
+    mTilePool = std::make_unique<TilePool>(nThreads);
+    mRecorder = std::make_unique<SkPictureRecorder>();
+  }
+}
+
+void IGraphicsSkia::RasterizeTiles(const SkPicture& picture)
+{
+  // tiles are the cells of a fixed grid, so that overlapping regions share tiles and no pixel is drawn by two threads
+  const int size = mRasterTileSize;
+  const int nCols = (mSurface->width() + size - 1) / size;
+  const SkIRect surfaceBounds = SkIRect::MakeWH(mSurface->width(), mSurface->height());
+  std::vector<int> cells;
+
+  for (const auto& rect : mFramePixelRects)
+  {
+    for (auto y = rect.top() / size; y <= (rect.bottom() - 1) / size; y++)
+      for (auto x = rect.left() / size; x <= (rect.right() - 1) / size; x++)
+        cells.push_back(y * nCols + x);
+  }
+
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+  mTiles.clear();
+
+  for (auto cell : cells)
+  {
+    SkIRect tile = SkIRect::MakeXYWH((cell % nCols) * size, (cell / nCols) * size, size, size);
+
+    if (tile.intersect(surfaceBounds))
+      mTiles.push_back(tile);
+  }
+
+  mSurface->notifyContentWillChange(SkSurface::kRetain_ContentChangeMode);
+
+  SkPixmap pixmap;
+  mSurface->peekPixels(&pixmap);
+
+  // playback only touches pixels inside the regions, as every control draw in the picture is clipped to its region
+  const std::function<void(int)> drawTile = [&](int tileIdx) {
+    auto pCanvas = SkCanvas::MakeRasterDirect(pixmap.info(), pixmap.writable_addr(), pixmap.rowBytes());
+    pCanvas->clipIRect(mTiles[tileIdx]);
+    pCanvas->drawPicture(&picture);
+  };
+
+  mTilePool->Process(static_cast<int>(mTiles.size()), drawTile);
+}
+#endif
+
 void IGraphicsSkia::EndFrame()
 {
 #ifdef IGRAPHICS_CPU
+  GetFramePixelRects(mFramePixelRects);
+
+  if (mRecordingCanvas)
+  {
+    sk_sp<SkPicture> picture = mRecorder->finishRecordingAsPicture();
+    mRecordingCanvas = nullptr;
+    UpdateLayer();
+    RasterizeTiles(*picture);
+  }
+
+  // only present the regions that were redrawn, in backing pixels
+  int64_t pixelsPresented = 0;
+
+  for (const auto& rect : mFramePixelRects)
+    pixelsPresented += static_cast<int64_t>(rect.width()) * rect.height();
+
   #if defined OS_MAC || defined OS_IOS
     SkPixmap pixmap;
     mSurface->peekPixels(&pixmap);
@@ -555,21 +777,39 @@ void IGraphicsSkia::EndFrame()
     CGContext* pCGContext = (CGContextRef) GetPlatformContext();
     CGContextSaveGState(pCGContext);
     CGContextScaleCTM(pCGContext, 1.0 / GetScreenScale(), 1.0 / GetScreenScale());
-    SkCGDrawBitmap(pCGContext, bmp, 0, 0);
+    for (const auto& rect : mFramePixelRects)
+    {
+      SkBitmap subset;
+      if (bmp.extractSubset(&subset, rect))
+        SkCGDrawBitmap(pCGContext, subset, rect.x(), rect.y());
+    }
     CGContextRestoreGState(pCGContext);
   #elif defined OS_WIN
-    auto w = WindowWidth() * GetScreenScale();
-    auto h = WindowHeight() * GetScreenScale();
     BITMAPINFO* bmpInfo = reinterpret_cast<BITMAPINFO*>(mSurfaceMemory.Get());
     HWND hWnd = (HWND) GetWindow();
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(hWnd, &ps);
-    StretchDIBits(hdc, 0, 0, w, h, 0, 0, w, h, bmpInfo->bmiColors, bmpInfo, DIB_RGB_COLORS, SRCCOPY);
+    // each region is copied from a DIB that starts at its first row and is exactly its height. The source y is then 0,
+    // so it doesn't matter which end of a top-down DIB the driver counts it from
+    const uint8_t* pSurfacePixels = reinterpret_cast<const uint8_t*>(bmpInfo->bmiColors);
+    const size_t rowBytes = static_cast<size_t>(bmpInfo->bmiHeader.biWidth) * sizeof(uint32_t);
+    BITMAPINFO regionInfo = {};
+    regionInfo.bmiHeader = bmpInfo->bmiHeader;
+    regionInfo.bmiHeader.biSizeImage = 0;
+
+    for (const auto& rect : mFramePixelRects)
+    {
+      regionInfo.bmiHeader.biHeight = -rect.height();
+      SetDIBitsToDevice(hdc, rect.x(), rect.y(), rect.width(), rect.height(), rect.x(), 0, 0, rect.height(),
+                        pSurfacePixels + rect.y() * rowBytes, &regionInfo, DIB_RGB_COLORS);
+    }
     ReleaseDC(hWnd, hdc);
     EndPaint(hWnd, &ps);
   #else
     #error NOT IMPLEMENTED
   #endif
+
+  SetPixelsPresented(pixelsPresented);
 #else // GPU
   mSurface->draw(mScreenSurface->getCanvas(), 0.0, 0.0, nullptr);
 
@@ -655,7 +895,13 @@ IColor IGraphicsSkia::GetPoint(int x, int y)
 {
   SkBitmap bitmap;
   bitmap.allocPixels(SkImageInfo::MakeN32Premul(1, 1));
+#ifdef IGRAPHICS_CPU
+  // a recording canvas has no pixels
+  SkCanvas* pCanvas = mCanvas == mRecordingCanvas ? mSurface->getCanvas() : mCanvas;
+  pCanvas->readPixels(bitmap, x, y);
+#else
   mCanvas->readPixels(bitmap, x, y);
+#endif
   auto color = bitmap.getColor(0,0);
   return IColor(SkColorGetA(color), SkColorGetR(color), SkColorGetG(color), SkColorGetB(color));
 }
@@ -971,7 +1217,14 @@ APIBitmap* IGraphicsSkia::CreateAPIBitmap(int width, int height, float scale, do
 
 void IGraphicsSkia::UpdateLayer()
 {
-  mCanvas = mLayers.empty() ? mSurface->getCanvas() : mLayers.top()->GetAPIBitmap()->GetBitmap()->mSurface->getCanvas();
+  if (!mLayers.empty())
+    mCanvas = mLayers.top()->GetAPIBitmap()->GetBitmap()->mSurface->getCanvas();
+#ifdef IGRAPHICS_CPU
+  else if (mRecordingCanvas)
+    mCanvas = mRecordingCanvas;
+#endif
+  else
+    mCanvas = mSurface->getCanvas();
 }
 
 static size_t CalcRowBytes(int width)
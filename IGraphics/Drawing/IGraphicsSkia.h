@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "IPlugPlatform.h"
 #include "IGraphics.h"
 
@@ -18,6 +21,8 @@
 #include "include/core/SkPath.h"
 #include "include/core/SkCanvas.h"
 #include "include/core/SkImage.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPictureRecorder.h"
 #include "include/gpu/GrDirectContext.h"
 #pragma warning( pop )
 
@@ -113,6 +118,9 @@ public:
 #endif
   void DrawFastDropShadow(const IRECT& innerBounds, const IRECT& outerBounds, float xyDrop, float roundness, float blur, IBlend* pBlend) override;
   
+  /** With parallel rasterization, see SetParallelRasterization(), the controls draw into a recording that is rasterised
+   * at the end of the frame. GetPoint() called while drawing then returns the pixel as it was at the end of the previous
+   * frame, not what has been drawn so far in this one */
   IColor GetPoint(int x, int y) override;
   void* GetDrawContext() override { return (void*) mCanvas; }
 
@@ -130,6 +138,17 @@ public:
   
   void DrawMultiLineText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend) override;
 
+#ifdef IGRAPHICS_CPU
+  static constexpr int kDefaultRasterTileSize = 256;
+
+  /** Rasterise frames in tiles on several threads. Each frame is first recorded to an SkPicture on the UI thread, then
+   * the tiles covering the regions being drawn are played back into the surface in parallel, which gives the same pixels
+   * as drawing directly. See GetPoint() for what it returns while a frame is drawn.
+   * @param nThreads The number of threads including the UI thread, 0 for one per core, 1 to draw directly (the default)
+   * @param tileSize The width and height of the tiles in backing pixels */
+  void SetParallelRasterization(int nThreads, int tileSize = kDefaultRasterTileSize);
+#endif
+
 protected:
     
   float DoMeasureText(const IText& text, const char* str, IRECT& bounds) const override;
@@ -157,6 +176,23 @@ private:
 #if defined OS_WIN && defined IGRAPHICS_CPU
   WDL_TypedBuf<uint8_t> mSurfaceMemory;
 #endif
+
+#ifdef IGRAPHICS_CPU
+  class TilePool;
+
+  /** Get the regions of the current frame in backing pixels, clipped to the surface */
+  void GetFramePixelRects(std::vector<SkIRect>& rects) const;
+
+  /** Play the recorded frame back into the surface, one tile per task on the tile pool */
+  void RasterizeTiles(const SkPicture& picture);
+
+  std::unique_ptr<TilePool> mTilePool;
+  std::unique_ptr<SkPictureRecorder> mRecorder;
+  SkCanvas* mRecordingCanvas = nullptr;
+  int mRasterTileSize = kDefaultRasterTileSize;
+  std::vector<SkIRect> mFramePixelRects;
+  std::vector<SkIRect> mTiles;
+#endif
   
 #ifndef IGRAPHICS_CPU
   sk_sp<GrDirectContext> mGrContext;
@@ -954,25 +954,48 @@ void IGraphics::Draw(IRECTList& rects)
     return;
   
   float scale = GetBackingPixelScale();
-    
-  BeginFrame();
-    
+  
+  mFrameRegions.Clear();
+
   if (mStrict)
   {
     IRECT r = rects.Bounds();
     r.PixelAlign(scale);
-    Draw(r, scale);
+    mFrameRegions.Add(r);
   }
   else
   {
     rects.PixelAlign(scale);
-    rects.Optimize();
+    rects.Optimize(mDrawRegionCost);
 
     for (auto i = 0; i < rects.Size(); i++)
-      Draw(rects.Get(i), scale);
+      mFrameRegions.Add(rects.Get(i));
   }
-  
+
+  const double pixelArea = static_cast<double>(scale) * scale;
+  const int64_t windowPixels = static_cast<int64_t>(static_cast<double>(Width()) * Height() * pixelArea);
+  double drawnArea = 0.;
+
+  for (auto i = 0; i < mFrameRegions.Size(); i++)
+    drawnArea += mFrameRegions.Get(i).Area();
+
+  // drawing classes that present less than the whole window report it in EndFrame()
+  mFramePixelsPresented = windowPixels;
+
+  const double startTime = GetTimestamp();
+
+  BeginFrame();
+
+  for (auto i = 0; i < mFrameRegions.Size(); i++)
+    Draw(mFrameRegions.Get(i), scale);
+
   EndFrame();
+
+  mFrameStats.mDrawTime += GetTimestamp() - startTime;
+  mFrameStats.mNumFrames++;
+  mFrameStats.mPixelsDrawn += static_cast<int64_t>(drawnArea * pixelArea);
+  mFrameStats.mPixelsPresented += mFramePixelsPresented;
+  mFrameStats.mPixelsWindow += windowPixels;
 }
 
 void IGraphics::SetStrictDrawing(bool strict)
@@ -2476,16 +2499,26 @@ void IGraphics::DrawGrid(const IColor& color, const IRECT& bounds, float gridSiz
   PathStroke(color, thickness, IStrokeOptions(), pBlend);
 }
 
-void IGraphics::DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness, bool fill)
+void IGraphics::DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness, bool fill, bool decimate)
 {
   if (nPoints == 0)
     return;
   
   PathClear();
   
-  float xPos = bounds.L;
+  const float pixelScale = GetBackingPixelScale();
+  const int nColumns = static_cast<int>(std::ceil(bounds.W() * pixelScale));
+
+  // a decimated column emits up to four points, so it only pays off with many more points than that
+  if (decimate && nPoints > 4 * nColumns)
+  {
+    PathDecimatedData(bounds, normYPoints, nPoints, normXPoints, pixelScale);
+  }
+  else
+  {
+    float xPos = bounds.L;
 
-  PathMoveTo(xPos, bounds.B - (bounds.H() * normYPoints[0]));
+    PathMoveTo(xPos, bounds.B - (bounds.H() * normYPoints[0]));
 
     for (auto i = 1; i < nPoints; i++)
     {
@@ -2496,6 +2529,7 @@ void IGraphics::DrawData(const IColor& color, const IRECT& bounds, float* normYP
       
       PathLineTo(xPos, bounds.B - (bounds.H() * normYPoints[i]));
     }
+  }
     
   if(fill) {
     PathLineTo(bounds.R, bounds.B);
@@ -2509,6 +2543,68 @@ void IGraphics::DrawData(const IColor& color, const IRECT& bounds, float* normYP
     
   }
   
+  void IGraphics::PathDecimatedData(const IRECT& bounds, const float* normYPoints, int nPoints, const float* normXPoints, float pixelScale)
+  {
+    auto getX = [&](int i) {
+      if (i == 0)
+        return bounds.L;
+      else if (normXPoints)
+        return bounds.L + (bounds.W() * normXPoints[i]);
+      else
+        return bounds.L + ((bounds.W() / (float) (nPoints - 1) * i));
+    };
+
+    auto getY = [&](int i) {
+      return bounds.B - (bounds.H() * normYPoints[i]);
+    };
+
+    bool started = false;
+    int column = 0, first = 0, last = 0, minIdx = 0, maxIdx = 0;
+
+    // emit the first, min, max and last points of a pixel column, in the order they occur
+    auto flushColumn = [&]() {
+      int idx[4] = {first, std::min(minIdx, maxIdx), std::max(minIdx, maxIdx), last};
+
+      for (auto j = 0; j < 4; j++)
+      {
+        if (j > 0 && idx[j] == idx[j - 1])
+          continue;
+
+        if (started)
+          PathLineTo(getX(idx[j]), getY(idx[j]));
+        else
+          PathMoveTo(getX(idx[j]), getY(idx[j]));
+
+        started = true;
+      }
+    };
+
+    for (auto i = 0; i < nPoints; i++)
+    {
+      const int pointColumn = static_cast<int>(std::floor((getX(i) - bounds.L) * pixelScale));
+
+      if (i == 0 || pointColumn != column)
+      {
+        if (i > 0)
+          flushColumn();
+
+        column = pointColumn;
+        first = minIdx = maxIdx = i;
+      }
+      else
+      {
+        if (normYPoints[i] < normYPoints[minIdx])
+          minIdx = i;
+        if (normYPoints[i] > normYPoints[maxIdx])
+          maxIdx = i;
+      }
+
+      last = i;
+    }
+
+    flushColumn();
+  }
+
   void IGraphics::DrawDottedLine(const IColor& color, float x1, float y1, float x2, float y2, const IBlend* pBlend, float thickness, float dashLen)
   {
     PathClear();
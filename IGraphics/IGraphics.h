@@ -504,8 +504,11 @@ public:
    * @param nPoints The number of points in the normYPoints / normXPoints
    * @param normXPoints Optional normailzed X positions of the points
    * @param pBlend Optional blend method
-   * @param thickness Optional line thickness */
-  virtual void DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints = nullptr, const IBlend* pBlend = 0, float thickness = 1.f, bool fill = false);
+   * @param thickness Optional line thickness
+   * @param fill Fill the area below the line
+   * @param decimate If \c true and there are many more points than pixel columns (at the backing scale), the points in each column
+   * are reduced to the first, minimum, maximum and last, which looks the same for waveform displays but makes a much shorter path */
+  virtual void DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints = nullptr, const IBlend* pBlend = 0, float thickness = 1.f, bool fill = false, bool decimate = false);
   
   /** Load a font to be used by the graphics context
    * @param fontID A CString that will be used to reference the font
@@ -781,6 +784,9 @@ private:
   IPattern GetSVGPattern(const NSVGpaint& paint, float opacity);
 
   void DoDrawSVG(const ISVG& svg, const IBlend* pBlend = nullptr, const IColor* pStrokeColor = nullptr, const IColor* pFillColor = nullptr);
+
+  /** Build the path for DrawData() from the first, minimum, maximum and last point of each pixel column */
+  void PathDecimatedData(const IRECT& bounds, const float* normYPoints, int nPoints, const float* normXPoints, float pixelScale);
   
   /** Prepare a particular area of the display for drawing, normally resulting in clipping of the region.
    * @param bounds The rectangular region to prepare  */
@@ -1098,6 +1104,11 @@ public:
    * @param strict Set /c true to enable strict drawing mode */
   void SetStrictDrawing(bool strict);
 
+  /** Set the estimated cost of drawing each dirty region, as an area in points. Each region visits every control, so when
+   * many small regions are dirty it can be cheaper to draw their bounds once, see IRECTList::Optimize()
+   * @param cost The cost of a region, 0. to only merge regions when their bounds are no larger than they are */
+  void SetDrawRegionCost(float cost) { mDrawRegionCost = cost; }
+
   /* Enables layout on resize. This means IGEditorDelegate:LayoutUI() will be called when the GUI is resized */
   void SetLayoutOnResize(bool layoutOnResize);
 
@@ -1369,6 +1380,13 @@ public:
   
   /** @return \c true if performance display is shown */
   bool ShowingFPSDisplay() { return mPerfDisplay != nullptr; }
+
+  /** @return Counts of the frames drawn and the pixels drawn and presented since the last call to ResetFrameStats(), to
+   * check how much of the window is being redrawn and whether the drawing backend presents only the dirty regions,
+   * and the time spent drawing them */
+  const IFrameStats& GetFrameStats() const { return mFrameStats; }
+
+  void ResetFrameStats() { mFrameStats = IFrameStats(); }
   
   /** Attach an IControl to the graphics context and add it to the top of the control stack. The control is owned by the graphics context and will be deleted when the context is deleted.
    * @param pControl A pointer to an IControl to attach.
@@ -1801,6 +1819,14 @@ protected:
    * @param ty Output y translation for rotation center */
   void CalculateTextRotation(const IText& text, const IRECT& bounds, IRECT& rect, double& tx, double& ty) const;
   
+  /** @return The regions being drawn in the current frame, pixel aligned, valid from BeginFrame() to EndFrame(). Drawing
+   * classes can use these in EndFrame() to only present what was redrawn */
+  const IRECTList& GetFrameRegions() const { return mFrameRegions; }
+
+  /** Called in EndFrame() by drawing classes that present less than the whole window
+   * @param pixels The area presented for the current frame, in backing pixels */
+  void SetPixelsPresented(int64_t pixels) { mFramePixelsPresented = pixels; }
+
   /** @return The combined scale factor for backing pixels (screen scale * draw scale) */
   virtual float GetBackingPixelScale() const { return GetScreenScale() * GetDrawScale(); };
 
@@ -1859,6 +1885,7 @@ private:
   int mLastClickedParam = kNoParameter;
   bool mEnableMouseOver = false;
   bool mStrict = false;
+  float mDrawRegionCost = 1024.f;
   bool mEnableTooltips = false;
   bool mShowControlBounds = false;
   bool mShowAreaDrawn = false;
@@ -1867,6 +1894,9 @@ private:
   bool mEnableMultiTouch = false;
   EUIResizerMode mGUISizeMode = EUIResizerMode::Scale;
   double mPrevTimestamp = 0.;
+  IRECTList mFrameRegions;
+  IFrameStats mFrameStats;
+  int64_t mFramePixelsPresented = 0;
   IKeyHandlerFunc mKeyHandlerFunc = nullptr;
   IDisplayTickFunc mDisplayTickFunc = nullptr;
   IUIAppearanceChangedFunc mAppearanceChangedFunc = nullptr;
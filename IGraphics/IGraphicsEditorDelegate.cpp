@@ -33,10 +33,14 @@ void* IGEditorDelegate::OpenWindow(void* pParent)
       GetUI()->Resize(mLastWidth, mLastHeight, mLastScale);
   }
   
-  if(mGraphics)
-    return mGraphics->OpenWindow(pParent);
-  else
-    return nullptr;
+  // set first, so that nothing sent from the processor after OnUIOpen() has sent the current values is missed
+  SetEditorOpen(true);
+  void* pView = mGraphics ? mGraphics->OpenWindow(pParent) : nullptr;
+
+  if (!pView)
+    SetEditorOpen(false);
+
+  return pView;
 }
 
 void IGEditorDelegate::CloseWindow()
@@ -16,6 +16,7 @@
  * @{
  */
 
+#include <algorithm>
 #include <functional>
 #include <chrono>
 #include <numeric>
@@ -1894,103 +1895,147 @@ public:
     return true;
   }
   
-  /** Remove rects that are contained by other rects and intersections and merge any rects that can be merged */
-  void Optimize()
+  /** Replace the rects with non-overlapping rects covering the same area, merging rects that line up. This is a sweep
+   * over the horizontal edges: the rects covering the current band are kept sorted by L, with a heap ordered by B to find
+   * those that end. Each rect is added and removed once in O(log n), and each band costs its number of rects, so rows and
+   * grids of controls are O(n log n).
+   * @param regionCost The estimated cost of drawing one more rect, as an area. If the merged rects cost more to draw than
+   * their bounds, they are replaced by the bounds */
+  void Optimize(float regionCost = 0.f)
   {
-    for (int i = 0; i < Size(); i++)
+    struct Span
     {
-      for (int j = i + 1; j < Size(); j++)
+      float L, R;
+      int idx; // the output rect being extended down by this span
+    };
+
+    std::vector<float> edges;
+    std::vector<int> order;
+
+    // rects without area, including Empty() ones, cover nothing
+    for (auto i = 0; i < Size(); i++)
+    {
+      if (Get(i).W() > 0.f && Get(i).H() > 0.f)
       {
-        if (Get(i).Contains(Get(j)))
-        {
-          mRects.Delete(j);
-          j--;
-        }
-        else if (Get(j).Contains(Get(i)))
-        {
-          mRects.Delete(i);
-          i--;
-          break;
-        }
-        else if (Get(i).Intersects(Get(j)))
-        {
-          IRECT intersection = Get(i).Intersect(Get(j));
-            
-          if (Get(i).Mergeable(intersection))
-            Set(i, Shrink(Get(i), intersection));
-          else if (Get(j).Mergeable(intersection))
-            Set(j, Shrink(Get(j), intersection));
-          else if (Get(i).Area() < Get(j).Area())
-            Set(i, Split(Get(i), intersection));
-          else
-            Set(j, Split(Get(j), intersection));
-        }
+        edges.push_back(Get(i).T);
+        edges.push_back(Get(i).B);
+        order.push_back(i);
       }
     }
-    
-    for (int i = 0; i < Size(); i++)
+
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    std::sort(order.begin(), order.end(), [this](int a, int b) { return Get(a).T < Get(b).T; });
+
+    auto byL = [this](int a, int b) { return Get(a).L < Get(b).L; };
+    auto laterB = [this](int a, int b) { return Get(a).B > Get(b).B; };
+
+    std::vector<IRECT> merged;
+    std::vector<int> active; // sorted by L
+    std::vector<int> ending; // a min-heap on B of the active rects
+    std::vector<int> entering;
+    std::vector<Span> spans, open, nextOpen;
+    size_t nextRect = 0;
+    float mergedArea = 0.f;
+
+    // each band between two edges is covered by the same rects, their union is a sorted list of spans
+    for (size_t e = 0; e + 1 < edges.size(); e++)
     {
-      for (int j = i + 1; j < Size(); j++)
+      const float y0 = edges[e];
+      const float y1 = edges[e + 1];
+
+      // only the rects that start or end at y0 change the active list
+      bool anyEnded = false;
+
+      while (!ending.empty() && Get(ending.front()).B <= y0)
       {
-        if (Get(i).Mergeable(Get(j)))
-        {
-          Set(j, Get(i).Union(Get(j)));
-          mRects.Delete(i);
-          i = -1;
-          break;
-        }
+        std::pop_heap(ending.begin(), ending.end(), laterB);
+        ending.pop_back();
+        anyEnded = true;
       }
-    }
-  }
-  
-private:
-  /** Shrinks a rectangle by removing the intersection area
-   * @param r The original rectangle
-   * @param i The intersection rectangle to remove
-   * @return The remaining portion of the original rectangle */
-  IRECT Shrink(const IRECT &r, const IRECT &i)
-  {
-    if (i.L != r.L)
-      return IRECT(r.L, r.T, i.L, r.B);
-    if (i.T != r.T)
-      return IRECT(r.L, r.T, r.R, i.T);
-    if (i.R != r.R)
-      return IRECT(i.R, r.T, r.R, r.B);
-    return IRECT(r.L, i.B, r.R, r.B);
-  }
-  
-  /** Splits a rectangle around an intersection, adding one part to the list
-   * @param r The rectangle to split
-   * @param i The intersection rectangle
-   * @return The remaining portion after adding the split part to the list */
-  IRECT Split(const IRECT r, const IRECT &i)
-  {
-    if (r.L == i.L)
-    {
-      if (r.T == i.T)
+
+      if (anyEnded)
+        active.erase(std::remove_if(active.begin(), active.end(), [this, y0](int i) { return Get(i).B <= y0; }), active.end());
+
+      entering.clear();
+
+      while (nextRect < order.size() && Get(order[nextRect]).T <= y0)
       {
-        Add(IRECT(i.R, r.T, r.R, i.B));
-        return IRECT(r.L, i.B, r.R, r.B);
+        const int i = order[nextRect++];
+        entering.push_back(i);
+        ending.push_back(i);
+        std::push_heap(ending.begin(), ending.end(), laterB);
       }
-      else
+
+      if (!entering.empty())
       {
-        Add(IRECT(r.L, r.T, r.R, i.T));
-        return IRECT(i.R, i.T, r.R, r.B);
+        std::sort(entering.begin(), entering.end(), byL);
+        const auto nActive = active.size();
+        active.insert(active.end(), entering.begin(), entering.end());
+        std::inplace_merge(active.begin(), active.begin() + nActive, active.end(), byL);
       }
+
+      spans.clear();
+
+      for (auto i : active)
+      {
+        const IRECT& r = Get(i);
+
+        if (!spans.empty() && r.L <= spans.back().R)
+          spans.back().R = std::max(spans.back().R, r.R);
+        else
+          spans.push_back({r.L, r.R, -1});
+      }
+
+      // a span that matches one of the band above extends its rect, both lists are sorted
+      auto o = 0;
+
+      for (auto span : spans)
+      {
+
+        while (o < static_cast<int>(open.size()) && open[o].L < span.L)
+          o++;
+
+        if (o < static_cast<int>(open.size()) && open[o].L == span.L && open[o].R == span.R)
+        {
+          span.idx = open[o].idx;
+          merged[span.idx].B = y1;
+        }
+        else
+        {
+          span.idx = static_cast<int>(merged.size());
+          merged.push_back(IRECT(span.L, y0, span.R, y1));
+        }
+
+        mergedArea += (span.R - span.L) * (y1 - y0);
+        nextOpen.push_back(span);
+      }
+
+      open.swap(nextOpen);
+      nextOpen.clear();
     }
-    
-    if (r.T == i.T)
-    {
-      Add(IRECT(r.L, r.T, i.L, i.B));
-      return IRECT(r.L, i.B, r.R, r.B);
-    }
-    else
+
+    if (merged.size() > 1)
     {
-      Add(IRECT(r.L, r.T, r.R, i.T));
-      return IRECT(r.L, i.T, i.L, r.B);
+      IRECT bounds = merged[0];
+
+      for (const auto& r : merged)
+        bounds = bounds.Union(r);
+
+      if (bounds.Area() + regionCost <= mergedArea + regionCost * merged.size())
+      {
+        merged.resize(1);
+        merged[0] = bounds;
+      }
     }
+
+    mRects.Resize(static_cast<int>(merged.size()));
+
+    for (auto i = 0; i < Size(); i++)
+      Set(i, merged[i]);
   }
   
+private:
   WDL_TypedBuf<IRECT> mRects;
 };
 
@@ -2398,6 +2443,16 @@ struct IShadow
   bool mDrawForeground = true;
 };
 
+/** Counts of the frames drawn by an IGraphics context, see IGraphics::GetFrameStats(). Areas are in backing pixels */
+struct IFrameStats
+{
+  int64_t mNumFrames = 0; // The number of calls to IGraphics::Draw() that drew something
+  int64_t mPixelsDrawn = 0; // The total area of the regions redrawn
+  int64_t mPixelsPresented = 0; // The total area copied or invalidated to get the frames on screen
+  int64_t mPixelsWindow = 0; // The total area of the window for the same frames, i.e. what a full present would cost
+  double mDrawTime = 0.; // The total time in seconds spent drawing and presenting the frames
+};
+
 /** Contains a set of 9 colors used to theme IVControls */
 struct IVColorSpec
 {
@@ -41,7 +41,7 @@ void AAX_CEffectGUI_IPLUG::CreateViewContainer()
   
   if (pWindow && mPlug->HasUI())
   {
-    mPlug->OpenWindow(pWindow);
+    mPlug->OpenEditorWindow(pWindow);
     
     IPlugAAXView_Interface* pViewInterface = (IPlugAAXView_Interface*) mPlug->GetAAXViewInterface();
     
@@ -52,7 +52,7 @@ void AAX_CEffectGUI_IPLUG::CreateViewContainer()
 
 void AAX_CEffectGUI_IPLUG::DeleteViewContainer() 
 {
-  mPlug->CloseWindow();
+  mPlug->CloseEditorWindow();
 }
 
 AAX_Result AAX_CEffectGUI_IPLUG::GetViewSize(AAX_Point* pNewViewSize) const
@@ -275,7 +275,7 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo, const TParamValPai
     {
       IMidiMsg msg(pMidiPacket->mTimestamp, pMidiPacket->mData[0], pMidiPacket->mData[1], pMidiPacket->mData[2]);
       ProcessMidiMsg(msg);
-      mMidiMsgsFromProcessor.Push(msg);
+      QueueMidiMsgForEditor(msg);
     }
   }
   
@@ -454,7 +454,7 @@ AAX_Result IPlugAAX::GetChunkSize(AAX_CTypeID chunkID, uint32_t* pSize) const
     
     //IByteChunk::InitChunkWithIPlugVer(&IPlugChunk);
     
-    if (SerializeState(chunk))
+    if (SerializeStateCached(chunk))
     {
       *pSize = chunk.Size();
     }
@@ -478,7 +478,7 @@ AAX_Result IPlugAAX::GetChunk(AAX_CTypeID chunkID, AAX_SPlugInChunk* pChunk) con
     
     //IByteChunk::InitChunkWithIPlugVer(&IPlugChunk); // TODO: IPlugVer should be in chunk!
     
-    if (SerializeState(chunk))
+    if (SerializeStateCached(chunk))
     {
       pChunk->fSize = chunk.Size();
       memcpy(pChunk->fData, chunk.GetData(), chunk.Size());
@@ -500,12 +500,17 @@ AAX_Result IPlugAAX::SetChunk(AAX_CTypeID chunkID, const AAX_SPlugInChunk* pChun
     chunk.PutBytes(pChunk->fData, pChunk->fSize);
     int pos = 0;
     //IByteChunk::GetIPlugVerFromChunk(chunk, pos); // TODO: IPlugVer should be in chunk!
-    pos = UnserializeState(chunk, pos);
+    bool restored = false;
+    pos = UnserializeStateIfChanged(chunk, pos, restored);
     
-    for (int i = 0; i< NParams(); i++)
-      SetParameterNormalizedValue(mParamIDs.Get(i)->Get(), GetParam(i)->GetNormalized());
+    if (restored)
+    {
+      for (int i = 0; i< NParams(); i++)
+        SetParameterNormalizedValue(mParamIDs.Get(i)->Get(), GetParam(i)->GetNormalized());
+      
+      OnRestoreState();
+    }
     
-    OnRestoreState();
     mNumPlugInChanges++; // necessary in order to cause CompareActiveChunk() to get called again and turn off the compare light 
     
     return AAX_SUCCESS;
@@ -524,7 +529,7 @@ AAX_Result IPlugAAX::CompareActiveChunk(const AAX_SPlugInChunk* pChunk, AAX_CBoo
     return AAX_SUCCESS;
   }
 
-  *pIsEqual = CompareState((const unsigned char*) pChunk->fData, 0);
+  *pIsEqual = IsCurrentState((const uint8_t*) pChunk->fData, pChunk->fSize) || CompareState((const unsigned char*) pChunk->fData, 0);
     
   return AAX_SUCCESS;
 }
@@ -606,6 +611,7 @@ void IPlugAAX::SetLatency(int latency)
   Controller()->SetSignalLatency(latency);
   
   IPlugProcessor::SetLatency(latency); // will update delay time
+  SignalIdleWork();
 }
 
 bool IPlugAAX::SendMidiMsg(const IMidiMsg& msg)
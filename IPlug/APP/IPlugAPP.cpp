@@ -157,7 +157,7 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
     while (mMidiMsgsFromCallback.Pop(msg))
     {
       ProcessMidiMsg(msg);
-      mMidiMsgsFromProcessor.Push(msg); // queue incoming MIDI for UI
+      QueueMidiMsgForEditor(msg); // queue incoming MIDI for UI
     }
   }
   
@@ -169,7 +169,7 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
     {
       ISysEx msg { data.mOffset, data.mData, data.mSize };
       ProcessSysEx(msg);
-      mSysExDataFromProcessor.Push(data); // queue incoming Sysex for UI
+      QueueSysExForEditor(data.mOffset, data.mSize, data.mData); // queue incoming Sysex for UI
     }
   }
   
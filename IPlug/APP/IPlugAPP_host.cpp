@@ -75,12 +75,12 @@ bool IPlugAPPHost::Init()
 
 bool IPlugAPPHost::OpenWindow(HWND pParent)
 {
-  return mIPlug->OpenWindow(pParent) != nullptr;
+  return mIPlug->OpenEditorWindow(pParent) != nullptr;
 }
 
 void IPlugAPPHost::CloseWindow()
 {
-  mIPlug->CloseWindow();
+  mIPlug->CloseEditorWindow();
 }
 
 bool IPlugAPPHost::InitState()
@@ -1461,7 +1461,7 @@ OSStatus IPlugAU::GetState(CFPropertyListRef* ppPropList)
   IByteChunk chunk;
   //InitChunkWithIPlugVer(&IPlugChunk); // TODO: IPlugVer should be in chunk!
 
-  if (SerializeState(chunk))
+  if (SerializeStateCached(chunk))
   {
     PutDataInDict(pDict, kAUPresetDataKey, &chunk);
   }
@@ -1920,12 +1920,14 @@ void IPlugAU::InformHostOfPresetChange()
 {
   //InformListeners(kAudioUnitProperty_CurrentPreset, kAudioUnitScope_Global);
   InformListeners(kAudioUnitProperty_PresentPreset, kAudioUnitScope_Global);
+  SignalIdleWork();
 }
 
 void IPlugAU::InformHostOfParameterDetailsChange()
 {
   InformListeners(kAudioUnitProperty_ParameterList, kAudioUnitScope_Global);
   InformListeners(kAudioUnitProperty_ParameterInfo, kAudioUnitScope_Global);
+  SignalIdleWork();
 }
 
 void IPlugAU::PreProcess()
@@ -2011,6 +2013,7 @@ void IPlugAU::SetLatency(int samples)
   TRACE
   InformListeners(kAudioUnitProperty_Latency, kAudioUnitScope_Global);
   IPlugProcessor::SetLatency(samples);
+  SignalIdleWork();
 }
 
 bool IPlugAU::SendMidiMsg(const IMidiMsg& msg)
@@ -2460,7 +2463,7 @@ OSStatus IPlugAU::DoMIDIEvent(IPlugAU* _this, UInt32 inStatus, UInt32 inData1, U
     msg.mData2 = inData2;
     msg.mOffset = inOffsetSampleFrame;
     _this->ProcessMidiMsg(msg);
-    _this->mMidiMsgsFromProcessor.Push(msg);
+    _this->QueueMidiMsgForEditor(msg);
     return noErr;
   }
   else
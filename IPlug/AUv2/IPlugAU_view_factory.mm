@@ -55,9 +55,9 @@ static const AudioUnitPropertyID kIPlugObjectPropertyID = UINT32_MAX-100;
       if (mPlug->HasUI())
       {
 #if __has_feature(objc_arc)
-        NSView* pView = (__bridge NSView*) mPlug->OpenWindow(nullptr);
+        NSView* pView = (__bridge NSView*) mPlug->OpenEditorWindow(nullptr);
 #else
-        NSView* pView = (NSView*) mPlug->OpenWindow(nullptr);
+        NSView* pView = (NSView*) mPlug->OpenEditorWindow(nullptr);
 #endif
         return pView;
       }
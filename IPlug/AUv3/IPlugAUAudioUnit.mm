@@ -781,7 +781,7 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
 
   IByteChunk chunk;
 //  IByteChunk::InitChunkWithIPlugVer(chunk);
-  mPlug->SerializeState(chunk);
+  mPlug->SerializeStateCached(chunk);
   NSMutableData* pData = [[NSMutableData alloc] init];
   [pData replaceBytesInRange:NSMakeRange (0, chunk.Size()) withBytes:chunk.GetData()];
   [pDict setValue:pData forKey:[NSString stringWithUTF8String:kAUPresetDataKey]];
@@ -799,7 +799,8 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
   chunk.PutBytes([pData bytes], static_cast<int>([pData length]));
   int pos = 0;
 //  IByteChunk::GetIPlugVerFromChunk(chunk, pos);
-  mPlug->UnserializeState(chunk, pos);
+  bool restored = false;
+  mPlug->UnserializeStateIfChanged(chunk, pos, restored);
 #endif
   
 //  [super setFullState: newFullState]; // this hangs auval
@@ -870,14 +871,14 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
 
 - (PLATFORM_VIEW*) openWindow: (PLATFORM_VIEW*) pParent
 {
-  PLATFORM_VIEW* pView = (__bridge PLATFORM_VIEW*) mPlug->OpenWindow((__bridge void*) pParent);
+  PLATFORM_VIEW* pView = (__bridge PLATFORM_VIEW*) mPlug->OpenEditorWindow((__bridge void*) pParent);
 
   return pView;
 }
 
 - (void) closeWindow
 {
-  mPlug->CloseWindow();
+  mPlug->CloseEditorWindow();
 }
 
 - (NSInteger) width
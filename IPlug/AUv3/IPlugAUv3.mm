@@ -150,7 +150,7 @@ void IPlugAUv3::ProcessWithEvents(AudioTimeStamp const* pTimestamp, uint32_t fra
 
         midiMsg = {static_cast<int>(midiEvent.eventSampleTime - now), midiEvent.data[0], midiEvent.data[1], midiEvent.data[2] };
         ProcessMidiMsg(midiMsg);
-        mMidiMsgsFromProcessor.Push(midiMsg);
+        QueueMidiMsgForEditor(midiMsg);
       }
       break;
 
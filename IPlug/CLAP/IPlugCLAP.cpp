@@ -127,6 +127,8 @@ void IPlugCLAP::SetLatency(int samples)
       runOnMainThread([&](){ if (!isBeingDestroyed()) GetClapHost().latencyChanged(); });
     }
   }
+
+  SignalIdleWork();
 }
 
 bool IPlugCLAP::SendMidiMsg(const IMidiMsg& msg)
@@ -412,7 +414,7 @@ bool IPlugCLAP::stateSave(const clap_ostream* pStream) noexcept
 {
   IByteChunk chunk;
   
-  if (!SerializeState(chunk))
+  if (!SerializeStateCached(chunk))
     return false;
   
   return pStream->write(pStream, chunk.GetData(), chunk.Size()) == chunk.Size();
@@ -432,9 +434,10 @@ bool IPlugCLAP::stateLoad(const clap_istream* pStream) noexcept
   if (bytesRead != 0)
     return false;
       
-  bool restoredOK = UnserializeState(chunk, 0) >= 0;
+  bool restored = false;
+  bool restoredOK = UnserializeStateIfChanged(chunk, 0, restored) >= 0;
   
-  if (restoredOK)
+  if (restoredOK && restored)
     OnRestoreState();
   
   return restoredOK;
@@ -540,7 +543,7 @@ void IPlugCLAP::ProcessInputEvents(const clap_input_events* pInputEvents) noexce
           auto velocity = static_cast<int>(std::round(pNote->velocity * 127.0));
           msg.MakeNoteOnMsg(pNote->key, velocity, pEvent->time, pNote->channel);
           ProcessMidiMsg(msg);
-          mMidiMsgsFromProcessor.Push(msg);
+          QueueMidiMsgForEditor(msg);
           break;
         }
           
@@ -549,7 +552,7 @@ void IPlugCLAP::ProcessInputEvents(const clap_input_events* pInputEvents) noexce
           auto pNote = ClapEventCast<clap_event_note>(pEvent);
           msg.MakeNoteOffMsg(pNote->key, pEvent->time, pNote->channel);
           ProcessMidiMsg(msg);
-          mMidiMsgsFromProcessor.Push(msg);
+          QueueMidiMsgForEditor(msg);
           break;
         }
           
@@ -558,7 +561,7 @@ void IPlugCLAP::ProcessInputEvents(const clap_input_events* pInputEvents) noexce
           auto pMidiEvent = ClapEventCast<clap_event_midi>(pEvent);
           msg = IMidiMsg(pEvent->time, pMidiEvent->data[0], pMidiEvent->data[1], pMidiEvent->data[2]);
           ProcessMidiMsg(msg);
-          mMidiMsgsFromProcessor.Push(msg);
+          QueueMidiMsgForEditor(msg);
           break;
         }
           
@@ -567,7 +570,7 @@ void IPlugCLAP::ProcessInputEvents(const clap_input_events* pInputEvents) noexce
           auto pSysexEvent = ClapEventCast<clap_event_midi_sysex>(pEvent);
           ISysEx sysEx(pEvent->time, pSysexEvent->buffer, pSysexEvent->size);
           ProcessSysEx(sysEx);
-          mSysExDataFromProcessor.PushFromArgs(sysEx.mOffset, sysEx.mSize, sysEx.mData);
+          QueueSysExForEditor(sysEx.mOffset, sysEx.mSize, sysEx.mData);
           break;
         }
           
@@ -881,7 +884,7 @@ bool IPlugCLAP::guiCreate(const char* api, bool isFloating) noexcept
 
 void IPlugCLAP::guiDestroy() noexcept
 {
-  CloseWindow();
+  CloseEditorWindow();
   mGUIOpen = false;
   mWindow = nullptr;
 }
@@ -890,7 +893,7 @@ bool IPlugCLAP::guiShow() noexcept
 {
   if (HasUI() && !mGUIOpen)
   {
-    OpenWindow(mWindow);
+    OpenEditorWindow(mWindow);
     return true;
   }
   else
@@ -903,7 +906,7 @@ bool IPlugCLAP::guiHide() noexcept
 {
   if (HasUI())
   {
-    CloseWindow();
+    CloseEditorWindow();
     mGUIOpen = false;
     return true;
   }
@@ -952,7 +955,7 @@ bool IPlugCLAP::GUIWindowAttach(void* pWindow) noexcept
 {
   if (HasUI())
   {
-    OpenWindow(pWindow);
+    OpenEditorWindow(pWindow);
     mWindow = pWindow;
     mGUIOpen = true;
     return true;
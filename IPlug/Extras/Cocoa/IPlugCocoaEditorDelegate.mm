@@ -30,11 +30,13 @@ void* CocoaEditorDelegate::OpenWindow(void* pParent)
   mViewController = vc;
 #endif
   
+  SetEditorOpen(true);
   return pParent;
 }
 
 void CocoaEditorDelegate::CloseWindow()
 {
+  SetEditorOpen(false);
   mViewController = nil;
 }
 
@@ -11,40 +11,61 @@
 
 #include "denormal.h"
 #include "IPlugConstants.h"
+#include "SIMDLane.h"
 
 BEGIN_IPLUG_NAMESPACE
 
+/** Multi-channel DC blocker. The one pole/one zero state of each channel is held in contiguous arrays so that when
+ * IPLUG_SIMDE is defined several channels are processed per instruction (see SIMDLane.h)
+ * @tparam T the sample type
+ * @tparam NC the maximum number of channels */
 template<typename T, int NC = 1>
 class DCBlocker
 {
 private:
-  // one pole IIR
-  // y[n] = x[n] + a[n] * y[n-1]
-  class rpole {
-    T y_m1 = 0;
-  public:
-    inline T process(T x, T a) { 
-      const T y = y_m1 = x + a * y_m1;
-      denormal_fix(&y_m1);
-      return y;
-    }
-  };
-
-  // one zero FIR
-  // y[n] = x[n] - b[n] * x[n-1]
-  class rzero {
-    T x_m1 = 0;
-  public:
-    inline T process(T x, T b) {
-      const T y = x - b * x_m1;
-      x_m1 = x;
-      denormal_fix(&x_m1);
-      return y;
+  using Lane = SIMDLane<T>;
+  static constexpr int kLaneWidth = Lane::kWidth;
+
+  // one zero FIR followed by one pole IIR
+  // y[n] = x[n] - b * x[n-1]
+  // y[n] = x[n] + a * y[n-1]
+  alignas(32) T mX1[NC] = {};
+  alignas(32) T mY1[NC] = {};
+
+  template <typename L>
+  inline void ProcessLanes(T** inputs, T** outputs, int startChan, int nFrames)
+  {
+    using LV = typename L::Type;
+    constexpr int W = L::kWidth;
+
+    const LV a = L::Set1(T(0.995));
+    const LV b = L::Set1(T(1.0));
+
+    LV x1 = L::Load(mX1 + startChan);
+    LV y1 = L::Load(mY1 + startChan);
+
+    alignas(32) T x[W], y[W];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto l = 0; l < W; l++)
+        x[l] = inputs[l][s];
+
+      const LV x0 = L::Load(x);
+      const LV z = L::Sub(x0, L::Mul(b, x1));
+      x1 = L::FlushDenormal(x0);
+      const LV y0 = L::Add(z, L::Mul(a, y1));
+      y1 = L::FlushDenormal(y0);
+
+      L::Store(y, y0);
+
+      for (auto l = 0; l < W; l++)
+        outputs[l][s] = y[l];
     }
-  };
 
-  rpole mPole[NC];
-  rzero mZero[NC];
+    L::Store(mX1 + startChan, x1);
+    L::Store(mY1 + startChan, y1);
+  }
 
 public:
 
@@ -52,14 +73,11 @@ public:
   {
     assert(nChans <= NC);
 
-    for (auto s=0; s<nFrames; s++)
-    {
-      for (auto c = 0; c < nChans; c++)
-      {
-        const auto x = inputs[c][s];
-        outputs[c][s] = mPole[c].process(mZero[c].process(x, T(1.0)), T(0.995));
-      }
-    }
+    auto c = 0;
+    for (; c + kLaneWidth <= nChans; c += kLaneWidth)
+      ProcessLanes<Lane>(inputs + c, outputs + c, c, nFrames);
+    for (; c < nChans; c++)
+      ProcessLanes<ScalarLane<T>>(inputs + c, outputs + c, c, nFrames);
   }
 
 } WDL_FIXALIGN;
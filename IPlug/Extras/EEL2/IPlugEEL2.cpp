@@ -0,0 +1,310 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "IPlugEEL2.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "eel2/ns-eel.h"
+
+using namespace iplug;
+
+#ifndef IPLUG_EEL2_NO_HOSTSTUBS
+// guards the compiler's global state, which is shared by every VM in the process
+static WDL_Mutex sEELMutex;
+
+void NSEEL_HOSTSTUB_EnterMutex() { sEELMutex.Enter(); }
+void NSEEL_HOSTSTUB_LeaveMutex() { sEELMutex.Leave(); }
+#endif
+
+/** One compiled script, with its own VM so that a replacement can be compiled and initialised while it runs */
+struct EEL2Processor::Program
+{
+  enum ESection { kInit = 0, kBlock, kSample, kNumSections };
+
+  Program(int nChans, int memorySize, const std::vector<ParamBinding>& bindings)
+  : mVM(NSEEL_VM_alloc())
+  {
+    char name[16];
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      snprintf(name, sizeof(name), "spl%d", c);
+      mSpl.push_back(NSEEL_VM_regvar(mVM, name));
+    }
+
+    mSrate = NSEEL_VM_regvar(mVM, "srate");
+    mSamplesBlock = NSEEL_VM_regvar(mVM, "samplesblock");
+
+    for (auto& binding : bindings)
+    {
+      mParams.push_back(binding.pParam);
+      mParamVars.push_back(NSEEL_VM_regvar(mVM, binding.varName.Get()));
+    }
+
+    NSEEL_VM_setramsize(mVM, memorySize);
+    NSEEL_VM_preallocram(mVM, -1);
+  }
+
+  ~Program()
+  {
+    // @init is freed last, as the other sections may call functions it defines
+    for (auto s = kNumSections - 1; s >= 0; s--)
+    {
+      if (mCode[s])
+        NSEEL_code_free(mCode[s]);
+    }
+
+    NSEEL_VM_free(mVM);
+  }
+
+  bool Compile(const char* script, WDL_String* pError)
+  {
+    WDL_String sections[kNumSections];
+    int firstLine[kNumSections] = {};
+    int section = kInit;
+    int line = 0;
+
+    for (const char* pLine = script; *pLine; line++)
+    {
+      const char* pEnd = strchr(pLine, '\n');
+      const int len = pEnd ? static_cast<int>(pEnd - pLine) : static_cast<int>(strlen(pLine));
+      const char* pText = pLine + strspn(pLine, " \t");
+
+      if (*pText == '@')
+      {
+        const int nameLen = static_cast<int>(strcspn(pText, " \t\r\n"));
+
+        if (nameLen == 5 && !strncmp(pText, "@init", 5)) section = kInit;
+        else if (nameLen == 6 && !strncmp(pText, "@block", 6)) section = kBlock;
+        else if (nameLen == 7 && !strncmp(pText, "@sample", 7)) section = kSample;
+        else
+        {
+          if (pError)
+            pError->SetFormatted(256, "line %d: unknown section %.*s", line + 1, nameLen, pText);
+          return false;
+        }
+
+        firstLine[section] = line + 1;
+      }
+      else
+      {
+        // WDL_String::Append() treats a length of 0 as the whole string
+        if (len)
+          sections[section].Append(pLine, len);
+
+        sections[section].Append("\n");
+      }
+
+      pLine = pEnd ? pEnd + 1 : pLine + len;
+    }
+
+    for (auto s = 0; s < kNumSections; s++)
+    {
+      if (!sections[s].GetLength())
+        continue;
+
+      // @sample leaves the FPU/SSE state to Process(), which sets it once per block rather than once per sample
+      const int flags = s == kInit ? NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS : s == kSample ? NSEEL_CODE_COMPILE_FLAG_NOFPSTATE : 0;
+      mCode[s] = NSEEL_code_compile_ex(mVM, sections[s].Get(), firstLine[s], flags);
+
+      // a section without code compiles to nullptr, without an error
+      const char* err = mCode[s] ? nullptr : NSEEL_code_getcodeerror(mVM);
+
+      if (err)
+      {
+        if (pError)
+          pError->Set(err);
+
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /** Run @init, on the thread that compiled the program or from OnReset() */
+  void Init(double sampleRate)
+  {
+    *mSrate = sampleRate;
+
+    if (mCode[kInit])
+      NSEEL_code_execute(mCode[kInit]);
+  }
+
+  void Process(sample** inputs, int nInputs, sample** outputs, int nOutputs, int nFrames)
+  {
+    const int nChans = static_cast<int>(mSpl.size());
+
+    for (size_t i = 0; i < mParams.size(); i++)
+    {
+      *mParamVars[i] = mParams[i]->Value();
+    }
+
+    *mSamplesBlock = nFrames;
+
+    if (mCode[kBlock])
+      NSEEL_code_execute(mCode[kBlock]);
+
+    NSEEL_CODEHANDLE sampleCode = mCode[kSample];
+    int fpState[2];
+    eel_enterfp(fpState);
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto c = 0; c < nChans; c++)
+        *mSpl[c] = c < nInputs ? static_cast<EEL_F>(inputs[c][s]) : 0.;
+
+      if (sampleCode)
+        NSEEL_code_execute(sampleCode);
+
+      for (auto c = 0; c < nOutputs; c++)
+        outputs[c][s] = static_cast<sample>(*mSpl[c]);
+    }
+
+    eel_leavefp(fpState);
+  }
+
+  NSEEL_VMCTX mVM;
+  NSEEL_CODEHANDLE mCode[kNumSections] = {};
+  // EEL_F_PTR, as EEL_F's alignment attribute would be dropped from the vectors' template argument
+  std::vector<EEL_F_PTR> mSpl;
+  EEL_F* mSrate;
+  EEL_F* mSamplesBlock;
+  std::vector<const IParam*> mParams;
+  std::vector<EEL_F_PTR> mParamVars;
+};
+
+EEL2Processor::EEL2Processor(int nInputChans, int nOutputChans)
+: mNInChans(nInputChans)
+, mNOutChans(nOutputChans)
+{
+}
+
+EEL2Processor::~EEL2Processor()
+{
+  delete mActive;
+  delete mPending.load();
+  delete mRetired.load();
+}
+
+void EEL2Processor::BindParam(const IParam* pParam, const char* varName)
+{
+  mBindings.push_back({pParam, WDL_String(varName)});
+}
+
+bool EEL2Processor::Compile(const char* script, WDL_String* pError)
+{
+  FreeRetiredProgram();
+
+  std::unique_ptr<Program> pProgram(new Program(NChans(), mMemorySize, mBindings));
+
+  if (!pProgram->Compile(script, pError))
+    return false;
+
+  // OnReset() can't change the sample rate between @init and queueing the program
+  WDL_MutexLock lock(&mResetMutex);
+  pProgram->Init(mSampleRate);
+
+  // if the audio thread hasn't picked up the last program yet, it never will
+  delete mPending.exchange(pProgram.release(), std::memory_order_acq_rel);
+  mHasProgram = true;
+  return true;
+}
+
+void EEL2Processor::FreeRetiredProgram()
+{
+  delete mRetired.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void EEL2Processor::OnReset(double sampleRate, int maxBlockSize)
+{
+  WDL_MutexLock lock(&mResetMutex);
+  mSampleRate = sampleRate;
+  mMaxBlockSize = maxBlockSize;
+  mFadeBuffer.assign(static_cast<size_t>(mNOutChans) * maxBlockSize, 0.);
+  mFadeOutputs.resize(mNOutChans);
+
+  for (auto c = 0; c < mNOutChans; c++)
+    mFadeOutputs[c] = mFadeBuffer.data() + c * maxBlockSize;
+
+  if (mActive)
+    mActive->Init(sampleRate);
+
+  // a queued program ran @init at the old sample rate. Only Compile() queues programs and it waits for the lock, so
+  // the slot is still empty when the program is put back
+  if (Program* pPending = mPending.exchange(nullptr, std::memory_order_acq_rel))
+  {
+    pPending->Init(sampleRate);
+    mPending.store(pPending, std::memory_order_release);
+  }
+}
+
+void EEL2Processor::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+{
+  Program* pPrevious = nullptr;
+
+  // swap only once the last replaced program has been collected, so there is always a free slot to hand it back in
+  if (!mRetired.load(std::memory_order_acquire))
+  {
+    if (Program* pProgram = mPending.exchange(nullptr, std::memory_order_acq_rel))
+    {
+      pPrevious = mActive;
+      mActive = pProgram;
+    }
+  }
+
+  if (!mActive)
+  {
+    for (auto c = 0; c < mNOutChans; c++)
+    {
+      if (c < mNInChans)
+      {
+        if (outputs[c] != inputs[c])
+          memcpy(outputs[c], inputs[c], nFrames * sizeof(sample));
+      }
+      else
+        memset(outputs[c], 0, nFrames * sizeof(sample));
+    }
+
+    return;
+  }
+
+  const int nFade = pPrevious ? std::min(nFrames, mMaxBlockSize) : 0;
+
+  // the previous program writes to the fade buffer first, as outputs may be the same buffers as inputs
+  if (nFade)
+    pPrevious->Process(inputs, mNInChans, mFadeOutputs.data(), mNOutChans, nFade);
+
+  mActive->Process(inputs, mNInChans, outputs, mNOutChans, nFrames);
+
+  if (nFade)
+  {
+    const sample step = sample(1) / static_cast<sample>(nFade);
+
+    for (auto c = 0; c < mNOutChans; c++)
+    {
+      const sample* pFrom = mFadeOutputs[c];
+      sample* pOut = outputs[c];
+
+      for (auto s = 0; s < nFade; s++)
+      {
+        const sample gain = static_cast<sample>(s + 1) * step;
+        pOut[s] = pFrom[s] + (pOut[s] - pFrom[s]) * gain;
+      }
+    }
+  }
+
+  // hand the previous program back only once it has finished, as the main thread may delete it straight away
+  if (pPrevious)
+    mRetired.store(pPrevious, std::memory_order_release);
+}
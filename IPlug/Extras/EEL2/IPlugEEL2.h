@@ -0,0 +1,125 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A DSP stage running JSFX style EEL2 scripts, compiled to native code by the WDL/eel2 JIT
+ *
+ * To use this class, add IPlugEEL2.cpp and the following files from WDL/eel2 to your project:
+ * nseel-caltab.c, nseel-cfunc.c, nseel-compiler.c, nseel-eval.c, nseel-lextab.c, nseel-ram.c, nseel-yylex.c
+ * plus the prebuilt code generator helpers for the target: asm-nseel-multi-macho.o on macOS, asm-nseel-x64.obj,
+ * asm-nseel-aarch64-msvc.obj or asm-nseel-arm64ec.obj on Windows. On Linux x86-64 assemble asm-nseel-x64-sse.asm with
+ * nasm -D AMD64ABI -f elf64. Defining EEL_TARGET_PORTABLE instead uses the EEL2 bytecode interpreter, without a JIT.
+ * The iPlug2::Extras::EEL2 CMake target does this, falling back to EEL_TARGET_PORTABLE on Linux x86-64.
+ *
+ * EEL2 needs the host to provide NSEEL_HOSTSTUB_EnterMutex() and NSEEL_HOSTSTUB_LeaveMutex(). IPlugEEL2.cpp defines
+ * them, unless IPLUG_EEL2_NO_HOSTSTUBS is defined because another EEL2 host in the binary already does.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "IPlugPlatform.h"
+#include "IPlugConstants.h"
+#include "IPlugParameter.h"
+#include "mutex.h"
+#include "wdlstring.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Processes audio with an EEL2 script, split into JSFX style sections:
+ * - \@init runs once the script is compiled, and again from OnReset()
+ * - \@block runs at the start of each block
+ * - \@sample runs for each sample frame
+ *
+ * Code before the first section is part of \@init. The variables spl0, spl1... hold the samples of each channel,
+ * srate holds the sample rate and samplesblock the number of frames in the block. IParams bound with BindParam() are
+ * copied to their variables before \@block.
+ *
+ * Compile() builds a new program on the calling thread, usually the main thread, and runs its \@init there too.
+ * ProcessBlock() swaps it in at the start of the next block, crossfading from the previous program over that block,
+ * so scripts can be edited while audio is running without clicks or dropouts. The audio thread never compiles,
+ * allocates, frees or runs \@init: the replaced program is handed back and deleted by the next Compile() or
+ * FreeRetiredProgram(), and OnReset() runs \@init again for the running program and for one waiting to be swapped in.
+ * Compile() and OnReset() may be called on different threads, but OnReset() must not run during ProcessBlock(). */
+class EEL2Processor
+{
+public:
+  static constexpr int kDefaultMemorySize = 4 * 65536;
+
+  /** @param nInputChans, nOutputChans The channels passed to ProcessBlock(). The script sees max(nInputChans, nOutputChans)
+   * splN variables, those without an input are set to 0 */
+  EEL2Processor(int nInputChans = 2, int nOutputChans = 2);
+  ~EEL2Processor();
+
+  EEL2Processor(const EEL2Processor&) = delete;
+  EEL2Processor& operator=(const EEL2Processor&) = delete;
+
+  /** Bind a parameter to a script variable. Bindings are used by the programs compiled after this call
+   * @param pParam The parameter, whose Value() is read at the start of each block
+   * @param varName The name of the variable in the script */
+  void BindParam(const IParam* pParam, const char* varName);
+
+  /** Set the number of values in the script's mem[] (and gmem[]) RAM, preallocated when a program is compiled so that
+   * the audio thread never allocates. Used by the programs compiled after this call */
+  void SetMemorySize(int nValues) { mMemorySize = nValues; }
+
+  /** Compile a script and queue it to replace the running program at the start of the next block.
+   * The previous program keeps running if compilation fails
+   * @param script The script source, with \@init, \@block and \@sample sections
+   * @param pError If not nullptr, set to the compiler error on failure
+   * @return \c true if the script compiled */
+  bool Compile(const char* script, WDL_String* pError = nullptr);
+
+  /** Delete the program replaced by the last swap, if any. Call this on the main thread, e.g. from OnIdle(),
+   * to release a replaced program without compiling again */
+  void FreeRetiredProgram();
+
+  /** @return \c true once a program has been compiled, even if it has not been swapped in yet */
+  bool HasProgram() const { return mHasProgram; }
+
+  /** Set the sample rate and the maximum block size, and run \@init again for the current program and the program
+   * waiting to be swapped in, if any. Call this from IPlugProcessor::OnReset(), while ProcessBlock() isn't running */
+  void OnReset(double sampleRate, int maxBlockSize);
+
+  /** Process a block with the current program. Without a program, inputs are copied to outputs */
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames);
+
+private:
+  struct Program;
+
+  int NChans() const { return std::max(mNInChans, mNOutChans); }
+
+  struct ParamBinding
+  {
+    const IParam* pParam;
+    WDL_String varName;
+  };
+
+  int mNInChans, mNOutChans;
+  int mMemorySize = kDefaultMemorySize;
+  bool mHasProgram = false;
+  std::vector<ParamBinding> mBindings;
+
+  WDL_Mutex mResetMutex; // held by Compile() and OnReset(), never by the audio thread
+  double mSampleRate = DEFAULT_SAMPLE_RATE;
+  int mMaxBlockSize = 0;
+  std::vector<sample> mFadeBuffer;
+  std::vector<sample*> mFadeOutputs;
+
+  Program* mActive = nullptr; // only used on the audio thread
+  std::atomic<Program*> mPending {nullptr}; // compiled, waiting to be swapped in
+  std::atomic<Program*> mRetired {nullptr}; // swapped out, waiting to be freed
+} WDL_FIXALIGN;
+
+END_IPLUG_NAMESPACE
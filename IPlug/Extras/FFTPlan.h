@@ -0,0 +1,608 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Real FFTs for float and double, vectorised with SIMDLane, with plans that are created outside the audio thread
+ *
+ * A single transform of N points is computed as a complex FFT of N/2 points, split four-step style into kWidth columns
+ * that are transformed side by side in the lanes of a SIMDLane. Batches of channels are transformed one channel per lane.
+ * Define IPLUG_FFT_WDL at project level to compute single float transforms with WDL_real_fft instead, e.g. to compare
+ * results with code that used it before.
+ *
+ * WDL_ConvolutionEngine doesn't use FFTPlan: it transforms two channels at once as the real and imaginary parts of a
+ * complex WDL_fft(), and keeps its spectra in WDL_fft's permuted order, so it stays on WDL_fft with or without
+ * IPLUG_FFT_WDL. Convolution built on FFTPlan uses Forward() and MultiplyAccumulate() instead.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "IPlugPlatform.h"
+#include "SIMDLane.h"
+
+#if defined IPLUG_FFT_WDL
+#include "fft.h"
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A real FFT of a fixed power of two size. Creating a plan allocates its tables and work buffers, so create it on the
+ * main thread, e.g. when the size is chosen. Transforms don't allocate and can run on the audio thread, but as they use
+ * the plan's work buffers a plan must only be used by one thread at a time.
+ *
+ * Spectra are packed into N values: out[0] is the DC bin, out[1] is the Nyquist bin (both real), and out[2k], out[2k+1]
+ * are the real and imaginary parts of bin k for 0 < k < N/2. The forward transform is unscaled, Inverse() scales by 1/N,
+ * so that Inverse(Forward(x)) == x.
+ * @tparam T float or double */
+template <typename T>
+class FFTPlan
+{
+  using Lane = SIMDLane<T>;
+  static constexpr int kLaneWidth = Lane::kWidth;
+  static_assert(kLaneWidth <= 8, "GatherDFT() handles up to 8 columns");
+
+public:
+  /** @param size The number of real points, a power of two of at least 4 */
+  FFTPlan(int size)
+  : mSize(size)
+  , mHalfSize(size / 2)
+  {
+    assert(size >= 4 && (size & (size - 1)) == 0);
+
+    const int nc = mHalfSize;
+    const double pi = std::acos(-1.);
+
+    // single transforms use kLaneWidth columns, transformed side by side
+    mUseLanes = kLaneWidth > 1 && nc >= 4 * kLaneWidth;
+
+    if (mUseLanes)
+    {
+      // w^(m * c) for row m and column c
+      mColumnTwiddleRe.resize(nc);
+      mColumnTwiddleIm.resize(nc);
+
+      for (auto k = 0; k < nc; k++)
+      {
+        const int m = k / kLaneWidth, c = k % kLaneWidth;
+        mColumnTwiddleRe[k] = static_cast<T>(std::cos(2. * pi * m * c / nc));
+        mColumnTwiddleIm[k] = static_cast<T>(-std::sin(2. * pi * m * c / nc));
+      }
+    }
+
+    mTwiddleRe.resize(nc);
+    mTwiddleIm.resize(nc);
+    mRealTwiddleRe.resize(nc);
+    mRealTwiddleIm.resize(nc);
+
+    for (auto k = 0; k < nc; k++)
+    {
+      mTwiddleRe[k] = static_cast<T>(std::cos(2. * pi * k / nc));
+      mTwiddleIm[k] = static_cast<T>(-std::sin(2. * pi * k / nc));
+      mRealTwiddleRe[k] = static_cast<T>(std::cos(pi * k / nc));
+      mRealTwiddleIm[k] = static_cast<T>(-std::sin(pi * k / nc));
+    }
+
+    // batches hold kLaneWidth channels
+    for (auto& buffer : mBuffers)
+      buffer.resize(nc * kLaneWidth);
+
+#if defined IPLUG_FFT_WDL
+    WDL_fft_init();
+    mWDLBuffer.resize(size);
+#endif
+  }
+
+  FFTPlan(const FFTPlan&) = delete;
+  FFTPlan& operator=(const FFTPlan&) = delete;
+
+  int GetSize() const { return mSize; }
+
+  /** Transform N real samples to a packed spectrum. input and output may be the same buffer */
+  void Forward(const T* input, T* output)
+  {
+#if defined IPLUG_FFT_WDL
+    if (ForwardWDL(input, output))
+      return;
+#endif
+    // the even and odd samples are the real and imaginary parts of N/2 complex points
+    T* zRe; T* zIm;
+    ComplexTransform<false>(input, input + 1, 2, zRe, zIm);
+
+    output[0] = zRe[0] + zIm[0];
+    output[1] = zRe[0] - zIm[0];
+
+    for (auto k = 1; k <= mHalfSize / 2; k++)
+    {
+      const int j = mHalfSize - k;
+      T xkRe, xkIm, xjRe, xjIm;
+      SplitSpectrum<ScalarLane<T>>(zRe[k], zIm[k], zRe[j], zIm[j], mRealTwiddleRe[k], mRealTwiddleIm[k], xkRe, xkIm, xjRe, xjIm);
+      output[2 * k] = xkRe;
+      output[2 * k + 1] = xkIm;
+
+      if (j != k)
+      {
+        output[2 * j] = xjRe;
+        output[2 * j + 1] = xjIm;
+      }
+    }
+  }
+
+  /** Transform a packed spectrum back to N real samples, scaled by 1/N. input and output may be the same buffer */
+  void Inverse(const T* input, T* output)
+  {
+#if defined IPLUG_FFT_WDL
+    if (InverseWDL(input, output))
+      return;
+#endif
+    T* aRe = mBuffers[4].data(); T* aIm = mBuffers[5].data();
+    const T scale = T(1) / static_cast<T>(mSize);
+
+    aRe[0] = (input[0] + input[1]) * scale;
+    aIm[0] = (input[0] - input[1]) * scale;
+
+    for (auto k = 1; k <= mHalfSize / 2; k++)
+    {
+      const int j = mHalfSize - k;
+      T zkRe, zkIm, zjRe, zjIm;
+      JoinSpectrum<ScalarLane<T>>(input[2 * k], input[2 * k + 1], input[2 * j], input[2 * j + 1], mRealTwiddleRe[k], mRealTwiddleIm[k], zkRe, zkIm, zjRe, zjIm);
+      aRe[k] = zkRe * scale;
+      aIm[k] = zkIm * scale;
+      aRe[j] = zjRe * scale;
+      aIm[j] = zjIm * scale;
+    }
+
+    T* zRe; T* zIm;
+    ComplexTransform<true>(aRe, aIm, 1, zRe, zIm);
+
+    for (auto n = 0; n < mHalfSize; n++)
+    {
+      output[2 * n] = zRe[n];
+      output[2 * n + 1] = zIm[n];
+    }
+  }
+
+  /** Transform several channels, kLaneWidth channels at a time, one per lane
+   * @param inputs nChans buffers of N real samples
+   * @param outputs nChans buffers for the packed spectra, may be the same as inputs */
+  void ForwardBatch(const T* const* inputs, T* const* outputs, int nChans)
+  {
+    auto c = 0;
+
+    for (; kLaneWidth > 1 && c + kLaneWidth <= nChans; c += kLaneWidth)
+    {
+      T* aRe = mBuffers[0].data(); T* aIm = mBuffers[1].data();
+
+      for (auto n = 0; n < mHalfSize; n++)
+      {
+        for (auto l = 0; l < kLaneWidth; l++)
+        {
+          aRe[n * kLaneWidth + l] = inputs[c + l][2 * n];
+          aIm[n * kLaneWidth + l] = inputs[c + l][2 * n + 1];
+        }
+      }
+
+      T* zRe; T* zIm;
+      Transform<Lane, false>(mHalfSize, 1, mBuffers[0].data(), mBuffers[1].data(), mBuffers[2].data(), mBuffers[3].data(), zRe, zIm);
+
+      // the bins are split in the lanes, then written out channel by channel
+      T* xRe = zRe == mBuffers[0].data() ? mBuffers[2].data() : mBuffers[0].data();
+      T* xIm = zRe == mBuffers[0].data() ? mBuffers[3].data() : mBuffers[1].data();
+      const auto z0Re = Lane::Load(zRe);
+      const auto z0Im = Lane::Load(zIm);
+      Lane::Store(xRe, Lane::Add(z0Re, z0Im));
+      Lane::Store(xIm, Lane::Sub(z0Re, z0Im));
+
+      for (auto k = 1; k <= mHalfSize / 2; k++)
+      {
+        const int j = mHalfSize - k;
+        typename Lane::Type xkRe, xkIm, xjRe, xjIm;
+        SplitSpectrum<Lane>(Lane::Load(zRe + k * kLaneWidth), Lane::Load(zIm + k * kLaneWidth), Lane::Load(zRe + j * kLaneWidth), Lane::Load(zIm + j * kLaneWidth),
+                            Lane::Set1(mRealTwiddleRe[k]), Lane::Set1(mRealTwiddleIm[k]), xkRe, xkIm, xjRe, xjIm);
+        Lane::Store(xRe + j * kLaneWidth, xjRe);
+        Lane::Store(xIm + j * kLaneWidth, xjIm);
+        Lane::Store(xRe + k * kLaneWidth, xkRe);
+        Lane::Store(xIm + k * kLaneWidth, xkIm);
+      }
+
+      for (auto l = 0; l < kLaneWidth; l++)
+      {
+        T* pOut = outputs[c + l];
+
+        for (auto k = 0; k < mHalfSize; k++)
+        {
+          pOut[2 * k] = xRe[k * kLaneWidth + l];
+          pOut[2 * k + 1] = xIm[k * kLaneWidth + l];
+        }
+      }
+    }
+
+    for (; c < nChans; c++)
+      Forward(inputs[c], outputs[c]);
+  }
+
+  /** Inverse transform several channels, kLaneWidth channels at a time, one per lane
+   * @param inputs nChans packed spectra
+   * @param outputs nChans buffers for N real samples each, may be the same as inputs */
+  void InverseBatch(const T* const* inputs, T* const* outputs, int nChans)
+  {
+    auto c = 0;
+    const auto scale = Lane::Set1(T(1) / static_cast<T>(mSize));
+
+    for (; kLaneWidth > 1 && c + kLaneWidth <= nChans; c += kLaneWidth)
+    {
+      T* xRe = mBuffers[4].data(); T* xIm = mBuffers[5].data();
+
+      for (auto k = 0; k < mHalfSize; k++)
+      {
+        for (auto l = 0; l < kLaneWidth; l++)
+        {
+          xRe[k * kLaneWidth + l] = inputs[c + l][2 * k];
+          xIm[k * kLaneWidth + l] = inputs[c + l][2 * k + 1];
+        }
+      }
+
+      T* aRe = mBuffers[0].data(); T* aIm = mBuffers[1].data();
+      const auto x0Re = Lane::Load(xRe);
+      const auto x0Im = Lane::Load(xIm);
+      Lane::Store(aRe, Lane::Mul(Lane::Add(x0Re, x0Im), scale));
+      Lane::Store(aIm, Lane::Mul(Lane::Sub(x0Re, x0Im), scale));
+
+      for (auto k = 1; k <= mHalfSize / 2; k++)
+      {
+        const int j = mHalfSize - k;
+        typename Lane::Type zkRe, zkIm, zjRe, zjIm;
+        JoinSpectrum<Lane>(Lane::Load(xRe + k * kLaneWidth), Lane::Load(xIm + k * kLaneWidth), Lane::Load(xRe + j * kLaneWidth), Lane::Load(xIm + j * kLaneWidth),
+                           Lane::Set1(mRealTwiddleRe[k]), Lane::Set1(mRealTwiddleIm[k]), zkRe, zkIm, zjRe, zjIm);
+        Lane::Store(aRe + j * kLaneWidth, Lane::Mul(zjRe, scale));
+        Lane::Store(aIm + j * kLaneWidth, Lane::Mul(zjIm, scale));
+        Lane::Store(aRe + k * kLaneWidth, Lane::Mul(zkRe, scale));
+        Lane::Store(aIm + k * kLaneWidth, Lane::Mul(zkIm, scale));
+      }
+
+      T* zRe; T* zIm;
+      Transform<Lane, true>(mHalfSize, 1, aRe, aIm, mBuffers[2].data(), mBuffers[3].data(), zRe, zIm);
+
+      for (auto l = 0; l < kLaneWidth; l++)
+      {
+        T* pOut = outputs[c + l];
+
+        for (auto n = 0; n < mHalfSize; n++)
+        {
+          pOut[2 * n] = zRe[n * kLaneWidth + l];
+          pOut[2 * n + 1] = zIm[n * kLaneWidth + l];
+        }
+      }
+    }
+
+    for (; c < nChans; c++)
+      Inverse(inputs[c], outputs[c]);
+  }
+
+  /** Multiply two packed spectra and add the result to a third, e.g. for fast convolution
+   * @param size The FFT size N of the spectra */
+  static void MultiplyAccumulate(const T* a, const T* b, T* acc, int size)
+  {
+    acc[0] += a[0] * b[0];
+    acc[1] += a[1] * b[1];
+
+    for (auto i = 2; i < size; i += 2)
+    {
+      acc[i] += a[i] * b[i] - a[i + 1] * b[i + 1];
+      acc[i + 1] += a[i] * b[i + 1] + a[i + 1] * b[i];
+    }
+  }
+
+private:
+  /** Get bins k and N/2-k of the real spectrum from bins k and N/2-k of the half size complex spectrum */
+  template <typename L, typename V = typename L::Type>
+  static inline void SplitSpectrum(V zkRe, V zkIm, V zjRe, V zjIm, V wRe, V wIm, V& xkRe, V& xkIm, V& xjRe, V& xjIm)
+  {
+    const V half = L::Set1(T(0.5));
+    // even = (Z[k] + conj(Z[j])) / 2, odd = -i * (Z[k] - conj(Z[j])) / 2
+    const V eRe = L::Mul(L::Add(zkRe, zjRe), half);
+    const V eIm = L::Mul(L::Sub(zkIm, zjIm), half);
+    const V oRe = L::Mul(L::Add(zkIm, zjIm), half);
+    const V oIm = L::Mul(L::Sub(zjRe, zkRe), half);
+    // X[k] = even + w^k * odd, X[j] = conj(even - w^k * odd)
+    const V tRe = L::Sub(L::Mul(wRe, oRe), L::Mul(wIm, oIm));
+    const V tIm = L::Add(L::Mul(wRe, oIm), L::Mul(wIm, oRe));
+    xkRe = L::Add(eRe, tRe);
+    xkIm = L::Add(eIm, tIm);
+    xjRe = L::Sub(eRe, tRe);
+    xjIm = L::Sub(tIm, eIm);
+  }
+
+  /** The inverse of SplitSpectrum(), without the factor of 1/2 */
+  template <typename L, typename V = typename L::Type>
+  static inline void JoinSpectrum(V xkRe, V xkIm, V xjRe, V xjIm, V wRe, V wIm, V& zkRe, V& zkIm, V& zjRe, V& zjIm)
+  {
+    // even = X[k] + conj(X[j]), odd = (X[k] - conj(X[j])) * conj(w^k)
+    const V eRe = L::Add(xkRe, xjRe);
+    const V eIm = L::Sub(xkIm, xjIm);
+    const V dRe = L::Sub(xkRe, xjRe);
+    const V dIm = L::Add(xkIm, xjIm);
+    const V oRe = L::Add(L::Mul(dRe, wRe), L::Mul(dIm, wIm));
+    const V oIm = L::Sub(L::Mul(dIm, wRe), L::Mul(dRe, wIm));
+    // Z[k] = even + i * odd, Z[j] = conj(even - i * odd)
+    zkRe = L::Sub(eRe, oIm);
+    zkIm = L::Add(eIm, oRe);
+    zjRe = L::Add(eRe, oIm);
+    zjIm = L::Sub(oRe, eIm);
+  }
+
+  /** Transform the N/2 complex points (pRe[n * stride], pIm[n * stride]). The result is in natural order, in the work
+   * buffers that zRe and zIm are set to */
+  template <bool inverse>
+  void ComplexTransform(const T* pRe, const T* pIm, int stride, T*& zRe, T*& zIm)
+  {
+    if (mUseLanes)
+      ComplexTransform<Lane, inverse>(pRe, pIm, stride, zRe, zIm);
+    else
+      Transform<ScalarLane<T>, inverse>(mHalfSize, 1, Gather(pRe, mBuffers[0].data(), stride),
+                                        Gather(pIm, mBuffers[1].data(), stride), mBuffers[2].data(), mBuffers[3].data(), zRe, zIm);
+  }
+
+  /** Copy N/2 values, step apart, into buffer */
+  T* Gather(const T* p, T* buffer, int step) const
+  {
+    for (auto n = 0; n < mHalfSize; n++)
+      buffer[n] = p[n * step];
+
+    return buffer;
+  }
+
+  /** With point n = m + rows * c for column c, Z[k1 * W + k2] = sum_m w^(m * k1 * W) * w^(m * k2) * DFT_c(z[m + rows * c])[k2].
+   * The small DFTs across the columns and the twiddles are done while gathering the input, then the transforms over m
+   * run one column per lane, leaving the result in natural order. */
+  template <typename L, bool inverse>
+  void ComplexTransform(const T* pRe, const T* pIm, int stride, T*& zRe, T*& zIm)
+  {
+    using V = typename L::Type;
+    constexpr int W = L::kWidth;
+    const int rows = mHalfSize / W;
+    T* aRe = mBuffers[0].data();
+    T* aIm = mBuffers[1].data();
+
+    for (auto m = 0; m < rows; m++)
+    {
+      alignas(32) T re[W], im[W];
+      GatherDFT<W, inverse>(pRe + m * stride, pIm + m * stride, rows * stride, re, im);
+
+      const V xRe = L::Load(re), xIm = L::Load(im);
+      const V wRe = L::Load(mColumnTwiddleRe.data() + m * W);
+      const V wIm = L::Load(mColumnTwiddleIm.data() + m * W);
+
+      if (inverse)
+      {
+        L::Store(aRe + m * W, L::Add(L::Mul(xRe, wRe), L::Mul(xIm, wIm)));
+        L::Store(aIm + m * W, L::Sub(L::Mul(xIm, wRe), L::Mul(xRe, wIm)));
+      }
+      else
+      {
+        L::Store(aRe + m * W, L::Sub(L::Mul(xRe, wRe), L::Mul(xIm, wIm)));
+        L::Store(aIm + m * W, L::Add(L::Mul(xRe, wIm), L::Mul(xIm, wRe)));
+      }
+    }
+
+    Transform<L, inverse>(rows, W, aRe, aIm, mBuffers[2].data(), mBuffers[3].data(), zRe, zIm);
+  }
+
+  /** Read W points, step apart, and transform them into re and im with a W point DFT */
+  template <int W, bool inverse>
+  inline void GatherDFT(const T* pRe, const T* pIm, int step, T* re, T* im) const
+  {
+    if (W == 1)
+    {
+      re[0] = pRe[0];
+      im[0] = pIm[0];
+    }
+    else if (W == 2)
+    {
+      const T aRe = pRe[0], aIm = pIm[0], bRe = pRe[step], bIm = pIm[step];
+      re[0] = aRe + bRe; im[0] = aIm + bIm;
+      re[1] = aRe - bRe; im[1] = aIm - bIm;
+    }
+    else if (W == 4)
+    {
+      GatherDFT4<inverse>(pRe, pIm, step, re, im);
+    }
+    else if (W == 8)
+    {
+      // radix-2 over two 4 point DFTs of the even and odd points
+      const T c = static_cast<T>(0.70710678118654752440);
+      const T sign = inverse ? T(1) : T(-1);
+      T eRe[4], eIm[4], oRe[4], oIm[4];
+      GatherDFT4<inverse>(pRe, pIm, 2 * step, eRe, eIm);
+      GatherDFT4<inverse>(pRe + step, pIm + step, 2 * step, oRe, oIm);
+
+      // e^(-+2 pi i k / 8) for k = 0..3
+      const T wRe[4] = {T(1), c, T(0), -c};
+      const T wIm[4] = {T(0), sign * c, sign, sign * c};
+
+      for (auto k = 0; k < 4; k++)
+      {
+        const T tRe = oRe[k] * wRe[k] - oIm[k] * wIm[k];
+        const T tIm = oRe[k] * wIm[k] + oIm[k] * wRe[k];
+        re[k] = eRe[k] + tRe; im[k] = eIm[k] + tIm;
+        re[k + 4] = eRe[k] - tRe; im[k + 4] = eIm[k] - tIm;
+      }
+    }
+  }
+
+  template <bool inverse>
+  static inline void GatherDFT4(const T* pRe, const T* pIm, int step, T* re, T* im)
+  {
+    const T a0Re = pRe[0], a0Im = pIm[0], a1Re = pRe[step], a1Im = pIm[step];
+    const T a2Re = pRe[2 * step], a2Im = pIm[2 * step], a3Re = pRe[3 * step], a3Im = pIm[3 * step];
+    const T t0Re = a0Re + a2Re, t0Im = a0Im + a2Im;
+    const T t1Re = a0Re - a2Re, t1Im = a0Im - a2Im;
+    const T t2Re = a1Re + a3Re, t2Im = a1Im + a3Im;
+    // -i * (a1 - a3) forward, i * (a1 - a3) inverse
+    const T t3Re = inverse ? a3Im - a1Im : a1Im - a3Im;
+    const T t3Im = inverse ? a1Re - a3Re : a3Re - a1Re;
+    re[0] = t0Re + t2Re; im[0] = t0Im + t2Im;
+    re[2] = t0Re - t2Re; im[2] = t0Im - t2Im;
+    re[1] = t1Re + t3Re; im[1] = t1Im + t3Im;
+    re[3] = t1Re - t3Re; im[3] = t1Im - t3Im;
+  }
+
+  /** Stockham autosort radix-4 FFT of n points, each point being an L::Type vector of independent values
+   * @param tableStride The step through the twiddle table, mHalfSize / n
+   * @param outRe, outIm Set to the buffers holding the result, either x or y */
+  template <typename L, bool inverse>
+  void Transform(int n, int tableStride, T* xRe, T* xIm, T* yRe, T* yIm, T*& outRe, T*& outIm) const
+  {
+    using V = typename L::Type;
+    constexpr int W = L::kWidth;
+    const T sign = inverse ? T(-1) : T(1);
+    int s = 1;
+
+    for (; n >= 4; n /= 4, s *= 4, tableStride *= 4)
+    {
+      const int n1 = n / 4;
+
+      for (auto p = 0; p < n1; p++)
+      {
+        const V w1Re = L::Set1(mTwiddleRe[p * tableStride]), w1Im = L::Set1(sign * mTwiddleIm[p * tableStride]);
+        const V w2Re = L::Set1(mTwiddleRe[2 * p * tableStride]), w2Im = L::Set1(sign * mTwiddleIm[2 * p * tableStride]);
+        const V w3Re = L::Set1(mTwiddleRe[3 * p * tableStride]), w3Im = L::Set1(sign * mTwiddleIm[3 * p * tableStride]);
+
+        for (auto q = 0; q < s; q++)
+        {
+          const int i0 = (q + s * p) * W;
+          const int i1 = i0 + s * n1 * W;
+          const int i2 = i1 + s * n1 * W;
+          const int i3 = i2 + s * n1 * W;
+          const V aRe = L::Load(xRe + i0), aIm = L::Load(xIm + i0);
+          const V bRe = L::Load(xRe + i1), bIm = L::Load(xIm + i1);
+          const V cRe = L::Load(xRe + i2), cIm = L::Load(xIm + i2);
+          const V dRe = L::Load(xRe + i3), dIm = L::Load(xIm + i3);
+
+          const V apcRe = L::Add(aRe, cRe), apcIm = L::Add(aIm, cIm);
+          const V amcRe = L::Sub(aRe, cRe), amcIm = L::Sub(aIm, cIm);
+          const V bpdRe = L::Add(bRe, dRe), bpdIm = L::Add(bIm, dIm);
+          // j * (b - d), with j = i forward and -i inverse
+          const V jbmdRe = inverse ? L::Sub(bIm, dIm) : L::Sub(dIm, bIm);
+          const V jbmdIm = inverse ? L::Sub(dRe, bRe) : L::Sub(bRe, dRe);
+
+          const int o0 = (q + s * 4 * p) * W;
+          const int o1 = o0 + s * W;
+          const int o2 = o1 + s * W;
+          const int o3 = o2 + s * W;
+          L::Store(yRe + o0, L::Add(apcRe, bpdRe));
+          L::Store(yIm + o0, L::Add(apcIm, bpdIm));
+
+          const V t1Re = L::Sub(amcRe, jbmdRe), t1Im = L::Sub(amcIm, jbmdIm);
+          L::Store(yRe + o1, L::Sub(L::Mul(w1Re, t1Re), L::Mul(w1Im, t1Im)));
+          L::Store(yIm + o1, L::Add(L::Mul(w1Re, t1Im), L::Mul(w1Im, t1Re)));
+
+          const V t2Re = L::Sub(apcRe, bpdRe), t2Im = L::Sub(apcIm, bpdIm);
+          L::Store(yRe + o2, L::Sub(L::Mul(w2Re, t2Re), L::Mul(w2Im, t2Im)));
+          L::Store(yIm + o2, L::Add(L::Mul(w2Re, t2Im), L::Mul(w2Im, t2Re)));
+
+          const V t3Re = L::Add(amcRe, jbmdRe), t3Im = L::Add(amcIm, jbmdIm);
+          L::Store(yRe + o3, L::Sub(L::Mul(w3Re, t3Re), L::Mul(w3Im, t3Im)));
+          L::Store(yIm + o3, L::Add(L::Mul(w3Re, t3Im), L::Mul(w3Im, t3Re)));
+        }
+      }
+
+      std::swap(xRe, yRe);
+      std::swap(xIm, yIm);
+    }
+
+    if (n == 2)
+    {
+      for (auto q = 0; q < s; q++)
+      {
+        const V aRe = L::Load(xRe + q * W), aIm = L::Load(xIm + q * W);
+        const V bRe = L::Load(xRe + (q + s) * W), bIm = L::Load(xIm + (q + s) * W);
+        L::Store(yRe + q * W, L::Add(aRe, bRe));
+        L::Store(yIm + q * W, L::Add(aIm, bIm));
+        L::Store(yRe + (q + s) * W, L::Sub(aRe, bRe));
+        L::Store(yIm + (q + s) * W, L::Sub(aIm, bIm));
+      }
+
+      std::swap(xRe, yRe);
+      std::swap(xIm, yIm);
+    }
+
+    outRe = xRe;
+    outIm = xIm;
+  }
+
+#if defined IPLUG_FFT_WDL
+  bool ForwardWDL(const T* input, T* output)
+  {
+    // WDL_real_fft() goes up to 32768 points
+    if (!std::is_same<T, WDL_FFT_REAL>::value || mSize > 32768)
+      return false;
+
+    WDL_FFT_REAL* pBuf = mWDLBuffer.data();
+    std::copy(input, input + mSize, pBuf);
+    WDL_real_fft(pBuf, mSize, 0);
+
+    // bin k is at WDL_fft_permute(N/2, k), bin 0 holds DC and Nyquist, all scaled by 2
+    const WDL_FFT_COMPLEX* pBins = reinterpret_cast<const WDL_FFT_COMPLEX*>(pBuf);
+    output[0] = static_cast<T>(pBuf[0] * WDL_FFT_REAL(0.5));
+    output[1] = static_cast<T>(pBuf[1] * WDL_FFT_REAL(0.5));
+
+    for (auto k = 1; k < mHalfSize; k++)
+    {
+      const WDL_FFT_COMPLEX& bin = pBins[WDL_fft_permute(mHalfSize, k)];
+      output[2 * k] = static_cast<T>(bin.re * WDL_FFT_REAL(0.5));
+      output[2 * k + 1] = static_cast<T>(bin.im * WDL_FFT_REAL(0.5));
+    }
+
+    return true;
+  }
+
+  bool InverseWDL(const T* input, T* output)
+  {
+    // WDL_real_fft() goes up to 32768 points
+    if (!std::is_same<T, WDL_FFT_REAL>::value || mSize > 32768)
+      return false;
+
+    WDL_FFT_REAL* pBuf = mWDLBuffer.data();
+    WDL_FFT_COMPLEX* pBins = reinterpret_cast<WDL_FFT_COMPLEX*>(pBuf);
+    const WDL_FFT_REAL scale = WDL_FFT_REAL(1) / static_cast<WDL_FFT_REAL>(mSize);
+    pBuf[0] = static_cast<WDL_FFT_REAL>(input[0]) * scale;
+    pBuf[1] = static_cast<WDL_FFT_REAL>(input[1]) * scale;
+
+    for (auto k = 1; k < mHalfSize; k++)
+    {
+      WDL_FFT_COMPLEX& bin = pBins[WDL_fft_permute(mHalfSize, k)];
+      bin.re = static_cast<WDL_FFT_REAL>(input[2 * k]) * scale;
+      bin.im = static_cast<WDL_FFT_REAL>(input[2 * k + 1]) * scale;
+    }
+
+    WDL_real_fft(pBuf, mSize, 1);
+    std::copy(pBuf, pBuf + mSize, output);
+    return true;
+  }
+
+  std::vector<WDL_FFT_REAL> mWDLBuffer;
+#endif
+
+  int mSize;
+  int mHalfSize;
+  bool mUseLanes;
+  std::vector<T> mTwiddleRe, mTwiddleIm; // w^k = e^(-2 pi i k / (N/2))
+  std::vector<T> mRealTwiddleRe, mRealTwiddleIm; // e^(-2 pi i k / N)
+  std::vector<T> mColumnTwiddleRe, mColumnTwiddleIm;
+  std::vector<T> mBuffers[6];
+};
+
+END_IPLUG_NAMESPACE
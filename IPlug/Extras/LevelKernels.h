@@ -0,0 +1,110 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Level analysis kernels for meters (sum of magnitudes, peak, mean and mean square), written against SIMDLane.h
+ * so that they are vectorised when IPLUG_SIMDE is defined. Used by IPeakSender and IPeakAvgSender
+ */
+
+#include "SIMDLane.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Sum of the magnitudes of a contiguous buffer, SIMDLane<T>::kWidth samples per instruction.
+ * Two accumulators are used to hide the latency of the adds, so the result may differ from a sequential sum in the last bits
+ * @param pSrc The samples
+ * @param n The number of samples
+ * @return The sum of |pSrc[i]| */
+template <typename T>
+inline T LevelAbsSum(const T* pSrc, int n)
+{
+  using L = SIMDLane<T>;
+  constexpr int W = L::kWidth;
+
+  auto sum0 = L::Zero();
+  auto sum1 = L::Zero();
+  auto i = 0;
+
+  for (; i + 2 * W <= n; i += 2 * W)
+  {
+    sum0 = L::Add(sum0, L::Abs(L::Load(pSrc + i)));
+    sum1 = L::Add(sum1, L::Abs(L::Load(pSrc + i + W)));
+  }
+
+  T sum = L::HSum(L::Add(sum0, sum1));
+
+  for (; i < n; i++)
+    sum += std::abs(pSrc[i]);
+
+  return sum;
+}
+
+/** Peak magnitude and sum of magnitudes or squares of each channel in a block of frame-interleaved channels,
+ * with one channel per lane of L. Each lane accumulates in frame order, so the sums match a sequential loop exactly */
+template <typename L>
+inline void LevelAbsMaxSumLanes(const typename L::Scalar* pFrames, int frameStride, int startChan, int nFrames, bool squares,
+                                typename L::Scalar* pPeaks, typename L::Scalar* pSums)
+{
+  auto peak = L::Zero();
+  auto sum = L::Zero();
+  const auto* pSrc = pFrames + startChan;
+
+  if (squares)
+  {
+    for (auto i = 0; i < nFrames; i++, pSrc += frameStride)
+    {
+      const auto x = L::Abs(L::Load(pSrc));
+      peak = L::Max(peak, x);
+      sum = L::Add(sum, L::Mul(x, x));
+    }
+  }
+  else
+  {
+    for (auto i = 0; i < nFrames; i++, pSrc += frameStride)
+    {
+      const auto x = L::Abs(L::Load(pSrc));
+      peak = L::Max(peak, x);
+      sum = L::Add(sum, x);
+    }
+  }
+
+  L::Store(pPeaks + startChan, peak);
+  L::Store(pSums + startChan, sum);
+}
+
+/** Peak magnitude and sum of magnitudes or squares of each channel of a frame-interleaved buffer,
+ * SIMDLane<T>::kWidth channels per instruction
+ * @param pFrames The buffer, nFrames frames of frameStride samples, channel c of frame i at pFrames[i * frameStride + c]
+ * @param frameStride The number of samples per frame
+ * @param startChan The first channel to analyse
+ * @param nChans The number of channels to analyse
+ * @param nFrames The number of frames
+ * @param squares If \c true sum the squares (for an RMS value), otherwise the magnitudes (for a mean value)
+ * @param pPeaks Receives the peak magnitude of channel c at pPeaks[c]
+ * @param pSums Receives the sum of channel c at pSums[c] */
+template <typename T>
+inline void LevelAbsMaxSum(const T* pFrames, int frameStride, int startChan, int nChans, int nFrames, bool squares, T* pPeaks, T* pSums)
+{
+  using L = SIMDLane<T>;
+  constexpr int W = L::kWidth;
+
+  const int endChan = startChan + nChans;
+  auto c = startChan;
+
+  for (; c + W <= endChan; c += W)
+    LevelAbsMaxSumLanes<L>(pFrames, frameStride, c, nFrames, squares, pPeaks, pSums);
+  for (; c < endChan; c++)
+    LevelAbsMaxSumLanes<ScalarLane<T>>(pFrames, frameStride, c, nFrames, squares, pPeaks, pSums);
+}
+
+END_IPLUG_NAMESPACE
@@ -1,68 +1,164 @@
 /*
  ==============================================================================
- 
- This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers. 
- 
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
  See LICENSE.txt for  more info.
- 
+
  ==============================================================================
 */
 
 #pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
 #include "IPlugPlatform.h"
+#include "heapbuf.h"
 
 BEGIN_IPLUG_NAMESPACE
 
-// A static delayline used to delay bypassed signals to match mLatency in AAX/VST3/AU
+/** A multi-channel delay line, used to delay bypassed signals to match mLatency in AAX/VST3/AU.
+ * Each channel has its own power-of-two ring buffer, large enough for the delay plus one block, so a block is written and
+ * read with at most two memcpy()s per channel each. Besides the fixed delay of ProcessBlock(), fractional and
+ * per-sample modulated taps can be read for each block with ReadModulatedBlock(), e.g. for chorus and flanger effects. */
 template<typename T>
 class NChanDelayLine
 {
 public:
+  static constexpr int kDefaultMaxBlockSize = 512;
+
   NChanDelayLine(int nInputChans = 2, int nOutputChans = 2)
   : mNInChans(nInputChans)
   , mNOutChans(nOutputChans)
   {}
 
-  void SetDelayTime(int delayTimeSamples)
+  /** Set the delay used by ProcessBlock(), which is also the longest delay that can be read with the other methods.
+   * This allocates and clears the buffer.
+   * @param delayTimeSamples The delay in samples
+   * @param maxBlockSize The largest block that will be written in one go. ProcessBlock() splits longer blocks */
+  void SetDelayTime(int delayTimeSamples, int maxBlockSize = kDefaultMaxBlockSize)
   {
     mDTSamples = delayTimeSamples;
-    mBuffer.Resize(mNInChans * delayTimeSamples);
+    mMaxBlockSize = std::max(maxBlockSize, 1);
+
+    uint32_t size = 1;
+    // +1 for the interpolation of fractional taps
+    while (size < mDTSamples + mMaxBlockSize + 1)
+      size <<= 1;
+
+    mBufferSize = size;
+    mMask = size - 1;
+    mBuffer.Resize(mNInChans * mBufferSize);
     mWriteAddress = 0;
     ClearBuffer();
   }
 
   void ClearBuffer()
   {
-    memset(mBuffer.Get(), 0, mNInChans * mDTSamples * sizeof(T));
+    memset(mBuffer.Get(), 0, mNInChans * mBufferSize * sizeof(T));
   }
 
+  /** Delay nFrames of each channel by the delay set with SetDelayTime(). inputs and outputs may be the same buffers */
   void ProcessBlock(T** inputs, T** outputs, int nFrames)
   {
-    T* buffer = mBuffer.Get();
+    for (auto pos = 0; pos < nFrames; pos += mMaxBlockSize)
+    {
+      const auto n = std::min(nFrames - pos, static_cast<int>(mMaxBlockSize));
+
+      WriteBlock(inputs, n, pos);
+      ReadBlock(outputs, mDTSamples, n, pos);
+      Advance(n);
+    }
+  }
+
+  /** Write a block of at most maxBlockSize samples. Taps for the same block can then be read with ReadBlock() and
+   * ReadModulatedBlock(), before calling Advance()
+   * @param offset The sample offset into the input buffers */
+  void WriteBlock(T** inputs, int nFrames, int offset = 0)
+  {
+    assert(nFrames <= static_cast<int>(mMaxBlockSize));
 
-    for (auto s = 0 ; s < nFrames; ++s)
+    for (auto c = 0; c < NChans(); c++)
     {
-      for (auto c = 0; c < mNInChans; c++)
+      CopyToRing(ChannelBuffer(c), mWriteAddress, inputs[c] + offset, nFrames);
+    }
+  }
+
+  /** Read the block written with WriteBlock(), delayed by an integer number of samples
+   * @param delaySamples The delay, up to the value passed to SetDelayTime()
+   * @param offset The sample offset into the output buffers */
+  void ReadBlock(T** outputs, int delaySamples, int nFrames, int offset = 0) const
+  {
+    assert(delaySamples <= static_cast<int>(mDTSamples));
+
+    const uint32_t readAddress = (mWriteAddress - delaySamples) & mMask;
+
+    for (auto c = 0; c < NChans(); c++)
+    {
+      CopyFromRing(outputs[c] + offset, ChannelBuffer(c), readAddress, nFrames);
+    }
+  }
+
+  /** Read the block written with WriteBlock() through a tap with a per-sample fractional delay, using linear interpolation.
+   * The same delay is used for every channel
+   * @param delaySamples nFrames delays in samples, from 0 up to the value passed to SetDelayTime()
+   * @param offset The sample offset into the output buffers */
+  void ReadModulatedBlock(T** outputs, const float* delaySamples, int nFrames, int offset = 0) const
+  {
+    for (auto c = 0; c < NChans(); c++)
+    {
+      const T* buffer = ChannelBuffer(c);
+      T* out = outputs[c] + offset;
+
+      for (auto s = 0; s < nFrames; s++)
       {
-        if (c < mNOutChans)
-        {
-          T input = inputs[c][s];
-          const int offset = c * mDTSamples;
-          outputs[c][s] = buffer[offset + mWriteAddress];
-          buffer[offset + mWriteAddress] = input;
-        }
+        const double delay = std::min(std::max(static_cast<double>(delaySamples[s]), 0.), static_cast<double>(mDTSamples));
+        const double readPos = static_cast<double>(mWriteAddress + mBufferSize + s) - delay;
+        const uint32_t idx = static_cast<uint32_t>(readPos);
+        const T frac = static_cast<T>(readPos - idx);
+        const T y0 = buffer[idx & mMask];
+        const T y1 = buffer[(idx + 1) & mMask];
+        out[s] = y0 + (y1 - y0) * frac;
       }
-
-      mWriteAddress++;
-      mWriteAddress %= mDTSamples;
     }
   }
 
+  /** Move the write position on by nFrames, after the block has been written and read */
+  void Advance(int nFrames)
+  {
+    mWriteAddress = (mWriteAddress + nFrames) & mMask;
+  }
+
 private:
+  int NChans() const { return static_cast<int>(std::min(mNInChans, mNOutChans)); }
+
+  T* ChannelBuffer(int chan) { return mBuffer.Get() + chan * mBufferSize; }
+  const T* ChannelBuffer(int chan) const { return mBuffer.Get() + chan * mBufferSize; }
+
+  inline void CopyToRing(T* ring, uint32_t address, const T* src, int nFrames) const
+  {
+    const auto n1 = std::min(static_cast<uint32_t>(nFrames), mBufferSize - address);
+    memcpy(ring + address, src, n1 * sizeof(T));
+    memcpy(ring, src + n1, (nFrames - n1) * sizeof(T));
+  }
+
+  inline void CopyFromRing(T* dst, const T* ring, uint32_t address, int nFrames) const
+  {
+    const auto n1 = std::min(static_cast<uint32_t>(nFrames), mBufferSize - address);
+    memcpy(dst, ring + address, n1 * sizeof(T));
+    memcpy(dst + n1, ring, (nFrames - n1) * sizeof(T));
+  }
+
   WDL_TypedBuf<T> mBuffer;
   uint32_t mNInChans, mNOutChans;
   uint32_t mWriteAddress = 0;
   uint32_t mDTSamples = 0;
+  uint32_t mMaxBlockSize = kDefaultMaxBlockSize;
+  uint32_t mBufferSize = 0;
+  uint32_t mMask = 0;
 } WDL_FIXALIGN;
 
 END_IPLUG_NAMESPACE
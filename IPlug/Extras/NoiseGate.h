@@ -28,6 +28,7 @@
 #pragma once
 
 #include "IPlugUtilities.h"
+#include "SIMDLane.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -43,12 +44,14 @@ public:
   void SetSampleRate(double sampleRate)
   {
     mSampleRate = sampleRate;
+    UpdateCoefficients();
   }
   
   void SetAttackTime(double attackTime)
   {
     mAttackTime = std::max(attackTime, (1.0 / mSampleRate));
     mMinRate = std::min(mAttackTime, mReleaseTime);
+    UpdateCoefficients();
   }
   
   void SetHoldTime(double holdTime)
@@ -60,37 +63,71 @@ public:
   {
     mReleaseTime = std::max(releaseTime, (1.0 / mSampleRate));
     mMinRate = std::min(mAttackTime, mReleaseTime);
+    UpdateCoefficients();
   }
 
   void ProcessBlock(T** inputs, T** outputs, T* sidechain, int nChans, int nFrames)
   {
     assert(nChans <= NC);
 
-    for (auto s=0; s <nFrames; s++)
+    // The gain is a serial recursion on the sidechain, so it is computed for a sub-block first
+    // and then applied to every channel kLaneWidth samples at a time
+    T gain[kGainBlockSize];
+
+    for (auto pos = 0; pos < nFrames; pos += kGainBlockSize)
     {
-      auto trigger = sidechain[s];
-      auto gain = processSample(trigger);
-      for (auto c=0; c<nChans; c++)
+      const auto n = std::min(kGainBlockSize, nFrames - pos);
+
+      for (auto s = 0; s < n; s++)
       {
-        outputs[c][s] = inputs[c][s] * gain;
+        gain[s] = processSample(sidechain[pos + s]);
+      }
+
+      for (auto c = 0; c < nChans; c++)
+      {
+        const T* in = inputs[c] + pos;
+        T* out = outputs[c] + pos;
+        auto s = 0;
+
+        for (; s + kLaneWidth <= n; s += kLaneWidth)
+        {
+          Lane::Store(out + s, Lane::Mul(Lane::Load(in + s), Lane::Load(gain + s)));
+        }
+
+        for (; s < n; s++)
+        {
+          out[s] = in[s] * gain[s];
+        }
       }
     }
   }
 
 private:
+  using Lane = SIMDLane<T>;
+  static constexpr int kLaneWidth = Lane::kWidth;
+  static constexpr int kGainBlockSize = 64;
+
+  void UpdateCoefficients()
+  {
+    auto tau2pole = [](double tau, double sr) {
+      return std::exp(-1.0 / (tau * sr));
+    };
+
+    mDetectorCoeff = T(tau2pole(mMinRate, mSampleRate));
+    mAttackCoeff = T(tau2pole(mAttackTime, mSampleRate));
+    mReleaseCoeff = T(tau2pole(mReleaseTime, mSampleRate));
+  }
+
   inline T processSample(T sample) 
   {
-    auto ampFollower = [](T x, T& y, double att, double rel, double sr) {
-      auto tau2pole = [](double tau, double sr) {
-        return std::exp(-1.0 / (tau * sr));
-      };
+    auto ampFollower = [](T x, T& y, T attCoeff, T relCoeff) {
       const auto absX = std::abs(x);
-      const auto coeff = (absX > y) ? T(tau2pole(att, sr)) : T(tau2pole(rel, sr));
+      const auto coeff = (absX > y) ? attCoeff : relCoeff;
       y = (T(1) - coeff) * absX + coeff * y;
       return y;
     };
     
-    auto rawGate = ampFollower(sample, mHistory2, mMinRate, mMinRate, mSampleRate) > mThreshold;
+    auto rawGate = ampFollower(sample, mHistory2, mDetectorCoeff, mDetectorCoeff) > mThreshold;
     
     if (rawGate < mPrevGate)
     {
@@ -105,7 +142,7 @@ private:
     }
     
     const auto heldGate = std::max(rawGate, mHoldCounter > 0);
-    const auto smoothed = ampFollower(T(heldGate), mHistory1, mAttackTime, mReleaseTime, mSampleRate);
+    const auto smoothed = ampFollower(T(heldGate), mHistory1, mAttackCoeff, mReleaseCoeff);
 
     mPrevGate = rawGate;
     
@@ -118,7 +155,11 @@ private:
   double mHoldTime = 0.01f;
   double mReleaseTime = 0.01f;
   double mMinRate = mAttackTime;
-  T mHistory1, mHistory2 = 0.0f;
+  T mDetectorCoeff = T(std::exp(-1.0 / (mMinRate * mSampleRate)));
+  T mAttackCoeff = mDetectorCoeff;
+  T mReleaseCoeff = mDetectorCoeff;
+  T mHistory1 = 0.0f;
+  T mHistory2 = 0.0f;
   bool mPrevGate = false;
   int mHoldCounter = 0;
 };
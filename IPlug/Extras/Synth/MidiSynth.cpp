@@ -8,6 +8,8 @@
  ==============================================================================
  */
 
+#include <algorithm>
+
 #include "MidiSynth.h"
 
 using namespace iplug;
@@ -405,6 +407,7 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
 
   if (mVoicesAreActive | !mMidiQueue.Empty())
   {
+    const bool eventDriven = mSlicingMode == kSlicingEventDriven;
     int blockSize = mBlockSize;
     int samplesRemaining = nFrames;
     int startIndex = 0;
@@ -419,7 +422,8 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
         IMidiMsg msg = mMidiQueue.Peek();
 
         // we assume the messages are in chronological order. If we find one later than the current block we are done.
-        if (msg.mOffset > startIndex + blockSize) break;
+        // in event driven mode a slice starts with the messages at its first sample
+        if (msg.mOffset > (eventDriven ? startIndex : startIndex + blockSize)) break;
 
         if(IsRPNMessage(msg))
         {
@@ -435,6 +439,18 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
         mMidiQueue.Remove();
       }
 
+      if (eventDriven)
+      {
+        // run to the next message, the end of the block or the maximum slice size
+        blockSize = samplesRemaining;
+
+        if (mMaxSliceSize > 0)
+          blockSize = std::min(blockSize, mMaxSliceSize);
+
+        if (!mMidiQueue.Empty())
+          blockSize = std::min(blockSize, mMidiQueue.Peek().mOffset - startIndex);
+      }
+
       mVoiceAllocator.ProcessEvents(blockSize, mSampleTime);
       mVoiceAllocator.ProcessVoices(inputs, outputs, nInputs, nOutputs, startIndex, blockSize);
 
@@ -448,12 +464,12 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
 
     for(int v = 0; v < NVoices(); v++)
     {
-      bool busy = GetVoice(v)->GetBusy();
+      bool busy = !mVoiceAllocator.GetVoiceCulled(v) && GetVoice(v)->GetBusy();
       voicesbusy |= busy;
 
       activeCount += (busy==true);
 #if DEBUG_VOICE_COUNT
-      if(GetVoice(v)->GetBusy()) printf("X");
+      if(busy) printf("X");
       else DBGMSG("_");
     }
     DBGMSG("\n");
@@ -41,6 +41,15 @@ public:
   static constexpr int kDefaultBlockSize = 32;
   static constexpr int kDefaultPitchBendRange = 12;
 
+  /** How ProcessBlock() splits the host block into the slices for which events and voices are processed */
+  enum ESlicingMode
+  {
+    /** Slices of the block size passed to the constructor, whether or not events fall inside them */
+    kSlicingFixed = 0,
+    /** Slices end only at the offsets of MIDI events, so that voices render the longest possible runs, and notes start on the sample of their event */
+    kSlicingEventDriven
+  };
+
 #pragma mark - MidiSynth class
 
   MidiSynth(VoiceAllocator::EPolyMode mode, int blockSize = kDefaultBlockSize);
@@ -57,6 +66,15 @@ public:
 
   void SetSampleRateAndBlockSize(double sampleRate, int blockSize);
 
+  /** Choose how ProcessBlock() slices the host block
+   * @param mode The slicing mode, kSlicingFixed by default
+   * @param maxSliceSize In kSlicingEventDriven mode, the maximum length of a slice in samples, e.g. to update glides and voice controls at a minimum control rate. 0 for no limit */
+  void SetSlicingMode(ESlicingMode mode, int maxSliceSize = 0)
+  {
+    mSlicingMode = mode;
+    mMaxSliceSize = maxSliceSize;
+  }
+
   /** If you are using this class in a non-traditional mode of polyphony (e.g.to stack loads of voices) you might want to manually SetVoicesActive()
    * usually this would happen when you trigger notes
    * @param active should the class report that voices are active */
@@ -118,6 +136,29 @@ public:
     mVoiceAllocator.SetControlGlideTime(t);
   }
 
+  /** @copydoc VoiceAllocator::SetLevelTracking() */
+  void SetLevelTracking(bool enable, double silenceThresholdDB = -120., int silenceTimeSamples = 1024)
+  {
+    mVoiceAllocator.SetLevelTracking(enable, silenceThresholdDB, silenceTimeSamples);
+  }
+
+  /** @return The number of voices culled by level tracking, since the last call to ResetVoiceCounters() */
+  uint64_t GetNumVoicesCulled() const
+  {
+    return mVoiceAllocator.GetNumVoicesCulled();
+  }
+
+  /** @return The number of voices stolen for new notes, since the last call to ResetVoiceCounters() */
+  uint64_t GetNumVoicesStolen() const
+  {
+    return mVoiceAllocator.GetNumVoicesStolen();
+  }
+
+  void ResetVoiceCounters()
+  {
+    mVoiceAllocator.ResetVoiceCounters();
+  }
+
   SynthVoice* GetVoice(int voiceIdx)
   {
     return mVoiceAllocator.GetVoice(voiceIdx);
@@ -200,6 +241,8 @@ private:
   float mAfterTouchLUT[128];
   ChannelState mChannelStates[16]{};
   int mBlockSize;
+  ESlicingMode mSlicingMode{kSlicingFixed};
+  int mMaxSliceSize{0};
   int64_t mSampleTime{0};
   double mSampleRate = DEFAULT_SAMPLE_RATE;
   bool mVoicesAreActive = false;
@@ -68,6 +68,10 @@ public:
   /** As with Trigger, called to do optional tasks when a voice is released. */
   virtual void Release() {};
 
+  /** Called when the voice allocator frees a released voice early because its output has been inaudible for a while, see VoiceAllocator::SetLevelTracking().
+   * The allocator ignores GetBusy() and stops processing the voice until it is triggered again. */
+  virtual void Cull() {};
+
   /** Process a block of audio data for the voice
    @param inputs Pointer to input channel arrays. Sometimes synthesisers have audio inputs. Alternatively you can pass in modulation from global LFOs etc here.
    @param outputs Pointer to output channel arrays. You should add to the existing data in these arrays (so that all the voices get summed)
@@ -11,11 +11,49 @@
 #include "VoiceAllocator.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <numeric>
 #include <iostream>
 
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+
 using namespace iplug;
 
+static inline int LowestBit(uint64_t bits)
+{
+#if defined _MSC_VER
+  unsigned long idx;
+  #if defined _WIN64
+  _BitScanForward64(&idx, bits);
+  #else
+  if (!_BitScanForward(&idx, static_cast<unsigned long>(bits)))
+  {
+    _BitScanForward(&idx, static_cast<unsigned long>(bits >> 32));
+    idx += 32;
+  }
+  #endif
+  return static_cast<int>(idx);
+#else
+  return __builtin_ctzll(bits);
+#endif
+}
+
+// call func(voiceIdx) for each bit set in words, in ascending order
+template <class F>
+static inline void ForEachVoiceBit(const uint64_t* words, int nWords, F func)
+{
+  for (auto w = 0; w < nWords; w++)
+  {
+    for (uint64_t bits = words[w]; bits; bits &= bits - 1)
+    {
+      func(w * 64 + LowestBit(bits));
+    }
+  }
+}
+
 std::ostream& operator<< (std::ostream& out, const VoiceInputEvent& r)
 {
   out << "[z" << (int)r.mAddress.mZone << " c" << (int)r.mAddress.mChannel << " k" << (int)r.mAddress.mKey << " f" << (int)r.mAddress.mFlags << "]"  ;
@@ -41,6 +79,28 @@ void VoiceAllocator::Clear()
   mHeldKeys.clear();
   mSustainedNotes.clear();
   HardKillAllVoices();
+  UpdateBusyVoices();
+}
+
+void VoiceAllocator::SetLevelTracking(bool enable, double silenceThresholdDB, int silenceTimeSamples)
+{
+  mLevelTracking = enable;
+  mSilenceThreshold = static_cast<float>(std::pow(10., silenceThresholdDB / 20.));
+  mSilenceTimeSamples = silenceTimeSamples;
+
+  for(int v = 0; v < kMaxVoices; v++)
+  {
+    mVoiceLevels[v] = 1.f;
+    mVoiceSilentSamples[v] = 0;
+  }
+}
+
+void VoiceAllocator::UpdateBusyVoices()
+{
+  for(int v = 0; v < mVoicePtrs.size(); v++)
+  {
+    SetVoiceBusy(v);
+  }
 }
 
 void VoiceAllocator::ClearVoiceInputs(SynthVoice* pVoice)
@@ -55,11 +115,19 @@ void VoiceAllocator::AddVoice(SynthVoice* pVoice, uint8_t zone)
 {
   if(mVoicePtrs.size() + 1 < UCHAR_MAX)
   {
+    const int voiceIdx = static_cast<int>(mVoicePtrs.size());
     mVoicePtrs.push_back(pVoice);
     ClearVoiceInputs(pVoice);
     pVoice->mKey = -1;
     pVoice->mZone = zone;
 
+    mVoiceZones[voiceIdx] = zone;
+    mVoiceChannels[voiceIdx] = pVoice->mChannel;
+    mVoiceKeys[voiceIdx] = pVoice->mKey;
+    mVoiceTriggerTimes[voiceIdx] = pVoice->mLastTriggeredTime;
+    mAllVoices.Set(voiceIdx, true);
+    SetVoiceBusy(voiceIdx);
+
     // make a glides structures for the control ramps of the new voice
     mVoiceGlides.emplace_back(ControlRampProcessor::Create(pVoice->mInputs));
   }
@@ -69,26 +137,46 @@ void VoiceAllocator::AddVoice(SynthVoice* pVoice, uint8_t zone)
   }
 }
 
-VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddress addr)
+void VoiceAllocator::KeepMatchingVoices(VoiceBitsArray& v, const uint8_t* values, uint8_t value)
 {
-  const int n = static_cast<int>(mVoicePtrs.size());
-  VoiceBitsArray v;
+  constexpr uint64_t kLow7 = 0x7F7F7F7F7F7F7F7Full;
+  constexpr uint64_t kOnes = 0x0101010101010101ull;
+  const uint64_t pattern = kOnes * value;
 
-  // set all bits to true
-  for(int i=0; i<n; ++i)
+  for (auto w = 0; w < VoiceBitsArray::kNumWords; w++)
   {
-    v[i] = true;
+    if (!v.mWords[w])
+      continue;
+
+    uint64_t matches = 0;
+
+    for (auto g = 0; g < 8; g++)
+    {
+      uint64_t bytes;
+      memcpy(&bytes, values + w * 64 + g * 8, sizeof(bytes));
+
+      // the high bit of each byte is set if the byte is nonzero, i.e. if the value differs
+      const uint64_t diff = bytes ^ pattern;
+      const uint64_t nonzero = ((diff & kLow7) + kLow7) | diff;
+      // gather the inverted high bits, one per voice
+      const uint64_t equal = (~nonzero >> 7) & kOnes;
+      matches |= ((equal * 0x0102040810204080ull) >> 56) << (g * 8);
+    }
+
+    v.mWords[w] &= matches;
   }
+}
+
+VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddress addr) const
+{
+  VoiceBitsArray v = mAllVoices;
 
   // for each criterion present in address, clear any voice bits not matching
 
   // zone
   if(addr.mZone != kAllZones)
   {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mZone == addr.mZone);
-    }
+    KeepMatchingVoices(v, mVoiceZones.data(), addr.mZone);
   }
 
   // setting the flag kVoicesAll returns all voices matching the zone of the address.
@@ -97,27 +185,21 @@ VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddres
   // channel
   if(addr.mChannel != kAllChannels)
   {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mChannel == addr.mChannel);
-    }
+    KeepMatchingVoices(v, mVoiceChannels.data(), addr.mChannel);
   }
 
   // Key
   if(addr.mKey != kAllKeys)
   {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mKey == addr.mKey);
-    }
+    KeepMatchingVoices(v, mVoiceKeys.data(), addr.mKey);
   }
 
   // busy flag
   if(addr.mFlags & kVoicesBusy)
   {
-    for(int i=0; i<n; ++i)
+    for(auto w = 0; w < VoiceBitsArray::kNumWords; w++)
     {
-      v[i] = v[i] & mVoicePtrs[i]->GetBusy();
+      v.mWords[w] &= mBusyVoices.mWords[w];
     }
   }
 
@@ -126,29 +208,20 @@ VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddres
   {
     int64_t maxT = -1;
     int maxIdx = -1;
-    for(int i=0; i<n; ++i)
-    {
-      if(v[i])
+
+    ForEachVoiceBit(v.mWords, VoiceBitsArray::kNumWords, [&](int i) {
+      if(mVoiceTriggerTimes[i] > maxT)
       {
-        int64_t vt = mVoicePtrs[i]->mLastTriggeredTime;
-        if(vt > maxT)
-        {
-          maxT = vt;
-          maxIdx = i;
-        }
+        maxT = mVoiceTriggerTimes[i];
+        maxIdx = i;
       }
-    }
+    });
 
-    // set all bits to false
-    //v.reset();
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = 0;
-    }
+    v = VoiceBitsArray();
 
     if(maxIdx >= 0)
     {
-      v[maxIdx] = true;
+      v.Set(maxIdx, true);
     }
   }
   return v;
@@ -157,36 +230,24 @@ VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddres
 void VoiceAllocator::SendControlToVoiceInputs(VoiceBitsArray v, int ctlIdx, float val, int glideSamples)
 {
   // send control change to all matched voices through glide generators
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(v[i])
-    {
-      mVoiceGlides[i]->at(ctlIdx).SetTarget(val, 0, glideSamples, mBlockSize);
-    }
-  }
+  ForEachVoiceBit(v.mWords, VoiceBitsArray::kNumWords, [&](int i) {
+    mVoiceGlides[i]->at(ctlIdx).SetTarget(val, 0, glideSamples, mBlockSize);
+  });
 }
 
 void VoiceAllocator::SendControlToVoicesDirect(VoiceBitsArray v, int ctlIdx, float val)
 {
   // send generic control change directly to voice
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(v[i])
-    {
-      mVoicePtrs[i]->SetControl(ctlIdx, val);
-    }
-  }
+  ForEachVoiceBit(v.mWords, VoiceBitsArray::kNumWords, [&](int i) {
+    mVoicePtrs[i]->SetControl(ctlIdx, val);
+  });
 }
 
 void VoiceAllocator::SendProgramChangeToVoices(VoiceBitsArray v, int pgm)
 {
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(v[i])
-    {
-      mVoicePtrs[i]->SetProgramNumber(pgm);
-    }
-  }
+  ForEachVoiceBit(v.mWords, VoiceBitsArray::kNumWords, [&](int i) {
+    mVoicePtrs[i]->SetProgramNumber(pgm);
+  });
 }
 
 void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
@@ -292,30 +353,64 @@ void VoiceAllocator::CalcGlideTimesInSamples()
 
 int VoiceAllocator::FindFreeVoiceIndex(int startIndex) const
 {
-  size_t voices = mVoicePtrs.size();
-  for(int i=0; i<voices; ++i)
+  const int voices = static_cast<int>(mVoicePtrs.size());
+
+  if(!voices)
+    return -1;
+
+  startIndex %= voices;
+
+  // the first free voice at or after startIndex, wrapping around
+  for(int pass = 0; pass < 2; ++pass)
   {
-    int j = (startIndex + i)%voices;
-    SynthVoice* pv = mVoicePtrs[j];
-    if(!pv->GetBusy())
+    const int first = pass ? 0 : startIndex;
+
+    for(int w = first / 64; w < VoiceBitsArray::kNumWords; ++w)
     {
-      return j;
+      uint64_t free = mAllVoices.mWords[w] & ~mBusyVoices.mWords[w];
+
+      if(w == first / 64)
+        free &= ~uint64_t(0) << (first % 64);
+
+      if(free)
+        return w * 64 + LowestBit(free);
     }
   }
+
   return -1;
 }
 
 int VoiceAllocator::FindVoiceIndexToSteal(int64_t sampleTime) const
 {
-  size_t voices = mVoicePtrs.size();
+  const int voices = static_cast<int>(mVoicePtrs.size());
+
+  if(mLevelTracking && voices)
+  {
+    // the quietest released voice, or else the quietest voice
+    int quietestIdx[2] = {-1, -1};
+    float quietestLevel[2] = {0.f, 0.f};
+
+    for(int i=0; i<voices; ++i)
+    {
+      const int held = mVoiceKeys[i] != kAllKeys;
+
+      if(quietestIdx[held] < 0 || mVoiceLevels[i] < quietestLevel[held])
+      {
+        quietestIdx[held] = i;
+        quietestLevel[held] = mVoiceLevels[i];
+      }
+    }
+
+    return quietestIdx[0] >= 0 ? quietestIdx[0] : quietestIdx[1];
+  }
+
   int64_t earliestTime = sampleTime;
   int longestPlayingVoiceIdx = 0;
   for(int i=0; i<voices; ++i)
   {
-    SynthVoice* pv = mVoicePtrs[i];
-    if(pv->mLastTriggeredTime < earliestTime)
+    if(mVoiceTriggerTimes[i] < earliestTime)
     {
-      earliestTime = pv->mLastTriggeredTime;
+      earliestTime = mVoiceTriggerTimes[i];
       longestPlayingVoiceIdx = i;
     }
   }
@@ -341,39 +436,43 @@ void VoiceAllocator::StartVoice(int voiceIdx, int channel, int key, float pitch,
   pVoice->mKey = key;
   pVoice->mGain = 1.;
 
+  // until it is measured, a new voice counts as loud
+  mCulledVoices.Set(voiceIdx, false);
+  mVoiceLevels[voiceIdx] = 1.f;
+  mVoiceSilentSamples[voiceIdx] = 0;
+
+  mVoiceTriggerTimes[voiceIdx] = sampleTime;
+  mVoiceChannels[voiceIdx] = static_cast<uint8_t>(channel);
+  mVoiceKeys[voiceIdx] = static_cast<uint8_t>(key);
+
   // call voice's Trigger method
   pVoice->Trigger(velocity, retrig);
+  SetVoiceBusy(voiceIdx);
 }
 
 // start all of the voice indexes marked in the VoieBitsArray and set the current channel and key of each.
 void VoiceAllocator::StartVoices(VoiceBitsArray vbits, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig)
 {
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(vbits[i])
-    {
-      StartVoice(i, channel, key, pitch, velocity, sampleOffset, sampleTime, retrig);
-    }
-  }
+  ForEachVoiceBit(vbits.mWords, VoiceBitsArray::kNumWords, [&](int i) {
+    StartVoice(i, channel, key, pitch, velocity, sampleOffset, sampleTime, retrig);
+  });
 }
 
 void VoiceAllocator::StopVoice(int voiceIdx, int sampleOffset)
 {
   mVoiceGlides[voiceIdx]->at(kVoiceControlGate).SetTarget(0.0, sampleOffset, 1, mBlockSize);
   mVoicePtrs[voiceIdx]->mKey = -1;
+  mVoiceKeys[voiceIdx] = mVoicePtrs[voiceIdx]->mKey;
   mVoicePtrs[voiceIdx]->Release();
+  SetVoiceBusy(voiceIdx);
 }
 
 // stop all voices marked in the VoiceBitsArray.
 void VoiceAllocator::StopVoices(VoiceBitsArray vbits, int sampleOffset)
 {
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(vbits[i])
-    {
-      StopVoice(i, sampleOffset);
-    }
-  }
+  ForEachVoiceBit(vbits.mWords, VoiceBitsArray::kNumWords, [&](int i) {
+    StopVoice(i, sampleOffset);
+  });
 }
 
 void VoiceAllocator::SoftKillAllVoices()
@@ -426,6 +525,7 @@ void VoiceAllocator::NoteOn(VoiceInputEvent e, int64_t sampleTime)
       if(i < 0)
       {
         i = FindVoiceIndexToSteal(sampleTime);
+        mNumVoicesStolen.fetch_add(1, std::memory_order_relaxed);
       }
       if(mRotateVoices)
       {
@@ -479,7 +579,7 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
     if(!mHeldKeys.empty())
     {
       queuedKey = mHeldKeys.back();
-      if (queuedKey != mVoicePtrs[0]->mKey)
+      if (queuedKey != mVoiceKeys[0])
       {
         doPlayQueuedKey = true;
         if(mSustainPedalDown)
@@ -495,7 +595,7 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
       if(!mSustainedNotes.empty())
       {
         queuedKey = mSustainedNotes.back();
-        if (queuedKey != mVoicePtrs[0]->mKey)
+        if (queuedKey != mVoiceKeys[0])
         {
           doPlayQueuedKey = true;
         }
@@ -529,12 +629,70 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
 
 void VoiceAllocator::ProcessVoices(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIndex, int blockSize)
 {
-  for(auto pVoice : mVoicePtrs)
+  // the level of a voice is the peak of what it adds to the outputs at the end of the slice
+  const int nLevelFrames = mLevelTracking ? std::min(blockSize, static_cast<int>(kLevelFrames)) : 0;
+  const int nLevelChans = std::min(nOutputs, static_cast<int>(kMaxLevelChannels));
+  const int levelStart = startIndex + blockSize - nLevelFrames;
+
+  for(int v = 0; v < mVoicePtrs.size(); v++)
   {
+    SynthVoice* pVoice = mVoicePtrs[v];
+
     // TODO distribute voices across cores
-    if(pVoice->GetBusy())
+    if(!mCulledVoices[v] && pVoice->GetBusy())
     {
+      for(int c = 0; c < nLevelChans && nLevelFrames; c++)
+      {
+        memcpy(mLevelScratch.data() + c * kLevelFrames, outputs[c] + levelStart, nLevelFrames * sizeof(sample));
+      }
+
       pVoice->ProcessSamplesAccumulating(inputs, outputs, nInputs, nOutputs, startIndex, blockSize);
+
+      if(nLevelFrames)
+      {
+        sample peak = 0.;
+
+        for(int c = 0; c < nLevelChans; c++)
+        {
+          const sample* pBefore = mLevelScratch.data() + c * kLevelFrames;
+          const sample* pAfter = outputs[c] + levelStart;
+
+          for(int s = 0; s < nLevelFrames; s++)
+          {
+            peak = std::max(peak, std::abs(pAfter[s] - pBefore[s]));
+          }
+        }
+
+        // only the measured samples count towards the silence time, a voice may have been loud earlier in a long slice
+        UpdateVoiceLevel(v, static_cast<float>(peak), nLevelFrames);
+      }
+
+      SetVoiceBusy(v);
+    }
+    else
+    {
+      mBusyVoices.Set(v, false);
     }
   }
 }
+
+void VoiceAllocator::UpdateVoiceLevel(int voiceIdx, float peak, int nFrames)
+{
+  mVoiceLevels[voiceIdx] = peak;
+
+  // held and sustained voices are never culled, their key is only cleared by StopVoice()
+  if(peak >= mSilenceThreshold || mVoiceKeys[voiceIdx] != kAllKeys)
+  {
+    mVoiceSilentSamples[voiceIdx] = 0;
+    return;
+  }
+
+  mVoiceSilentSamples[voiceIdx] += nFrames;
+
+  if(mVoiceSilentSamples[voiceIdx] >= mSilenceTimeSamples)
+  {
+    mCulledVoices.Set(voiceIdx, true);
+    mVoicePtrs[voiceIdx]->Cull();
+    mNumVoicesCulled.fetch_add(1, std::memory_order_relaxed);
+  }
+}
@@ -16,10 +16,12 @@
  */
 
 #include <array>
+#include <atomic>
+#include <climits>
+#include <memory>
 #include <vector>
 #include <stdint.h>
 #include <functional>
-#include <bitset>
 //#include <iostream>
 
 #include "IPlugLogger.h"
@@ -137,14 +139,70 @@ public:
 
   void ProcessVoices(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIndex, int blockSize);
 
+  /** Track the output level of each voice, measured on its contribution to the outputs in ProcessVoices(), over the last
+   * samples of each slice. Released voices that stay below silenceThresholdDB for silenceTimeSamples measured samples are
+   * culled, i.e. freed early, which saves processing long inaudible release tails. Slices longer than the measured 64 samples
+   * take longer to cull a voice, but never cull one that was loud earlier in the slice. When a voice has to be stolen, the quietest released voice
+   * is chosen, or else the quietest voice, instead of the oldest.
+   * @param enable \c true to track levels, off by default
+   * @param silenceThresholdDB The peak level below which a voice is considered silent
+   * @param silenceTimeSamples How many measured samples a released voice has to be silent for before it is culled */
+  void SetLevelTracking(bool enable, double silenceThresholdDB = -120., int silenceTimeSamples = 1024);
+
+  /** @return The peak level of the voice's output in its last processed slice, linear, if level tracking is enabled */
+  float GetVoiceLevel(int voiceIdx) const { return mVoiceLevels[voiceIdx]; }
+
+  /** @return \c true if the voice was culled, and is neither processed nor considered busy until it is triggered again */
+  bool GetVoiceCulled(int voiceIdx) const { return mCulledVoices[voiceIdx]; }
+
+  /** @return The number of voices culled because they were silent, since the last call to ResetVoiceCounters() */
+  uint64_t GetNumVoicesCulled() const { return mNumVoicesCulled.load(std::memory_order_relaxed); }
+
+  /** @return The number of voices stolen for new notes, since the last call to ResetVoiceCounters() */
+  uint64_t GetNumVoicesStolen() const { return mNumVoicesStolen.load(std::memory_order_relaxed); }
+
+  void ResetVoiceCounters()
+  {
+    mNumVoicesCulled.store(0, std::memory_order_relaxed);
+    mNumVoicesStolen.store(0, std::memory_order_relaxed);
+  }
+
+  /** Update the busy state of all voices kept by the allocator. Call this if voices are started or stopped other than
+   * through the allocator, busy voices are otherwise tracked as they are triggered, released and processed. */
+  void UpdateBusyVoices();
+
   size_t GetNVoices() const {return mVoicePtrs.size();}
   SynthVoice* GetVoice(int voiceIndex) const {return mVoicePtrs[voiceIndex];}
   void SetPitchOffset(float offset) { mPitchOffset = offset; }
 
 private:
-  using VoiceBitsArray = std::bitset<UCHAR_MAX>;
+  static constexpr int kMaxVoices = 256;
 
-  VoiceBitsArray VoicesMatchingAddress(VoiceAddress va);
+  /** One bit per voice, 64 voices per word */
+  struct VoiceBitsArray
+  {
+    static constexpr int kNumWords = kMaxVoices / 64;
+
+    uint64_t mWords[kNumWords] = {};
+
+    bool operator[](int voiceIdx) const { return (mWords[voiceIdx / 64] >> (voiceIdx % 64)) & 1; }
+    void Set(int voiceIdx, bool value)
+    {
+      const uint64_t bit = uint64_t(1) << (voiceIdx % 64);
+      mWords[voiceIdx / 64] = value ? (mWords[voiceIdx / 64] | bit) : (mWords[voiceIdx / 64] & ~bit);
+    }
+  };
+
+  VoiceBitsArray VoicesMatchingAddress(VoiceAddress va) const;
+
+  /** Clear the bits of voices for which values[voiceIdx] != value, eight voices at a time */
+  static void KeepMatchingVoices(VoiceBitsArray& v, const uint8_t* values, uint8_t value);
+
+  void SetVoiceBusy(int voiceIdx) { mBusyVoices.Set(voiceIdx, !mCulledVoices[voiceIdx] && mVoicePtrs[voiceIdx]->GetBusy()); }
+
+  /** Update the level of a voice from the peak of the nFrames samples measured at the end of its last slice, and cull it if it
+   * has been released and silent for long enough */
+  void UpdateVoiceLevel(int voiceIdx, float peak, int nFrames);
 
   void SendControlToVoiceInputs(VoiceBitsArray v, int ctlIdx, float val, int glideSamples);
   void SendControlToVoicesDirect(VoiceBitsArray v, int ctlIdx, float val);
@@ -167,6 +225,28 @@ private:
   IPlugQueue<VoiceInputEvent> mInputQueue{1024};
 
   std::vector<SynthVoice*> mVoicePtrs;
+
+  // voice addressing data, kept here in contiguous arrays so that voices can be matched without visiting each SynthVoice.
+  // mZone, mChannel, mKey and mLastTriggeredTime of the voices are still set for their own use
+  alignas(64) std::array<uint8_t, kMaxVoices> mVoiceZones {};
+  alignas(64) std::array<uint8_t, kMaxVoices> mVoiceChannels {};
+  alignas(64) std::array<uint8_t, kMaxVoices> mVoiceKeys {};
+  std::array<int64_t, kMaxVoices> mVoiceTriggerTimes {};
+  VoiceBitsArray mAllVoices; // a bit for each voice that has been added
+  VoiceBitsArray mBusyVoices; // GetBusy() of each voice, as of the last trigger, release or process
+  VoiceBitsArray mCulledVoices; // voices freed by level tracking, until they are triggered again
+
+  // level tracking
+  static constexpr int kLevelFrames = 64; // the number of samples at the end of each slice that a voice's level is measured on
+  static constexpr int kMaxLevelChannels = 8;
+  bool mLevelTracking{false};
+  float mSilenceThreshold{1e-6f};
+  int mSilenceTimeSamples{1024};
+  std::array<float, kMaxVoices> mVoiceLevels {};
+  std::array<int, kMaxVoices> mVoiceSilentSamples {};
+  std::array<sample, kLevelFrames * kMaxLevelChannels> mLevelScratch {};
+  std::atomic<uint64_t> mNumVoicesCulled{0};
+  std::atomic<uint64_t> mNumVoicesStolen{0};
   std::vector<std::unique_ptr<VoiceControlRamps>> mVoiceGlides;
   std::vector<int> mHeldKeys; // The currently physically held keys on the keyboard
   std::vector<int> mSustainedNotes; // Any notes that are sustained, including those that are physically held
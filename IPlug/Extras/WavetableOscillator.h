@@ -0,0 +1,320 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Mip-mapped band-limited wavetable oscillators, rendering several voices per SIMD instruction
+ */
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "IPlugPlatform.h"
+#include "SIMDLane.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** An immutable set of band-limited single cycle tables, one per octave.
+ * Table L contains the partials up to kTableSize/2 >> L, so it plays without aliasing as long as the fundamental is
+ * below sampleRate * 2^L / kTableSize. Sets are shared between oscillators via std::shared_ptr, and the built-in
+ * shapes returned by Get() are generated once per process, on first use.
+ * @tparam T the sample type */
+template <typename T>
+class WavetableSet
+{
+public:
+  static constexpr int kTableSize = 2048;
+  static constexpr int kNumLevels = 11; // 1024 partials down to 1
+
+  enum EShape
+  {
+    kSine = 0,
+    kSaw,
+    kSquare,
+    kTriangle,
+    kNumShapes
+  };
+
+  /** Create a set from the amplitudes of sine phase harmonics. This allocates and is not realtime safe.
+   * @param amplitudes amplitudes[0] is the fundamental, harmonics above kTableSize/2 are ignored
+   * @param normalize If \c true all tables are scaled by the same factor so that the full bandwidth table peaks at 1 */
+  static std::shared_ptr<const WavetableSet> Create(const std::vector<double>& amplitudes, bool normalize = true)
+  {
+    return std::shared_ptr<const WavetableSet>(new WavetableSet(amplitudes, normalize));
+  }
+
+  /** @return The shared set for one of the built-in shapes */
+  static std::shared_ptr<const WavetableSet> Get(EShape shape)
+  {
+    static const std::array<std::shared_ptr<const WavetableSet>, kNumShapes> sTables = {
+      Create(ShapeAmplitudes(kSine)),
+      Create(ShapeAmplitudes(kSaw)),
+      Create(ShapeAmplitudes(kSquare)),
+      Create(ShapeAmplitudes(kTriangle))
+    };
+
+    return sTables[shape];
+  }
+
+  /** @return kTableSize + 1 samples, the last one being a copy of the first for interpolation */
+  const T* GetTable(int level) const { return mTables.data() + level * (kTableSize + 1); }
+
+  /** @param phaseIncr The fundamental frequency divided by the sample rate
+   * @return The lowest table level that does not alias */
+  static inline int LevelForIncrement(double phaseIncr)
+  {
+    const double partials = std::abs(phaseIncr) * kTableSize;
+
+    if (partials < 1.)
+      return 0;
+
+    return std::min(std::ilogb(partials) + 1, kNumLevels - 1);
+  }
+
+private:
+  WavetableSet(const std::vector<double>& amplitudes, bool normalize)
+  : mTables(kNumLevels * (kTableSize + 1))
+  {
+    std::vector<double> sine(kTableSize);
+    std::vector<double> sum(kTableSize, 0.);
+
+    for (auto i = 0; i < kTableSize; i++)
+    {
+      sine[i] = std::sin(2. * PI * i / kTableSize);
+    }
+
+    // build from the top level down, each level adds the partials of one more octave to the one above
+    std::vector<std::vector<double>> levels(kNumLevels);
+    auto harmonic = 1;
+
+    for (auto level = kNumLevels - 1; level >= 0; level--)
+    {
+      const auto maxHarmonic = std::min<int>((kTableSize / 2) >> level, static_cast<int>(amplitudes.size()));
+
+      for (; harmonic <= maxHarmonic; harmonic++)
+      {
+        const double amp = amplitudes[harmonic - 1];
+
+        if (amp == 0.)
+          continue;
+
+        for (auto i = 0; i < kTableSize; i++)
+        {
+          sum[i] += amp * sine[(harmonic * i) & (kTableSize - 1)];
+        }
+      }
+
+      levels[level] = sum;
+    }
+
+    double peak = 0.;
+
+    for (auto i = 0; i < kTableSize; i++)
+    {
+      peak = std::max(peak, std::abs(levels[0][i]));
+    }
+
+    const double scale = (normalize && peak > 0.) ? 1. / peak : 1.;
+
+    for (auto level = 0; level < kNumLevels; level++)
+    {
+      T* pTable = mTables.data() + level * (kTableSize + 1);
+
+      for (auto i = 0; i < kTableSize; i++)
+      {
+        pTable[i] = static_cast<T>(levels[level][i] * scale);
+      }
+
+      pTable[kTableSize] = pTable[0];
+    }
+  }
+
+  static std::vector<double> ShapeAmplitudes(EShape shape)
+  {
+    std::vector<double> amplitudes(kTableSize / 2, 0.);
+
+    for (auto h = 1; h <= kTableSize / 2; h++)
+    {
+      switch (shape)
+      {
+        case kSine: amplitudes[h - 1] = h == 1 ? 1. : 0.; break;
+        case kSaw: amplitudes[h - 1] = -1. / h; break;
+        case kSquare: amplitudes[h - 1] = (h & 1) ? 1. / h : 0.; break;
+        case kTriangle: amplitudes[h - 1] = (h & 1) ? ((h & 2) ? -1. : 1.) / (h * h) : 0.; break;
+        default: break;
+      }
+    }
+
+    return amplitudes;
+  }
+
+  std::vector<T> mTables;
+};
+
+/** A bank of up to NV wavetable oscillators, e.g. the voices of a synth or the partials of a unison stack.
+ * Oscillators are rendered SIMDLane<T>::kWidth at a time, each lane holding the phase of one oscillator.
+ * The table level is chosen per sample from the frequency, so audio-rate frequency modulation stays band-limited.
+ * @tparam T the sample type
+ * @tparam NV the maximum number of oscillators */
+template <typename T, int NV = 8>
+class WavetableOscillatorBank
+{
+  using Lane = SIMDLane<T>;
+  using Tables = WavetableSet<T>;
+  static constexpr int kLaneWidth = Lane::kWidth;
+
+public:
+  WavetableOscillatorBank(typename Tables::EShape shape = Tables::kSaw)
+  : mTables(Tables::Get(shape))
+  {
+    for (auto v = 0; v < NV; v++)
+    {
+      SetFreqCPS(v, 440.);
+    }
+  }
+
+  /** Swap in another set of tables. Not realtime safe if this releases the last reference to the previous set */
+  void SetTables(std::shared_ptr<const Tables> tables) { mTables = std::move(tables); }
+
+  void SetShape(typename Tables::EShape shape) { mTables = Tables::Get(shape); }
+
+  void SetSampleRate(double sampleRate)
+  {
+    for (auto v = 0; v < NV; v++)
+    {
+      mPhaseIncr[v] = static_cast<T>(mPhaseIncr[v] * mSampleRate / sampleRate);
+    }
+
+    mSampleRate = sampleRate;
+  }
+
+  /** Set the frequency used when ProcessBlock() is called without frequency buffers */
+  void SetFreqCPS(int voice, double freqHz) { mPhaseIncr[voice] = static_cast<T>(freqHz / mSampleRate); }
+
+  /** @param phase The phase in cycles, 0. to 1. */
+  void SetPhase(int voice, double phase) { mPhase[voice] = static_cast<T>(phase - std::floor(phase)); }
+
+  void Reset()
+  {
+    for (auto v = 0; v < NV; v++)
+    {
+      mPhase[v] = T(0);
+    }
+  }
+
+  /** Render each oscillator to its own output buffer
+   * @param freqCPS nVoices buffers of nFrames frequencies in Hz, or nullptr to use the values from SetFreqCPS()
+   * @param outputs nVoices output buffers */
+  void ProcessBlock(float** freqCPS, T** outputs, int nVoices, int nFrames)
+  {
+    assert(nVoices <= NV);
+
+    auto v = 0;
+    for (; v + kLaneWidth <= nVoices; v += kLaneWidth)
+      ProcessLanes<Lane, false>(freqCPS, outputs + v, nullptr, v, nFrames);
+    for (; v < nVoices; v++)
+      ProcessLanes<ScalarLane<T>, false>(freqCPS, outputs + v, nullptr, v, nFrames);
+  }
+
+  /** Render the sum of the oscillators into one buffer, e.g. for unison
+   * @param freqCPS nVoices buffers of nFrames frequencies in Hz, or nullptr to use the values from SetFreqCPS()
+   * @param output The buffer to add the oscillators to
+   * @param gains nVoices gains, or nullptr for unity gain */
+  void ProcessBlockAccumulating(float** freqCPS, T* output, int nVoices, int nFrames, const T* gains = nullptr)
+  {
+    assert(nVoices <= NV);
+
+    auto v = 0;
+    for (; v + kLaneWidth <= nVoices; v += kLaneWidth)
+      ProcessLanes<Lane, true>(freqCPS, &output, gains, v, nFrames);
+    for (; v < nVoices; v++)
+      ProcessLanes<ScalarLane<T>, true>(freqCPS, &output, gains, v, nFrames);
+  }
+
+private:
+  template <typename L, bool accumulate>
+  inline void ProcessLanes(float** freqCPS, T** outputs, const T* gains, int startVoice, int nFrames)
+  {
+    using LV = typename L::Type;
+    constexpr int W = L::kWidth;
+
+    const T* pTables = mTables->GetTable(0);
+    const LV tableSize = L::Set1(T(Tables::kTableSize));
+    const T invSampleRate = static_cast<T>(1. / mSampleRate);
+
+    alignas(32) T incr[W], index[W], y0[W], y1[W], out[W], gain[W];
+    int level[W];
+
+    for (auto l = 0; l < W; l++)
+    {
+      incr[l] = mPhaseIncr[startVoice + l];
+      level[l] = Tables::LevelForIncrement(incr[l]);
+      gain[l] = gains ? gains[startVoice + l] : T(1);
+    }
+
+    const LV vGain = L::Load(gain);
+    LV phase = L::Load(mPhase + startVoice);
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      if (freqCPS)
+      {
+        for (auto l = 0; l < W; l++)
+        {
+          incr[l] = freqCPS[startVoice + l][s] * invSampleRate;
+          level[l] = Tables::LevelForIncrement(incr[l]);
+        }
+      }
+
+      L::Store(index, L::Mul(phase, tableSize));
+
+      // tables are looked up per lane, the interpolation is done across lanes
+      for (auto l = 0; l < W; l++)
+      {
+        const int i = static_cast<int>(index[l]);
+        const T* pTable = pTables + level[l] * (Tables::kTableSize + 1) + (i & (Tables::kTableSize - 1));
+        index[l] -= T(i);
+        y0[l] = pTable[0];
+        y1[l] = pTable[1];
+      }
+
+      const LV vy0 = L::Load(y0);
+      const LV y = L::Add(vy0, L::Mul(L::Sub(L::Load(y1), vy0), L::Load(index)));
+
+      phase = L::Add(phase, L::Load(incr));
+      phase = L::Sub(phase, L::Floor(phase));
+
+      if (accumulate)
+      {
+        outputs[0][s] += L::HSum(L::Mul(y, vGain));
+      }
+      else
+      {
+        L::Store(out, y);
+
+        for (auto l = 0; l < W; l++)
+          outputs[l][s] = out[l];
+      }
+    }
+
+    L::Store(mPhase + startVoice, phase);
+  }
+
+  std::shared_ptr<const Tables> mTables;
+  double mSampleRate = 44100.;
+  alignas(32) T mPhase[NV] = {};
+  alignas(32) T mPhaseIncr[NV] = {};
+} WDL_FIXALIGN;
+
+END_IPLUG_NAMESPACE
@@ -136,6 +136,13 @@ using namespace iplug;
 {
   if ([[message name] isEqualToString:@"callback"])
   {
+    // strings, e.g. batched frames, are passed on as they are
+    if ([message.body isKindOfClass:[NSString class]])
+    {
+      mWebView->OnMessageFromWebView([(NSString*) message.body UTF8String]);
+      return;
+    }
+
     NSDictionary* dict = (NSDictionary*) message.body;
     NSData* data = [NSJSONSerialization dataWithJSONObject:dict options:NSJSONWritingPrettyPrinted error:nil];
     NSString* jsonString = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
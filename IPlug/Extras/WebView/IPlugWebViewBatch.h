@@ -0,0 +1,299 @@
+/*
+ ==============================================================================
+ 
+  MIT License
+
+  iPlug2 WebView Library
+  Copyright (c) 2024 Oliver Larkin
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ 
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Binary message frames for the batched transport of WebViewEditorDelegate, see WebViewEditorDelegate::SetBatchedTransport()
+ *
+ * A frame is a sequence of records, each starting on a 4 byte boundary with a uint32 type from EWebViewBatchMsg,
+ * followed by the fields listed there. Data payloads are padded to 4 bytes, so that the page can view them as
+ * Float32Array etc. without copying. Fields are written in native byte order, which is little endian on every supported target.
+ * Frames travel base64 encoded, once per frame rather than once per message.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "IPlugPlatform.h"
+#include "wdlstring.h"
+#include "wdl_base64.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Record types of a batched frame, named after the messages they carry */
+enum EWebViewBatchMsg : uint32_t
+{
+  // delegate to UI, delivered with one call to IPlugBatchFD() per frame
+  kBatchSCVFD = 1, // int32 ctrlTag, float64 normalized value
+  kBatchSPVFD,     // int32 paramIdx, float64 normalized value
+  kBatchSCMFD,     // int32 ctrlTag, int32 msgTag, int32 size, payload
+  kBatchSAMFD,     // int32 msgTag, int32 size, payload
+  kBatchSMMFD,     // uint8 status, uint8 data1, uint8 data2, uint8 unused
+
+  // UI to delegate, posted by IPlugUIBatch once per task
+  kBatchSPVFUI = 16, // int32 paramIdx, float64 normalized value
+  kBatchBPCFUI,      // int32 paramIdx
+  kBatchEPCFUI,      // int32 paramIdx
+  kBatchSAMFUI,      // int32 msgTag, int32 ctrlTag, int32 size, payload
+  kBatchSMMFUI       // uint8 status, uint8 data1, uint8 data2, uint8 unused
+};
+
+/** A batched frame posted from the page is a string message with this prefix, followed by the base64 encoded frame */
+static constexpr const char* kWebViewBatchPrefix = "IPLUGBATCH:";
+
+/** Accumulates records into a frame. The buffer is kept between frames, so that steady traffic doesn't allocate */
+class WebViewBatchWriter
+{
+public:
+  void Clear() { mData.clear(); }
+  bool Empty() const { return mData.empty(); }
+  int Size() const { return static_cast<int>(mData.size()); }
+  const uint8_t* Data() const { return mData.data(); }
+
+  /** @return The size of the frame after base64 encoding */
+  int EncodedSize() const { return ((Size() + 2) / 3) * 4; }
+
+  void PutType(EWebViewBatchMsg type) { PutUInt32(type); }
+  void PutInt32(int32_t value) { Put(&value, sizeof(value)); }
+  void PutUInt32(uint32_t value) { Put(&value, sizeof(value)); }
+  void PutDouble(double value) { Put(&value, sizeof(value)); }
+
+  void PutBytes4(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3)
+  {
+    const uint8_t bytes[4] = {b0, b1, b2, b3};
+    Put(bytes, 4);
+  }
+
+  /** Put an int32 size followed by the payload, padded to 4 bytes */
+  void PutData(const void* pData, int size)
+  {
+    PutInt32(size);
+
+    if (size > 0)
+      Put(pData, size);
+
+    mData.resize((mData.size() + 3) & ~static_cast<size_t>(3), 0);
+  }
+
+  /** Wrap the frame into a script calling IPlugBatchFD(), replacing the contents of str.
+   * The call is guarded, so that frames arriving while the page reloads are dropped rather than throwing */
+  void GetScript(WDL_String& str) const
+  {
+    static constexpr const char* kPrefix = "typeof IPlugBatchFD === 'function' && IPlugBatchFD('";
+    static constexpr const char* kSuffix = "')";
+    const int prefixLen = static_cast<int>(strlen(kPrefix));
+    const int suffixLen = static_cast<int>(strlen(kSuffix));
+    const int encodedLen = EncodedSize();
+
+    str.SetLen(prefixLen + encodedLen + suffixLen);
+    char* pStr = str.Get();
+    memcpy(pStr, kPrefix, prefixLen);
+    wdl_base64encode(mData.data(), pStr + prefixLen, Size());
+    memcpy(pStr + prefixLen + encodedLen, kSuffix, suffixLen + 1);
+  }
+
+private:
+  void Put(const void* pSrc, size_t size)
+  {
+    const size_t pos = mData.size();
+    mData.resize(pos + size);
+    memcpy(mData.data() + pos, pSrc, size);
+  }
+
+  std::vector<uint8_t> mData;
+};
+
+/** Reads the records of a frame. Every Get method returns \c false, leaving the reader at the end, if the frame is truncated */
+class WebViewBatchReader
+{
+public:
+  WebViewBatchReader(const uint8_t* pData, int size)
+  : mPos(pData)
+  , mEnd(pData + size)
+  {
+  }
+
+  bool AtEnd() const { return mPos >= mEnd; }
+
+  bool GetType(uint32_t& type) { return Get(&type, sizeof(type)); }
+  bool GetInt32(int32_t& value) { return Get(&value, sizeof(value)); }
+  bool GetDouble(double& value) { return Get(&value, sizeof(value)); }
+
+  bool GetBytes4(uint8_t (&bytes)[4]) { return Get(bytes, 4); }
+
+  /** Get a payload written by PutData(). pData points into the frame, so it is only valid as long as the frame.
+   * Both writers pad the payload, so a frame that ends in the padding is truncated too */
+  bool GetData(const uint8_t*& pData, int& size)
+  {
+    int32_t len;
+
+    if (!GetInt32(len) || len < 0)
+      return Fail();
+
+    const size_t padded = (static_cast<size_t>(len) + 3) & ~static_cast<size_t>(3);
+
+    if (padded > static_cast<size_t>(mEnd - mPos))
+      return Fail();
+
+    pData = mPos;
+    size = len;
+    mPos += padded;
+    return true;
+  }
+
+private:
+  bool Get(void* pDst, size_t size)
+  {
+    if (size > static_cast<size_t>(mEnd - mPos))
+      return Fail();
+
+    memcpy(pDst, mPos, size);
+    mPos += size;
+    return true;
+  }
+
+  bool Fail()
+  {
+    mPos = mEnd;
+    return false;
+  }
+
+  const uint8_t* mPos;
+  const uint8_t* mEnd;
+};
+
+/** Defines the page side of the batched transport, evaluated by WebViewEditorDelegate once the page has loaded.
+ *
+ * IPlugBatchFD(frame) dispatches the records of a frame to the same global functions as the unbatched transport
+ * (SCVFD, SPVFD, SCMFD, SAMFD, SMMFD). Data messages are passed as Uint8Array views into the frame to SCMFDBinary(ctrlTag, msgTag, data)
+ * or SAMFDBinary(msgTag, data) if the page defines them, or base64 encoded to SCMFD/SAMFD as before otherwise.
+ *
+ * IPlugUIBatch.SPVFUI(paramIdx, value), BPCFUI(paramIdx), EPCFUI(paramIdx), SAMFUI(msgTag, ctrlTag, data), SMMFUI(status, data1, data2)
+ * append to a frame that is posted to the delegate at the end of the current task, where data is an ArrayBuffer or a typed array. */
+static constexpr const char* kWebViewBatchScript = R"(
+(function() {
+  function fromBase64(str) {
+    if (Uint8Array.fromBase64) return Uint8Array.fromBase64(str);
+    var bin = atob(str), bytes = new Uint8Array(bin.length);
+    for (var i = 0; i < bin.length; i++) bytes[i] = bin.charCodeAt(i);
+    return bytes;
+  }
+
+  function toBase64(bytes) {
+    if (bytes.toBase64) return bytes.toBase64();
+    var bin = '';
+    for (var i = 0; i < bytes.length; i += 0x8000) bin += String.fromCharCode.apply(null, bytes.subarray(i, i + 0x8000));
+    return btoa(bin);
+  }
+
+  function call(name, args) {
+    var fn = window[name];
+    if (typeof fn !== 'function') return false;
+    try { fn.apply(null, args); } catch (e) { console.error(e); }
+    return true;
+  }
+
+  window.IPlugBatchFD = function(frame) {
+    var bytes = fromBase64(frame), view = new DataView(bytes.buffer), pos = 0, end = bytes.length;
+
+    function data() {
+      var size = view.getInt32(pos, true), start = pos + 4;
+      pos = start + ((size + 3) & ~3);
+      return bytes.subarray(start, start + size);
+    }
+
+    while (pos + 4 <= end) {
+      var type = view.getUint32(pos, true);
+      pos += 4;
+
+      switch (type) {
+        case 1: call('SCVFD', [view.getInt32(pos, true), view.getFloat64(pos + 4, true)]); pos += 12; break;
+        case 2: call('SPVFD', [view.getInt32(pos, true), view.getFloat64(pos + 4, true)]); pos += 12; break;
+        case 3: {
+          var ctrlTag = view.getInt32(pos, true), msgTag = view.getInt32(pos + 4, true);
+          pos += 8;
+          var d = data();
+          if (!call('SCMFDBinary', [ctrlTag, msgTag, d])) { var b64 = toBase64(d); call('SCMFD', [ctrlTag, msgTag, b64.length + 1, b64]); }
+          break;
+        }
+        case 4: {
+          var tag = view.getInt32(pos, true);
+          pos += 4;
+          var d = data();
+          if (!call('SAMFDBinary', [tag, d])) { var b64 = toBase64(d); call('SAMFD', [tag, b64.length + 1, b64]); }
+          break;
+        }
+        case 5: call('SMMFD', [bytes[pos], bytes[pos + 1], bytes[pos + 2]]); pos += 4; break;
+        default: console.error('IPlugBatchFD: unknown record ' + type); return;
+      }
+    }
+  };
+
+  var buffer = new ArrayBuffer(1024), view = new DataView(buffer), bytes = new Uint8Array(buffer), size = 0, scheduled = false;
+
+  function reserve(n) {
+    if (size + n > buffer.byteLength) {
+      var grown = new ArrayBuffer(Math.max(buffer.byteLength * 2, size + n));
+      new Uint8Array(grown).set(bytes.subarray(0, size));
+      buffer = grown; view = new DataView(buffer); bytes = new Uint8Array(buffer);
+    }
+    if (!scheduled) { scheduled = true; queueMicrotask(flush); }
+  }
+
+  function putInt32(type, value) { reserve(8); view.setUint32(size, type, true); view.setInt32(size + 4, value, true); size += 8; }
+
+  function flush() {
+    scheduled = false;
+    if (!size) return;
+    var frame = toBase64(bytes.subarray(0, size));
+    size = 0;
+    IPlugSendMsg('IPLUGBATCH:' + frame);
+  }
+
+  window.IPlugUIBatch = {
+    SPVFUI: function(paramIdx, value) { putInt32(16, paramIdx); reserve(8); view.setFloat64(size, value, true); size += 8; },
+    BPCFUI: function(paramIdx) { putInt32(17, paramIdx); },
+    EPCFUI: function(paramIdx) { putInt32(18, paramIdx); },
+    SAMFUI: function(msgTag, ctrlTag, data) {
+      var d = data ? (data instanceof ArrayBuffer ? new Uint8Array(data) : new Uint8Array(data.buffer, data.byteOffset, data.byteLength)) : new Uint8Array(0);
+      putInt32(19, msgTag); reserve(8 + d.length + 3);
+      view.setInt32(size, ctrlTag, true); view.setInt32(size + 4, d.length, true);
+      bytes.set(d, size + 8); bytes.fill(0, size + 8 + d.length, size + 8 + ((d.length + 3) & ~3));
+      size += 8 + ((d.length + 3) & ~3);
+    },
+    SMMFUI: function(status, data1, data2) { reserve(8); view.setUint32(size, 20, true); bytes[size + 4] = status; bytes[size + 5] = data1; bytes[size + 6] = data2; bytes[size + 7] = 0; size += 8; },
+    flush: flush
+  };
+})();
+)";
+
+END_IPLUG_NAMESPACE
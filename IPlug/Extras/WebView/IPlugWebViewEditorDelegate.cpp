@@ -66,7 +66,12 @@ void* WebViewEditorDelegate::OpenWindow(void* pParent)
   }
     
 
+  SetEditorOpen(true);
   mView = OpenWebView(pParent, 0., 0., static_cast<float>(GetEditorWidth()), static_cast<float>(GetEditorHeight()), 1);
+
+  if (!mView)
+    SetEditorOpen(false);
+
   return mView;
 }
 
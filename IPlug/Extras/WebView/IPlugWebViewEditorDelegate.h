@@ -35,6 +35,7 @@
 
 #include "IPlugEditorDelegate.h"
 #include "IPlugWebView.h"
+#include "IPlugWebViewBatch.h"
 #include "wdl_base64.h"
 #include "json.hpp"
 #include <functional>
@@ -82,7 +83,9 @@ public:
 
   void CloseWindow() override
   {
+    SetEditorOpen(false);
     CloseWebView();
+    mBatch.Clear();
   }
 
   bool OnMessage(int msgTag, int ctrlTag, int dataSize, const void* pData) override
@@ -101,6 +104,15 @@ public:
 
   void SendControlValueFromDelegate(int ctrlTag, double normalizedValue) override
   {
+    if (mBatchedTransport)
+    {
+      BeginBatchRecord(16);
+      mBatch.PutType(kBatchSCVFD);
+      mBatch.PutInt32(ctrlTag);
+      mBatch.PutDouble(normalizedValue);
+      return;
+    }
+
     WDL_String str;
     str.SetFormatted(mMaxJSStringLength, "SCVFD(%i, %f)", ctrlTag, normalizedValue);
    #ifdef OS_MAC
@@ -112,6 +124,16 @@ public:
 
   void SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData) override
   {
+    if (mBatchedTransport)
+    {
+      BeginBatchRecord(16 + dataSize);
+      mBatch.PutType(kBatchSCMFD);
+      mBatch.PutInt32(ctrlTag);
+      mBatch.PutInt32(msgTag);
+      mBatch.PutData(pData, dataSize);
+      return;
+    }
+
     WDL_String str;
     std::vector<char> base64;
     base64.resize(B64ENCODE_OUT_SAFESIZE(dataSize));
@@ -132,6 +154,15 @@ public:
     {
       value = GetParam(paramIdx)->ToNormalized(value);
     }
+
+    if (mBatchedTransport)
+    {
+      BeginBatchRecord(16);
+      mBatch.PutType(kBatchSPVFD);
+      mBatch.PutInt32(paramIdx);
+      mBatch.PutDouble(value);
+      return;
+    }
     
     str.SetFormatted(mMaxJSStringLength, "SPVFD(%i, %f)", paramIdx, value);
 #ifdef OS_MAC
@@ -143,6 +174,15 @@ public:
 
   void SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData) override
   {
+    if (mBatchedTransport)
+    {
+      BeginBatchRecord(12 + dataSize);
+      mBatch.PutType(kBatchSAMFD);
+      mBatch.PutInt32(msgTag);
+      mBatch.PutData(pData, dataSize);
+      return;
+    }
+
     WDL_String str;
     std::vector<char> base64;
     base64.resize(B64ENCODE_OUT_SAFESIZE(dataSize));
@@ -158,6 +198,14 @@ public:
   
   void SendMidiMsgFromDelegate(const IMidiMsg& msg) override
   {
+    if (mBatchedTransport)
+    {
+      BeginBatchRecord(8);
+      mBatch.PutType(kBatchSMMFD);
+      mBatch.PutBytes4(msg.mStatus, msg.mData1, msg.mData2, 0);
+      return;
+    }
+
     WDL_String str;
     str.SetFormatted(mMaxJSStringLength, "SMMFD(%i, %i, %i)", msg.mStatus, msg.mData1, msg.mData2);
 #ifdef OS_MAC
@@ -167,6 +215,17 @@ public:
 #endif
   }
   
+  /** Deliver the messages batched since the last call with one script evaluation. Called on each tick of the idle timer */
+  void FlushMessagesFromDelegate() override
+  {
+    if (mBatch.Empty() || !mWebViewReady)
+      return;
+
+    mBatch.GetScript(mBatchScript);
+    mBatch.Clear();
+    EvaluateJavaScript(mBatchScript.Get());
+  }
+
   bool OnKeyDown(const IKeyPress& key) override;
   bool OnKeyUp(const IKeyPress& key) override;
 
@@ -215,6 +274,12 @@ public:
 
   void OnMessageFromWebView(const char* jsonStr) override
   {
+    if (!strncmp(jsonStr, kWebViewBatchPrefix, strlen(kWebViewBatchPrefix)))
+    {
+      OnBatchFromWebView(jsonStr + strlen(kWebViewBatchPrefix));
+      return;
+    }
+
     nlohmann::json json;
     try {
       json = nlohmann::json::parse(jsonStr, nullptr, false);
@@ -222,6 +287,10 @@ public:
       return;
     }
 
+    // a string posted by the page, other than a batch
+    if (!json.is_object())
+      return;
+
     if (json["msg"] == "SPVFUI")
     {
       assert(json["paramIdx"] > -1);
@@ -318,7 +387,13 @@ public:
 
     // Send params using the correct mechanism (SendJSONFromDelegate -> SendArbitraryMsgFromDelegate with -1)
     printf("Sending params via SendJSONFromDelegate\n");
+
+    // defined again on each load, before the first frame
+    if (mBatchedTransport)
+      EvaluateJavaScript(kWebViewBatchScript);
+
     SendJSONFromDelegate(msg);
+    FlushMessagesFromDelegate();
 
    #ifdef OS_MAC
     // First flush all queued JavaScript messages and set mWebViewReady = true
@@ -333,6 +408,18 @@ public:
     mMaxJSStringLength = length;
   }
 
+  /** Batch the messages sent to the page. Rather than evaluating one script per message, with its payload base64 encoded
+   * into the script, the messages sent during a tick of the idle timer are written into one binary frame and delivered with
+   * a single evaluation, see IPlugWebViewBatch.h. The page's SCVFD(), SPVFD() etc. functions are still called, and can receive
+   * data as Uint8Array by defining SCMFDBinary() and SAMFDBinary().
+   * The page can batch its own messages with IPlugUIBatch, which is parsed without going through JSON.
+   * Call this before the editor is opened, e.g. in the constructor */
+  void SetBatchedTransport(bool enable)
+  {
+    mBatchedTransport = enable;
+    mBatch.Clear();
+  }
+
   #ifdef OS_MAC
   // JavaScript message queue system for macOS timing fix
   void QueueJavaScript(const char* scriptStr);
@@ -375,6 +462,11 @@ protected:
   std::queue<std::string> mJavaScriptQueue;
   bool mWebViewReady = false;
   std::mutex mQueueMutex;
+
+  bool mBatchedTransport = false;
+  WebViewBatchWriter mBatch;
+  WDL_String mBatchScript;
+  std::vector<uint8_t> mBatchFromWebView;
   
 private:
   IKeyPress ConvertToIKeyPress(uint32_t keyCode, const char* utf8, bool shift, bool ctrl, bool alt)
@@ -382,6 +474,67 @@ private:
     return IKeyPress(utf8, DOMKeyToVirtualKey(keyCode), shift,ctrl, alt);
   }
 
+  /** Make room for a record of about recordSize bytes, delivering or dropping the frame first if it would grow past mMaxJSStringLength */
+  void BeginBatchRecord(int recordSize)
+  {
+    if (mBatch.Empty() || ((mBatch.Size() + recordSize + 2) / 3) * 4 < mMaxJSStringLength)
+      return;
+
+    if (mWebViewReady)
+      FlushMessagesFromDelegate();
+    else
+    {
+      DBGMSG("WebViewEditorDelegate: dropping a batch of %i bytes, the page has not loaded\n", mBatch.Size());
+      mBatch.Clear();
+    }
+  }
+
+  void OnBatchFromWebView(const char* base64)
+  {
+    const int len = static_cast<int>(strlen(base64));
+    mBatchFromWebView.resize(B64DECODE_OUT_SAFESIZE(len) + 1);
+    const int size = wdl_base64decode(base64, mBatchFromWebView.data(), static_cast<int>(mBatchFromWebView.size()));
+
+    WebViewBatchReader reader(mBatchFromWebView.data(), size);
+    uint32_t type;
+
+    while (reader.GetType(type))
+    {
+      int32_t idx, msgTag, ctrlTag;
+      double value;
+      uint8_t bytes[4];
+      const uint8_t* pData;
+      int dataSize;
+
+      switch (type)
+      {
+        case kBatchSPVFUI:
+          if (reader.GetInt32(idx) && reader.GetDouble(value) && idx > -1 && idx < NParams())
+            SendParameterValueFromUI(idx, value);
+          break;
+        case kBatchBPCFUI:
+          if (reader.GetInt32(idx) && idx > -1 && idx < NParams())
+            BeginInformHostOfParamChangeFromUI(idx);
+          break;
+        case kBatchEPCFUI:
+          if (reader.GetInt32(idx) && idx > -1 && idx < NParams())
+            EndInformHostOfParamChangeFromUI(idx);
+          break;
+        case kBatchSAMFUI:
+          if (reader.GetInt32(msgTag) && reader.GetInt32(ctrlTag) && reader.GetData(pData, dataSize))
+            SendArbitraryMsgFromUI(msgTag, ctrlTag, dataSize, pData);
+          break;
+        case kBatchSMMFUI:
+          if (reader.GetBytes4(bytes))
+            SendMidiMsgFromUI(IMidiMsg {0, bytes[0], bytes[1], bytes[2]});
+          break;
+        default:
+          DBGMSG("WebViewEditorDelegate: unknown batch record %u\n", type);
+          return;
+      }
+    }
+  }
+
   static int GetBase64Length(int dataSize)
   {
     return static_cast<int>(4. * std::ceil((static_cast<double>(dataSize) / 3.)));
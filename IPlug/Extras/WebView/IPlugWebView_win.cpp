@@ -186,11 +186,20 @@ void* IWebViewImpl::OpenWebView(void* pParent, float x, float y, float w, float
                                                                       ICoreWebView2* sender,
                                                                       ICoreWebView2WebMessageReceivedEventArgs* args) {
                 wil::unique_cotaskmem_string jsonString;
-                args->get_WebMessageAsJson(&jsonString);
-                std::wstring jsonWString = jsonString.get();
                 WDL_String cStr;
-                UTF16ToUTF8(cStr, jsonWString.c_str());
-                if (strcmp(cStr.Get(), "\"kp32\"") == 0)
+
+                // strings, e.g. batched frames, are passed on without JSON quotes
+                if (SUCCEEDED(args->TryGetWebMessageAsString(&jsonString)))
+                {
+                  UTF16ToUTF8(cStr, jsonString.get());
+                }
+                else
+                {
+                  args->get_WebMessageAsJson(&jsonString);
+                  UTF16ToUTF8(cStr, jsonString.get());
+                }
+
+                if (strcmp(cStr.Get(), "kp32") == 0)
                 {
                    // spacebar
                    PostMessage(mParentWnd, WM_KEYDOWN, VK_SPACE, 0);
@@ -17,11 +17,108 @@
 #include <cstdio>
 #include <ctime>
 #include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
 
 #include "IPlugAPIBase.h"
 
 using namespace iplug;
 
+BEGIN_IPLUG_NAMESPACE
+
+/** Runs the idle work of all the IPlugAPIBase instances in the process from one IDLE_TIMER_RATE timer, rather than one
+ * timer per instance. Each instance decides on every tick whether it is due, see IPlugAPIBase::OnIdleTick() */
+class IdleScheduler
+{
+public:
+  static IdleScheduler& Get()
+  {
+    static IdleScheduler sInstance;
+    return sInstance;
+  }
+
+  void Add(IPlugAPIBase* pPlug)
+  {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    mInstances.push_back(pPlug);
+
+    if (!mRunningTimer)
+      mStoppedTimer = nullptr;
+
+    if (!mTimer)
+      mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&IdleScheduler::OnTimer, this, std::placeholders::_1), IDLE_TIMER_RATE));
+  }
+
+  void Remove(IPlugAPIBase* pPlug)
+  {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    auto it = std::find(mInstances.begin(), mInstances.end(), pPlug);
+
+    if (it == mInstances.end())
+      return;
+
+    // OnTimer() compacts the list once it has finished iterating
+    if (mRunningTimer)
+      *it = nullptr;
+    else
+      mInstances.erase(it);
+
+    if (NInstances() == 0 && mTimer)
+    {
+      mTimer->Stop();
+
+      // a timer can't be deleted from its own callback
+      if (mTimer.get() == mRunningTimer)
+        mStoppedTimer = std::move(mTimer);
+      else
+        mTimer = nullptr;
+    }
+  }
+
+private:
+  IdleScheduler() = default;
+
+  ~IdleScheduler()
+  {
+    if (mTimer)
+      mTimer->Stop();
+  }
+
+  int NInstances() const
+  {
+    return static_cast<int>(std::count_if(mInstances.begin(), mInstances.end(), [](IPlugAPIBase* pPlug) { return pPlug != nullptr; }));
+  }
+
+  void OnTimer(Timer& t)
+  {
+    std::lock_guard<std::recursive_mutex> lock(mMutex);
+    mRunningTimer = &t;
+
+    if (mStoppedTimer.get() != &t)
+      mStoppedTimer = nullptr;
+
+    // instances added by an idle call are appended and ticked straight away
+    for (size_t i = 0; i < mInstances.size(); i++)
+    {
+      if (IPlugAPIBase* pPlug = mInstances[i])
+        pPlug->OnIdleTick();
+    }
+
+    mRunningTimer = nullptr;
+    mInstances.erase(std::remove(mInstances.begin(), mInstances.end(), nullptr), mInstances.end());
+  }
+
+  std::recursive_mutex mMutex; // instances may be created or destroyed from an idle call
+  std::vector<IPlugAPIBase*> mInstances;
+  std::unique_ptr<Timer> mTimer;
+  std::unique_ptr<Timer> mStoppedTimer; // stopped from its own callback, deleted later
+  Timer* mRunningTimer = nullptr; // set while OnTimer() is iterating
+};
+
+END_IPLUG_NAMESPACE
+
 IPlugAPIBase::IPlugAPIBase(Config c, EAPI plugAPI)
   : IPluginBase(c.nParams, c.nPresets)
 {
@@ -47,9 +144,9 @@ IPlugAPIBase::IPlugAPIBase(Config c, EAPI plugAPI)
 
 IPlugAPIBase::~IPlugAPIBase()
 {
-  if(mTimer)
+  if (mIdleRegistered)
   {
-    mTimer->Stop();
+    IdleScheduler::Get().Remove(this);
   }
 
   TRACE
@@ -66,7 +163,11 @@ void IPlugAPIBase::OnHostRequestingImportantParameters(int count, WDL_TypedBuf<i
 
 void IPlugAPIBase::CreateTimer()
 {
-  mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&IPlugAPIBase::OnTimer, this, std::placeholders::_1), IDLE_TIMER_RATE));
+  if (!mIdleRegistered)
+  {
+    mIdleRegistered = true;
+    IdleScheduler::Get().Add(this);
+  }
 }
 
 bool IPlugAPIBase::CompareState(const uint8_t* pIncomingState, int startPos) const
@@ -120,6 +221,7 @@ void IPlugAPIBase::SetParameterValue(int idx, double normalizedValue)
   GetParam(idx)->SetNormalized(normalizedValue);
   InformHostOfParamChange(idx, normalizedValue);
   OnParamChange(idx, kUI);
+  SignalIdleWork();
 }
 
 void IPlugAPIBase::DirtyParametersFromUI()
@@ -129,18 +231,107 @@ void IPlugAPIBase::DirtyParametersFromUI()
     double normalizedValue = GetParam(p)->GetNormalized();
     InformHostOfParamChange(p, normalizedValue);
   }
+
+  SignalIdleWork();
 }
 
 void IPlugAPIBase::SendParameterValueFromAPI(int paramIdx, double value, bool normalized)
 {
+  // OnUIOpen() sends all the current values when the editor opens
+  if (!EditorIsListening())
+  {
+    mNParamChangesSkipped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
   if (normalized)
     value = GetParam(paramIdx)->FromNormalized(value);
   
   mParamChangeFromProcessor.PushFromArgs(paramIdx, value);
 }
 
-void IPlugAPIBase::OnTimer(Timer& t)
+IPlugAPIBase::EditorTrafficStats IPlugAPIBase::GetEditorTrafficStats() const
+{
+  EditorTrafficStats stats;
+  stats.nParamChangesSkipped = mNParamChangesSkipped.load(std::memory_order_relaxed);
+  stats.nMidiMsgsSkipped = mNMidiMsgsSkipped.load(std::memory_order_relaxed);
+  stats.nSysExMsgsSkipped = mNSysExMsgsSkipped.load(std::memory_order_relaxed);
+  stats.nDiscarded = mNDiscarded;
+  stats.nIdleTicksSkipped = mNIdleTicksSkipped;
+  return stats;
+}
+
+void IPlugAPIBase::DiscardQueuesForEditor()
 {
+  ParamTuple p;
+  while (mParamChangeFromProcessor.Pop(p))
+    mNDiscarded++;
+
+  IMidiMsg msg;
+  while (mMidiMsgsFromProcessor.Pop(msg))
+    mNDiscarded++;
+
+  SysExData sysEx;
+  while (mSysExDataFromProcessor.Pop(sysEx))
+    mNDiscarded++;
+}
+
+void IPlugAPIBase::OnIdleTick()
+{
+  mIdleStats.nTicks++;
+
+  const bool pending = mIdleWorkPending.exchange(false, std::memory_order_relaxed)
+                    || mParamChangeFromProcessor.ElementsAvailable()
+                    || mMidiMsgsFromProcessor.ElementsAvailable()
+                    || mSysExDataFromProcessor.ElementsAvailable();
+
+  const bool listening = EditorIsListening();
+  const bool backOff = mIdleBackoffWhenEditorOpen || !listening;
+  const int maxInterval = listening ? IDLE_TIMER_MAX_BACKOFF : std::max(IDLE_TIMER_CLOSED_EDITOR_DIVIDER, 1);
+
+  // the editor may have closed while backing off with it open
+  mIdleStats.intervalTicks = std::min(mIdleStats.intervalTicks, maxInterval);
+
+  if (!backOff || pending)
+  {
+    if (mIdleTicksSinceCall + 1 < mIdleStats.intervalTicks)
+      mIdleStats.nWakeups++;
+
+    mIdleStats.intervalTicks = 1;
+  }
+
+  if (++mIdleTicksSinceCall >= mIdleStats.intervalTicks)
+  {
+    mIdleTicksSinceCall = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    OnTimer();
+    const double timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    mIdleStats.nCalls++;
+    mIdleStats.totalTimeMs += timeMs;
+    mIdleStats.maxTimeMs = std::max(mIdleStats.maxTimeMs, timeMs);
+
+    if (backOff && !pending)
+      mIdleStats.intervalTicks = std::min(mIdleStats.intervalTicks * 2, maxInterval);
+  }
+  else
+    mNIdleTicksSkipped++;
+
+  // on every tick, as messages may have been sent to the editor outside OnTimer(), e.g. by the host setting a parameter
+  FlushMessagesFromDelegate();
+}
+
+void IPlugAPIBase::OnTimer()
+{
+  if (!EditorIsListening())
+  {
+    // the audio thread may have queued data just before the editor closed
+    DiscardQueuesForEditor();
+    OnIdle();
+    return;
+  }
+
 // VST3 ********************************************************************************
 #if defined VST3P_API || defined VST3_API
   while (mMidiMsgsFromProcessor.ElementsAvailable())
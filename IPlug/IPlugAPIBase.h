@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <cstdint>
 #include <memory>
@@ -107,7 +108,10 @@ public:
 #endif
   }
 
-  /** Override this method to get an "idle"" call on the main thread */
+  /** Override this method to get an "idle"" call on the main thread.
+   * This is called on every tick of the idle timer (IDLE_TIMER_RATE). With SetSkipEditorTrafficWhileClosed(), while the
+   * editor is closed the interval doubles on each call without pending work, up to IDLE_TIMER_CLOSED_EDITOR_DIVIDER ticks,
+   * see SignalIdleWork() */
   virtual void OnIdle() {}
     
 #pragma mark - Methods you can call - some of which have custom implementations in the API classes, some implemented in IPlugAPIBase.cpp
@@ -181,8 +185,93 @@ public:
     mSysExDataFromEditor.PushFromArgs(msg.mOffset, msg.mSize, msg.mData); // copies data
   }
 
-  /** Called by the API class to create the timer that pumps the parameter/message queues */
+  /** Called by the API class to register with the idle scheduler that pumps the parameter/message queues.
+   * All the instances in a process share one timer */
   void CreateTimer();
+
+  /** Have OnIdle() called on the next tick of the idle timer, even if the instance is backing off.
+   * Call this when the processor has data for OnIdle() in your own queues, it can be called on the realtime audio thread.
+   * ISenders drained with TransmitData() call it when data is pushed, and the API classes call it from SetLatency() and
+   * the InformHostOf...() methods, as those are usually followed by more work on the main thread. The parameter, MIDI
+   * and SysEx queues to the editor are checked on every tick, so they don't need it */
+  void SignalIdleWork() override { mIdleWorkPending.store(true, std::memory_order_relaxed); }
+
+  /** By default idle calls only back off while the editor is closed, see SetSkipEditorTrafficWhileClosed(). Enable this to back off while it is open too, if
+   * OnIdle() has nothing to do unless SignalIdleWork() was called (e.g. because the senders are attached to ISenderHub) */
+  void SetIdleBackoffWhenEditorOpen(bool enable) { mIdleBackoffWhenEditorOpen = enable; }
+
+  /** Idle timing of an instance, see GetIdleStats() */
+  struct IdleStats
+  {
+    uint64_t nTicks = 0; // ticks of the shared idle timer since CreateTimer()
+    uint64_t nCalls = 0; // ticks on which the queues were pumped and OnIdle() called
+    uint64_t nWakeups = 0; // calls brought forward from a backed off interval, because work was queued or signalled
+    double totalTimeMs = 0.; // time spent in those calls
+    double maxTimeMs = 0.; // longest call
+    int intervalTicks = 1; // the current interval between calls
+  };
+
+  /** @return The idle timing of this instance. Call this on the main thread */
+  IdleStats GetIdleStats() const { return mIdleStats; }
+
+  /** Stop processor to editor traffic while no editor is open (see IEditorDelegate::IsEditorOpen()). Off by default.
+   * When enabled, while the editor is closed:
+   * - parameter changes from the host, and MIDI and SysEx received by the processor, are not queued for the editor.
+   *   OnUIOpen() sends all the current values when it opens again
+   * - data queued just before the editor closed is discarded
+   * - idle calls back off, see OnIdle()
+   * Only enable this if every way your editor opens and closes sets the flag, e.g. via IEditorDelegate::OpenWindow() and
+   * CloseWindow() or OpenEditorWindow() and CloseEditorWindow(). Call it from your plug-in's constructor */
+  void SetSkipEditorTrafficWhileClosed(bool enable) { mSkipEditorTrafficWhileClosed = enable; }
+
+  /** Counts of processor to editor traffic avoided because no editor was open, see SetSkipEditorTrafficWhileClosed() */
+  struct EditorTrafficStats
+  {
+    uint64_t nParamChangesSkipped = 0; // parameter changes from the host that were not queued
+    uint64_t nMidiMsgsSkipped = 0; // MIDI messages received by the processor that were not queued
+    uint64_t nSysExMsgsSkipped = 0; // SysEx messages received by the processor that were not queued
+    uint64_t nDiscarded = 0; // messages queued just before the editor closed, dropped rather than delivered when it opens again
+    uint64_t nIdleTicksSkipped = 0; // idle timer ticks that returned without draining the queues or calling OnIdle()
+  };
+
+  /** @return The counters since the plug-in was created */
+  EditorTrafficStats GetEditorTrafficStats() const;
+
+protected:
+  /** Called by the API class to queue a MIDI message received by the processor for the editor.
+   * Nothing is queued while no editor is open, if SetSkipEditorTrafficWhileClosed() is enabled. Can be called on the realtime audio thread */
+  void QueueMidiMsgForEditor(const IMidiMsg& msg)
+  {
+    if (EditorIsListening())
+      mMidiMsgsFromProcessor.Push(msg);
+    else
+      mNMidiMsgsSkipped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** Called by the API class to queue a SysEx message received by the processor for the editor.
+   * Nothing is queued while no editor is open, if SetSkipEditorTrafficWhileClosed() is enabled. Can be called on the realtime audio thread */
+  void QueueSysExForEditor(int offset, int size, const void* pData)
+  {
+    if (EditorIsListening())
+      mSysExDataFromProcessor.PushFromArgs(offset, size, pData);
+    else
+      mNSysExMsgsSkipped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+private:
+  /** @return \c true if data from the processor should be queued for the editor. In distributed plug-ins the editor
+   * is not attached to this object, so the queues are always used to forward the data to it */
+  bool EditorIsListening() const
+  {
+#if defined VST3P_API || defined WAM_API || defined WASM_DSP_API || defined WEB_API || defined WASM_UI_API
+    return true;
+#else
+    return !mSkipEditorTrafficWhileClosed || IsEditorOpen();
+#endif
+  }
+
+  /** Empty the processor to editor queues while the editor is closed, so that stale data is not sent when it opens */
+  void DiscardQueuesForEditor();
   
 private:
   /** Implementations call into the APIs resize hooks
@@ -211,7 +300,13 @@ private:
    * @param data The SysEx data to transmit */
   virtual void TransmitSysExDataFromProcessor(const SysExData& data) {}
 
-  void OnTimer(Timer& t);
+  /** Called by the idle scheduler on each tick of the shared timer, calls OnTimer() when the instance is due and FlushMessagesFromDelegate() */
+  void OnIdleTick();
+
+  /** Pump the parameter/message queues and call OnIdle() */
+  void OnTimer();
+
+  friend class IdleScheduler;
 
   friend class IPlugAPP;
   friend class IPlugAAX;
@@ -228,7 +323,7 @@ private:
 
 private:
   WDL_String mParamDisplayStr;
-  std::unique_ptr<Timer> mTimer;
+  bool mIdleRegistered = false;
   
   IPlugQueue<ParamTuple> mParamChangeFromProcessor {PARAM_TRANSFER_SIZE};
   IPlugQueue<IMidiMsg> mMidiMsgsFromEditor {MIDI_TRANSFER_SIZE}; // a queue of midi messages generated in the editor by clicking keyboard UI etc
@@ -236,6 +331,18 @@ private:
   IPlugQueue<SysExData> mSysExDataFromEditor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the processor
   IPlugQueue<SysExData> mSysExDataFromProcessor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the editor
   SysExData mSysexBuf;
+
+  bool mSkipEditorTrafficWhileClosed = false;
+  std::atomic<uint64_t> mNParamChangesSkipped {0};
+  std::atomic<uint64_t> mNMidiMsgsSkipped {0};
+  std::atomic<uint64_t> mNSysExMsgsSkipped {0};
+  uint64_t mNDiscarded = 0;
+  uint64_t mNIdleTicksSkipped = 0;
+
+  std::atomic<bool> mIdleWorkPending {false};
+  bool mIdleBackoffWhenEditorOpen = false;
+  int mIdleTicksSinceCall = 0;
+  IdleStats mIdleStats;
 };
 
 END_IPLUG_NAMESPACE
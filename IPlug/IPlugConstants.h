@@ -111,6 +111,14 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 #define IDLE_TIMER_RATE 20 // this controls the frequency of data going from processor to editor (and OnIdle calls)
 #endif
 
+#ifndef IDLE_TIMER_CLOSED_EDITOR_DIVIDER
+#define IDLE_TIMER_CLOSED_EDITOR_DIVIDER 10 // while the editor is closed, idle calls back off to at most every Nth tick of the idle timer
+#endif
+
+#ifndef IDLE_TIMER_MAX_BACKOFF
+#define IDLE_TIMER_MAX_BACKOFF 16 // the longest interval between idle calls with the editor open, see IPlugAPIBase::SetIdleBackoffWhenEditorOpen()
+#endif
+
 #ifndef MAX_SYSEX_SIZE
 #define MAX_SYSEX_SIZE 512
 #endif
@@ -122,6 +130,8 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 // All version ints are stored as 0xVVVVRRMM: V = version, R = revision, M = minor revision.
 #define IPLUG_VERSION 0x010000
 #define IPLUG_VERSION_MAGIC 'pfft'
+#define IPLUG_COMPACT_STATE_MAGIC 'ipcs'
+#define IPLUG_COMPACT_STATE_VERSION 1
 
 static const int DEFAULT_BLOCK_SIZE = 1024;
 static const double DEFAULT_TEMPO = 120.0;
@@ -163,6 +173,20 @@ enum EParamSource
 
 static const char* ParamSourceStrs[kNumParamSources] = { "Reset", "Host", "Preset", "UI", "Editor Delegate", "Recompile", "Unknown"};
 
+/** @enum EStateFormatFlags
+ * Options for the compact state format, see IPluginBase::SerializeParamsCompact()
+ */
+enum EStateFormatFlags
+{
+  kStateFormatDefault = 0,
+  /** Only store the parameters that differ from their default value */
+  kStateFormatDeltaFromDefault = 1 << 0,
+  /** Deflate the parameters and custom data with zlib. Ignored unless IPLUG_ZLIB is defined and WDL/zlib is compiled in,
+   * which the CMake option IPLUG2_ZLIB does. Parameter tables deflate well, sample data hardly at all and slowly,
+   * see Tests/UnitTests/StateFormatTest.cpp */
+  kStateFormatCompressed = 1 << 1
+};
+
 /** @enum ERoute
  * Used to identify whether a bus/channel connection is an input or an output
  */
@@ -15,6 +15,7 @@
  * @copydoc IEditorDelegate
  */
 
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <stdint.h>
@@ -65,12 +66,27 @@ public:
   /** Adds an IParam to the parameters ptr list
    * Note: This is only used in special circumstances, since most plug-in formats don't support dynamic parameters
    * @return Ptr to the newly created IParam object */
-  IParam* AddParam() { return mParams.Add(new IParam()); }
+  IParam* AddParam()
+  {
+    IParam* pParam = mParams.Add(new IParam());
+    mParamValues.Resize(NParams());
+    pParam->LinkValueStore(&mParamValues, NParams() - 1);
+    return pParam;
+  }
   
   /** Remove an IParam at a particular index
    * Note: This is only used in special circumstances, since most plug-in formats don't support dynamic parameters
    * @param idx The index of the parameter to remove */
-  void RemoveParam(int idx) { return mParams.Delete(idx); }
+  void RemoveParam(int idx)
+  {
+    GetParam(idx)->LinkValueStore(nullptr, -1);
+    mParams.Delete(idx);
+
+    for (int i = idx; i < NParams(); i++)
+      GetParam(i)->LinkValueStore(&mParamValues, i);
+
+    mParamValues.Resize(NParams());
+  }
   
   /** Get a pointer to one of the delegate's IParam objects
    * @param paramIdx The index of the parameter object to be got
@@ -84,13 +100,37 @@ public:
 
   /** @return Returns the number of parameters that belong to the plug-in. */
   int NParams() const { return mParams.GetSize(); }
+
+  /** Copy the current values of all parameters into a contiguous buffer in one pass, e.g. at the start of ProcessBlock().
+   * This only reads the cache-aligned mirror of the values kept in IParamValueStore, not the IParam objects.
+   * Only one thread should take the changed mask, normally the audio thread
+   * @param pValues NParams() doubles to fill with the real (non-normalized) values
+   * @param pChangedBits NumParamChangedWords() words to fill with a mask of the parameters that changed since the last call, or nullptr
+   * @return \c true if any parameter changed since the last time the mask was taken \see IParamValueStore::ForEachChanged() */
+  bool SnapshotParamValues(double* pValues, uint64_t* pChangedBits = nullptr) { return mParamValues.Snapshot(pValues, pChangedBits); }
+
+  /** @return The number of 64 bit words in a changed mask passed to SnapshotParamValues() */
+  int NumParamChangedWords() const { return mParamValues.NChangedWords(); }
+
+  /** @return The store mirroring the parameter values */
+  IParamValueStore& GetParamValueStore() { return mParamValues; }
   
   /** If you are not using IGraphics, you can implement this method to attach to the native parent view e.g. NSView, UIView, HWND.
    *  Defer calling OnUIOpen() if necessary. */
-  virtual void* OpenWindow(void* pParent) { OnUIOpen(); return nullptr; }
+  virtual void* OpenWindow(void* pParent) { SetEditorOpen(true); OnUIOpen(); return nullptr; }
   
   /** If you are not using IGraphics you can if you need to free resources etc when the window closes. Call base implementation. */
-  virtual void CloseWindow() { OnUIClose(); }
+  virtual void CloseWindow() { SetEditorOpen(false); OnUIClose(); }
+
+  /** Called by the API classes to open the editor, instead of calling OpenWindow() directly. Marks the editor open first,
+   * so that IsEditorOpen() is right even when an OpenWindow() override doesn't call the base implementation */
+  void* OpenEditorWindow(void* pParent) { SetEditorOpen(true); return OpenWindow(pParent); }
+
+  /** Called by the API classes to close the editor, instead of calling CloseWindow() directly. @see OpenEditorWindow() */
+  void CloseEditorWindow() { SetEditorOpen(false); CloseWindow(); }
+
+  /** @return \c true while the editor is open. This is a relaxed atomic read, so it can be called on the realtime audio thread */
+  bool IsEditorOpen() const { return mEditorOpen.load(std::memory_order_relaxed); }
 
   /** Called by app wrappers when the OS window scaling buttons/resizers are used */
   virtual void OnParentWindowResize(int width, int height) { /* NO-OP*/ }
@@ -225,6 +265,14 @@ public:
    * @param normalized \c true if value is normalised */
   virtual void SendParameterValueFromDelegate(int paramIdx, double value, bool normalized) { OnParamChangeUI(paramIdx, EParamSource::kDelegate); } // TODO: normalised?
 
+  /** Called after a batch of the Send...FromDelegate() methods above has been called, e.g. once per tick of the idle timer.
+   * Delegates that accumulate messages rather than delivering each one as it is sent should deliver them here */
+  virtual void FlushMessagesFromDelegate() {}
+
+  /** Called when data has been queued for the editor, e.g. by ISender::PushData(), so that it is sent on the next idle tick
+   * even if the plug-in's idle calls are backing off (see IPlugAPIBase::SignalIdleWork()). Can be called on the realtime audio thread */
+  virtual void SignalIdleWork() {}
+
 #pragma mark - Methods for sending values FROM the user interface
   // The following methods are called from the user interface in order to set or query values of parameters in the class implementing IEditorDelegate
   
@@ -347,6 +395,11 @@ public:
    * @param scale The new screen scale*/
   virtual void SetScreenScale(float scale) {}
 
+protected:
+  /** Called by OpenEditorWindow() and CloseEditorWindow(), and by editor delegates whose windows open or close in other ways */
+  void SetEditorOpen(bool open) { mEditorOpen.store(open, std::memory_order_relaxed); }
+
+public:
   friend class IPlugAPP;
   friend class IPlugAAX;
   friend class IPlugVST2;
@@ -364,12 +417,17 @@ private:
   /** A list of IParam objects. This list is populated in the delegate constructor depending on the number of parameters passed as an argument to MakeConfig() in the plug-in class implementation constructor */
   WDL_PtrList<IParam> mParams;
 
+  /** Contiguous mirror of the values of mParams, read by SnapshotParamValues() */
+  IParamValueStore mParamValues;
+
   /** The width of the plug-in editor in pixels. Can be updated by resizing, exists here for persistance, even if UI doesn't exist. */
   int mEditorWidth = 0;
   /** The height of the plug-in editor in pixels. Can be updated by resizing, exists here for persistance, even if UI doesn't exist */
   int mEditorHeight = 0;
   /** Editor sizing constraints */
   int mMinWidth = 10, mMaxWidth = 100000, mMinHeight = 10, mMaxHeight = 100000;
+  /** Set while an editor window is open, see IsEditorOpen() */
+  std::atomic<bool> mEditorOpen {false};
 };
 
 END_IPLUG_NAMESPACE
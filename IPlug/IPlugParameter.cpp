@@ -15,12 +15,102 @@
 
 #include <cstdio>
 #include <algorithm>
+#include <typeinfo>
 
 #include "IPlugParameter.h"
 #include "IPlugLogger.h"
+#include "SIMDLane.h"
 
 using namespace iplug;
 
+#pragma mark - IParamValueStore
+
+void IParamValueStore::Resize(int nParams)
+{
+  const int nBanks = NWordsForParams(nParams);
+
+  // removed values leave the hash and are reset to 0., the value that new ones start from
+  for (auto p = nParams; p < mNParams; p++)
+  {
+    const double prev = mBanks[p / kParamsPerWord].mValues[p % kParamsPerWord].exchange(0., std::memory_order_relaxed);
+    mHash.fetch_sub(HashValue(p, prev), std::memory_order_relaxed);
+  }
+
+  if (nBanks != mNBanks)
+  {
+    std::unique_ptr<Bank[]> banks(new Bank[nBanks]);
+    std::unique_ptr<std::atomic<uint64_t>[]> changed(new std::atomic<uint64_t>[nBanks]);
+
+    for (auto b = 0; b < nBanks; b++)
+    {
+      const bool existing = b < mNBanks;
+
+      for (auto i = 0; i < kParamsPerWord; i++)
+      {
+        banks[b].mValues[i].store(existing ? mBanks[b].mValues[i].load(std::memory_order_relaxed) : 0., std::memory_order_relaxed);
+      }
+
+      changed[b].store(existing ? mChanged[b].load(std::memory_order_relaxed) : 0, std::memory_order_relaxed);
+    }
+
+    mBanks = std::move(banks);
+    mChanged = std::move(changed);
+    mNBanks = nBanks;
+  }
+
+  // new values are reported as changed, bits beyond the last parameter are kept clear
+  for (auto p = mNParams; p < nParams; p++)
+  {
+    mChanged[p / kParamsPerWord].fetch_or(uint64_t(1) << (p % kParamsPerWord), std::memory_order_relaxed);
+    mHash.fetch_add(HashValue(p, 0.), std::memory_order_relaxed);
+  }
+
+  if (nParams < mNParams && nParams % kParamsPerWord)
+  {
+    mChanged[nParams / kParamsPerWord].fetch_and((uint64_t(1) << (nParams % kParamsPerWord)) - 1, std::memory_order_relaxed);
+  }
+
+  mNParams = nParams;
+}
+
+bool IParamValueStore::Snapshot(double* pValues, uint64_t* pChangedBits)
+{
+  bool anyChanged = false;
+
+  // take the bits first: a value set after this is reported again by the next snapshot
+  if (pChangedBits)
+  {
+    for (auto w = 0; w < mNBanks; w++)
+    {
+      pChangedBits[w] = mChanged[w].exchange(0, std::memory_order_acquire);
+      anyChanged |= pChangedBits[w] != 0;
+    }
+  }
+
+  for (auto b = 0; b < mNBanks; b++)
+  {
+    const int n = std::min(kParamsPerWord, mNParams - b * kParamsPerWord);
+    const std::atomic<double>* pSrc = mBanks[b].mValues;
+    double* pDst = pValues + b * kParamsPerWord;
+
+    for (auto i = 0; i < n; i++)
+    {
+      pDst[i] = pSrc[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  return anyChanged;
+}
+
+void IParamValueStore::MarkAllChanged()
+{
+  for (auto w = 0; w < mNBanks; w++)
+  {
+    const int n = std::min(kParamsPerWord, mNParams - w * kParamsPerWord);
+    mChanged[w].store(n == kParamsPerWord ? ~uint64_t(0) : (uint64_t(1) << n) - 1, std::memory_order_release);
+  }
+}
+
 #pragma mark - Shape
 
 double IParam::ShapeLinear::NormalizedToValue(double value, const IParam& param) const
@@ -168,6 +258,7 @@ void IParam::InitDouble(const char* name, double defaultVal, double minVal, doub
     
   mShape = std::unique_ptr<Shape>(shape.Clone());
   mShape->Init(*this);
+  UpdateShapeID();
 }
 
 void IParam::InitFrequency(const char *name, double defaultVal, double minVal, double maxVal, double step, int flags, const char *group)
@@ -442,3 +533,184 @@ double IParam::GetShapeValue() const
     return 0.0;
 }
 
+
+void IParam::UpdateShapeID()
+{
+  // only the exact built-in types can be devirtualised, a subclass may override the conversions
+  const std::type_info& type = typeid(*mShape);
+
+  if (type == typeid(ShapeLinear))
+  {
+    mShapeID = kShapeLinear;
+  }
+  else if (type == typeid(ShapePowCurve))
+  {
+    mShapeID = kShapePowCurve;
+    mShapeCurve = static_cast<const ShapePowCurve&>(*mShape).mShape;
+  }
+  else if (type == typeid(ShapeExp))
+  {
+    mShapeID = kShapeExponential;
+    mShapeAdd = static_cast<const ShapeExp&>(*mShape).mAdd;
+    mShapeMul = static_cast<const ShapeExp&>(*mShape).mMul;
+  }
+  else
+  {
+    mShapeID = kShapeUnknown;
+  }
+}
+
+#pragma mark - Block conversions
+
+namespace
+{
+  static constexpr int kShapeBlockSize = 64;
+
+  /** The constants of a built-in shape, in the form used by the block conversions. ShapeExp is evaluated in base 2 */
+  struct ShapeConstants
+  {
+    IParam::EShapeIDs id;
+    float min, max, range, invRange;
+    float step, invStep;
+    bool stepped;
+    float curve, invCurve;
+    float add2, mul2, invMul2;
+  };
+
+  template <typename L>
+  inline typename L::Type ConstrainLanes(const ShapeConstants& k, typename L::Type v)
+  {
+    if (k.stepped)
+      v = L::Mul(L::Floor(L::Add(L::Mul(v, L::Set1(k.invStep)), L::Set1(0.5f))), L::Set1(k.step));
+
+    return L::Min(L::Max(v, L::Set1(k.min)), L::Set1(k.max));
+  }
+
+  template <typename L>
+  inline void NormalizedToValueLanes(const ShapeConstants& k, float* pBuf)
+  {
+    auto v = L::Min(L::Max(L::Load(pBuf), L::Zero()), L::Set1(1.f));
+
+    switch (k.id)
+    {
+      case IParam::kShapeLinear:
+        v = L::Add(L::Set1(k.min), L::Mul(v, L::Set1(k.range)));
+        break;
+      case IParam::kShapePowCurve:
+      {
+        const auto curved = LaneExp2<L>(L::Mul(L::Set1(k.curve), LaneLog2<L>(v)));
+        v = L::Add(L::Set1(k.min), L::Mul(L::Select(L::CmpGT(v, L::Zero()), curved, L::Zero()), L::Set1(k.range)));
+        break;
+      }
+      case IParam::kShapeExponential:
+        v = LaneExp2<L>(L::Add(L::Set1(k.add2), L::Mul(v, L::Set1(k.mul2))));
+        break;
+      default:
+        break;
+    }
+
+    L::Store(pBuf, ConstrainLanes<L>(k, v));
+  }
+
+  template <typename L>
+  inline void ValueToNormalizedLanes(const ShapeConstants& k, float* pBuf)
+  {
+    auto v = ConstrainLanes<L>(k, L::Load(pBuf));
+
+    switch (k.id)
+    {
+      case IParam::kShapeLinear:
+        v = L::Mul(L::Sub(v, L::Set1(k.min)), L::Set1(k.invRange));
+        break;
+      case IParam::kShapePowCurve:
+      {
+        const auto r = L::Mul(L::Sub(v, L::Set1(k.min)), L::Set1(k.invRange));
+        v = L::Select(L::CmpGT(r, L::Zero()), LaneExp2<L>(L::Mul(L::Set1(k.invCurve), LaneLog2<L>(r))), L::Zero());
+        break;
+      }
+      case IParam::kShapeExponential:
+        v = L::Mul(L::Sub(LaneLog2<L>(v), L::Set1(k.add2)), L::Set1(k.invMul2));
+        break;
+      default:
+        break;
+    }
+
+    L::Store(pBuf, L::Min(L::Max(v, L::Zero()), L::Set1(1.f)));
+  }
+
+  template <typename L>
+  inline void ConvertLanes(bool fromNormalized, const ShapeConstants& k, float* pBuf)
+  {
+    if (fromNormalized)
+      NormalizedToValueLanes<L>(k, pBuf);
+    else
+      ValueToNormalizedLanes<L>(k, pBuf);
+  }
+}
+
+template <bool fromNormalized, typename T>
+void IParam::ConvertBlock(const T* pSrc, T* pDst, int nValues) const
+{
+  using Lane = SIMDLane<float>;
+
+  // without SIMD the approximations would be no faster than the exact conversions
+  if (mShapeID == kShapeUnknown || Lane::kWidth == 1)
+  {
+    for (auto i = 0; i < nValues; i++)
+    {
+      const double v = static_cast<double>(pSrc[i]);
+      pDst[i] = static_cast<T>(fromNormalized ? FromNormalized(v) : ToNormalized(v));
+    }
+
+    return;
+  }
+
+  const double ln2 = std::log(2.);
+
+  const ShapeConstants k = {
+    mShapeID,
+    static_cast<float>(mMin), static_cast<float>(mMax), static_cast<float>(mMax - mMin), static_cast<float>(1. / (mMax - mMin)),
+    static_cast<float>(mStep), static_cast<float>(1. / mStep), (mFlags & kFlagStepped) != 0,
+    static_cast<float>(mShapeCurve), static_cast<float>(1. / mShapeCurve),
+    static_cast<float>(mShapeAdd / ln2), static_cast<float>(mShapeMul / ln2), static_cast<float>(ln2 / mShapeMul)
+  };
+
+  alignas(32) float buf[kShapeBlockSize];
+
+  for (auto pos = 0; pos < nValues; pos += kShapeBlockSize)
+  {
+    const auto n = std::min(nValues - pos, kShapeBlockSize);
+
+    for (auto i = 0; i < n; i++)
+      buf[i] = static_cast<float>(pSrc[pos + i]);
+
+    auto i = 0;
+    for (; i + Lane::kWidth <= n; i += Lane::kWidth)
+      ConvertLanes<Lane>(fromNormalized, k, buf + i);
+    for (; i < n; i++)
+      ConvertLanes<ScalarLane<float>>(fromNormalized, k, buf + i);
+
+    for (i = 0; i < n; i++)
+      pDst[pos + i] = static_cast<T>(buf[i]);
+  }
+}
+
+void IParam::FromNormalized(const float* pNormalized, float* pValues, int nValues) const
+{
+  ConvertBlock<true>(pNormalized, pValues, nValues);
+}
+
+void IParam::FromNormalized(const double* pNormalized, double* pValues, int nValues) const
+{
+  ConvertBlock<true>(pNormalized, pValues, nValues);
+}
+
+void IParam::ToNormalized(const float* pValues, float* pNormalized, int nValues) const
+{
+  ConvertBlock<false>(pValues, pNormalized, nValues);
+}
+
+void IParam::ToNormalized(const double* pValues, double* pNormalized, int nValues) const
+{
+  ConvertBlock<false>(pValues, pNormalized, nValues);
+}
@@ -16,16 +16,144 @@
  */
 
 #include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <functional>
 #include <memory>
 
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+
 #include "wdlstring.h"
 
 #include "IPlugUtilities.h"
 
 BEGIN_IPLUG_NAMESPACE
 
+/** A contiguous, cache-line aligned copy of the values of a delegate's parameters, for the audio thread.
+ * IParam objects are large and scattered across the heap, so reading hundreds of them per block touches as many cache lines.
+ * Each IParam linked to a store mirrors every value it is set to into it and raises a bit in a "changed" mask.
+ * Snapshot() then copies all values into a plug-in owned buffer in one pass, and hands over the bits of the parameters
+ * that changed since the previous call, so that DSP can skip the ones that did not.
+ * Values may be set from any thread, but there must be only one thread calling Snapshot(), since it consumes the changed bits.
+ * Resize() is not realtime safe, and like adding parameters must not happen while processing */
+class IParamValueStore
+{
+public:
+  static constexpr int kCacheLineSize = 64;
+  static constexpr int kParamsPerWord = 64;
+
+  IParamValueStore() = default;
+  IParamValueStore(const IParamValueStore&) = delete;
+  IParamValueStore& operator=(const IParamValueStore&) = delete;
+
+  /** Set the number of values, keeping existing values and marking new ones as changed */
+  void Resize(int nParams);
+
+  /** @return The number of values */
+  int NParams() const { return mNParams; }
+
+  /** @return The number of 64 bit words needed for a changed mask, which is the size of the buffer to pass to Snapshot() */
+  int NChangedWords() const { return NWordsForParams(mNParams); }
+
+  /** Store a value, mark it as changed and update Hash() */
+  inline void Set(int paramIdx, double value)
+  {
+    const double prev = mBanks[paramIdx / kParamsPerWord].mValues[paramIdx % kParamsPerWord].exchange(value, std::memory_order_relaxed);
+    const uint64_t delta = HashValue(paramIdx, value) - HashValue(paramIdx, prev);
+
+    if (delta)
+      mHash.fetch_add(delta, std::memory_order_relaxed);
+
+    mChanged[paramIdx / kParamsPerWord].fetch_or(uint64_t(1) << (paramIdx % kParamsPerWord), std::memory_order_release);
+  }
+
+  /** @return The last value stored for paramIdx */
+  inline double Get(int paramIdx) const
+  {
+    return mBanks[paramIdx / kParamsPerWord].mValues[paramIdx % kParamsPerWord].load(std::memory_order_relaxed);
+  }
+
+  /** Copy all values into a contiguous buffer, and optionally take the mask of values changed since the last call
+   * @param pValues NParams() doubles to fill
+   * @param pChangedBits NChangedWords() words to fill with the changed mask, bit (paramIdx % 64) of word (paramIdx / 64). If nullptr the mask is left pending
+   * @return \c true if any parameter changed since the last time the mask was taken */
+  bool Snapshot(double* pValues, uint64_t* pChangedBits = nullptr);
+
+  /** Mark every value as changed, e.g. after a reset so that DSP recomputes everything on the next block */
+  void MarkAllChanged();
+
+  /** @return A hash of all the values, which depends only on the values and their indexes. It is the sum of a mix of each
+   * index and value, so Set() updates it in O(1) instead of rehashing every parameter */
+  uint64_t Hash() const { return mHash.load(std::memory_order_relaxed); }
+
+  /** @return \c true if the bit of paramIdx is raised in a mask filled by Snapshot() */
+  static inline bool IsChanged(const uint64_t* pChangedBits, int paramIdx)
+  {
+    return (pChangedBits[paramIdx / kParamsPerWord] >> (paramIdx % kParamsPerWord)) & 1;
+  }
+
+  /** Call func(paramIdx) for each parameter that is raised in a mask filled by Snapshot(), in ascending order
+   * @param nWords The number of words in the mask, NChangedWords() */
+  template <class F>
+  static inline void ForEachChanged(const uint64_t* pChangedBits, int nWords, F func)
+  {
+    for (auto w = 0; w < nWords; w++)
+    {
+      for (uint64_t bits = pChangedBits[w]; bits; bits &= bits - 1)
+      {
+        func(w * kParamsPerWord + LowestBit(bits));
+      }
+    }
+  }
+
+  static inline int NWordsForParams(int nParams) { return (nParams + kParamsPerWord - 1) / kParamsPerWord; }
+
+private:
+  static inline int LowestBit(uint64_t bits)
+  {
+#if defined _MSC_VER
+    unsigned long idx;
+  #if defined _WIN64
+    _BitScanForward64(&idx, bits);
+  #else
+    if (!_BitScanForward(&idx, static_cast<unsigned long>(bits)))
+    {
+      _BitScanForward(&idx, static_cast<unsigned long>(bits >> 32));
+      idx += 32;
+    }
+  #endif
+    return static_cast<int>(idx);
+#else
+    return __builtin_ctzll(bits);
+#endif
+  }
+
+  /** A 64 bit finalizer (splitmix64) of the index and the bits of the value */
+  static inline uint64_t HashValue(int paramIdx, double value)
+  {
+    uint64_t x;
+    memcpy(&x, &value, sizeof(x));
+    x += (static_cast<uint64_t>(paramIdx) + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  /** The values of 64 parameters, eight cache lines, banks are allocated contiguously */
+  struct alignas(kCacheLineSize) Bank
+  {
+    std::atomic<double> mValues[kParamsPerWord];
+  };
+
+  std::unique_ptr<Bank[]> mBanks;
+  std::unique_ptr<std::atomic<uint64_t>[]> mChanged;
+  std::atomic<uint64_t> mHash {0};
+  int mNParams = 0;
+  int mNBanks = 0;
+};
+
 /** IPlug's parameter class */
 class IParam
 {
@@ -286,7 +414,7 @@ public:
    * @return double The resulting constrained value */
   inline double ConstrainNormalized(double normalizedValue) const
   {
-    return ToNormalized(mShape->NormalizedToValue(normalizedValue, *this));
+    return ToNormalized(ShapeNormalizedToValue(normalizedValue));
   }
   
   /** Convert a real value to normalized value for this parameter
@@ -294,7 +422,7 @@ public:
    * @return The corresponding normalized value, for this parameter */
   inline double ToNormalized(double nonNormalizedValue) const
   {
-    return Clip(mShape->ValueToNormalized(Constrain(nonNormalizedValue), *this), 0., 1.);
+    return Clip(ShapeValueToNormalized(Constrain(nonNormalizedValue)), 0., 1.);
   }
 
   /** Convert a normalized value to real value for this parameter
@@ -302,12 +430,34 @@ public:
    * @return The corresponding real value, for this parameter */
   inline double FromNormalized(double normalizedValue) const
   {
-    return Constrain(mShape->NormalizedToValue(normalizedValue, *this));
+    return Constrain(ShapeNormalizedToValue(normalizedValue));
   }
 
+  /** Convert a block of normalized values to real values, e.g. for sample accurate automation.
+   * With IPLUG_SIMDE the built-in shapes are evaluated several values per instruction (see SIMDLane.h), in single
+   * precision and with the approximations LaneExp2() and LaneLog2(). Compared to FromNormalized() the error is below
+   * 1e-6 of the parameter's range, and below 1e-6 relative for ShapeExp. Stepped values can land on the neighbouring
+   * step when the exact value is that close to the middle of two steps. Inputs are clamped to 0. to 1., results are
+   * constrained like FromNormalized(). Custom shapes, and all shapes without IPLUG_SIMDE, are converted exactly, one value at a time
+   * @param pNormalized nValues normalized values
+   * @param pValues nValues real values to fill, can be the same buffer as pNormalized */
+  void FromNormalized(const float* pNormalized, float* pValues, int nValues) const;
+
+  /** @copydoc FromNormalized(const float*, float*, int) const */
+  void FromNormalized(const double* pNormalized, double* pValues, int nValues) const;
+
+  /** Convert a block of real values to normalized values, with the same approximations as the block version of
+   * FromNormalized(). The absolute error of the normalized values is below 1e-6
+   * @param pValues nValues real values, constrained like ToNormalized()
+   * @param pNormalized nValues normalized values to fill, can be the same buffer as pValues */
+  void ToNormalized(const float* pValues, float* pNormalized, int nValues) const;
+
+  /** @copydoc ToNormalized(const float*, float*, int) const */
+  void ToNormalized(const double* pValues, double* pNormalized, int nValues) const;
+
   /** Sets the parameter value
    * @param value Value to be set. Will be stepped and clamped between \c mMin and \c mMax */
-  void Set(double value) { mValue.store(Constrain(value)); }
+  void Set(double value) { StoreValue(Constrain(value)); }
 
   /** Sets the parameter value from a normalized range (usually coming from the linked IControl)
    * @param normalizedValue The expected normalized value between 0. and 1. */
@@ -315,10 +465,10 @@ public:
 
   /** Set the parameter value using a textual representation
    * @param str The textual representations as a CString */
-  void SetString(const char* str) { mValue.store(StringToValue(str)); }
+  void SetString(const char* str) { StoreValue(StringToValue(str)); }
 
   /** Replaces the parameter's current value with the default one  */
-  void SetToDefault() { mValue.store(mDefault); }
+  void SetToDefault() { StoreValue(mDefault); }
 
   /** Set the parameter's default value, and set the parameter to that default
    * @param value The new default value */
@@ -504,6 +654,58 @@ public:
   /** Helper to print the parameter details to debug console in debug builds */
   void PrintDetails() const;
 private:
+  friend class IEditorDelegate;
+
+  /** Link the parameter to the slot paramIdx of a value store, which is updated with the current value and then every time the value is set
+   * @param pStore The store, or nullptr to unlink */
+  void LinkValueStore(IParamValueStore* pStore, int paramIdx)
+  {
+    mValueStore = pStore;
+    mValueStoreIdx = paramIdx;
+
+    if (mValueStore)
+      mValueStore->Set(mValueStoreIdx, mValue.load());
+  }
+
+  /** Shape::NormalizedToValue(), without the virtual call for the built-in shapes */
+  inline double ShapeNormalizedToValue(double value) const
+  {
+    switch (mShapeID)
+    {
+      case kShapeLinear: return mMin + value * (mMax - mMin);
+      case kShapePowCurve: return mMin + std::pow(value, mShapeCurve) * (mMax - mMin);
+      case kShapeExponential: return std::exp(mShapeAdd + value * mShapeMul);
+      default: return mShape->NormalizedToValue(value, *this);
+    }
+  }
+
+  /** Shape::ValueToNormalized(), without the virtual call for the built-in shapes */
+  inline double ShapeValueToNormalized(double value) const
+  {
+    switch (mShapeID)
+    {
+      case kShapeLinear: return (value - mMin) / (mMax - mMin);
+      case kShapePowCurve: return std::pow((value - mMin) / (mMax - mMin), 1.0 / mShapeCurve);
+      case kShapeExponential: return (std::log(value) - mShapeAdd) / mShapeMul;
+      default: return mShape->ValueToNormalized(value, *this);
+    }
+  }
+
+  /** Update the tag and the constants of the devirtualised shape, after mShape changed */
+  void UpdateShapeID();
+
+  /** Implements the block versions of FromNormalized() and ToNormalized() */
+  template <bool fromNormalized, typename T>
+  void ConvertBlock(const T* pSrc, T* pDst, int nValues) const;
+
+  inline void StoreValue(double value)
+  {
+    mValue.store(value);
+
+    if (mValueStore)
+      mValueStore->Set(mValueStoreIdx, value);
+  }
+
   /** A DisplayText is used to link a certain real value of the parameter with a CString. For example -70 on a decibel gain parameter could instead read "-inf" */
   struct DisplayText
   {
@@ -526,9 +728,18 @@ private:
   char mParamGroup[MAX_PARAM_GROUP_LEN];
   
   std::unique_ptr<Shape> mShape;
+  /** The exact type of mShape if it is one of the built-in shapes, or kShapeUnknown for custom shapes */
+  EShapeIDs mShapeID = kShapeLinear;
+  /** Copies of ShapePowCurve::mShape and ShapeExp::mAdd/mMul */
+  double mShapeCurve = 1.0;
+  double mShapeAdd = 0.0;
+  double mShapeMul = 1.0;
   DisplayFunc mDisplayFunction = nullptr;
 
   WDL_TypedBuf<DisplayText> mDisplayTexts;
+
+  IParamValueStore* mValueStore = nullptr;
+  int mValueStoreIdx = -1;
 } WDL_FIXALIGN;
 
 END_IPLUG_NAMESPACE
@@ -13,12 +13,71 @@
  * @brief IPluginBase implementation
  */
 
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include "IPlugPluginBase.h"
 #include "wdlendian.h"
 #include "wdl_base64.h"
+#include "fnv64.h"
+
+#if defined IPLUG_ZLIB
+#include "zlib.h"
+#endif
 
 using namespace iplug;
 
+/** The factory presets of all the plug-ins in this binary, keyed by manufacturer and plug-in ID, and indexed by preset.
+ * The shared presets are immutable. A plug-in's entries are released along with its last instance */
+struct SharedFactoryPresets
+{
+  struct Entry
+  {
+    /** @return \c true if the preset was made with this name, from the same static data or from data with this hash */
+    bool Matches(const char* name, const void* pStaticSource, size_t sourceSize, uint64_t sourceHash) const
+    {
+      return mPreset && mStaticSource == pStaticSource && mSourceSize == sourceSize && mSourceHash == sourceHash && !strcmp(mName.Get(), name);
+    }
+
+    WDL_String mName;
+    const void* mStaticSource = nullptr;
+    size_t mSourceSize = 0;
+    uint64_t mSourceHash = 0;
+    std::shared_ptr<const IFactoryPreset> mPreset;
+  };
+
+  struct Plugin
+  {
+    int mNInstances = 0;
+    std::vector<Entry> mEntries;
+  };
+
+  std::mutex mMutex;
+  std::unordered_map<uint64_t, Plugin> mPlugins;
+
+  static SharedFactoryPresets& Get()
+  {
+    static SharedFactoryPresets sInstance;
+    return sInstance;
+  }
+
+  static uint64_t Key(int mfrID, int uniqueID)
+  {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(mfrID)) << 32) | static_cast<uint32_t>(uniqueID);
+  }
+
+  /** Called by each instance that shared its factory presets, as it is destroyed */
+  void Release(int mfrID, int uniqueID)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mPlugins.find(Key(mfrID, uniqueID));
+
+    if (it != mPlugins.end() && --it->second.mNInstances <= 0)
+      mPlugins.erase(it);
+  }
+};
+
 IPluginBase::IPluginBase(int nParams, int nPresets)
 : EDITOR_DELEGATE_CLASS(nParams)
 {  
@@ -29,6 +88,9 @@ IPluginBase::IPluginBase(int nParams, int nPresets)
 IPluginBase::~IPluginBase()
 {
   mPresets.Empty(true);
+
+  if (mSharesFactoryPresets)
+    SharedFactoryPresets::Get().Release(GetMfrID(), GetUniqueID());
 }
 
 int IPluginBase::GetPluginVersion(bool decimal) const
@@ -144,6 +206,273 @@ int IPluginBase::UnserializeParams(const IByteChunk& chunk, int startPos)
   return pos;
 }
 
+// magic, version, flags, payload size, stored (possibly compressed) size
+static constexpr int kCompactStateHeaderSize = 5 * sizeof(int32_t);
+
+#if defined IPLUG_ZLIB
+// deflate can't compress better than 1032:1, plus a few bytes of zlib header and end of stream
+static constexpr int kMaxDeflateRatio = 1032;
+static constexpr int kMaxDeflateOverhead = 64;
+#endif
+
+bool IPluginBase::SerializeParamsCompact(IByteChunk& chunk, int flags, const IByteChunk* pCustomState) const
+{
+  TRACE
+#if !defined IPLUG_ZLIB
+  flags &= ~kStateFormatCompressed;
+#endif
+  const int n = NParams();
+  const int customSize = pCustomState ? pCustomState->Size() : 0;
+
+  // the table is stored as an array of indexes followed by an array of values, which deflates better than pairs
+  WDL_TypedBuf<int32_t> indexes;
+  WDL_TypedBuf<double> values;
+  indexes.Resize(n);
+  values.Resize(n);
+  int nEntries = 0;
+
+  for (int i = 0; i < n; ++i)
+  {
+    const IParam* pParam = GetParam(i);
+    const double v = pParam->Value();
+
+    if ((flags & kStateFormatDeltaFromDefault) && v == pParam->Constrain(pParam->GetDefault()))
+      continue;
+
+    indexes.Get()[nEntries] = i;
+    values.Get()[nEntries] = v;
+    ++nEntries;
+  }
+
+  const int payloadSize = static_cast<int>(sizeof(int32_t) + nEntries * (sizeof(int32_t) + sizeof(double)) + sizeof(int32_t) + customSize);
+
+  auto putPayload = [&](IByteChunk& dst) {
+    dst.Put(&nEntries);
+    dst.PutBytes(indexes.Get(), nEntries * sizeof(int32_t));
+    dst.PutBytes(values.Get(), nEntries * sizeof(double));
+    dst.Put(&customSize);
+    if (customSize)
+      dst.PutChunk(pCustomState);
+  };
+
+  const int headerPos = chunk.Size();
+
+  if (!(flags & kStateFormatCompressed))
+  {
+    const int32_t header[] = { IPLUG_COMPACT_STATE_MAGIC, IPLUG_COMPACT_STATE_VERSION, flags, payloadSize, payloadSize };
+    chunk.Reserve(headerPos + kCompactStateHeaderSize + payloadSize);
+    chunk.PutBytes(header, kCompactStateHeaderSize);
+    putPayload(chunk);
+    return chunk.Size() == headerPos + kCompactStateHeaderSize + payloadSize;
+  }
+
+#if defined IPLUG_ZLIB
+  IByteChunk payload;
+  payload.Reserve(payloadSize);
+  putPayload(payload);
+
+  uLongf storedSize = compressBound(payloadSize);
+  chunk.Resize(headerPos + kCompactStateHeaderSize + static_cast<int>(storedSize));
+
+  if (compress2(chunk.GetData() + headerPos + kCompactStateHeaderSize, &storedSize, payload.GetData(), payloadSize, Z_BEST_SPEED) != Z_OK)
+  {
+    chunk.Resize(headerPos);
+    return false;
+  }
+
+  // the header is written in front of the compressed data, once its size is known
+  const int32_t header[] = { IPLUG_COMPACT_STATE_MAGIC, IPLUG_COMPACT_STATE_VERSION, flags, payloadSize, static_cast<int32_t>(storedSize) };
+  memcpy(chunk.GetData() + headerPos, header, kCompactStateHeaderSize);
+  chunk.Resize(headerPos + kCompactStateHeaderSize + static_cast<int>(storedSize));
+  return true;
+#else
+  return false;
+#endif
+}
+
+int IPluginBase::UnserializeParamsCompact(const IByteChunk& chunk, int startPos, IByteChunk* pCustomState)
+{
+  TRACE
+  int magic = 0, version = 0, flags = 0, payloadSize = 0, storedSize = 0;
+
+  if (chunk.Get(&magic, startPos) < 0 || magic != IPLUG_COMPACT_STATE_MAGIC)
+    return UnserializeParams(chunk, startPos);
+
+  int pos = chunk.Get(&magic, startPos);
+  pos = chunk.Get(&version, pos);
+  pos = chunk.Get(&flags, pos);
+  pos = chunk.Get(&payloadSize, pos);
+  pos = chunk.Get(&storedSize, pos);
+
+  if (pos < 0 || version > IPLUG_COMPACT_STATE_VERSION || payloadSize < 0 || storedSize < 0 || storedSize > chunk.Size() - pos)
+    return -1;
+
+  const uint8_t* pPayload = chunk.GetData() + pos;
+  IByteChunk inflated;
+
+  if (flags & kStateFormatCompressed)
+  {
+#if defined IPLUG_ZLIB
+    // payloadSize is only a claim, so it is checked against the most that deflate can expand storedSize to, before allocating
+    if (static_cast<int64_t>(payloadSize) > static_cast<int64_t>(storedSize) * kMaxDeflateRatio + kMaxDeflateOverhead)
+      return -1;
+
+    inflated.Resize(payloadSize);
+    uLongf size = payloadSize;
+
+    if (uncompress(inflated.GetData(), &size, pPayload, storedSize) != Z_OK || static_cast<int>(size) != payloadSize)
+      return -1;
+
+    pPayload = inflated.GetData();
+#else
+    DBGMSG("Compressed state can't be loaded, IPLUG_ZLIB is not defined\n");
+    return -1;
+#endif
+  }
+  else if (storedSize != payloadSize)
+  {
+    return -1;
+  }
+
+  IByteStream payload(pPayload, payloadSize);
+  int nEntries = 0, customSize = 0;
+  int payloadPos = payload.Get(&nEntries, 0);
+
+  if (payloadPos < 0 || nEntries < 0 || nEntries > (payloadSize - payloadPos) / static_cast<int>(sizeof(int32_t) + sizeof(double)))
+    return -1;
+
+  const int indexesPos = payloadPos;
+  const int valuesPos = indexesPos + nEntries * static_cast<int>(sizeof(int32_t));
+  payloadPos = payload.Get(&customSize, valuesPos + nEntries * static_cast<int>(sizeof(double)));
+
+  if (payloadPos < 0 || customSize < 0 || customSize > payloadSize - payloadPos)
+    return -1;
+
+  ENTER_PARAMS_MUTEX
+  // indexes are ascending, the parameters in the gaps between them are at their default
+  int nextIdx = 0;
+
+  for (int e = 0; e < nEntries; ++e)
+  {
+    int32_t idx;
+    double v;
+    memcpy(&idx, pPayload + indexesPos + e * sizeof(int32_t), sizeof(int32_t));
+    memcpy(&v, pPayload + valuesPos + e * sizeof(double), sizeof(double));
+
+    // parameters that no longer exist are skipped
+    if (idx < 0 || idx >= NParams())
+      continue;
+
+    for (; nextIdx < idx; ++nextIdx)
+      GetParam(nextIdx)->Set(GetParam(nextIdx)->GetDefault());
+
+    GetParam(idx)->Set(v);
+    nextIdx = std::max(nextIdx, idx + 1);
+  }
+
+  for (; nextIdx < NParams(); ++nextIdx)
+    GetParam(nextIdx)->Set(GetParam(nextIdx)->GetDefault());
+
+  OnParamReset(kPresetRecall);
+  LEAVE_PARAMS_MUTEX
+
+  if (pCustomState)
+  {
+    pCustomState->Clear();
+    pCustomState->PutBytes(pPayload + payloadPos, customSize);
+  }
+
+  return pos + storedSize;
+}
+
+void IPluginBase::EnableStateCache(bool enable)
+{
+  WDL_MutexLock lock(&mStateCacheMutex);
+  mStateCacheEnabled = enable;
+  mStateCacheValid = false;
+}
+
+uint64_t IPluginBase::GetStateHash() const
+{
+  const uint64_t words[2] = { mParamValues.Hash(), mCustomStateVersion.load(std::memory_order_relaxed) };
+  return WDL_FNV64(WDL_FNV64_IV, reinterpret_cast<const unsigned char*>(words), sizeof(words));
+}
+
+bool IPluginBase::SerializeStateCached(IByteChunk& chunk) const
+{
+  if (!mStateCacheEnabled)
+    return SerializeState(chunk);
+
+  WDL_MutexLock lock(&mStateCacheMutex);
+
+  // taken before serializing, so that a change made meanwhile invalidates the cache
+  const uint64_t hash = GetStateHash();
+
+  if (!mStateCacheValid || !mStateCacheSerialized || mStateCacheHash != hash)
+  {
+    mStateCache.Clear();
+    mStateCacheValid = SerializeState(mStateCache);
+    mStateCacheSerialized = true;
+    mStateCacheHash = hash;
+
+    if (!mStateCacheValid)
+      return false;
+  }
+
+  chunk.PutChunk(&mStateCache);
+  return true;
+}
+
+int IPluginBase::UnserializeStateIfChanged(const IByteChunk& chunk, int startPos, bool& restored)
+{
+  restored = false;
+
+  if (mStateCacheEnabled)
+  {
+    WDL_MutexLock lock(&mStateCacheMutex);
+
+    const int cacheSize = mStateCache.Size();
+
+    // the data may be followed by more data from the API class (e.g. the VST3 bypass state), only the cached part is compared
+    if (mStateCacheValid && mStateCacheHash == GetStateHash() && chunk.Size() - startPos >= cacheSize &&
+        !memcmp(chunk.GetData() + startPos, mStateCache.GetData(), cacheSize))
+    {
+      return startPos + cacheSize;
+    }
+  }
+
+  const int pos = UnserializeState(chunk, startPos);
+  restored = true;
+
+  if (mStateCacheEnabled)
+  {
+    WDL_MutexLock lock(&mStateCacheMutex);
+
+    // custom data was replaced too, the data that restored it now describes the state
+    DirtyState();
+    mStateCacheValid = pos >= startPos;
+    mStateCacheSerialized = false;
+    mStateCacheHash = GetStateHash();
+    mStateCache.Clear();
+
+    if (mStateCacheValid)
+      mStateCache.PutBytes(chunk.GetData() + startPos, pos - startPos);
+  }
+
+  return pos;
+}
+
+bool IPluginBase::IsCurrentState(const uint8_t* pData, int dataSize) const
+{
+  if (!mStateCacheEnabled)
+    return false;
+
+  WDL_MutexLock lock(&mStateCacheMutex);
+
+  return mStateCacheValid && mStateCacheHash == GetStateHash() && dataSize == mStateCache.Size() &&
+         !memcmp(pData, mStateCache.GetData(), dataSize);
+}
+
 void IPluginBase::InitParamRange(int startIdx, int endIdx, int countStart, const char* nameFmtStr, double defaultVal, double minVal, double maxVal, double step, const char *label, int flags, const char *group, const IParam::Shape& shape, IParam::EParamUnit unit, IParam::DisplayFunc displayFunc)
 {
   WDL_String nameStr;
@@ -264,73 +593,181 @@ void IPluginBase::PrintParamValues()
   });
 }
 
-static IPreset* GetNextUninitializedPreset(WDL_PtrList<IPreset>* pPresets)
+static int GetNextUninitializedPresetIdx(WDL_PtrList<IPreset>* pPresets)
 {
   int n = pPresets->GetSize();
   for (int i = 0; i < n; ++i)
   {
-    IPreset* pPreset = pPresets->Get(i);
-    if (!(pPreset->mInitialized))
+    if (!(pPresets->Get(i)->mInitialized))
     {
-      return pPreset;
+      return i;
     }
   }
-  return 0;
+  return -1;
+}
+
+/** The kinds of factory preset source, hashed first so that different sources with the same bytes don't match */
+enum EFactoryPresetSource : uint8_t
+{
+  kPresetFromValues,
+  kPresetFromChunk
+};
+
+/** A 64 bit FNV-1a style hash of a factory preset's source, which isn't static data. It is taken a word at a time in four
+ * independent lanes, since every instance hashes these presets */
+static uint64_t HashPresetSource(EFactoryPresetSource source, const void* pData, size_t size)
+{
+  constexpr uint64_t kPrime = 1099511628211ull;
+  uint64_t lanes[4] = {14695981039346656037ull ^ source, 1, 2, 3};
+  const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+  size_t i = 0;
+
+  for (; i + sizeof(lanes) <= size; i += sizeof(lanes))
+  {
+    uint64_t words[4];
+    memcpy(words, pBytes + i, sizeof(words));
+
+    for (int l = 0; l < 4; ++l)
+    {
+      lanes[l] = (lanes[l] ^ words[l]) * kPrime;
+      lanes[l] ^= lanes[l] >> 32;
+    }
+  }
+
+  uint64_t hash = size;
+
+  for (int l = 0; l < 4; ++l)
+    hash = (hash ^ lanes[l]) * kPrime;
+
+  for (; i < size; ++i)
+    hash = (hash ^ pBytes[i]) * kPrime;
+
+  return hash;
+}
+
+/** A preset made from parameter values is the values, in order */
+static IFactoryPreset::MakeFunc MakeFromValues(std::vector<double>&& values)
+{
+  return [values = std::move(values)](IByteChunk& chunk) {
+    chunk.PutBytes(values.data(), static_cast<int>(values.size() * sizeof(double)));
+  };
+}
+
+static IFactoryPreset::MakeFunc MakeFromChunk(std::shared_ptr<const IByteChunk> pSrc)
+{
+  return [pSrc](IByteChunk& chunk) { chunk.PutChunk(pSrc.get()); };
+}
+
+bool IPluginBase::ShareFactoryPreset(int idx, const void* pStaticSource, size_t sourceSize, uint64_t sourceHash, IFactoryPreset::MakeFunc* pMakeFunc)
+{
+  IPreset* pPreset = mPresets.Get(idx);
+  pPreset->ClearChunk();
+
+  auto& shared = SharedFactoryPresets::Get();
+  std::lock_guard<std::mutex> lock(shared.mMutex);
+  auto& plugin = shared.mPlugins[SharedFactoryPresets::Key(GetMfrID(), GetUniqueID())];
+
+  if (!mSharesFactoryPresets)
+  {
+    mSharesFactoryPresets = true;
+    plugin.mNInstances++;
+  }
+
+  if (idx >= static_cast<int>(plugin.mEntries.size()))
+    plugin.mEntries.resize(idx + 1);
+
+  auto& entry = plugin.mEntries[idx];
+
+  if (entry.Matches(pPreset->mName, pStaticSource, sourceSize, sourceHash))
+  {
+    pPreset->mFactoryPreset = entry.mPreset;
+    return true;
+  }
+
+  if (!pMakeFunc)
+    return false;
+
+  pPreset->mFactoryPreset = std::make_shared<const IFactoryPreset>(std::move(*pMakeFunc));
+
+  // a slot made differently, by another instance or at another time, is left to the first one and this preset isn't shared
+  if (!entry.mPreset)
+  {
+    entry.mName.Set(pPreset->mName);
+    entry.mStaticSource = pStaticSource;
+    entry.mSourceSize = sourceSize;
+    entry.mSourceHash = sourceHash;
+    entry.mPreset = pPreset->mFactoryPreset;
+  }
+
+  return true;
+}
+
+void IPluginBase::SetFactoryPreset(int idx, const void* pStaticSource, size_t sourceSize, uint64_t sourceHash, IFactoryPreset::MakeFunc makeFunc)
+{
+  ShareFactoryPreset(idx, pStaticSource, sourceSize, sourceHash, &makeFunc);
 }
 
 void IPluginBase::MakeDefaultPreset(const char* name, int nPresets)
 {
   for (int i = 0; i < nPresets; ++i)
   {
-    IPreset* pPreset = GetNextUninitializedPreset(&mPresets);
-    if (pPreset)
+    int idx = GetNextUninitializedPresetIdx(&mPresets);
+    if (idx > -1)
     {
+      IPreset* pPreset = mPresets.Get(idx);
       pPreset->mInitialized = true;
       strcpy(pPreset->mName, (name ? name : "Empty"));
-      SerializeState(pPreset->mChunk);
+
+      // the current state can change, so it is serialized now
+      auto pState = std::make_shared<IByteChunk>();
+      SerializeState(*pState);
+
+      const size_t size = pState->Size();
+      const uint64_t sourceHash = HashPresetSource(kPresetFromChunk, pState->GetData(), size);
+      SetFactoryPreset(idx, nullptr, size, sourceHash, MakeFromChunk(pState));
     }
   }
 }
 
 void IPluginBase::MakePreset(const char* name, ...)
 {
-  IPreset* pPreset = GetNextUninitializedPreset(&mPresets);
-  if (pPreset)
+  int idx = GetNextUninitializedPresetIdx(&mPresets);
+  if (idx > -1)
   {
+    IPreset* pPreset = mPresets.Get(idx);
     pPreset->mInitialized = true;
     strcpy(pPreset->mName, name);
     
     int i, n = NParams();
     
-    double v = 0.0;
+    std::vector<double> values(n);
     va_list vp;
     va_start(vp, name);
     for (i = 0; i < n; ++i)
     {
-      GET_PARAM_FROM_VARARG(GetParam(i)->Type(), vp, v);
-      pPreset->mChunk.Put(&v);
+      GET_PARAM_FROM_VARARG(GetParam(i)->Type(), vp, values[i]);
     }
+    va_end(vp);
+
+    const size_t size = values.size() * sizeof(double);
+    const uint64_t sourceHash = HashPresetSource(kPresetFromValues, values.data(), size);
+    SetFactoryPreset(idx, nullptr, size, sourceHash, MakeFromValues(std::move(values)));
   }
 }
 
 void IPluginBase::MakePresetFromNamedParams(const char* name, int nParamsNamed, ...)
 {
   TRACE
-  IPreset* pPreset = GetNextUninitializedPreset(&mPresets);
-  if (pPreset)
+  int idx = GetNextUninitializedPresetIdx(&mPresets);
+  if (idx > -1)
   {
+    IPreset* pPreset = mPresets.Get(idx);
     pPreset->mInitialized = true;
     strcpy(pPreset->mName, name);
     
     int i = 0, n = NParams();
     
-    WDL_TypedBuf<double> vals;
-    vals.Resize(n);
-    double* pV = vals.Get();
-    for (i = 0; i < n; ++i, ++pV)
-    {
-      *pV = PARAM_UNINIT;
-    }
+    std::vector<double> values(n, PARAM_UNINIT);
     
     va_list vp;
     va_start(vp, nParamsNamed);
@@ -340,41 +777,62 @@ void IPluginBase::MakePresetFromNamedParams(const char* name, int nParamsNamed,
       // This assert will fire if any of the passed-in param values do not match
       // the type that the param was initialized with (int for bool, int, enum; double for double).
       assert(paramIdx > kNoParameter && paramIdx < n);
-      GET_PARAM_FROM_VARARG(GetParam(paramIdx)->Type(), vp, *(vals.Get() + paramIdx));
+      GET_PARAM_FROM_VARARG(GetParam(paramIdx)->Type(), vp, values[paramIdx]);
     }
     va_end(vp);
     
-    pV = vals.Get();
-    for (int i = 0; i < n; ++i, ++pV)
+    for (i = 0; i < n; ++i)
     {
-      if (*pV == PARAM_UNINIT)        // Any that weren't explicitly set, use the defaults.
+      if (values[i] == PARAM_UNINIT)        // Any that weren't explicitly set, use the defaults.
       {
-        *pV = GetParam(i)->Value();
+        values[i] = GetParam(i)->Value();
       }
-      pPreset->mChunk.Put(pV);
     }
+
+    const size_t size = values.size() * sizeof(double);
+    const uint64_t sourceHash = HashPresetSource(kPresetFromValues, values.data(), size);
+    SetFactoryPreset(idx, nullptr, size, sourceHash, MakeFromValues(std::move(values)));
   }
 }
 
 void IPluginBase::MakePresetFromChunk(const char* name, IByteChunk& chunk)
 {
-  IPreset* pPreset = GetNextUninitializedPreset(&mPresets);
-  if (pPreset)
+  int idx = GetNextUninitializedPresetIdx(&mPresets);
+  if (idx > -1)
   {
+    IPreset* pPreset = mPresets.Get(idx);
     pPreset->mInitialized = true;
     strcpy(pPreset->mName, name);
     
-    pPreset->mChunk.PutChunk(&chunk);
+    // the chunk is only copied if no other instance made this preset
+    const size_t size = chunk.Size();
+    const uint64_t sourceHash = HashPresetSource(kPresetFromChunk, chunk.GetData(), size);
+
+    if (!ShareFactoryPreset(idx, nullptr, size, sourceHash, nullptr))
+    {
+      auto pChunk = std::make_shared<IByteChunk>();
+      pChunk->PutChunk(&chunk);
+      SetFactoryPreset(idx, nullptr, size, sourceHash, MakeFromChunk(pChunk));
+    }
   }
 }
 
 void IPluginBase::MakePresetFromBlob(const char* name, const char* blob, int sizeOfChunk)
 {
-  IByteChunk presetChunk;
-  presetChunk.Resize(sizeOfChunk);
-  wdl_base64decode(blob, presetChunk.GetData(), sizeOfChunk);
-  
-  MakePresetFromChunk(name, presetChunk);
+  int idx = GetNextUninitializedPresetIdx(&mPresets);
+  if (idx > -1)
+  {
+    IPreset* pPreset = mPresets.Get(idx);
+    pPreset->mInitialized = true;
+    strcpy(pPreset->mName, name);
+
+    // the blob is decoded when the preset is first used, by whichever instance uses it first, so it is static data and
+    // matched by its address without being read
+    SetFactoryPreset(idx, blob, sizeOfChunk, 0, [blob, sizeOfChunk](IByteChunk& chunk) {
+      chunk.Resize(sizeOfChunk);
+      wdl_base64decode(blob, chunk.GetData(), sizeOfChunk);
+    });
+  }
 }
 
 static void MakeDefaultUserPresetName(WDL_PtrList<IPreset>* pPresets, char* str)
@@ -428,11 +886,12 @@ bool IPluginBase::RestorePreset(int idx)
     {
       pPreset->mInitialized = true;
       MakeDefaultUserPresetName(&mPresets, pPreset->mName);
+      pPreset->ClearChunk();
       restoredOK = SerializeState(pPreset->mChunk);
     }
     else
     {
-      restoredOK = (UnserializeState(pPreset->mChunk, 0) > 0);
+      restoredOK = (UnserializeState(pPreset->GetChunk(), 0) > 0);
     }
     
     if (restoredOK)
@@ -476,7 +935,7 @@ void IPluginBase::ModifyCurrentPreset(const char* name)
   if (mCurrentPresetIdx >= 0 && mCurrentPresetIdx < mPresets.GetSize())
   {
     IPreset* pPreset = mPresets.Get(mCurrentPresetIdx);
-    pPreset->mChunk.Clear();
+    pPreset->ClearChunk();
     
     Trace(TRACELOC, "%d %s", mCurrentPresetIdx, pPreset->mName);
     
@@ -504,7 +963,7 @@ bool IPluginBase::SerializePresets(IByteChunk& chunk) const
     chunk.Put(&pPreset->mInitialized);
     if (pPreset->mInitialized)
     {
-      savedOK &= (chunk.PutChunk(&(pPreset->mChunk)) > 0);
+      savedOK &= (chunk.PutChunk(&(pPreset->GetChunk())) > 0);
     }
   }
   return savedOK;
@@ -529,7 +988,7 @@ int IPluginBase::UnserializePresets(const IByteChunk& chunk, int startPos)
       pos = UnserializeState(chunk, pos);
       if (pos > 0)
       {
-        pPreset->mChunk.Clear();
+        pPreset->ClearChunk();
         SerializeState(pPreset->mChunk);
       }
     }
@@ -636,8 +1095,8 @@ void IPluginBase::DumpPresetBlob(const char* filename) const
   
   char buf[MAX_BLOB_LENGTH];
   
-  IByteChunk* pPresetChunk = &mPresets.Get(mCurrentPresetIdx)->mChunk;
-  uint8_t* byteStart = pPresetChunk->GetData();
+  const IByteChunk* pPresetChunk = &mPresets.Get(mCurrentPresetIdx)->GetChunk();
+  const uint8_t* byteStart = pPresetChunk->GetData();
   
   wdl_base64encode(byteStart, buf, pPresetChunk->Size());
   
@@ -813,7 +1272,7 @@ bool IPluginBase::SaveBankAsFXB(const char* file) const
         for (int i = 0; i< NParams(); i++)
         {
           double v = 0.0;
-          pos = pPreset->mChunk.Get(&v, pos);
+          pos = pPreset->GetChunk().Get(&v, pos);
           
           WDL_EndianFloat v32;
           v32.f = (float) GetParam(i)->ToNormalized(v);
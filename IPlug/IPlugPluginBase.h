@@ -15,6 +15,10 @@
  * @copydoc IPluginBase
  */
 
+#include <atomic>
+
+#include "mutex.h"
+
 #include "IPlugDelegate_select.h"
 #include "IPlugParameter.h"
 #include "IPlugStructs.h"
@@ -140,6 +144,25 @@ public:
    * @return The new chunk position (endPos) */
   int UnserializeParams(const IByteChunk& chunk, int startPos);
     
+  /** Serializes the parameters in the compact state format, an alternative to SerializeParams() for plug-ins with many
+   * parameters or large custom state. The data starts with a header (magic number, format version, flags and sizes),
+   * followed by a table of the parameter indexes, which hosts already require to be stable for automation, and their
+   * values, and then the optional custom data. The size of the whole chunk is reserved up front.
+   * To use it, call it from an override of SerializeState() and UnserializeParamsCompact() from UnserializeState()
+   * @param chunk The output chunk to serialize to. Will append data if the chunk has already been started.
+   * @param flags EStateFormatFlags, e.g. kStateFormatDeltaFromDefault | kStateFormatCompressed
+   * @param pCustomState Optional custom data (e.g. samples) to store and compress along with the parameters
+   * @return \c true if the serialization was successful */
+  bool SerializeParamsCompact(IByteChunk& chunk, int flags = kStateFormatDeltaFromDefault, const IByteChunk* pCustomState = nullptr) const;
+
+  /** Unserializes parameters written by SerializeParamsCompact(). Parameters missing from the table are set to their default.
+   * Chunks written by SerializeParams() are recognised and passed to UnserializeParams(), so that existing sessions still load
+   * @param chunk The incoming chunk where parameter values are stored to unserialize
+   * @param startPos The start position in the chunk where parameter values are stored
+   * @param pCustomState Optional chunk to fill with the custom data stored along with the parameters
+   * @return The new chunk position (endPos), or -1 if the data is not valid */
+  int UnserializeParamsCompact(const IByteChunk& chunk, int startPos, IByteChunk* pCustomState = nullptr);
+    
   /** Override this method to serialize custom state data, if your plugin does state chunks.
    * @param chunk The output bytechunk where data can be serialized
    * @return \c true if serialization was successful*/
@@ -152,6 +175,39 @@ public:
    * @return The new chunk position (endPos)*/
   virtual int UnserializeState(const IByteChunk& chunk, int startPos) { TRACE return UnserializeParams(chunk, startPos); }
   
+  /** Enable the state cache used by SerializeStateCached() and UnserializeStateIfChanged(). Parameter changes are tracked
+   * automatically, but a plug-in that serializes custom data in SerializeState() must call DirtyState() whenever that data
+   * changes, otherwise stale state would be returned to the host. Disabled by default
+   * @param enable \c true to enable the cache */
+  void EnableStateCache(bool enable);
+
+  /** Call this when custom data written by SerializeState() changes, to invalidate the cached state */
+  void DirtyState() { mCustomStateVersion.fetch_add(1, std::memory_order_relaxed); }
+
+  /** @return A hash identifying the current state, in O(1). It combines the hash of the parameter values, which is kept up
+   * to date as they change, with a counter incremented by DirtyState() */
+  uint64_t GetStateHash() const;
+
+  /** Used by the API classes instead of SerializeState(). If the state cache is enabled and the state has not changed since
+   * the last call, the cached chunk is appended instead of serializing the state again
+   * @param chunk The output chunk to serialize to. Will append data if the chunk has already been started.
+   * @return \c true if the serialization was successful */
+  bool SerializeStateCached(IByteChunk& chunk) const;
+
+  /** Used by the API classes instead of UnserializeState(). If the state cache is enabled and the incoming data is the state
+   * that was last serialized or restored, and the state has not changed since, nothing is restored, so hosts that set the
+   * same state repeatedly (e.g. for undo or compare) don't cause every parameter and the UI to be updated
+   * @param chunk The incoming chunk containing the state data
+   * @param startPos The position in the chunk where the data starts
+   * @param restored Set to \c true if UnserializeState() was called, in which case OnRestoreState() should follow
+   * @return The new chunk position (endPos) */
+  int UnserializeStateIfChanged(const IByteChunk& chunk, int startPos, bool& restored);
+
+  /** @return \c true if the state cache is enabled and the data matches the current state, without unserializing it
+   * @param pData The state data, as written by SerializeState()
+   * @param dataSize The size of pData in bytes */
+  bool IsCurrentState(const uint8_t* pData, int dataSize) const;
+
   /** VST3 ONLY! - THIS IS ONLY INCLUDED FOR COMPATIBILITY - NOONE ELSE SHOULD NEED IT!
    * @param chunk The output bytechunk where data can be serialized.
    * @return \c true if serialization was successful */
@@ -210,8 +266,12 @@ public:
   {
     IPreset* pDst = mPresets.Get(destIdx);
 
-    pDst->mChunk.Clear();
-    pDst->mChunk.PutChunk(&pSrc->mChunk);
+    pDst->ClearChunk();
+
+    if (pSrc->mFactoryPreset)
+      pDst->mFactoryPreset = pSrc->mFactoryPreset;
+    else
+      pDst->mChunk.PutChunk(&pSrc->mChunk);
     pDst->mInitialized = true;
     strncpy(pDst->mName, pSrc->mName, MAX_PRESET_NAME_LEN - 1);
   }
@@ -249,7 +309,8 @@ public:
    * This can be used when your plugin state includes arbitary data, other than just parameters.
    * See DumpPresetBlob() which is a utility that can be used to create the code for DumpPresetBlob() calls
    * @param name The preset name
-   * @param blob The base64 encoded string
+   * @param blob The base64 encoded string. It is decoded when the preset is first used, so it must stay valid as long as the
+   * plug-in binary is loaded, e.g. a string literal
    * @param sizeOfChunk The binary string size */
   void MakePresetFromBlob(const char* name, const char* blob, int sizeOfChunk);
   
@@ -397,6 +458,22 @@ public:
   friend class IPlugAPIBase;
   
 private:
+  /** Factory presets are made once per process and shared by every instance of the plug-in. If an instance already made the
+   * factory preset at idx with the same name and source, point it at that state. Otherwise give it a new state, made by
+   * makeFunc when it is first needed, and share that
+   * @param pStaticSource Static data that the preset is made from, matched by its address and sourceSize without being read. nullptr if the source is temporary
+   * @param sourceSize The size of the source
+   * @param sourceHash A hash of everything a temporary source is made from, 0 for static data
+   * @param pMakeFunc Serializes the preset, see IFactoryPreset. If nullptr, the preset is only set if it can be shared
+   * @return \c true if the preset was set */
+  bool ShareFactoryPreset(int idx, const void* pStaticSource, size_t sourceSize, uint64_t sourceHash, IFactoryPreset::MakeFunc* pMakeFunc);
+
+  /** Set the factory preset at idx, shared if another instance made it from the same source, see ShareFactoryPreset() */
+  void SetFactoryPreset(int idx, const void* pStaticSource, size_t sourceSize, uint64_t sourceHash, IFactoryPreset::MakeFunc makeFunc);
+
+  /** \c true once this instance counts towards the factory presets shared with other instances */
+  bool mSharesFactoryPresets = false;
+
   int mCurrentPresetIdx = 0;
   /** \c true if the plug-in does opaque state chunks. If false the host will provide a default interface */
   bool mStateChunks = false;
@@ -432,6 +509,17 @@ private:
   WDL_PtrList<const char> mParamGroups;
   /** "Baked in" Factory presets */
   WDL_PtrList<IPreset> mPresets;
+  /** Incremented by DirtyState() */
+  std::atomic<uint64_t> mCustomStateVersion {0};
+  /** Guards the state cache, which is filled from const methods */
+  mutable WDL_Mutex mStateCacheMutex;
+  /** The last state serialized or restored, valid while GetStateHash() == mStateCacheHash */
+  mutable IByteChunk mStateCache;
+  mutable uint64_t mStateCacheHash = 0;
+  mutable bool mStateCacheValid = false;
+  /** \c true if mStateCache was written by SerializeState(), rather than restored from the host */
+  mutable bool mStateCacheSerialized = false;
+  bool mStateCacheEnabled = false;
 
 #ifdef PARAMS_MUTEX
   friend class IPlugVST3ProcessorBase;
@@ -18,6 +18,9 @@
  */
 
 #include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include "wdlstring.h"
 #include "ptrlist.h"
 
@@ -215,6 +218,13 @@ public:
   {
     mBytes.Resize(0);
   }
+
+  /** Allocates memory for nBytes in total up front, so that subsequent calls to Put() do not reallocate
+   * @param nBytes The expected size of the chunk (in bytes) */
+  inline void Reserve(int nBytes)
+  {
+    mBytes.Prealloc(nBytes);
+  }
   
   /** Returns the current size of the chunk
    * @return Current size (in bytes) */
@@ -254,7 +264,7 @@ public:
   /** Compares the size & values of the data of another chunk with this one
    * @param otherChunk The chunk to compare with
    * @return \c true if the chunks are equal */
-  inline bool IsEqual(IByteChunk& otherChunk) const
+  inline bool IsEqual(const IByteChunk& otherChunk) const
   {
     return (otherChunk.Size() == Size() && !memcmp(otherChunk.mBytes.Get(), mBytes.Get(), Size()));
   }
@@ -596,6 +606,39 @@ struct ITimeInfo
   bool mTransportLoopEnabled = false;
 };
 
+/** The serialized state of a factory preset, shared by all instances of a plug-in in the process. The state is made from
+ * the preset's source, e.g. its parameter values or base64 blob, the first time it is needed */
+class IFactoryPreset
+{
+public:
+  using MakeFunc = std::function<void(IByteChunk& chunk)>;
+
+  /** @param makeFunc Serializes the preset into chunk, it is called once and then released along with its source */
+  IFactoryPreset(MakeFunc makeFunc)
+  : mMakeFunc(std::move(makeFunc))
+  {}
+
+  IFactoryPreset(const IFactoryPreset&) = delete;
+  IFactoryPreset& operator=(const IFactoryPreset&) = delete;
+
+  /** Thread safe. The first call makes the state, which allocates
+   * @return The serialized state of the preset */
+  const IByteChunk& GetChunk() const
+  {
+    std::call_once(mMade, [this]() {
+      mMakeFunc(mChunk);
+      mMakeFunc = nullptr;
+    });
+
+    return mChunk;
+  }
+
+private:
+  mutable std::once_flag mMade;
+  mutable MakeFunc mMakeFunc;
+  mutable IByteChunk mChunk;
+};
+
 /** A struct used for specifying baked-in factory presets */
 struct IPreset
 {
@@ -604,10 +647,23 @@ struct IPreset
 
   IByteChunk mChunk;
 
+  /** The state of an unmodified factory preset, shared by all instances of the plug-in in the process. When set, mChunk is empty */
+  std::shared_ptr<const IFactoryPreset> mFactoryPreset;
+
   IPreset()
   {
     snprintf(mName, MAX_PRESET_NAME_LEN, "%s", UNUSED_PRESET_NAME);
   }
+
+  /** @return The serialized state of the preset */
+  const IByteChunk& GetChunk() const { return mFactoryPreset ? mFactoryPreset->GetChunk() : mChunk; }
+
+  /** Detach the preset from the shared factory state and clear mChunk, before it is overwritten */
+  void ClearChunk()
+  {
+    mFactoryPreset = nullptr;
+    mChunk.Clear();
+  }
 };
 
 /** Used for key press info, such as ASCII representation, virtual key (mapped to win32 codes) and modifiers */
@@ -238,7 +238,7 @@
     {
       gPlug = std::unique_ptr<iplug::IPlugWeb>(iplug::MakePlug(iplug::InstanceInfo()));
       gPlug->SetHost("www", 0);
-      gPlug->OpenWindow(nullptr);
+      gPlug->OpenEditorWindow(nullptr);
       iplug_syncfs(); // plug in may initialise settings in constructor, write to persistent data after init
     }
   }
@@ -297,7 +297,7 @@
     {
       gPlug = std::unique_ptr<iplug::IPlugWasmUI>(iplug::MakePlug(iplug::InstanceInfo()));
       gPlug->SetHost("www", 0);
-      gPlug->OpenWindow(nullptr);
+      gPlug->OpenEditorWindow(nullptr);
       iplug_syncfs();
     }
   }
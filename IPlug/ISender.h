@@ -17,11 +17,19 @@
  */
 
 #include "denormal.h"
-#include "fft.h"
 
 #include "IPlugPlatform.h"
+#include "IPlugEditorDelegate.h"
 #include "IPlugQueue.h"
+#include "IPlugTimer.h"
+#include "FFTPlan.h"
+#include "LevelKernels.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #if defined OS_IOS || defined OS_MAC
 #include <Accelerate/Accelerate.h>
@@ -60,17 +68,199 @@ struct ISenderData
   }
 };
 
-/** ISender is a utility class which can be used to defer data from the realtime audio processing and send it to the GUI for visualization */
+class ISenderHub;
+
+/** The part of ISender that does not depend on the data type, used by ISenderHub */
+class ISenderBase
+{
+public:
+  ISenderBase() = default;
+  virtual ~ISenderBase() = default;
+
+  ISenderBase(const ISenderBase&) = delete;
+  ISenderBase& operator=(const ISenderBase&) = delete;
+
+  /** @return \c false while the sender is attached to ISenderHub and its editor is closed, in which case ProcessBlock()
+   * and PushData() return straight away. Can be called on the realtime audio thread */
+  bool IsListening() const { return mListening.load(std::memory_order_relaxed); }
+
+protected:
+  /** Called by ISenderHub on the main thread, to send the queued data to the controls of an open editor */
+  virtual void TransmitFromHub(IEditorDelegate& dlg) = 0;
+
+  /** Called by ISenderHub on the main thread when the editor opens, to drop data queued before it was closed */
+  virtual void DiscardData() = 0;
+
+private:
+  friend class ISenderHub;
+  std::atomic<bool> mListening {true};
+};
+
+/** ISenderHub drains the ISenders of all the plug-in instances in a process on a single timer, rather than each instance
+ * calling TransmitData() for each of its senders from OnIdle(). Senders are attached with ISender::AttachToHub().
+ * On each tick, the senders of instances whose editor is closed are skipped (see IEditorDelegate::IsEditorOpen()), and
+ * stop queueing data on the audio thread until the editor is opened again. The others are drained to their editor.
+ * Senders must be attached, detached and destroyed on the main thread */
+class ISenderHub
+{
+public:
+  struct Stats
+  {
+    uint64_t nTicks = 0; // timer callbacks
+    uint64_t nTransmitted = 0; // senders drained to an open editor
+    uint64_t nSkipped = 0; // senders skipped because their editor was closed
+  };
+
+  static ISenderHub& Get()
+  {
+    static ISenderHub sInstance;
+    return sInstance;
+  }
+
+  ISenderHub(const ISenderHub&) = delete;
+  ISenderHub& operator=(const ISenderHub&) = delete;
+
+  /** Attach a sender, starting the hub's timer if it is the first one
+   * @param sender The sender to drain
+   * @param dlg The editor delegate whose controls receive the data */
+  void Attach(ISenderBase& sender, IEditorDelegate& dlg)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto& entry : mEntries)
+    {
+      if (entry.pSender == &sender)
+      {
+        entry.pDelegate = &dlg;
+        return;
+      }
+    }
+
+    sender.mListening.store(dlg.IsEditorOpen(), std::memory_order_relaxed);
+    mEntries.push_back({&sender, &dlg});
+
+    if (!mTimer)
+      mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&ISenderHub::OnTimer, this, std::placeholders::_1), IDLE_TIMER_RATE));
+  }
+
+  /** Detach a sender, stopping the hub's timer if it was the last one. The sender queues data again, as if it was never attached */
+  void Detach(ISenderBase& sender)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(), [&sender](const Entry& entry) { return entry.pSender == &sender; }), mEntries.end());
+    sender.mListening.store(true, std::memory_order_relaxed);
+
+    if (mEntries.empty() && mTimer)
+    {
+      mTimer->Stop();
+      mTimer = nullptr;
+    }
+  }
+
+  /** Drain the senders of open editors and update which senders are listening. Called by the hub's timer */
+  void Transmit()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.nTicks++;
+
+    for (auto& entry : mEntries)
+    {
+      ISenderBase* pSender = entry.pSender;
+      const bool open = entry.pDelegate->IsEditorOpen();
+
+      if (open != pSender->IsListening())
+      {
+        // the audio thread is not pushing yet, so the queue can be emptied from here
+        if (open)
+          pSender->DiscardData();
+
+        pSender->mListening.store(open, std::memory_order_relaxed);
+      }
+
+      if (open)
+      {
+        pSender->TransmitFromHub(*entry.pDelegate);
+        mStats.nTransmitted++;
+
+        if (std::find(mTransmittedTo.begin(), mTransmittedTo.end(), entry.pDelegate) == mTransmittedTo.end())
+          mTransmittedTo.push_back(entry.pDelegate);
+      }
+      else
+        mStats.nSkipped++;
+    }
+
+    // once per editor, after all its senders
+    for (auto* pDelegate : mTransmittedTo)
+      pDelegate->FlushMessagesFromDelegate();
+
+    mTransmittedTo.clear();
+  }
+
+  /** @return The number of attached senders */
+  int NSenders()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return static_cast<int>(mEntries.size());
+  }
+
+  /** @return Counters since the process started */
+  Stats GetStats()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+  }
+
+private:
+  ISenderHub() = default;
+
+  ~ISenderHub()
+  {
+    if (mTimer)
+      mTimer->Stop();
+  }
+
+  void OnTimer(Timer& t) { Transmit(); }
+
+  struct Entry
+  {
+    ISenderBase* pSender;
+    IEditorDelegate* pDelegate;
+  };
+
+  std::mutex mMutex;
+  std::vector<Entry> mEntries;
+  std::vector<IEditorDelegate*> mTransmittedTo;
+  std::unique_ptr<Timer> mTimer;
+  Stats mStats;
+};
+
+/** ISender is a utility class which can be used to defer data from the realtime audio processing and send it to the GUI for visualization.
+ * Call TransmitData() from OnIdle(), or attach the sender to the process-wide ISenderHub with AttachToHub() */
 template <int MAXNC = 1, int QUEUE_SIZE = 64, typename T = float>
-class ISender
+class ISender : public ISenderBase
 {
 public:
   static constexpr int kUpdateMessage = 0;
 
-  /** Pushes a data element onto the queue. This can be called on the realtime audio thread. */
+  ~ISender()
+  {
+    if (mAttached)
+      ISenderHub::Get().Detach(*this);
+  }
+
+  /** Pushes a data element onto the queue. This can be called on the realtime audio thread.
+   * Once the sender has been drained with TransmitData(), this also calls IEditorDelegate::SignalIdleWork(), so that
+   * OnIdle() drains it on the next tick. Senders attached to ISenderHub don't, so that instances can back off */
   void PushData(const ISenderData<MAXNC, T>& d)
   {
-    mQueue.Push(d);
+    if (IsListening())
+    {
+      mQueue.Push(d);
+
+      if (IEditorDelegate* pDelegate = mIdleDelegate.load(std::memory_order_relaxed))
+        pDelegate->SignalIdleWork();
+    }
   }
 
   /** This is called on the main thread and can be used to transform the data, e.g. take an FFT. */
@@ -79,6 +269,68 @@ public:
   /** Pops elements off the queue and sends messages to controls.
    *  This must be called on the main thread - typically in MyPlugin::OnIdle() */
   void TransmitData(IEditorDelegate& dlg)
+  {
+    mIdleDelegate.store(&dlg, std::memory_order_relaxed);
+    Drain(dlg);
+  }
+  
+  /** This variation can be used if you need to supply multiple controls with the same ISenderData, overriding the tags in the data packet
+   @param dlg The editor delegate
+   @param ctrlTags A list of control tags that should receive the updates from this sender */
+  void TransmitDataToControlsWithTags(IEditorDelegate& dlg, const std::initializer_list<int>& ctrlTags)
+  {
+    mIdleDelegate.store(&dlg, std::memory_order_relaxed);
+    TransmitToTags(dlg, ctrlTags.begin(), ctrlTags.end());
+  }
+
+  /** Attach this sender to the process-wide ISenderHub, which drains it on its timer while the editor is open.
+   * Don't call TransmitData() for an attached sender. Call this on the main thread, e.g. in the plug-in's constructor
+   * @param dlg The editor delegate, usually the plug-in
+   * @param ctrlTags If not empty, the data is sent to these controls as with TransmitDataToControlsWithTags() */
+  void AttachToHub(IEditorDelegate& dlg, const std::initializer_list<int>& ctrlTags = {})
+  {
+    // the hub drains on its own timer, so pushes don't need to wake OnIdle()
+    mIdleDelegate.store(nullptr, std::memory_order_relaxed);
+    mHubCtrlTags.assign(ctrlTags.begin(), ctrlTags.end());
+    mAttached = true;
+    ISenderHub::Get().Attach(*this, dlg);
+  }
+
+  /** Detach this sender from ISenderHub, after which it must be drained with TransmitData() again */
+  void DetachFromHub()
+  {
+    if (mAttached)
+    {
+      ISenderHub::Get().Detach(*this);
+      mAttached = false;
+    }
+  }
+
+  /** Gets the last data item sent to the UI  */
+  ISenderData<MAXNC, T> GetLastData() { return mLastData; }
+  
+protected:
+  void TransmitFromHub(IEditorDelegate& dlg) override
+  {
+    if (mHubCtrlTags.empty())
+      Drain(dlg);
+    else
+      TransmitToTags(dlg, mHubCtrlTags.data(), mHubCtrlTags.data() + mHubCtrlTags.size());
+  }
+
+  void DiscardData() override
+  {
+    ISenderData<MAXNC, T> d;
+
+    while (mQueue.ElementsAvailable())
+      mQueue.Pop(d);
+  }
+
+  IPlugQueue<ISenderData<MAXNC, T>> mQueue {QUEUE_SIZE};
+  ISenderData<MAXNC, T> mLastData;
+
+private:
+  void Drain(IEditorDelegate& dlg)
   {
     while (mQueue.ElementsAvailable())
     {
@@ -90,35 +342,30 @@ public:
       mLastData = d;
     }
   }
-  
-  /** This variation can be used if you need to supply multiple controls with the same ISenderData, overriding the tags in the data packet
-   @param dlg The editor delegate
-   @param ctrlTags A list of control tags that should receive the updates from this sender */
-  void TransmitDataToControlsWithTags(IEditorDelegate& dlg, const std::initializer_list<int>& ctrlTags)
+
+  void TransmitToTags(IEditorDelegate& dlg, const int* pTagsBegin, const int* pTagsEnd)
   {
     while(mQueue.ElementsAvailable())
     {
       ISenderData<MAXNC, T> d;
       mQueue.Pop(d);
       
-      for (auto tag : ctrlTags)
+      for (auto pTag = pTagsBegin; pTag != pTagsEnd; pTag++)
       {
-        d.ctrlTag = tag;
-        dlg.SendControlMsgFromDelegate(tag, kUpdateMessage, sizeof(ISenderData<MAXNC, T>), (void*) &d);
+        d.ctrlTag = *pTag;
+        dlg.SendControlMsgFromDelegate(*pTag, kUpdateMessage, sizeof(ISenderData<MAXNC, T>), (void*) &d);
       }
     }
   }
 
-  /** Gets the last data item sent to the UI  */
-  ISenderData<MAXNC, T> GetLastData() { return mLastData; }
-  
-protected:
-  IPlugQueue<ISenderData<MAXNC, T>> mQueue {QUEUE_SIZE};
-  ISenderData<MAXNC, T> mLastData;
+  bool mAttached = false;
+  std::vector<int> mHubCtrlTags;
+  std::atomic<IEditorDelegate*> mIdleDelegate {nullptr}; // set by TransmitData(), woken by PushData()
 };
 
 /** IPeakSender is a utility class which can be used to defer peak data from sample buffers for sending to the GUI
  * It sends the average peak value over a certain time window.
+ * Each channel is summed a run of frames at a time, several samples per instruction when IPLUG_SIMDE is defined (see LevelKernels.h)
  */
 template <int MAXNC = 1, int QUEUE_SIZE = 64>
 class IPeakSender : public ISender<MAXNC, QUEUE_SIZE, float>
@@ -151,7 +398,10 @@ public:
    @param chanOffset the starting channel */
   void ProcessBlock(sample** inputs, int nFrames, int ctrlTag = kNoTag, int nChans = MAXNC, int chanOffset = 0)
   {
-    for (auto s = 0; s < nFrames; s++)
+    if (!this->IsListening())
+      return;
+    
+    for (auto s = 0; s < nFrames;)
     {
       if (mCount == 0)
       {
@@ -172,12 +422,16 @@ public:
         mPreviousSum = sum;
       }
       
+      // accumulate the frames up to the end of the window, or of the block
+      const int nRun = std::min(nFrames - s, mWindowSize - mCount);
+
       for (auto c = chanOffset; c < (chanOffset + nChans); c++)
       {
-        mPeaks[c] += std::fabs(static_cast<float>(inputs[c][s]));
+        mPeaks[c] += static_cast<float>(LevelAbsSum(inputs[c] + s, nRun));
       }
       
-      mCount++;
+      s += nRun;
+      mCount += nRun;
       mCount %= mWindowSize;
     }
   }
@@ -192,6 +446,8 @@ private:
 
 /** IPeakAvgSender is a utility class which can be used to defer peak & avg/RMS data from sample buffers for sending to the GUI
  * It also features an envelope follower to control meter ballistics
+ * The window is kept interleaved, so that off Apple platforms the peak and mean/RMS of several channels are computed per instruction
+ * when IPLUG_SIMDE is defined (see LevelKernels.h). On Apple platforms vDSP is used
  */
 template <int MAXNC = 1, int QUEUE_SIZE = 64>
 class IPeakAvgSender : public ISender<MAXNC, QUEUE_SIZE, std::pair<float, float>>
@@ -271,11 +527,7 @@ public:
     mWindowSizeMs = static_cast<float>(timeMs);
     mWindowSize = static_cast<int>(timeMs * 0.001 * sampleRate);
 
-    for (auto i=0; i<MAXNC; i++)
-    {
-      mBuffers[i].resize(mWindowSize);
-      std::fill(mBuffers[i].begin(), mBuffers[i].end(), 0.0f);
-    }
+    mWindow.assign(static_cast<size_t>(mWindowSize) * MAXNC, 0.0f);
   }
   
   void SetPeakHoldTimeMs(double timeMs, double sampleRate)
@@ -293,62 +545,71 @@ public:
    @param chanOffset the starting channel */
   void ProcessBlock(sample** inputs, int nFrames, int ctrlTag = kNoTag, int nChans = MAXNC, int chanOffset = 0)
   {
-    for (auto s = 0; s < nFrames; s++)
+    if (!this->IsListening())
+      return;
+    
+    for (auto s = 0; s < nFrames;)
     {
+      // the window is analysed at the frames where mCount wraps to 0, after that frame is written
+      const int nRun = std::min(nFrames - s, mCount == 0 ? 1 : mWindowSize - mCount + 1);
       int windowPos = s % mWindowSize;
       
-      for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+      for (auto i = s; i < s + nRun; i++)
       {
-        mBuffers[c][windowPos] = static_cast<float>(inputs[c][s]);
+        float* pFrame = mWindow.data() + windowPos * MAXNC;
+        
+        for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+        {
+          pFrame[c] = static_cast<float>(inputs[c][i]);
+        }
+        
+        if (++windowPos == mWindowSize)
+          windowPos = 0;
       }
       
-      if (mCount == 0)
+      const bool analyse = mCount == 0 || mCount + nRun > mWindowSize;
+      s += nRun;
+      mCount += nRun;
+      mCount %= mWindowSize;
+      
+      if (analyse)
       {
         ISenderData<MAXNC, std::pair<float, float>> d {ctrlTag, nChans, chanOffset};
         
         auto avgSum = 0.0f;
         
+#if defined OS_IOS || defined OS_MAC
         for (auto c = chanOffset; c < (chanOffset + nChans); c++)
         {
-          auto peakVal = 0.0f;
-          auto avgVal = 0.0f;
-#if defined OS_IOS || defined OS_MAC
-          vDSP_vabs(mBuffers[c].data(), 1, mBuffers[c].data(), 1, mWindowSize);
-          vDSP_maxv(mBuffers[c].data(), 1, &peakVal, mWindowSize);
+          vDSP_maxmgv(mWindow.data() + c, MAXNC, &mPeakVals[c], mWindowSize);
           
           if (mRMSMode)
           {
-            vDSP_rmsqv(mBuffers[c].data(), 1, &avgVal, mWindowSize);
+            vDSP_rmsqv(mWindow.data() + c, MAXNC, &mAvgVals[c], mWindowSize);
           }
           else
           {
-            vDSP_meanv(mBuffers[c].data(), 1, &avgVal, mWindowSize);
+            vDSP_meanmgv(mWindow.data() + c, MAXNC, &mAvgVals[c], mWindowSize);
           }
+        }
 #else
-          for (auto i=0; i<mWindowSize; i++)
-          {
-            auto absVal = std::fabs(mBuffers[c][i]);
-            
-            if (absVal > peakVal)
-            {
-              peakVal = absVal;
-            }
-            
-            if (mRMSMode)
-            {
-              absVal = absVal * absVal;
-            }
-            
-            avgVal += absVal;
-          }
-          
-          avgVal /= static_cast<float>(mWindowSize);
+        LevelAbsMaxSum(mWindow.data(), MAXNC, chanOffset, nChans, mWindowSize, mRMSMode, mPeakVals.data(), mAvgVals.data());
+        
+        for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+        {
+          mAvgVals[c] /= static_cast<float>(mWindowSize);
           
           if (mRMSMode)
           {
-            avgVal = std::sqrt(avgVal);
+            mAvgVals[c] = std::sqrt(mAvgVals[c]);
           }
+        }
 #endif
+        
+        for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+        {
+          auto peakVal = mPeakVals[c];
+          auto avgVal = mAvgVals[c];
       
           // set peak-hold value
           if (mPeakHoldCounters[c] <= 0)
@@ -403,9 +664,6 @@ public:
         
         mPreviousSum = avgSum;
       }
-      
-      mCount++;
-      mCount %= mWindowSize;
     }
   }
 private:
@@ -422,7 +680,9 @@ private:
   float mAttackTimeSamples = 1.0f;
   float mDecayTimeSamples = DEFAULT_SAMPLE_RATE/10.0f;
   std::array<float, MAXNC> mHeldPeaks = {0};
-  std::array<std::vector<float>, MAXNC> mBuffers;
+  std::vector<float> mWindow; // mWindowSize frames of MAXNC channels, interleaved so that channels can be analysed in SIMD lanes
+  std::array<float, MAXNC> mPeakVals;
+  std::array<float, MAXNC> mAvgVals;
   std::array<int, MAXNC> mPeakHoldCounters;
   std::array<EnvelopeFollower, MAXNC> mEnvFollowers;
 };
@@ -455,6 +715,9 @@ public:
    @param chanOffset the starting channel */
   void ProcessBlock(sample** inputs, int nFrames, int ctrlTag = kNoTag, int nChans = MAXNC, int chanOffset = 0)
   {
+    if (!this->IsListening())
+      return;
+    
     for (auto s = 0; s < nFrames; s++)
     {
       if (mBufCount == mBufferSize)
@@ -509,7 +772,8 @@ private:
   float mThreshold = 0.01f;
 };
 
-/** ISpectrumSender is designed for sending Spectral Data from the plug-in to the UI */
+/** ISpectrumSender is designed for sending Spectral Data from the plug-in to the UI.
+ * The frames of all channels are transformed together with FFTPlan::ForwardBatch() */
 template <int MAXNC = 1, int QUEUE_SIZE = 64, int MAX_FFT_SIZE = 4096>
 class ISpectrumSender : public IBufferSender<MAXNC, QUEUE_SIZE, MAX_FFT_SIZE>
 {
@@ -535,7 +799,6 @@ public:
   , mWindowType(window)
   , mOutputType(outputType)
   {
-    WDL_fft_init();
     SetFFTSizeAndOverlap(fftSize, overlap);
   }
 
@@ -548,6 +811,10 @@ public:
   {
     mFFTSize = fftSize;
     mOverlap = overlap;
+
+    if (!mFFT || mFFT->GetSize() != fftSize)
+      mFFT = std::make_unique<FFTPlan<float>>(fftSize);
+
     int hopSize = fftSize / overlap;
     TBufferSender::SetBufferSize(hopSize);
     InitSTFTFrames();
@@ -578,9 +845,7 @@ public:
 
         for (auto ch = 0; ch < MAXNC; ch++)
         {
-          auto windowedValue = (float) d.vals[ch][s] * mWindow[stftFrame.pos];
-          stftFrame.bins[ch][stftFrame.pos].re = windowedValue;
-          stftFrame.bins[ch][stftFrame.pos].im = 0.0f;
+          stftFrame.samples[ch][stftFrame.pos] = (float) d.vals[ch][s] * mWindow[stftFrame.pos];
         }
 
         stftFrame.pos++;
@@ -588,10 +853,11 @@ public:
         if (stftFrame.pos >= mFFTSize)
         {
           stftFrame.pos = 0;
+          Transform(stftFrameIdx);
 
           for (auto ch = 0; ch < MAXNC; ch++)
           {
-            Permute(ch, stftFrameIdx);
+            Permute(ch);
             memcpy(d.vals[ch].data(), mSTFTOutput[ch].data(), mFFTSize * sizeof(float));
           }
         }
@@ -634,7 +900,7 @@ private:
       auto& frame = mSTFTFrames[i];
       for (auto ch = 0; ch < MAXNC; ch++)
       {
-        std::fill(frame.bins[ch].begin(), frame.bins[ch].end(), WDL_FFT_COMPLEX{0.0f, 0.0f});
+        std::fill(frame.samples[ch].begin(), frame.samples[ch].end(), 0.0f);
       }
       // Stagger frame positions so FFTs are computed at different times
       frame.pos = i * hopSize;
@@ -696,28 +962,41 @@ private:
     mScalingFactor = scaling * scaling;
   }
 
-  void Permute(int ch, int frameIdx)
+  /** Transform the windowed samples of all channels of a frame into mSpectra */
+  void Transform(int frameIdx)
+  {
+    const float* inputs[MAXNC];
+    float* outputs[MAXNC];
+
+    for (auto ch = 0; ch < MAXNC; ch++)
+    {
+      inputs[ch] = mSTFTFrames[frameIdx].samples[ch].data();
+      outputs[ch] = mSpectra[ch].data();
+    }
+
+    mFFT->ForwardBatch(inputs, outputs, MAXNC);
+  }
+
+  void Permute(int ch)
   {
-    WDL_fft(mSTFTFrames[frameIdx].bins[ch].data(), mFFTSize, false);
+    // the packed spectrum holds the real Nyquist bin in place of the imaginary part of the DC bin, which is 0
+    const float* spectrum = mSpectra[ch].data();
+    auto nBins = mFFTSize / 2;
 
     if (mOutputType == EOutputType::Complex)
     {
-      auto nBins = mFFTSize / 2;
       for (auto i = 0; i < nBins; ++i)
       {
-        int sortIdx = WDL_fft_permute(mFFTSize, i);
-        mSTFTOutput[ch][i] = mSTFTFrames[frameIdx].bins[ch][sortIdx].re;
-        mSTFTOutput[ch][i + nBins] = mSTFTFrames[frameIdx].bins[ch][sortIdx].im;
+        mSTFTOutput[ch][i] = spectrum[2 * i];
+        mSTFTOutput[ch][i + nBins] = i > 0 ? spectrum[2 * i + 1] : 0.0f;
       }
     }
     else // magPhase
     {
-      auto nBins = mFFTSize / 2;
       for (auto i = 0; i < nBins; ++i)
       {
-        int sortIdx = WDL_fft_permute(mFFTSize, i);
-        auto re = mSTFTFrames[frameIdx].bins[ch][sortIdx].re;
-        auto im = mSTFTFrames[frameIdx].bins[ch][sortIdx].im;
+        auto re = spectrum[2 * i];
+        auto im = i > 0 ? spectrum[2 * i + 1] : 0.0f;
         mSTFTOutput[ch][i] = std::sqrt(2.0f * (re * re + im * im) / mScalingFactor);
         mSTFTOutput[ch][i + nBins] = std::atan2(im, re);
       }
@@ -727,7 +1006,7 @@ private:
   struct STFTFrame
   {
     int pos;
-    std::array<std::array<WDL_FFT_COMPLEX, MAX_FFT_SIZE>, MAXNC> bins;
+    std::array<std::array<float, MAX_FFT_SIZE>, MAXNC> samples;
   };
 
   int mFFTSize = 1024;
@@ -736,7 +1015,9 @@ private:
   EOutputType mOutputType;
   std::array<float, MAX_FFT_SIZE> mWindow;
   std::vector<STFTFrame> mSTFTFrames;
+  std::array<std::array<float, MAX_FFT_SIZE>, MAXNC> mSpectra;
   std::array<std::array<float, MAX_FFT_SIZE>, MAXNC> mSTFTOutput;
+  std::unique_ptr<FFTPlan<float>> mFFT;
   float mScalingFactor = 0.0f;
 };
 
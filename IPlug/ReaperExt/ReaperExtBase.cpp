@@ -88,7 +88,7 @@ void ReaperExtBase::DestroyMainWindow()
     return;
 
   SaveDockState();
-  gPlug->CloseWindow();
+  gPlug->CloseEditorWindow();
   DockWindowRemove(gHWND);
   DestroyWindow(gHWND);
   gHWND = NULL;
@@ -119,7 +119,7 @@ void ReaperExtBase::ToggleDocking()
 
   // Destroy and recreate - this is the SWS pattern for reliable dock toggling
   mSaveStateOnDestroy = false;
-  gPlug->CloseWindow();
+  gPlug->CloseEditorWindow();
   DockWindowRemove(gHWND);
   DestroyWindow(gHWND);
   gHWND = NULL;
@@ -265,7 +265,7 @@ WDL_DLGRET ReaperExtBase::MainDlgProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARA
         ShowWindow(hwnd, SW_SHOW);
       }
 
-      gPlug->OpenWindow(hwnd);
+      gPlug->OpenEditorWindow(hwnd);
 
       // Trigger initial resize now that IGraphics exists
       // (WM_SIZE during SetWindowPos/DockWindowAddEx above fires before OpenWindow)
@@ -305,7 +305,7 @@ WDL_DLGRET ReaperExtBase::MainDlgProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARA
       return 0;
     }
     case WM_CLOSE:
-      gPlug->CloseWindow();
+      gPlug->CloseEditorWindow();
       DestroyWindow(hwnd);
       return 0;
   }
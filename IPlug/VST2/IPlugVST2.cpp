@@ -194,6 +194,7 @@ void IPlugVST2::EndInformHostOfParamChange(int idx)
 void IPlugVST2::InformHostOfPresetChange()
 {
   mHostCallback(&mAEffect, audioMasterUpdateDisplay, 0, 0, 0, 0.0f);
+  SignalIdleWork();
 }
 
 bool IPlugVST2::EditorResize(int viewWidth, int viewHeight)
@@ -226,6 +227,7 @@ void IPlugVST2::SetLatency(int samples)
   mAEffect.initialDelay = samples;
   IPlugProcessor::SetLatency(samples);
   mHostCallback(&mAEffect, audioMasterIOChanged, 0, 0, 0, 0.0f);
+  SignalIdleWork();
 }
 
 bool IPlugVST2::SendVSTEvent(VstEvent& event)
@@ -463,13 +465,13 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
     case effEditOpen:
     {
 #if defined OS_WIN || defined ARCH_64BIT
-      if (_this->OpenWindow(ptr))
+      if (_this->OpenEditorWindow(ptr))
       {
         return 1;
       }
 #else   // OSX 32 bit, check if we are in a Cocoa VST host, otherwise tough luck
       bool iscocoa = (_this->mHasVSTExtensions&VSTEXT_COCOA);
-      if (iscocoa && _this->OpenWindow(ptr))
+      if (iscocoa && _this->OpenEditorWindow(ptr))
       {
         return 1; // cocoa supported open cocoa
       }
@@ -480,7 +482,7 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
     {
       if (_this->HasUI())
       {
-        _this->CloseWindow();
+        _this->CloseEditorWindow();
         return 1;
       }
       return 0;
@@ -506,7 +508,7 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
         }
         else
         {
-          savedOK = _this->SerializeState(chunk);
+          savedOK = _this->SerializeStateCached(chunk);
         }
 
         if (savedOK && chunk.Size())
@@ -529,19 +531,23 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
         int iplugVer = IByteChunk::GetIPlugVerFromChunk(chunk, pos);
         isBank &= (iplugVer >= 0x010000);
 
+        bool restored = true;
+
         if (isBank)
         {
           pos = static_cast<IPluginBase*>(_this)->UnserializePresets(chunk, pos);
         }
         else
         {
-          pos = _this->UnserializeState(chunk, pos);
+          pos = _this->UnserializeStateIfChanged(chunk, pos, restored);
           _this->ModifyCurrentPreset();
         }
 
         if (pos >= 0)
         {
-          _this->OnRestoreState();
+          if (restored)
+            _this->OnRestoreState();
+
           return 1;
         }
       }
@@ -562,7 +568,7 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
               VstMidiEvent* pME = (VstMidiEvent*) pEvent;
               IMidiMsg msg(pME->deltaFrames, pME->midiData[0], pME->midiData[1], pME->midiData[2]);
               _this->ProcessMidiMsg(msg);
-              _this->mMidiMsgsFromProcessor.Push(msg);
+              _this->QueueMidiMsgForEditor(msg);
 
               //#ifdef TRACER_BUILD
               //  msg.LogMsg();
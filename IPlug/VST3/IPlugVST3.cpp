@@ -218,6 +218,7 @@ void IPlugVST3::InformHostOfParameterDetailsChange()
 {
   FUnknownPtr<IComponentHandler> handler(componentHandler);
   handler->restartComponent(kParamTitlesChanged);
+  SignalIdleWork();
 }
 
 bool IPlugVST3::EditorResize(int viewWidth, int viewHeight)
@@ -266,4 +267,6 @@ void IPlugVST3::SetLatency(int latency)
       handler->restartComponent(kLatencyChanged);
     }
   }
+
+  SignalIdleWork();
 }
@@ -29,7 +29,7 @@ struct IPlugVST3State
     // TODO: IPlugVer should be in chunk!
     //  IByteChunk::GetIPlugVerFromChunk(chunk)
     
-    if (pPlug->SerializeState(chunk))
+    if (pPlug->SerializeStateCached(chunk))
     {
       /*
        int chunkSize = chunk.Size();
@@ -66,7 +66,8 @@ struct IPlugVST3State
       
       chunk.PutBytes(buffer, bytesRead);
     }
-    int pos = pPlug->UnserializeState(chunk,0);
+    bool restored = false;
+    int pos = pPlug->UnserializeStateIfChanged(chunk, 0, restored);
     
     Steinberg::int32 savedBypass = 0;
     
@@ -80,7 +81,8 @@ struct IPlugVST3State
     if (pController)
       pController->UpdateParams(pPlug, savedBypass);
     
-    pPlug->OnRestoreState();
+    if (restored)
+      pPlug->OnRestoreState();
     
     return true;
   }
@@ -113,10 +113,10 @@ public:
       void* pView = nullptr;
 #ifdef OS_WIN
       if (strcmp(type, Steinberg::kPlatformTypeHWND) == 0)
-        pView = mOwner.OpenWindow(pParent);
+        pView = mOwner.OpenEditorWindow(pParent);
 #elif defined OS_MAC
       if (strcmp(type, Steinberg::kPlatformTypeNSView) == 0)
-        pView = mOwner.OpenWindow(pParent);
+        pView = mOwner.OpenEditorWindow(pParent);
       else // Carbon
         return Steinberg::kResultFalse;
 #endif
@@ -132,7 +132,7 @@ public:
   Steinberg::tresult PLUGIN_API removed() override
   {
     if (mOwner.HasUI())
-      mOwner.CloseWindow();
+      mOwner.CloseEditorWindow();
     
     return CPluginView::removed();
   }
@@ -16,6 +16,9 @@ endif()
 # Option to disable deprecation warnings (useful for CI)
 option(IPLUG2_DISABLE_DEPRECATION_WARNINGS "Disable deprecation warnings" ON)
 
+# Option to compile WDL's zlib into plug-ins and define IPLUG_ZLIB, for compressed state (kStateFormatCompressed)
+option(IPLUG2_ZLIB "Compress plug-in state with WDL's zlib" OFF)
+
 if(NOT TARGET iPlug2::IPlug)
   add_library(iPlug2::IPlug INTERFACE IMPORTED)
 
@@ -55,6 +58,22 @@ if(NOT TARGET iPlug2::IPlug)
     list(APPEND IPLUG_SRC ${WDL_DIR}/win32_utf8.c)
   endif()
 
+  if(IPLUG2_ZLIB)
+    # the inflate and deflate parts of zlib, without gzip file and zip archive support
+    list(APPEND IPLUG_SRC
+      ${WDL_DIR}/zlib/adler32.c
+      ${WDL_DIR}/zlib/compress.c
+      ${WDL_DIR}/zlib/crc32.c
+      ${WDL_DIR}/zlib/deflate.c
+      ${WDL_DIR}/zlib/inffast.c
+      ${WDL_DIR}/zlib/inflate.c
+      ${WDL_DIR}/zlib/inftrees.c
+      ${WDL_DIR}/zlib/trees.c
+      ${WDL_DIR}/zlib/uncompr.c
+      ${WDL_DIR}/zlib/zutil.c
+    )
+  endif()
+
   target_sources(iPlug2::IPlug INTERFACE ${IPLUG_SRC})
   
   target_include_directories(iPlug2::IPlug INTERFACE
@@ -69,6 +88,7 @@ if(NOT TARGET iPlug2::IPlug)
     NOMINMAX  # Prevent min/max macros from Windows.h and SWELL
     $<$<CONFIG:Debug>:DEBUG>
     $<$<CONFIG:Debug>:_DEBUG>
+    $<$<BOOL:${IPLUG2_ZLIB}>:IPLUG_ZLIB>
   )
   
   if(MSVC)
@@ -184,6 +204,42 @@ if(NOT TARGET iPlug2::Extras::HIIR)
   target_link_libraries(iPlug2::Extras::HIIR INTERFACE iPlug2::IPlug)
 endif()
 
+# EEL2 scripting stage (JIT compiled @init/@block/@sample scripts)
+if(NOT TARGET iPlug2::Extras::EEL2)
+  add_library(iPlug2::Extras::EEL2 INTERFACE IMPORTED)
+
+  target_sources(iPlug2::Extras::EEL2 INTERFACE
+    ${IPLUG_DIR}/Extras/EEL2/IPlugEEL2.cpp
+    ${WDL_DIR}/eel2/nseel-caltab.c
+    ${WDL_DIR}/eel2/nseel-cfunc.c
+    ${WDL_DIR}/eel2/nseel-compiler.c
+    ${WDL_DIR}/eel2/nseel-eval.c
+    ${WDL_DIR}/eel2/nseel-lextab.c
+    ${WDL_DIR}/eel2/nseel-ram.c
+    ${WDL_DIR}/eel2/nseel-yylex.c
+  )
+
+  target_include_directories(iPlug2::Extras::EEL2 INTERFACE
+    ${IPLUG_DIR}/Extras/EEL2
+  )
+
+  target_link_libraries(iPlug2::Extras::EEL2 INTERFACE iPlug2::IPlug)
+
+  # code generator helpers that are prebuilt in WDL, other targets use inline assembly or the portable interpreter
+  if(APPLE AND NOT IOS)
+    target_sources(iPlug2::Extras::EEL2 INTERFACE ${WDL_DIR}/eel2/asm-nseel-multi-macho.o)
+  elseif(WIN32 AND CMAKE_GENERATOR_PLATFORM STREQUAL "ARM64EC")
+    target_sources(iPlug2::Extras::EEL2 INTERFACE ${WDL_DIR}/eel2/asm-nseel-arm64ec.obj)
+  elseif(WIN32 AND CMAKE_GENERATOR_PLATFORM STREQUAL "ARM64")
+    target_sources(iPlug2::Extras::EEL2 INTERFACE ${WDL_DIR}/eel2/asm-nseel-aarch64-msvc.obj)
+  elseif(WIN32 AND CMAKE_SIZEOF_VOID_P EQUAL 8)
+    target_sources(iPlug2::Extras::EEL2 INTERFACE ${WDL_DIR}/eel2/asm-nseel-x64.obj)
+  elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "x86_64|AMD64")
+    # asm-nseel-x64-sse.asm needs nasm
+    target_compile_definitions(iPlug2::Extras::EEL2 INTERFACE EEL_TARGET_PORTABLE)
+  endif()
+endif()
+
 # IWebViewControl support for IGraphics plugins (minimal - no EditorDelegate)
 # Use this when embedding IWebViewControl in an IGraphics UI
 # Note: IPlugWebView.cpp and IPlugWK*.mm are #included by platform-specific files (unity build)
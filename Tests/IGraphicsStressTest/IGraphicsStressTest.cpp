@@ -3,6 +3,16 @@
 
 #include "IControls.h"
 
+#if defined IGRAPHICS_SKIA && defined IGRAPHICS_CPU
+#include "IGraphicsSkia.h"
+
+static constexpr unsigned int kRasterTestSeed = 1234;
+static constexpr int kRasterTestTileSize = 64; // small tiles, so that many things cross tile edges
+static constexpr int kRasterBenchmarkFrames = 60;
+static constexpr int kRasterTestThreads[] = {1, 2, 4, 8, 0}; // 0 is one thread per core
+static constexpr int kNumRasterTestThreads = sizeof(kRasterTestThreads) / sizeof(int);
+#endif
+
 IGraphicsStressTest::IGraphicsStressTest(const InstanceInfo& info)
 : iplug::Plugin(info, MakeConfig(kNumParams, 1))
 {
@@ -62,28 +72,49 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
     GetUI()->SetAllControlsDirty();
   };
   
-  pGraphics->SetKeyHandlerFunc([DoFunc](const IKeyPress& key, bool isUp)
+  pGraphics->SetKeyHandlerFunc([this, DoFunc](const IKeyPress& key, bool isUp)
   {
     if(!isUp) {
       switch (key.VK) {
         case kVK_UP: DoFunc(EFunc::More); return true;
         case kVK_DOWN: DoFunc(EFunc::Less); return true;
         case kVK_TAB: key.S ? DoFunc(EFunc::Prev) : DoFunc(EFunc::Next); return true;
+#if defined IGRAPHICS_SKIA && defined IGRAPHICS_CPU
+        case kVK_R: StartRasterTest(ERasterTest::Compare); return true;
+        case kVK_B: StartRasterTest(ERasterTest::Benchmark); return true;
+#endif
         default: return false;
       }
     }
     return false;
   });
   
+#if defined IGRAPHICS_SKIA && defined IGRAPHICS_CPU
+  pGraphics->SetDisplayTickFunc([this]() { RasterTestTick(); });
+#endif
+  
   pGraphics->EnableMouseOver(false);
   pGraphics->LoadFont("Roboto-Regular", ROBOTO_FN);
   pGraphics->AttachPanelBackground(COLOR_GRAY);
   pGraphics->AttachControl(new ILambdaControl(visualsArea, [&](ILambdaControl* pCaller, IGraphics& g, IRECT& r) {
     static IBitmap smiley = g.LoadBitmap(SMILEY_FN);
     static ISVG tiger = g.LoadSVG(TIGER_FN);
+    static std::vector<float> waveform = [](){
+      // a scope-sized buffer, like IVScopeControl draws per channel
+      std::vector<float> points(4096);
+      for (size_t i = 0; i < points.size(); i++)
+        points[i] = 0.5f + 0.3f * std::sin(static_cast<float>(i) * 0.05f) + 0.15f * (static_cast<float>(rand()) / RAND_MAX - 0.5f);
+      return points;
+    }();
     
     g.FillRect(COLOR_WHITE, r);
     
+#if defined IGRAPHICS_SKIA && defined IGRAPHICS_CPU
+    // the raster tests need the same things every frame
+    if (this->mRasterTest != ERasterTest::None)
+      srand(kRasterTestSeed);
+#endif
+    
     if(this->mKindOfThing == 0)
     {
       g.DrawText(IText(30), "Press tab to go to next test", r);
@@ -94,12 +125,13 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
     {
       //        g.StartLayer(r);
       
+      bool dir = 0;
+      
       for (int i=0; i<this->mNumberOfThings; i++)
       {
         IRECT rr = r.GetRandomSubRect();
         IColor rc = IColor::GetRandomColor();
         IBlend rb = {};
-        static bool dir = 0;
         static float thickness = 5.f;
         static float roundness = 5.f;
         float rrad1 = static_cast<float>(rand() % 360);
@@ -119,6 +151,8 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
           case 10: g.DrawDottedLine(rc, dir == 0 ? rr.L : rr.R, rr.B, dir == 0 ? rr.R : rr.L, rr.T, &rb, thickness); break;
           case 11: g.DrawFittedBitmap(smiley, rr, &rb); break;
           case 12: g.DrawSVG(tiger, rr); break;
+          case 13: g.DrawData(rc, rr, waveform.data(), static_cast<int>(waveform.size()), nullptr, &rb, thickness); break;
+          case 14: g.DrawData(rc, rr, waveform.data(), static_cast<int>(waveform.size()), nullptr, &rb, thickness, false, true); break;
           default:
             break;
         }
@@ -144,7 +178,7 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
       switch (button){
         case 0:
         {
-          static IPopupMenu menu {"Test", {"Start", "DrawRect", "FillRect", "DrawRoundRect", "FillRoundRect", "DrawEllipse", "FillEllipse", "DrawArc", "FillArc", "DrawLine", "DrawDottedLine", "DrawFittedBitmap", "DrawSVG"},
+          static IPopupMenu menu {"Test", {"Start", "DrawRect", "FillRect", "DrawRoundRect", "FillRoundRect", "DrawEllipse", "FillEllipse", "DrawArc", "FillArc", "DrawLine", "DrawDottedLine", "DrawFittedBitmap", "DrawSVG", "DrawData", "DrawData (decimated)"},
             [DoFunc](IPopupMenu* pMenu) {
               DoFunc(EFunc::Set, pMenu->GetChosenItemIdx());
             }};
@@ -171,4 +205,103 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
   });
 
 }
+
+#if defined IGRAPHICS_SKIA && defined IGRAPHICS_CPU
+void IGraphicsStressTest::StartRasterTest(ERasterTest test)
+{
+  // the FPS display would differ between frames
+  GetUI()->ShowFPSDisplay(false);
+  mRasterTest = test;
+  mRasterTestStep = 0;
+  mRasterMismatches = 0;
+  mRasterResults.Set(test == ERasterTest::Compare ? "Differing pixels:" : "ms per frame:");
+}
+
+void IGraphicsStressTest::RasterTestTick()
+{
+  if (mRasterTest == ERasterTest::None)
+    return;
+
+  auto* pGraphics = static_cast<IGraphicsSkia*>(GetUI());
+
+  // outside a frame the draw context is the surface canvas, which holds the last frame
+  auto readSurface = [pGraphics](std::vector<uint32_t>& pixels) {
+    SkCanvas* pCanvas = static_cast<SkCanvas*>(pGraphics->GetDrawContext());
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(pCanvas->imageInfo().width(), pCanvas->imageInfo().height());
+    pixels.resize(static_cast<size_t>(info.width()) * info.height());
+    pCanvas->readPixels(info, pixels.data(), info.minRowBytes(), 0, 0);
+  };
+
+  auto finish = [&]() {
+    pGraphics->SetParallelRasterization(1);
+    mRasterTest = ERasterTest::None;
+    DBGMSG("%s\n", mRasterResults.Get());
+    pGraphics->GetControlWithTag(kCtrlTagNumThings)->As<ITextControl>()->SetStr(mRasterResults.Get());
+    pGraphics->SetAllControlsDirty();
+  };
+
+  if (mRasterTest == ERasterTest::Compare)
+  {
+    // step 0 draws the reference serially, each further step reads the previous frame and draws the next thread count
+    if (mRasterTestStep == 1)
+    {
+      readSurface(mRasterReference);
+    }
+    else if (mRasterTestStep > 1)
+    {
+      std::vector<uint32_t> pixels;
+      readSurface(pixels);
+      int64_t nDiffering = 0;
+
+      for (size_t i = 0; i < pixels.size(); i++)
+        nDiffering += pixels[i] != mRasterReference[i];
+
+      mRasterMismatches += nDiffering;
+      mRasterResults.AppendFormatted(64, " %dT %lld", kRasterTestThreads[mRasterTestStep - 1], static_cast<long long>(nDiffering));
+    }
+
+    if (mRasterTestStep == kNumRasterTestThreads)
+    {
+      // any differing pixel is a failure, the tiles must reproduce the serial frame exactly
+      if (mRasterMismatches)
+        mRasterResults.AppendFormatted(64, " - MISMATCH, %lld in total", static_cast<long long>(mRasterMismatches));
+      else
+        mRasterResults.Append(" - match");
+      finish();
+      return;
+    }
+
+    pGraphics->SetParallelRasterization(kRasterTestThreads[mRasterTestStep], kRasterTestTileSize);
+    pGraphics->SetAllControlsDirty();
+    mRasterTestStep++;
+  }
+  else
+  {
+    // kRasterBenchmarkFrames frames per thread count, all the controls redrawn every frame
+    const int threadsIdx = mRasterTestStep / (kRasterBenchmarkFrames + 1);
+    const int frame = mRasterTestStep % (kRasterBenchmarkFrames + 1);
+
+    if (frame == 0)
+    {
+      if (threadsIdx > 0)
+      {
+        const IFrameStats& stats = pGraphics->GetFrameStats();
+        mRasterResults.AppendFormatted(64, " %dT %.2f", kRasterTestThreads[threadsIdx - 1], stats.mNumFrames ? 1000. * stats.mDrawTime / stats.mNumFrames : 0.);
+      }
+
+      if (threadsIdx == kNumRasterTestThreads)
+      {
+        finish();
+        return;
+      }
+
+      pGraphics->SetParallelRasterization(kRasterTestThreads[threadsIdx]);
+      pGraphics->ResetFrameStats();
+    }
+
+    pGraphics->SetAllControlsDirty();
+    mRasterTestStep++;
+  }
+}
+#endif
 #endif
@@ -33,5 +33,19 @@ public:
 public:
   int mNumberOfThings = 16;
   int mKindOfThing = 0;
+#if defined IGRAPHICS_SKIA && defined IGRAPHICS_CPU
+  enum class ERasterTest { None, Compare, Benchmark };
+
+  /** Start comparing parallel and serial rasterization pixel for pixel, or timing frames at several thread counts.
+   * The test draws the current test's things, the same every frame, and runs one step per display tick */
+  void StartRasterTest(ERasterTest test);
+  void RasterTestTick();
+
+  ERasterTest mRasterTest = ERasterTest::None;
+  int mRasterTestStep = 0;
+  std::vector<uint32_t> mRasterReference;
+  int64_t mRasterMismatches = 0;
+  WDL_String mRasterResults;
+#endif
 #endif
 };
@@ -0,0 +1,275 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Checks that ControlRamp::ForEachSegment() covers the block with contiguous segments that agree with GetValueAt()
+// (to 1e-12), including transitions that start before the block, end after it or are steps, and that Write() matches
+// GetValueAt() to 1e-6, stays inside its range and ends exactly on endValue. Glides made by ControlRampProcessor are
+// followed across blocks. Then times writing every ramp against querying them, and the IPlugInstrument example.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "TestUtils.h"
+
+// the parameters of the IPlugInstrument example, which its DSP header expects
+enum EParams
+{
+  kParamGain = 0,
+  kParamNoteGlideTime,
+  kParamAttack,
+  kParamDecay,
+  kParamSustain,
+  kParamRelease,
+  kParamLFOShape,
+  kParamLFORateHz,
+  kParamLFORateTempo,
+  kParamLFORateMode,
+  kParamLFODepth,
+  kNumParams
+};
+
+#include "IPlugInstrument_DSP.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr int kNFrames = 32;
+
+/** The accumulating Write() that ControlRamp.h shipped before ForEachSegment() */
+void WriteAccumulating(const ControlRamp& ramp, float* buffer, int startIdx, int nFrames)
+{
+  float val = static_cast<float>(ramp.startValue);
+  float dv = static_cast<float>((ramp.endValue - ramp.startValue) / (ramp.transitionEnd - ramp.transitionStart));
+
+  for (int i = startIdx; i < startIdx + ramp.transitionStart; ++i)
+    buffer[i] = val;
+
+  for (int i = startIdx + ramp.transitionStart; i < startIdx + ramp.transitionEnd; ++i)
+  {
+    val += dv;
+    buffer[i] = val;
+  }
+
+  for (int i = startIdx + ramp.transitionEnd; i < startIdx + nFrames; ++i)
+    buffer[i] = val;
+}
+
+void TestSegments(const ControlRamp& ramp)
+{
+  int nextOffset = 0, nSegments = 0;
+
+  ramp.ForEachSegment(kNFrames, [&](int offset, int n, double value, double increment) {
+    nSegments++;
+    IPLUG_CHECK(offset == nextOffset && n > 0, "ramp %d-%d: segment at %d of %d samples, expected at %d", ramp.transitionStart, ramp.transitionEnd, offset, n, nextOffset);
+    nextOffset = offset + n;
+
+    for (auto i = 0; i < n; i++)
+    {
+      const double expected = ramp.GetValueAt(offset + i);
+      IPLUG_CHECK(std::fabs(value + i * increment - expected) < 1e-12, "ramp %d-%d: sample %d is %g, GetValueAt() %g", ramp.transitionStart, ramp.transitionEnd, offset + i, value + i * increment, expected);
+    }
+  });
+
+  IPLUG_CHECK(nextOffset == kNFrames, "ramp %d-%d: segments end at %d", ramp.transitionStart, ramp.transitionEnd, nextOffset);
+  IPLUG_CHECK(nSegments <= 3 && (!ramp.IsConstant() || nSegments == 1), "ramp %d-%d: %d segments", ramp.transitionStart, ramp.transitionEnd, nSegments);
+}
+
+void TestWrite(const ControlRamp& ramp)
+{
+  constexpr int kStartIdx = 5, kGuard = 3;
+  constexpr float kUnwritten = -1234.f;
+  std::vector<float> buffer(kGuard + kStartIdx + kNFrames + kGuard, kUnwritten);
+  float* pBlock = buffer.data() + kGuard;
+
+  ramp.Write(pBlock, kStartIdx, kNFrames);
+
+  for (auto i = -kGuard; i < kStartIdx; i++)
+    IPLUG_CHECK(pBlock[i] == kUnwritten, "ramp %d-%d: wrote sample %d before startIdx", ramp.transitionStart, ramp.transitionEnd, i);
+
+  for (auto i = kStartIdx + kNFrames; i < kStartIdx + kNFrames + kGuard; i++)
+    IPLUG_CHECK(pBlock[i] == kUnwritten, "ramp %d-%d: wrote sample %d after the block", ramp.transitionStart, ramp.transitionEnd, i);
+
+  for (auto i = 0; i < kNFrames; i++)
+  {
+    const double expected = ramp.GetValueAt(i);
+    IPLUG_CHECK(std::fabs(pBlock[kStartIdx + i] - expected) < 1e-6, "ramp %d-%d: Write() sample %d is %g, GetValueAt() %g", ramp.transitionStart, ramp.transitionEnd, i, pBlock[kStartIdx + i], expected);
+  }
+
+  if (ramp.transitionStart < kNFrames && ramp.transitionEnd <= kNFrames)
+    IPLUG_CHECK(pBlock[kStartIdx + kNFrames - 1] == static_cast<float>(ramp.endValue), "ramp %d-%d: Write() ends on %g, not %g", ramp.transitionStart, ramp.transitionEnd, pBlock[kStartIdx + kNFrames - 1], ramp.endValue);
+}
+
+/** Every transition start and end in and around the block, including steps, and a constant ramp */
+void TestBoundaries()
+{
+  for (auto start = -2; start <= kNFrames + 2; start++)
+  {
+    for (auto end = start; end <= kNFrames + 2; end++)
+    {
+      const ControlRamp ramp {0.25, -0.75, start, end};
+      TestSegments(ramp);
+      TestWrite(ramp);
+    }
+  }
+
+  const ControlRamp constant {0.5, 0.5, 3, 9};
+  TestSegments(constant);
+  TestWrite(constant);
+}
+
+/** A step is at transitionStart, not one sample later or earlier */
+void TestStep()
+{
+  for (auto at : {0, 1, kNFrames / 2, kNFrames - 1})
+  {
+    const ControlRamp step {0., 1., at, at};
+    float buffer[kNFrames];
+    step.Write(buffer, 0, kNFrames);
+
+    for (auto i = 0; i < kNFrames; i++)
+      IPLUG_CHECK(buffer[i] == (i < at ? 0.f : 1.f), "step at %d: sample %d is %g", at, i, buffer[i]);
+  }
+}
+
+/** Glides from ControlRampProcessor are continuous across blocks, reach the target on time, also when they start in a
+ * later block, and Write() them like the accumulating version did */
+void TestProcessorGlides()
+{
+  for (auto glide : {0, 1, 5, 40, 100})
+  {
+    for (auto offset : {0, 3, kNFrames - 1, kNFrames, kNFrames + 5})
+    {
+      ControlRamp ramp {};
+      ControlRampProcessor processor(ramp);
+      processor.SetTarget(1., offset, glide, kNFrames);
+
+      const int reachedAt = offset + std::max(glide, 1) - 1; // the sample on which the ramp is at the target
+      float buffer[kNFrames], accumulated[kNFrames];
+      double previous = 0.;
+
+      for (auto block = 0; block < 6; block++)
+      {
+        processor.Process(kNFrames);
+        IPLUG_CHECK(ramp.startValue == previous, "glide %d from %d: block %d starts at %g, previous ended at %g", glide, offset, block, ramp.startValue, previous);
+        previous = ramp.endValue;
+
+        ramp.Write(buffer, 0, kNFrames);
+        WriteAccumulating(ramp, accumulated, 0, kNFrames);
+
+        for (auto i = 0; i < kNFrames; i++)
+        {
+          const int t = block * kNFrames + i;
+          IPLUG_CHECK(std::fabs(buffer[i] - accumulated[i]) < 1e-6f, "glide %d from %d: sample %d is %g, accumulated %g", glide, offset, t, buffer[i], accumulated[i]);
+
+          if (t >= reachedAt)
+            IPLUG_CHECK(buffer[i] == 1.f, "glide %d from %d: sample %d is %g after the glide", glide, offset, t, buffer[i]);
+          else
+            IPLUG_CHECK(buffer[i] < 1.f, "glide %d from %d: sample %d is at the target early", glide, offset, t);
+        }
+      }
+    }
+  }
+}
+
+/** 128 voices with five ramps each, a 512 sample block in 16 sample sub-blocks, as MidiSynth's default slicing calls them */
+void BenchmarkRamps()
+{
+  constexpr int kNRamps = 128 * 5, kBlockSize = 512, kSubBlockSize = 16;
+  std::vector<ControlRamp> ramps(kNRamps, ControlRamp {0.3, 0.3, 0, 0});
+  ramps[7] = {0.1, 0.3, 3, 12}; // one voice is gliding
+  float buffer[kSubBlockSize];
+
+  auto writeAll = [&](bool accumulating) {
+    double sum = 0.;
+    for (auto s = 0; s < kBlockSize; s += kSubBlockSize)
+    {
+      for (auto& ramp : ramps)
+      {
+        if (accumulating)
+          WriteAccumulating(ramp, buffer, 0, kSubBlockSize);
+        else
+          ramp.Write(buffer, 0, kSubBlockSize);
+        sum += buffer[5];
+      }
+    }
+    DoNotOptimize(sum);
+  };
+
+  auto query = [&]() {
+    double sum = 0.;
+    for (auto s = 0; s < kBlockSize; s += kSubBlockSize)
+    {
+      for (auto& ramp : ramps)
+      {
+        if (ramp.IsConstant())
+          sum += ramp.endValue;
+        else
+        {
+          ramp.Write(buffer, 0, kSubBlockSize);
+          sum += buffer[5];
+        }
+      }
+    }
+    DoNotOptimize(sum);
+  };
+
+  printf("%d ramps per %d sample sub-block, per %d sample block:\n", kNRamps, kSubBlockSize, kBlockSize);
+  printf("  accumulating Write()   %8.2f us\n", TimeMicroseconds([&]() { writeAll(true); }));
+  printf("  Write()                %8.2f us\n", TimeMicroseconds([&]() { writeAll(false); }));
+  printf("  query, write if needed %8.2f us\n", TimeMicroseconds(query));
+}
+
+/** The IPlugInstrument example with every voice held, its timbre ramps constant */
+void BenchmarkInstrument()
+{
+  constexpr int kNVoices = 128, kBlockSize = 512;
+  IPlugInstrumentDSP<sample> dsp(kNVoices);
+  dsp.Reset(48000., kBlockSize);
+  dsp.SetParam(kParamGain, 100.);
+  dsp.SetParam(kParamSustain, 50.);
+  dsp.SetParam(kParamAttack, 1.);
+  dsp.SetParam(kParamDecay, 100.);
+  dsp.SetParam(kParamRelease, 100.);
+
+  for (auto k = 0; k < kNVoices; k++)
+  {
+    IMidiMsg msg;
+    msg.MakeNoteOnMsg(k, 100, 0);
+    dsp.ProcessMidiMsg(msg);
+  }
+
+  std::vector<sample> left(kBlockSize), right(kBlockSize);
+  sample* outputs[2] = {left.data(), right.data()};
+
+  const double t = TimeMicroseconds([&]() {
+    dsp.ProcessBlock(nullptr, outputs, 2, kBlockSize);
+    DoNotOptimize(left[kBlockSize - 1]);
+  });
+
+  printf("IPlugInstrument, %d held notes: %8.1f us per %d sample block\n", kNVoices, t, kBlockSize);
+}
+
+} // namespace
+
+int main()
+{
+  TestBoundaries();
+  TestStep();
+  TestProcessorGlides();
+
+  BenchmarkRamps();
+  BenchmarkInstrument();
+
+  return TestResult("ControlRampTest");
+}
@@ -0,0 +1,268 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Compares SVF, DCBlocker and NoiseGate, which process channels in SIMDLane lanes, with the scalar implementations
+// they replaced (ScalarReference.h), then times both. The lane timings include gathering each sample frame from the
+// channel buffers into a vector and scattering the result back.
+//
+// Expected accuracy:
+// - DCBlocker and NoiseGate: bit-exact for float and double.
+// - SVF<double>: bit-exact, the recursion and the output sum are the same double operations in the same order.
+// - SVF<float> (double state): the output sum is formed in double and rounded to float once, where the scalar
+//   version rounded each term and summed in float, so outputs differ by a few float ulps.
+// - SVF<float, NC, float>: the state is float too, so the error grows with the filter's sensitivity to rounding.
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+#include "ScalarReference.h"
+#include "SVF.h"
+#include "DCBlocker.h"
+#include "NoiseGate.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr int kMaxChans = 9; // more than two AVX double lanes plus a tail
+constexpr int kBlockSize = 256;
+constexpr int kNumBlocks = 8;
+
+template <typename T>
+struct Buffers
+{
+  Buffers(int nChans, int nFrames)
+  : data(static_cast<size_t>(nChans) * nFrames)
+  , ptrs(nChans)
+  {
+    for (auto c = 0; c < nChans; c++)
+      ptrs[c] = data.data() + c * nFrames;
+  }
+
+  std::vector<T> data;
+  std::vector<T*> ptrs;
+};
+
+/** Noise, sines and a decaying tail that reaches the denormal range, different on each channel */
+template <typename T>
+void FillSignal(Buffers<T>& buf, int nChans, int nFrames, int block)
+{
+  std::mt19937 rng(1234 + block);
+  std::uniform_real_distribution<double> noise(-1., 1.);
+
+  for (auto c = 0; c < nChans; c++)
+  {
+    for (auto s = 0; s < nFrames; s++)
+    {
+      const double t = static_cast<double>(block * nFrames + s);
+      double x = 0.5 * std::sin(t * 0.01 * (c + 1)) + 0.25 * noise(rng);
+
+      if (block >= kNumBlocks / 2)
+        x *= std::pow(1e-3, t / nFrames); // decays towards the denormal range
+
+      buf.ptrs[c][s] = static_cast<T>(x);
+    }
+  }
+}
+
+template <typename T>
+double MaxDiff(const Buffers<T>& a, const Buffers<T>& b, int nChans, int nFrames, double& maxRef)
+{
+  double maxDiff = 0.;
+
+  for (auto c = 0; c < nChans; c++)
+  {
+    for (auto s = 0; s < nFrames; s++)
+    {
+      maxDiff = std::max(maxDiff, std::abs(static_cast<double>(a.ptrs[c][s]) - static_cast<double>(b.ptrs[c][s])));
+      maxRef = std::max(maxRef, std::abs(static_cast<double>(b.ptrs[c][s])));
+    }
+  }
+
+  return maxDiff;
+}
+
+const char* kModeNames[] = {SVFMODES_VALIST};
+
+/** @param tolerance The largest difference allowed, relative to the largest reference output */
+template <typename T, typename TState>
+void TestSVF(const char* name, double tolerance)
+{
+  using Lanes = SVF<T, kMaxChans, TState>;
+  using Scalar = ScalarSVF<T, kMaxChans>;
+
+  for (auto mode = 0; mode < Lanes::kNumModes; mode++)
+  {
+    for (auto nChans = 1; nChans <= kMaxChans; nChans++)
+    {
+      Lanes lanes;
+      Scalar scalar;
+      Buffers<T> in(nChans, kBlockSize), outLanes(nChans, kBlockSize), outScalar(nChans, kBlockSize);
+      double maxDiff = 0., maxRef = 0.;
+
+      for (auto block = 0; block < kNumBlocks; block++)
+      {
+        // change the coefficients between blocks
+        const double freq = 200. * (block + 1) * (mode + 1);
+        lanes.SetMode(static_cast<typename Lanes::EMode>(mode));
+        scalar.SetMode(static_cast<typename Scalar::EMode>(mode));
+        lanes.SetSampleRate(48000.);
+        scalar.SetSampleRate(48000.);
+        lanes.SetFreqCPS(freq);
+        scalar.SetFreqCPS(freq);
+        lanes.SetQ(0.5 + block);
+        scalar.SetQ(0.5 + block);
+        lanes.SetGain(6. - 3. * block);
+        scalar.SetGain(6. - 3. * block);
+
+        FillSignal(in, nChans, kBlockSize, block);
+        lanes.ProcessBlock(in.ptrs.data(), outLanes.ptrs.data(), nChans, kBlockSize);
+        scalar.ProcessBlock(in.ptrs.data(), outScalar.ptrs.data(), nChans, kBlockSize);
+        maxDiff = std::max(maxDiff, MaxDiff(outLanes, outScalar, nChans, kBlockSize, maxRef));
+      }
+
+      IPLUG_CHECK(maxDiff <= tolerance * maxRef, "%s %s %d channels: max difference %g, max output %g", name, kModeNames[mode], nChans, maxDiff, maxRef);
+    }
+  }
+}
+
+template <typename T>
+void TestDCBlocker(const char* name)
+{
+  for (auto nChans = 1; nChans <= kMaxChans; nChans++)
+  {
+    DCBlocker<T, kMaxChans> lanes;
+    ScalarDCBlocker<T, kMaxChans> scalar;
+    Buffers<T> in(nChans, kBlockSize), outLanes(nChans, kBlockSize), outScalar(nChans, kBlockSize);
+    double maxDiff = 0., maxRef = 0.;
+
+    for (auto block = 0; block < kNumBlocks; block++)
+    {
+      FillSignal(in, nChans, kBlockSize, block);
+      lanes.ProcessBlock(in.ptrs.data(), outLanes.ptrs.data(), nChans, kBlockSize);
+      scalar.ProcessBlock(in.ptrs.data(), outScalar.ptrs.data(), nChans, kBlockSize);
+      maxDiff = std::max(maxDiff, MaxDiff(outLanes, outScalar, nChans, kBlockSize, maxRef));
+    }
+
+    IPLUG_CHECK(maxDiff == 0., "%s %d channels: max difference %g", name, nChans, maxDiff);
+  }
+}
+
+template <typename T>
+void TestNoiseGate(const char* name)
+{
+  for (auto nChans = 1; nChans <= kMaxChans; nChans++)
+  {
+    NoiseGate<T, kMaxChans> lanes;
+    ScalarNoiseGate<T, kMaxChans> scalar;
+
+    lanes.SetSampleRate(48000.);
+    scalar.SetSampleRate(48000.);
+    lanes.SetThreshold(-20.);
+    scalar.SetThreshold(-20.);
+    lanes.SetAttackTime(0.002);
+    scalar.SetAttackTime(0.002);
+    lanes.SetHoldTime(0.005);
+    scalar.SetHoldTime(0.005);
+    lanes.SetReleaseTime(0.05);
+    scalar.SetReleaseTime(0.05);
+
+    // odd block sizes exercise the gain sub-blocks and the lane tails
+    const int nFrames = kBlockSize + 37;
+    Buffers<T> in(nChans, nFrames), sidechain(1, nFrames), outLanes(nChans, nFrames), outScalar(nChans, nFrames);
+    double maxDiff = 0., maxRef = 0.;
+
+    for (auto block = 0; block < kNumBlocks; block++)
+    {
+      FillSignal(in, nChans, nFrames, block);
+      FillSignal(sidechain, 1, nFrames, block + 100);
+
+      // gate the sidechain on and off
+      for (auto s = 0; s < nFrames; s++)
+        sidechain.ptrs[0][s] *= static_cast<T>(((s / 64) & 1) ? 1. : 0.01);
+
+      lanes.ProcessBlock(in.ptrs.data(), outLanes.ptrs.data(), sidechain.ptrs[0], nChans, nFrames);
+      scalar.ProcessBlock(in.ptrs.data(), outScalar.ptrs.data(), sidechain.ptrs[0], nChans, nFrames);
+      maxDiff = std::max(maxDiff, MaxDiff(outLanes, outScalar, nChans, nFrames, maxRef));
+    }
+
+    IPLUG_CHECK(maxDiff == 0., "%s %d channels: max difference %g", name, nChans, maxDiff);
+  }
+}
+
+/** SIMDLane::Floor() against std::floor, including values beyond the int32 range */
+template <typename T>
+void TestFloor(const char* name)
+{
+  using L = SIMDLane<T>;
+  const T values[] = {T(0), T(-0.), T(0.5), T(-0.5), T(1), T(-1), T(2.75), T(-2.75), T(8388607.5), T(-8388607.5),
+                      T(8388609), T(-8388609), T(2147483520), T(-2147483648.), T(3e9), T(-3e9), T(1e10), T(-1e10),
+                      T(1e30), T(-1e30), std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+  constexpr int nValues = sizeof(values) / sizeof(values[0]);
+
+  for (auto i = 0; i < nValues; i++)
+  {
+    T in[L::kWidth], out[L::kWidth];
+
+    // each value in every lane, next to its neighbours
+    for (auto j = 0; j < L::kWidth; j++)
+      in[j] = values[(i + j) % nValues];
+
+    L::Store(out, L::Floor(L::Load(in)));
+
+    for (auto j = 0; j < L::kWidth; j++)
+      IPLUG_CHECK(out[j] == std::floor(in[j]), "%s Floor(%g) = %g", name, static_cast<double>(in[j]), static_cast<double>(out[j]));
+  }
+}
+
+template <typename Lanes, typename Scalar, typename T>
+void Benchmark(const char* name, int nChans)
+{
+  constexpr int nFrames = 512;
+  Lanes lanes;
+  Scalar scalar;
+  Buffers<T> in(nChans, nFrames), out(nChans, nFrames);
+  FillSignal(in, nChans, nFrames, 0);
+
+  const double tLanes = TimeMicroseconds([&]() { lanes.ProcessBlock(in.ptrs.data(), out.ptrs.data(), nChans, nFrames); DoNotOptimize(out.ptrs[0][0]); });
+  const double tScalar = TimeMicroseconds([&]() { scalar.ProcessBlock(in.ptrs.data(), out.ptrs.data(), nChans, nFrames); DoNotOptimize(out.ptrs[0][0]); });
+
+  printf("  %-28s %2d ch x %d: scalar %8.2f us, lanes %8.2f us (x%.2f)\n", name, nChans, nFrames, tScalar, tLanes, tScalar / tLanes);
+}
+
+} // namespace
+
+int main()
+{
+  TestSVF<double, double>("SVF<double>", 0.);
+  TestSVF<float, double>("SVF<float>", 1e-6);
+  TestSVF<float, float>("SVF<float, NC, float>", 1e-3);
+  TestDCBlocker<double>("DCBlocker<double>");
+  TestDCBlocker<float>("DCBlocker<float>");
+  TestNoiseGate<double>("NoiseGate<double>");
+  TestNoiseGate<float>("NoiseGate<float>");
+  TestFloor<double>("SIMDLane<double>");
+  TestFloor<float>("SIMDLane<float>");
+
+  printf("SIMDLane<double> width %d, SIMDLane<float> width %d\n", SIMDLane<double>::kWidth, SIMDLane<float>::kWidth);
+  Benchmark<SVF<double, 2>, ScalarSVF<double, 2>, double>("SVF<double>", 2);
+  Benchmark<SVF<double, 16>, ScalarSVF<double, 16>, double>("SVF<double>", 16);
+  Benchmark<SVF<float, 16, float>, ScalarSVF<float, 16>, float>("SVF<float, 16, float>", 16);
+  Benchmark<DCBlocker<double, 2>, ScalarDCBlocker<double, 2>, double>("DCBlocker<double>", 2);
+  Benchmark<DCBlocker<float, 16>, ScalarDCBlocker<float, 16>, float>("DCBlocker<float>", 16);
+
+  return TestResult("DSPLanesTest");
+}
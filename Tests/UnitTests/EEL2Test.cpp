@@ -0,0 +1,301 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Checks EEL2Processor: compile errors keep the running program, a script with bound parameters matches the same DSP
+// written in C++ (to 1e-12), and a recompiled program is swapped in at the start of the next block, crossfaded from the
+// previous one over that block (to 1e-12), which keeps running until then, and is freed by FreeRetiredProgram() or the next
+// Compile() (counted with NSEEL_getstats()). Recompiles on another thread while audio runs, then times the script
+// against C++ per sample frame. Built with EEL_TARGET_PORTABLE on Linux x86-64, like the iPlug2::Extras::EEL2 target.
+
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+#include "IPlugEEL2.h"
+#include "eel2/ns-eel.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr int kBlockSize = 256;
+
+/** A one pole lowpass and a soft clip, per channel */
+const char* kFilterScript = R"(
+@init
+y0 = y1 = 0;
+@block
+a = exp(-2 * $pi * cutoff / srate);
+@sample
+y0 = spl0 + a * (y0 - spl0);
+y1 = spl1 + a * (y1 - spl1);
+spl0 = drive * y0 / (1 + abs(drive * y0));
+spl1 = drive * y1 / (1 + abs(drive * y1));
+)";
+
+/** kFilterScript in C++ */
+struct Filter
+{
+  void Process(sample** inputs, sample** outputs, int nFrames, double cutoff, double drive, double sampleRate)
+  {
+    const double a = std::exp(-2. * PI * cutoff / sampleRate);
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      y0 = inputs[0][s] + a * (y0 - inputs[0][s]);
+      y1 = inputs[1][s] + a * (y1 - inputs[1][s]);
+      outputs[0][s] = drive * y0 / (1. + std::fabs(drive * y0));
+      outputs[1][s] = drive * y1 / (1. + std::fabs(drive * y1));
+    }
+  }
+
+  double y0 = 0., y1 = 0.;
+};
+
+/** A stereo block, filled with a test signal */
+struct Block
+{
+  Block()
+  {
+    for (auto s = 0; s < kBlockSize; s++)
+    {
+      mData[0][s] = std::sin(s * 0.05);
+      mData[1][s] = std::cos(s * 0.03);
+    }
+  }
+
+  std::vector<sample> mData[2] = {std::vector<sample>(kBlockSize), std::vector<sample>(kBlockSize)};
+  sample* mPtrs[2] = {mData[0].data(), mData[1].data()};
+};
+
+int NumCodeHandles()
+{
+  return NSEEL_getstats()[4];
+}
+
+/** Compile errors are reported, and leave the program that is running */
+void TestCompileErrors()
+{
+  EEL2Processor processor;
+  processor.OnReset(48000., kBlockSize);
+  WDL_String error;
+
+  IPLUG_CHECK(!processor.Compile("@sample\nspl0 = (;", &error) && error.GetLength(), "syntax error: accepted");
+  IPLUG_CHECK(!processor.Compile("@samples\nspl0 = 0;", &error) && strstr(error.Get(), "unknown section"), "unknown section: %s", error.Get());
+  IPLUG_CHECK(!processor.HasProgram(), "a failed compile left a program");
+
+  Block in, out;
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0] == in.mData[0] && out.mData[1] == in.mData[1], "without a program, inputs are not passed through");
+
+  IPLUG_CHECK(processor.Compile("@sample\nspl0 = spl1 = 0.5;"), "compile failed");
+  IPLUG_CHECK(!processor.Compile("@sample\nspl0 = (;"), "syntax error: accepted");
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0][0] == 0.5, "a failed compile replaced the program, output %g", out.mData[0][0]);
+}
+
+/** The filter script, with bound parameters, gives the output of the C++ filter */
+void TestAgainstCpp()
+{
+  IParam cutoff, drive;
+  cutoff.InitDouble("Cutoff", 1000., 20., 20000., 1.);
+  drive.InitDouble("Drive", 2., 1., 10., 0.1);
+
+  EEL2Processor processor;
+  processor.BindParam(&cutoff, "cutoff");
+  processor.BindParam(&drive, "drive");
+  processor.OnReset(48000., kBlockSize);
+
+  WDL_String error;
+  IPLUG_CHECK(processor.Compile(kFilterScript, &error), "filter script: %s", error.Get());
+
+  Block in, out, expected;
+  Filter filter;
+  double maxDiff = 0.;
+
+  for (auto b = 0; b < 8; b++)
+  {
+    if (b == 4)
+      cutoff.Set(3000.);
+
+    processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+    filter.Process(in.mPtrs, expected.mPtrs, kBlockSize, cutoff.Value(), drive.Value(), 48000.);
+
+    for (auto c = 0; c < 2; c++)
+      for (auto s = 0; s < kBlockSize; s++)
+        maxDiff = std::max(maxDiff, std::fabs(out.mData[c][s] - expected.mData[c][s]));
+  }
+
+  IPLUG_CHECK(maxDiff < 1e-12, "filter script differs from C++ by %g", maxDiff);
+}
+
+/** Compile, swap at the next block, crossfade over it, retire the previous program and free it */
+void TestSwap()
+{
+  const int nHandlesBefore = NumCodeHandles();
+  EEL2Processor processor;
+  processor.OnReset(48000., kBlockSize);
+  Block in, out;
+
+  // a counts samples, so that it shows it is still running while it fades out
+  IPLUG_CHECK(processor.Compile("@sample\nn += 1; spl0 = spl1 = n;"), "compile a failed");
+  const int nHandlesA = NumCodeHandles() - nHandlesBefore;
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0][kBlockSize - 1] == kBlockSize, "a: last sample %g", out.mData[0][kBlockSize - 1]);
+
+  IPLUG_CHECK(processor.Compile("@sample\nspl0 = spl1 = -1;"), "compile b failed");
+  const int nHandlesB = NumCodeHandles() - nHandlesBefore - nHandlesA;
+  IPLUG_CHECK(nHandlesA > 0 && nHandlesB > 0, "%d and %d code handles", nHandlesA, nHandlesB);
+
+  // the block that swaps fades from a to b
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  double maxDiff = 0.;
+
+  for (auto s = 0; s < kBlockSize; s++)
+  {
+    const double a = kBlockSize + s + 1, b = -1., gain = (s + 1.) / kBlockSize;
+    maxDiff = std::max(maxDiff, std::fabs(out.mData[0][s] - (a + (b - a) * gain)));
+  }
+
+  IPLUG_CHECK(maxDiff < 1e-12, "crossfade differs by %g", maxDiff);
+  IPLUG_CHECK(out.mData[0][kBlockSize - 1] == -1., "crossfade ends on %g", out.mData[0][kBlockSize - 1]);
+
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0][0] == -1. && out.mData[1][kBlockSize - 1] == -1., "b after the swap: %g", out.mData[0][0]);
+
+  // a is retired, until it is freed on this thread
+  IPLUG_CHECK(NumCodeHandles() - nHandlesBefore == nHandlesA + nHandlesB, "a was freed before FreeRetiredProgram()");
+  processor.FreeRetiredProgram();
+  IPLUG_CHECK(NumCodeHandles() - nHandlesBefore == nHandlesB, "a was not freed by FreeRetiredProgram()");
+
+  // two compiles before a block: the first is never swapped in, and the next Compile() frees the retired program
+  IPLUG_CHECK(processor.Compile("@sample\nspl0 = spl1 = 2;"), "compile c failed");
+  IPLUG_CHECK(processor.Compile("@sample\nspl0 = spl1 = 3;"), "compile d failed");
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0][kBlockSize - 1] == 3., "b did not fade to d: %g", out.mData[0][kBlockSize - 1]);
+  IPLUG_CHECK(processor.Compile("@sample\nspl0 = spl1 = 4;"), "compile e failed");
+  IPLUG_CHECK(NumCodeHandles() - nHandlesBefore == 2 * nHandlesB, "b was not freed by Compile()");
+}
+
+/** OnReset() runs @init again, for the running program and the one waiting to be swapped in */
+void TestReset()
+{
+  EEL2Processor processor;
+  processor.OnReset(48000., kBlockSize);
+  Block in, out;
+
+  IPLUG_CHECK(processor.Compile("@init\nrate = srate;\n@sample\nspl0 = spl1 = rate;"), "compile failed");
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0][0] == 48000., "@init saw srate %g", out.mData[0][0]);
+
+  processor.OnReset(44100., kBlockSize);
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0][0] == 44100., "OnReset(): the running program saw srate %g", out.mData[0][0]);
+
+  IPLUG_CHECK(processor.Compile("@init\nrate = -srate;\n@sample\nspl0 = spl1 = rate;"), "compile failed");
+  processor.OnReset(96000., kBlockSize);
+  processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+  IPLUG_CHECK(out.mData[0][kBlockSize - 1] == -96000., "OnReset(): the waiting program saw srate %g", -out.mData[0][kBlockSize - 1]);
+}
+
+/** Recompile on another thread while blocks are processed: every sample is one program's value or a fade between them */
+void TestCompileWhileProcessing()
+{
+  const int nHandlesBefore = NumCodeHandles();
+  int nBad = 0, nBlocks = 0;
+
+  {
+    EEL2Processor processor;
+    processor.OnReset(48000., kBlockSize);
+    processor.Compile("@sample\nspl0 = spl1 = 1;");
+
+    std::atomic<bool> run {true};
+    std::thread compiler([&]() {
+      for (auto i = 0; run; i++)
+      {
+        processor.Compile(i % 2 ? "@sample\nspl0 = spl1 = 1;" : "@sample\nspl0 = spl1 = 2;");
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    });
+
+    Block in, out;
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+      processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize);
+      nBlocks++;
+
+      for (auto c = 0; c < 2; c++)
+        for (auto s = 0; s < kBlockSize; s++)
+          nBad += !(out.mData[c][s] >= 1. && out.mData[c][s] <= 2.);
+    }
+
+    run = false;
+    compiler.join();
+  }
+
+  IPLUG_CHECK(nBad == 0, "%d bad samples in %d blocks", nBad, nBlocks);
+  IPLUG_CHECK(NumCodeHandles() == nHandlesBefore, "%d code handles leaked", NumCodeHandles() - nHandlesBefore);
+}
+
+void Benchmark()
+{
+  IParam cutoff, drive;
+  cutoff.InitDouble("Cutoff", 1000., 20., 20000., 1.);
+  drive.InitDouble("Drive", 2., 1., 10., 0.1);
+
+  EEL2Processor processor;
+  processor.BindParam(&cutoff, "cutoff");
+  processor.BindParam(&drive, "drive");
+  processor.OnReset(48000., kBlockSize);
+  processor.Compile(kFilterScript);
+
+  Block in, out;
+  Filter filter;
+
+  const double tEEL = TimeMicroseconds([&]() { processor.ProcessBlock(in.mPtrs, out.mPtrs, kBlockSize); });
+  const double tCpp = TimeMicroseconds([&]() {
+    filter.Process(in.mPtrs, out.mPtrs, kBlockSize, cutoff.Value(), drive.Value(), 48000.);
+    DoNotOptimize(out.mData[0][0]);
+  });
+
+#if defined EEL_TARGET_PORTABLE
+  const char* name = "EEL2 interpreter";
+#else
+  const char* name = "EEL2 JIT";
+#endif
+  printf("Lowpass and soft clip, stereo, %d sample blocks, per sample frame:\n", kBlockSize);
+  printf("  %-18s %8.2f ns\n", name, tEEL * 1000. / kBlockSize);
+  printf("  %-18s %8.2f ns\n", "C++", tCpp * 1000. / kBlockSize);
+}
+
+} // namespace
+
+int main()
+{
+  TestCompileErrors();
+  TestAgainstCpp();
+  TestSwap();
+  TestReset();
+  TestCompileWhileProcessing();
+
+  Benchmark();
+
+  return TestResult("EEL2Test");
+}
@@ -0,0 +1,290 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Checks FFTPlan against a double precision reference FFT for 4 to 65536 points, with WDL_real_fft measured the same
+// way for comparison, then times WDL_real_fft and FFTPlan at 256 to 65536 points.
+// Built twice more with IPLUG_FFT_WDL, where single float transforms go through WDL_real_fft up to 32768 points.
+//
+// Expected accuracy, largest error relative to the largest bin:
+// - FFTPlan<float> ~1.5e-7, WDL_real_fft ~1e-7. FFTPlan<double> ~7e-16.
+// - Inverse(Forward(x)) returns x to within a few ulps of the largest sample.
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+#include "FFTPlan.h"
+#include "fft.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr int kMinLog2Size = 2;
+constexpr int kMaxLog2Size = 16;
+constexpr int kMaxWDLSize = 32768; // WDL_real_fft() goes up to 32768 points
+constexpr int kBatchChans = 8;
+
+/** Bins 0..N/2 of the DFT of N real samples, by an iterative radix-2 FFT in double */
+std::vector<std::complex<double>> ReferenceFFT(const std::vector<double>& input)
+{
+  const int n = static_cast<int>(input.size());
+  std::vector<std::complex<double>> x(input.begin(), input.end());
+
+  for (int i = 1, j = 0; i < n; i++)
+  {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+
+    if (i < j)
+      std::swap(x[i], x[j]);
+  }
+
+  const double pi = std::acos(-1.);
+
+  for (auto len = 2; len <= n; len <<= 1)
+  {
+    for (auto i = 0; i < n; i += len)
+    {
+      for (auto k = 0; k < len / 2; k++)
+      {
+        const auto w = std::polar(1., -2. * pi * k / len);
+        const auto a = x[i + k];
+        const auto b = x[i + k + len / 2] * w;
+        x[i + k] = a + b;
+        x[i + k + len / 2] = a - b;
+      }
+    }
+  }
+
+  x.resize(n / 2 + 1);
+  return x;
+}
+
+std::vector<double> MakeSignal(int size, int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> noise(-1., 1.);
+  std::vector<double> signal(size);
+
+  for (auto i = 0; i < size; i++)
+    signal[i] = 0.5 * std::sin(0.05 * i * (seed % 7 + 1)) + 0.5 * noise(rng);
+
+  return signal;
+}
+
+/** @return The largest difference between a packed spectrum and the reference bins, relative to the largest bin */
+template <typename T>
+double SpectrumError(const T* packed, const std::vector<std::complex<double>>& ref)
+{
+  const int half = static_cast<int>(ref.size()) - 1;
+  double maxDiff = std::max(std::abs(packed[0] - ref[0].real()), std::abs(packed[1] - ref[half].real()));
+  double maxRef = std::max(std::abs(ref[0]), std::abs(ref[half]));
+
+  for (auto k = 1; k < half; k++)
+  {
+    maxDiff = std::max(maxDiff, std::abs(std::complex<double>(packed[2 * k], packed[2 * k + 1]) - ref[k]));
+    maxRef = std::max(maxRef, std::abs(ref[k]));
+  }
+
+  return maxDiff / maxRef;
+}
+
+/** WDL_real_fft() unpacked to FFTPlan's layout and scaling, the way ISpectrumSender used it before FFTPlan */
+void WDLForward(std::vector<WDL_FFT_REAL>& buf, WDL_FFT_REAL* output)
+{
+  const int size = static_cast<int>(buf.size());
+  const int half = size / 2;
+  WDL_real_fft(buf.data(), size, 0);
+
+  const WDL_FFT_COMPLEX* pBins = reinterpret_cast<const WDL_FFT_COMPLEX*>(buf.data());
+  output[0] = buf[0] * WDL_FFT_REAL(0.5);
+  output[1] = buf[1] * WDL_FFT_REAL(0.5);
+
+  for (auto k = 1; k < half; k++)
+  {
+    const WDL_FFT_COMPLEX& bin = pBins[WDL_fft_permute(half, k)];
+    output[2 * k] = bin.re * WDL_FFT_REAL(0.5);
+    output[2 * k + 1] = bin.im * WDL_FFT_REAL(0.5);
+  }
+}
+
+/** @param tolerance The largest error allowed, relative to the largest bin or sample */
+template <typename T>
+void TestAccuracy(const char* name, double tolerance)
+{
+  printf("%s accuracy, relative to the largest bin:\n", name);
+
+  for (auto log2Size = kMinLog2Size; log2Size <= kMaxLog2Size; log2Size++)
+  {
+    const int size = 1 << log2Size;
+    FFTPlan<T> plan(size);
+
+    // single and batch transforms, with one channel more than a batch so that the tail goes through Forward()
+    const int nChans = kBatchChans + 1;
+    std::vector<std::vector<double>> signals;
+    std::vector<std::vector<T>> inputs(nChans), outputs(nChans, std::vector<T>(size));
+    std::vector<const T*> inPtrs;
+    std::vector<T*> outPtrs;
+    double forwardError = 0., batchError = 0., roundTripError = 0., batchRoundTripError = 0.;
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      signals.push_back(MakeSignal(size, 100 * log2Size + c));
+      inputs[c].assign(signals[c].begin(), signals[c].end());
+      inPtrs.push_back(inputs[c].data());
+      outPtrs.push_back(outputs[c].data());
+    }
+
+    std::vector<T> single(size), roundTrip(size);
+    plan.ForwardBatch(inPtrs.data(), outPtrs.data(), nChans);
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      const auto ref = ReferenceFFT(signals[c]);
+      plan.Forward(inputs[c].data(), single.data());
+      forwardError = std::max(forwardError, SpectrumError(single.data(), ref));
+      batchError = std::max(batchError, SpectrumError(outputs[c].data(), ref));
+
+      plan.Inverse(single.data(), roundTrip.data());
+
+      for (auto i = 0; i < size; i++)
+        roundTripError = std::max(roundTripError, std::abs(static_cast<double>(roundTrip[i] - inputs[c][i])));
+    }
+
+    // in place
+    plan.InverseBatch(outPtrs.data(), outPtrs.data(), nChans);
+
+    for (auto c = 0; c < nChans; c++)
+      for (auto i = 0; i < size; i++)
+        batchRoundTripError = std::max(batchRoundTripError, std::abs(static_cast<double>(outputs[c][i] - inputs[c][i])));
+
+    double wdlError = -1.;
+
+    if (std::is_same<T, WDL_FFT_REAL>::value && size >= 4 && size <= kMaxWDLSize)
+    {
+      std::vector<WDL_FFT_REAL> buf(signals[0].begin(), signals[0].end()), out(size);
+      WDLForward(buf, out.data());
+      wdlError = SpectrumError(out.data(), ReferenceFFT(signals[0]));
+    }
+
+    // the signals peak at 1
+    IPLUG_CHECK(forwardError <= tolerance, "%s %d points: Forward() error %g", name, size, forwardError);
+    IPLUG_CHECK(batchError <= tolerance, "%s %d points: ForwardBatch() error %g", name, size, batchError);
+    IPLUG_CHECK(roundTripError <= 4. * tolerance, "%s %d points: round trip error %g", name, size, roundTripError);
+    IPLUG_CHECK(batchRoundTripError <= 4. * tolerance, "%s %d points: batch round trip error %g", name, size, batchRoundTripError);
+
+    if (wdlError >= 0.)
+      printf("  %5d: Forward %.2e, batch %.2e, round trip %.2e / %.2e, WDL_real_fft %.2e\n", size, forwardError, batchError, roundTripError, batchRoundTripError, wdlError);
+    else
+      printf("  %5d: Forward %.2e, batch %.2e, round trip %.2e / %.2e\n", size, forwardError, batchError, roundTripError, batchRoundTripError);
+  }
+}
+
+/** Circular convolution with MultiplyAccumulate(), against a direct sum */
+template <typename T>
+void TestMultiplyAccumulate(const char* name, double tolerance)
+{
+  constexpr int size = 64;
+  FFTPlan<T> plan(size);
+  const auto a = MakeSignal(size, 1), b = MakeSignal(size, 2), d = MakeSignal(size, 3);
+  std::vector<T> ta(a.begin(), a.end()), tb(b.begin(), b.end()), td(d.begin(), d.end()), acc(size, T(0));
+
+  // acc = a * b + a * d
+  plan.Forward(ta.data(), ta.data());
+  plan.Forward(tb.data(), tb.data());
+  plan.Forward(td.data(), td.data());
+  FFTPlan<T>::MultiplyAccumulate(ta.data(), tb.data(), acc.data(), size);
+  FFTPlan<T>::MultiplyAccumulate(ta.data(), td.data(), acc.data(), size);
+  plan.Inverse(acc.data(), acc.data());
+
+  double maxDiff = 0.;
+
+  for (auto n = 0; n < size; n++)
+  {
+    double sum = 0.;
+
+    for (auto m = 0; m < size; m++)
+      sum += a[m] * (b[(n - m + size) % size] + d[(n - m + size) % size]);
+
+    maxDiff = std::max(maxDiff, std::abs(acc[n] - sum));
+  }
+
+  IPLUG_CHECK(maxDiff <= tolerance, "%s MultiplyAccumulate(): max difference %g", name, maxDiff);
+}
+
+void Benchmark()
+{
+  printf("Forward transform, SIMDLane<float> width %d, SIMDLane<double> width %d:\n", SIMDLane<float>::kWidth, SIMDLane<double>::kWidth);
+  printf("      N   WDL_real_fft    FFTPlan<float>  batch/ch    FFTPlan<double>  batch/ch\n");
+
+  for (auto log2Size = 8; log2Size <= kMaxLog2Size; log2Size++)
+  {
+    const int size = 1 << log2Size;
+    const auto signal = MakeSignal(size, log2Size);
+    double tWDL = 0.;
+
+    if (size <= kMaxWDLSize)
+    {
+      WDL_fft_init();
+      std::vector<WDL_FFT_REAL> buf(size);
+      tWDL = TimeMicroseconds([&]() { std::copy(signal.begin(), signal.end(), buf.begin()); WDL_real_fft(buf.data(), size, 0); DoNotOptimize(buf[1]); });
+    }
+
+    auto timePlan = [&](auto zero, double& tSingle, double& tBatch) {
+      using T = decltype(zero);
+      FFTPlan<T> plan(size);
+      std::vector<std::vector<T>> ins(kBatchChans, std::vector<T>(signal.begin(), signal.end()));
+      std::vector<std::vector<T>> outs(kBatchChans, std::vector<T>(size));
+      std::vector<const T*> inPtrs;
+      std::vector<T*> outPtrs;
+
+      for (auto c = 0; c < kBatchChans; c++)
+      {
+        inPtrs.push_back(ins[c].data());
+        outPtrs.push_back(outs[c].data());
+      }
+
+      tSingle = TimeMicroseconds([&]() { plan.Forward(inPtrs[0], outPtrs[0]); DoNotOptimize(outs[0][1]); });
+      tBatch = TimeMicroseconds([&]() { plan.ForwardBatch(inPtrs.data(), outPtrs.data(), kBatchChans); DoNotOptimize(outs[0][1]); }) / kBatchChans;
+    };
+
+    double tFloat, tFloatBatch, tDouble, tDoubleBatch;
+    timePlan(0.f, tFloat, tFloatBatch);
+    timePlan(0., tDouble, tDoubleBatch);
+
+    if (size <= kMaxWDLSize)
+      printf("  %5d   %9.2f us  %9.2f us  %7.2f us  %9.2f us   %7.2f us\n", size, tWDL, tFloat, tFloatBatch, tDouble, tDoubleBatch);
+    else
+      printf("  %5d    unsupported  %9.2f us  %7.2f us  %9.2f us   %7.2f us\n", size, tFloat, tFloatBatch, tDouble, tDoubleBatch);
+  }
+}
+
+} // namespace
+
+int main()
+{
+  WDL_fft_init();
+
+  TestAccuracy<float>("FFTPlan<float>", 1e-6);
+  TestAccuracy<double>("FFTPlan<double>", 1e-14);
+  TestMultiplyAccumulate<float>("FFTPlan<float>", 1e-4);
+  TestMultiplyAccumulate<double>("FFTPlan<double>", 1e-12);
+  Benchmark();
+
+  return TestResult("FFTPlanTest");
+}
@@ -0,0 +1,348 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Checks that IRECTList::Optimize() gives non-overlapping rects covering exactly the area of its input, by rasterising
+// random lists and control layouts, and compares it with the pairwise Shrink()/Split() algorithm it replaced. That one
+// can lose area, when an intersection is in the middle of a rect and Shrink() keeps only one side; the count of such
+// lists is printed. Then times both on rows and grids of controls, and on a staircase, the worst case for the sweep.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// libstdc++ before GCC 14 doesn't declare std::fmodf, which IGraphicsStructs.h uses
+#if defined __GLIBCXX__
+namespace std { using ::fmodf; }
+#endif
+
+#include "TestUtils.h"
+#include "IGraphicsStructs.h"
+
+using namespace iplug;
+using namespace igraphics;
+using namespace iplugtest;
+
+namespace
+{
+
+/** The IRECTList optimisation from before the sweep line, two O(n^2) passes over the list */
+struct OldIRECTList
+{
+  WDL_TypedBuf<IRECT> mRects;
+
+  int Size() const { return mRects.GetSize(); }
+  const IRECT& Get(int idx) const { return mRects.Get()[idx]; }
+  void Set(int idx, const IRECT& rect) { mRects.Get()[idx] = rect; }
+  void Add(const IRECT& rect) { mRects.Add(rect); }
+
+  void Optimize()
+  {
+    for (int i = 0; i < Size(); i++)
+    {
+      for (int j = i + 1; j < Size(); j++)
+      {
+        if (Get(i).Contains(Get(j)))
+        {
+          mRects.Delete(j);
+          j--;
+        }
+        else if (Get(j).Contains(Get(i)))
+        {
+          mRects.Delete(i);
+          i--;
+          break;
+        }
+        else if (Get(i).Intersects(Get(j)))
+        {
+          IRECT intersection = Get(i).Intersect(Get(j));
+            
+          if (Get(i).Mergeable(intersection))
+            Set(i, Shrink(Get(i), intersection));
+          else if (Get(j).Mergeable(intersection))
+            Set(j, Shrink(Get(j), intersection));
+          else if (Get(i).Area() < Get(j).Area())
+            Set(i, Split(Get(i), intersection));
+          else
+            Set(j, Split(Get(j), intersection));
+        }
+      }
+    }
+    
+    for (int i = 0; i < Size(); i++)
+    {
+      for (int j = i + 1; j < Size(); j++)
+      {
+        if (Get(i).Mergeable(Get(j)))
+        {
+          Set(j, Get(i).Union(Get(j)));
+          mRects.Delete(i);
+          i = -1;
+          break;
+        }
+      }
+    }
+  }
+  
+  /** Shrinks a rectangle by removing the intersection area
+   * @param r The original rectangle
+   * @param i The intersection rectangle to remove
+   * @return The remaining portion of the original rectangle */
+  IRECT Shrink(const IRECT &r, const IRECT &i)
+  {
+    if (i.L != r.L)
+      return IRECT(r.L, r.T, i.L, r.B);
+    if (i.T != r.T)
+      return IRECT(r.L, r.T, r.R, i.T);
+    if (i.R != r.R)
+      return IRECT(i.R, r.T, r.R, r.B);
+    return IRECT(r.L, i.B, r.R, r.B);
+  }
+  
+  /** Splits a rectangle around an intersection, adding one part to the list
+   * @param r The rectangle to split
+   * @param i The intersection rectangle
+   * @return The remaining portion after adding the split part to the list */
+  IRECT Split(const IRECT r, const IRECT &i)
+  {
+    if (r.L == i.L)
+    {
+      if (r.T == i.T)
+      {
+        Add(IRECT(i.R, r.T, r.R, i.B));
+        return IRECT(r.L, i.B, r.R, r.B);
+      }
+      else
+      {
+        Add(IRECT(r.L, r.T, r.R, i.T));
+        return IRECT(i.R, i.T, r.R, r.B);
+      }
+    }
+    
+    if (r.T == i.T)
+    {
+      Add(IRECT(r.L, r.T, i.L, i.B));
+      return IRECT(r.L, i.B, r.R, r.B);
+    }
+    else
+    {
+      Add(IRECT(r.L, r.T, r.R, i.T));
+      return IRECT(r.L, i.T, i.L, r.B);
+    }
+  }
+};
+
+constexpr int kWidth = 200;
+constexpr int kHeight = 150;
+
+/** The number of rects covering each pixel */
+template <typename L>
+void Rasterise(const L& list, std::vector<int>& coverage)
+{
+  std::fill(coverage.begin(), coverage.end(), 0);
+
+  for (auto i = 0; i < list.Size(); i++)
+  {
+    const IRECT r = list.Get(i);
+
+    for (auto y = static_cast<int>(r.T); y < static_cast<int>(r.B); y++)
+      for (auto x = static_cast<int>(r.L); x < static_cast<int>(r.R); x++)
+        coverage[y * kWidth + x]++;
+  }
+}
+
+/** @return \c true if optimized covers every pixel of input once, and no other pixel */
+bool CoversExactly(const std::vector<int>& input, const std::vector<int>& optimized)
+{
+  for (size_t i = 0; i < input.size(); i++)
+  {
+    if (optimized[i] != (input[i] ? 1 : 0))
+      return false;
+  }
+
+  return true;
+}
+
+/** Random rects, some aligned to a grid so that they share edges, duplicate and merge */
+template <typename L>
+void AddRandomRects(L& list, std::mt19937& rng, int test)
+{
+  const int nRects = 1 + static_cast<int>(rng() % 40);
+
+  for (auto i = 0; i < nRects; i++)
+  {
+    int x = rng() % (kWidth - 10), y = rng() % (kHeight - 10);
+    int w = 1 + rng() % std::min(40, kWidth - x), h = 1 + rng() % std::min(40, kHeight - y);
+
+    if (test % 3 == 0)
+    {
+      x = (x / 10) * 10;
+      y = (y / 10) * 10;
+      w = h = 10;
+    }
+
+    list.Add(IRECT(static_cast<float>(x), static_cast<float>(y), static_cast<float>(x + w), static_cast<float>(y + h)));
+  }
+}
+
+void TestCoverage()
+{
+  std::mt19937 rng(1);
+  std::vector<int> input(kWidth * kHeight), optimized(kWidth * kHeight), old(kWidth * kHeight);
+  int nFailures = 0, nOldFailures = 0;
+
+  for (auto test = 0; test < 3000; test++)
+  {
+    std::mt19937 listRng(rng());
+    IRECTList list;
+    OldIRECTList oldList;
+    AddRandomRects(list, listRng, test);
+
+    for (auto i = 0; i < list.Size(); i++)
+      oldList.Add(list.Get(i));
+
+    Rasterise(list, input);
+    list.Optimize();
+    oldList.Optimize();
+    Rasterise(list, optimized);
+    Rasterise(oldList, old);
+
+    nFailures += !CoversExactly(input, optimized);
+    nOldFailures += !CoversExactly(input, old);
+  }
+
+  IPLUG_CHECK(nFailures == 0, "%d of 3000 random lists not covered exactly", nFailures);
+  printf("random lists not covered exactly: Optimize() %d, previous algorithm %d of 3000\n", nFailures, nOldFailures);
+}
+
+void TestEdgeCases()
+{
+  {
+    IRECTList list;
+    list.Optimize();
+    IPLUG_CHECK(list.Size() == 0, "an empty list gave %d rects", list.Size());
+  }
+
+  {
+    IRECTList list;
+    list.Add(IRECT(10, 10, 10, 50));
+    list.Add(IRECT(30, 10, 50, 10));
+    list.Add(IRECT());
+    list.Add(IRECT(0, 0, 20, 20));
+    list.Add(IRECT(0, 0, 20, 20));
+    list.Optimize();
+    IPLUG_CHECK(list.Size() == 1 && list.Get(0) == IRECT(0, 0, 20, 20), "rects without area and duplicates: %d rects", list.Size());
+  }
+
+  {
+    // a row of touching controls is one rect, a column too
+    IRECTList row, column;
+
+    for (auto i = 0; i < 8; i++)
+    {
+      row.Add(IRECT(i * 10.f, 0.f, i * 10.f + 10.f, 30.f));
+      column.Add(IRECT(0.f, i * 10.f, 30.f, i * 10.f + 10.f));
+    }
+
+    row.Optimize();
+    column.Optimize();
+    IPLUG_CHECK(row.Size() == 1 && row.Get(0) == IRECT(0, 0, 80, 30), "a touching row gave %d rects", row.Size());
+    IPLUG_CHECK(column.Size() == 1 && column.Get(0) == IRECT(0, 0, 30, 80), "a touching column gave %d rects", column.Size());
+  }
+
+  {
+    // separate controls stay separate, unless the region cost makes their bounds cheaper
+    IRECTList cheap, costly;
+
+    for (auto i = 0; i < 10; i++)
+    {
+      cheap.Add(IRECT(i * 10.f, 0.f, i * 10.f + 8.f, 8.f));
+      costly.Add(IRECT(i * 10.f, 0.f, i * 10.f + 8.f, 8.f));
+    }
+
+    cheap.Optimize(0.f);
+    costly.Optimize(64.f);
+    IPLUG_CHECK(cheap.Size() == 10, "region cost 0 gave %d rects", cheap.Size());
+    IPLUG_CHECK(costly.Size() == 1 && costly.Get(0) == IRECT(0, 0, 98, 8), "region cost 64 gave %d rects", costly.Size());
+  }
+}
+
+/** Times Optimize() and the previous algorithm on the same list, made by addRects */
+template <typename F>
+void Benchmark(const char* name, int nControls, F addRects)
+{
+  IRECTList list;
+  OldIRECTList oldList;
+  int nRects = 0, nOld = 0;
+
+  const double t = TimeMicroseconds([&]() {
+    list.Clear();
+    addRects(list);
+    list.Optimize();
+    nRects = list.Size();
+  });
+
+  const double tOld = TimeMicroseconds([&]() {
+    oldList.mRects.Resize(0);
+    addRects(oldList);
+    oldList.Optimize();
+    nOld = oldList.Size();
+  });
+
+  printf("  %-22s %5d controls: Optimize() %9.1f us -> %5d rects, previous %10.1f us -> %5d rects\n", name, nControls, t, nRects, tOld, nOld);
+}
+
+void Benchmarks()
+{
+  for (auto n : {16, 64, 256, 1024})
+  {
+    // meters in rows of 64, each dirty as a bar and a peak line a little wider than the bar
+    Benchmark("meter bridge", n, [n](auto& list) {
+      for (auto i = 0; i < n; i++)
+      {
+        const float x = (i % 64) * 20.f, y = (i / 64) * 110.f;
+        list.Add(IRECT(x, y, x + 16.f, y + 100.f));
+        list.Add(IRECT(x - 1.f, y + 50.f, x + 17.f, y + 52.f));
+      }
+    });
+  }
+
+  for (auto n : {64, 256})
+  {
+    // a grid of overlapping knobs and their labels
+    Benchmark("knob grid", n, [n](auto& list) {
+      for (auto i = 0; i < n; i++)
+      {
+        const float x = (i % 32) * 40.f, y = (i / 32) * 60.f;
+        list.Add(IRECT(x, y, x + 44.f, y + 44.f));
+        list.Add(IRECT(x + 4.f, y + 40.f, x + 40.f, y + 56.f));
+      }
+    });
+  }
+
+  for (auto n : {64, 256, 1024})
+  {
+    // every rect starts in its own band and spans all the later ones, so each band has O(n) rects
+    Benchmark("staircase", n, [n](auto& list) {
+      for (auto i = 0; i < n; i++)
+        list.Add(IRECT(i * 3.f, i * 2.f, i * 3.f + 2.f, n * 2.f + 10.f));
+    });
+  }
+}
+
+} // namespace
+
+int main()
+{
+  TestCoverage();
+  TestEdgeCases();
+  Benchmarks();
+  return TestResult("IRECTListTest");
+}
@@ -0,0 +1,203 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Compares the LevelKernels.h kernels, which use SIMDLane, with the same analysis done one sample at a time with
+// ScalarLane, then times both on 64 channels of 512 frames. Without IPLUG_SIMDE SIMDLane is ScalarLane, so the two
+// LevelAbsMaxSum() timings are the same code, and LevelAbsSum() only gains from its two accumulators.
+//
+// Expected accuracy:
+// - LevelAbsMaxSum(): bit-exact peaks and sums for float and double, every lane accumulates in frame order.
+//   Entries of pPeaks and pSums outside the analysed channels are not written.
+// - LevelAbsSum(): the accumulators are summed in a different order, so the sum is within n float or double
+//   epsilons (relative) of the sequential sum.
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+#include "LevelKernels.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr int kMaxChans = 19; // two AVX float lanes plus a tail
+constexpr int kMaxStartChan = 3;
+
+/** Noise of a different level on each channel, with a few silent stretches and the odd denormal */
+template <typename T>
+std::vector<T> MakeFrames(int frameStride, int nFrames, int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> noise(-1., 1.);
+  std::vector<T> frames(static_cast<size_t>(frameStride) * nFrames);
+
+  for (auto i = 0; i < nFrames; i++)
+  {
+    for (auto c = 0; c < frameStride; c++)
+    {
+      double x = noise(rng) / (c + 1);
+
+      if ((i / 16 + c) % 7 == 0)
+        x = 0.;
+      else if ((i + c) % 53 == 0)
+        x = std::numeric_limits<T>::denorm_min() * (c + 1);
+
+      frames[i * frameStride + c] = static_cast<T>(x);
+    }
+  }
+
+  return frames;
+}
+
+/** LevelAbsMaxSum() with every channel in a ScalarLane */
+template <typename T>
+void ScalarAbsMaxSum(const T* pFrames, int frameStride, int startChan, int nChans, int nFrames, bool squares, T* pPeaks, T* pSums)
+{
+  for (auto c = startChan; c < startChan + nChans; c++)
+    LevelAbsMaxSumLanes<ScalarLane<T>>(pFrames, frameStride, c, nFrames, squares, pPeaks, pSums);
+}
+
+template <typename T>
+void TestAbsMaxSum(const char* typeName)
+{
+  constexpr T kUnwritten = T(-1234);
+  int nMismatches = 0, nOverwrites = 0;
+
+  for (auto nFrames : {0, 1, 7, 64, 333})
+  {
+    for (auto startChan = 0; startChan <= kMaxStartChan; startChan++)
+    {
+      for (auto nChans = 0; startChan + nChans <= kMaxChans; nChans++)
+      {
+        const int frameStride = kMaxChans + 1; // one channel more than is ever analysed
+        const auto frames = MakeFrames<T>(frameStride, nFrames, nFrames + 100 * startChan + nChans);
+
+        for (auto squares : {false, true})
+        {
+          std::vector<T> peaks(frameStride, kUnwritten), sums(frameStride, kUnwritten);
+          std::vector<T> refPeaks(frameStride, kUnwritten), refSums(frameStride, kUnwritten);
+
+          LevelAbsMaxSum(frames.data(), frameStride, startChan, nChans, nFrames, squares, peaks.data(), sums.data());
+          ScalarAbsMaxSum(frames.data(), frameStride, startChan, nChans, nFrames, squares, refPeaks.data(), refSums.data());
+
+          for (auto c = 0; c < frameStride; c++)
+          {
+            if (c < startChan || c >= startChan + nChans)
+            {
+              nOverwrites += peaks[c] != kUnwritten || sums[c] != kUnwritten;
+              continue;
+            }
+
+            if (peaks[c] != refPeaks[c] || sums[c] != refSums[c])
+            {
+              if (nMismatches++ < 5)
+                printf("%s: %d frames, channels %d-%d, %s: channel %d peak %g sum %g, scalar %g %g\n", typeName, nFrames, startChan,
+                       startChan + nChans - 1, squares ? "squares" : "magnitudes", c, (double) peaks[c], (double) sums[c], (double) refPeaks[c], (double) refSums[c]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  IPLUG_CHECK(nMismatches == 0, "%s LevelAbsMaxSum(): %d channels differ from ScalarLane", typeName, nMismatches);
+  IPLUG_CHECK(nOverwrites == 0, "%s LevelAbsMaxSum(): wrote %d channels outside the range", typeName, nOverwrites);
+}
+
+template <typename T>
+void TestAbsSum(const char* typeName)
+{
+  constexpr int kMaxN = 4096;
+  const auto samples = MakeFrames<T>(1, kMaxN + 1, 7);
+
+  for (auto n = 0; n <= kMaxN; n = n < 80 ? n + 1 : n * 2)
+  {
+    // an odd start, so that the loads aren't aligned
+    const T* pSrc = samples.data() + 1;
+    const T sum = LevelAbsSum(pSrc, n);
+
+    T expected = 0;
+    for (auto i = 0; i < n; i++)
+      expected += ScalarLane<T>::Abs(pSrc[i]);
+
+    const double tolerance = n * std::numeric_limits<T>::epsilon() * expected;
+    IPLUG_CHECK(std::fabs(sum - expected) <= tolerance, "%s LevelAbsSum(): %d samples sum to %.17g, sequential %.17g", typeName, n, (double) sum, (double) expected);
+  }
+}
+
+/** 64 channels of 512 frames, as IPeakAvgSender and IPeakSender analyse them */
+template <typename T>
+void Benchmark(const char* typeName)
+{
+  constexpr int kNChans = 64, kNFrames = 512;
+  const auto frames = MakeFrames<T>(kNChans, kNFrames, 1);
+  std::vector<T> peaks(kNChans), sums(kNChans);
+
+  const double tScalar = TimeMicroseconds([&]() {
+    ScalarAbsMaxSum(frames.data(), kNChans, 0, kNChans, kNFrames, true, peaks.data(), sums.data());
+    DoNotOptimize(sums[kNChans - 1]);
+  });
+
+  const double tLanes = TimeMicroseconds([&]() {
+    LevelAbsMaxSum(frames.data(), kNChans, 0, kNChans, kNFrames, true, peaks.data(), sums.data());
+    DoNotOptimize(sums[kNChans - 1]);
+  });
+
+  // one channel at a time along a contiguous buffer, as IPeakSender calls it
+  const auto channel = MakeFrames<T>(1, kNChans * kNFrames, 2);
+
+  const double tSumScalar = TimeMicroseconds([&]() {
+    T sum = 0;
+    for (auto c = 0; c < kNChans; c++)
+    {
+      const T* pSrc = channel.data() + c * kNFrames;
+      for (auto i = 0; i < kNFrames; i++)
+        sum += ScalarLane<T>::Abs(pSrc[i]);
+    }
+    DoNotOptimize(sum);
+  });
+
+  const double tSumLanes = TimeMicroseconds([&]() {
+    T sum = 0;
+    for (auto c = 0; c < kNChans; c++)
+      sum += LevelAbsSum(channel.data() + c * kNFrames, kNFrames);
+    DoNotOptimize(sum);
+  });
+
+  printf("%s, width %d, %d channels of %d frames:\n", typeName, SIMDLane<T>::kWidth, kNChans, kNFrames);
+  printf("  LevelAbsMaxSum() ScalarLane %8.2f us  SIMDLane %8.2f us  %5.2fx\n", tScalar, tLanes, tScalar / tLanes);
+  printf("  LevelAbsSum()    sequential %8.2f us  SIMDLane %8.2f us  %5.2fx\n", tSumScalar, tSumLanes, tSumScalar / tSumLanes);
+}
+
+} // namespace
+
+int main()
+{
+  TestAbsMaxSum<float>("float");
+  TestAbsMaxSum<double>("double");
+  TestAbsSum<float>("float");
+  TestAbsSum<double>("double");
+
+#if defined IPLUG_SIMDE
+  printf("With IPLUG_SIMDE\n");
+#else
+  printf("Without IPLUG_SIMDE, SIMDLane is ScalarLane\n");
+#endif
+  Benchmark<float>("float");
+  Benchmark<double>("double");
+
+  return TestResult("LevelKernelsTest");
+}
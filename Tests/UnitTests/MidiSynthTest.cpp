@@ -0,0 +1,356 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Checks that MidiSynth's fixed and event-driven slicing (SetSlicingMode()) put notes on the same samples: a voice that
+// renders its gate and pitch ramps sample by sample must give exactly the same output in both modes, for any host block
+// size, with notes on and around the slice boundaries, and a note must start on the sample of its event.
+// Then times both modes for host block sizes of 32 to 2048 samples, with a block-oriented voice and the IPlugInstrument
+// example's voice, and prints the time per second of audio.
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+
+// the parameters of the IPlugInstrument example, which its DSP header expects
+enum EParams
+{
+  kParamGain = 0,
+  kParamNoteGlideTime,
+  kParamAttack,
+  kParamDecay,
+  kParamSustain,
+  kParamRelease,
+  kParamLFOShape,
+  kParamLFORateHz,
+  kParamLFORateTempo,
+  kParamLFORateMode,
+  kParamLFODepth,
+  kNumParams
+};
+
+#include "IPlugInstrument_DSP.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr double kSampleRate = 48000.;
+constexpr int kSliceSize = MidiSynth::kDefaultBlockSize;
+
+/** Adds its gate to output 0 and gate * (1 + pitch) to output 1, sample by sample, so that the output shows where the
+ * allocator put each note on and off */
+class GateVoice : public SynthVoice
+{
+public:
+  // busy from its trigger, as its gate ramp only opens when the allocator processes the slice
+  bool GetBusy() const override { return mGateOn || mInputs[kVoiceControlGate].IsNonzero(); }
+  void Trigger(double level, bool isRetrigger) override { mGateOn = true; }
+  void Release() override { mGateOn = false; }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    const ControlRamp& gate = mInputs[kVoiceControlGate];
+    const ControlRamp& pitch = mInputs[kVoiceControlPitch];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      outputs[0][startIdx + s] += gate.GetValueAt(s);
+      outputs[1][startIdx + s] += gate.GetValueAt(s) * (1. + pitch.GetValueAt(s));
+    }
+  }
+
+private:
+  bool mGateOn = false;
+};
+
+/** A sawtooth that does its work in a tight loop over the slice, so that the cost per slice shows */
+class BlockVoice : public SynthVoice
+{
+public:
+  bool GetBusy() const override { return mGateOn; }
+  void Trigger(double level, bool isRetrigger) override { mGateOn = true; }
+  void Release() override { mGateOn = false; }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    const double increment = 0.01 * (1 + mKey % 12);
+    double phase = mPhase;
+
+    for (auto s = startIdx; s < startIdx + nFrames; s++)
+    {
+      phase += increment;
+      phase -= (phase >= 1.);
+      outputs[0][s] += phase - 0.5;
+    }
+
+    mPhase = phase;
+  }
+
+private:
+  bool mGateOn = false;
+  double mPhase = 0.;
+};
+
+struct TimedMsg
+{
+  int mTime; // samples from the start of the run
+  IMidiMsg mMsg;
+};
+
+/** Render msgs, which must be in chronological order, in host blocks of blockSize samples, @return output 0 then output 1 */
+std::vector<sample> Render(const std::vector<TimedMsg>& msgs, int nFrames, int blockSize, MidiSynth::ESlicingMode mode, int maxSliceSize)
+{
+  MidiSynth synth(VoiceAllocator::kPolyModePoly, kSliceSize);
+  std::vector<GateVoice> voices(32); // enough that none is stolen
+
+  for (auto& voice : voices)
+    synth.AddVoice(&voice, 0);
+
+  synth.SetSampleRateAndBlockSize(kSampleRate, blockSize);
+  synth.SetSlicingMode(mode, maxSliceSize);
+
+  std::vector<sample> output(2 * nFrames);
+  auto msgIt = msgs.begin();
+
+  for (auto start = 0; start < nFrames; start += blockSize)
+  {
+    const int n = std::min(blockSize, nFrames - start);
+
+    for (; msgIt != msgs.end() && msgIt->mTime < start + n; ++msgIt)
+    {
+      IMidiMsg msg = msgIt->mMsg;
+      msg.mOffset = msgIt->mTime - start;
+      synth.AddMidiMsgToQueue(msg);
+    }
+
+    sample* outputs[2] = {output.data() + start, output.data() + nFrames + start};
+    synth.ProcessBlock(nullptr, outputs, 0, 2, n);
+  }
+
+  return output;
+}
+
+/** Notes on, just before and just after slice boundaries, and at random times, each held for a while. Keys are given out
+ * in turn, so that no key is pressed again while it is still held. Notes are longer than a slice, as fixed slicing sets
+ * one gate target per voice per slice, and drops a note that starts and ends in the same slice */
+std::vector<TimedMsg> MakeNotes(int nFrames)
+{
+  std::mt19937 rng(3);
+  std::vector<int> times;
+
+  for (auto time = kSliceSize; time + kSliceSize < nFrames; time += 3 * kSliceSize)
+  {
+    times.push_back(time - 1);
+    times.push_back(time);
+    times.push_back(time + 1);
+  }
+
+  for (auto i = 0; i < 100; i++)
+    times.push_back(static_cast<int>(rng() % nFrames));
+
+  std::sort(times.begin(), times.end());
+  std::vector<TimedMsg> msgs;
+
+  for (auto i = 0; i < static_cast<int>(times.size()); i++)
+  {
+    const int key = 24 + i % 80;
+    const int length = kSliceSize + 1 + static_cast<int>(rng() % 300);
+    IMidiMsg on, off;
+    on.MakeNoteOnMsg(key, 1 + static_cast<int>(rng() % 127), 0);
+    off.MakeNoteOffMsg(key, 0);
+    msgs.push_back({times[i], on});
+    msgs.push_back({std::min(times[i] + length, nFrames - 1), off});
+  }
+
+  std::stable_sort(msgs.begin(), msgs.end(), [](const TimedMsg& a, const TimedMsg& b) { return a.mTime < b.mTime; });
+  return msgs;
+}
+
+void TestSameOffsets()
+{
+  constexpr int kNFrames = 8192;
+  const std::vector<TimedMsg> msgs = MakeNotes(kNFrames);
+  const std::vector<sample> reference = Render(msgs, kNFrames, 64, MidiSynth::kSlicingFixed, 0);
+
+  for (auto blockSize : {32, 64, 100, 512, 1024})
+  {
+    for (auto maxSliceSize : {-1, 0, 7, 128}) // -1 for fixed slicing
+    {
+      const auto mode = maxSliceSize < 0 ? MidiSynth::kSlicingFixed : MidiSynth::kSlicingEventDriven;
+      const std::vector<sample> output = Render(msgs, kNFrames, blockSize, mode, std::max(maxSliceSize, 0));
+
+      int nDiffering = 0, firstDiffering = -1;
+      for (auto s = 0; s < 2 * kNFrames; s++)
+      {
+        if (std::fabs(output[s] - reference[s]) > 1e-9)
+        {
+          if (!nDiffering++)
+            firstDiffering = s;
+        }
+      }
+
+      IPLUG_CHECK(nDiffering == 0, "host block %d, max slice %d: %d samples differ, the first is %d", blockSize, maxSliceSize, nDiffering, firstDiffering);
+    }
+  }
+}
+
+/** A single note is silent up to its event and sounds from it on */
+void TestNoteStart()
+{
+  constexpr int kNFrames = 1024;
+
+  for (auto time : {0, 1, kSliceSize - 1, kSliceSize, kSliceSize + 1, 100, 511, 512, kNFrames - 1})
+  {
+    IMidiMsg on;
+    on.MakeNoteOnMsg(60, 100, 0);
+
+    for (auto mode : {MidiSynth::kSlicingFixed, MidiSynth::kSlicingEventDriven})
+    {
+      const std::vector<sample> output = Render({{time, on}}, kNFrames, 512, mode, 0);
+      const int first = static_cast<int>(std::find_if(output.begin(), output.begin() + kNFrames, [](sample s) { return s != 0.; }) - output.begin());
+      IPLUG_CHECK(first == time, "%s slicing: note at %d starts at %d", mode == MidiSynth::kSlicingFixed ? "fixed" : "event-driven", time, first);
+    }
+  }
+}
+
+/** Held notes and about 20 note events per second, as a player might, @return the best time per second of audio in microseconds */
+template <class Synth>
+double Benchmark(Synth& synth, int blockSize)
+{
+  constexpr int kSeconds = 2;
+  std::mt19937 rng(2);
+  std::vector<sample> left(blockSize), right(blockSize);
+  sample* outputs[2] = {left.data(), right.data()};
+  std::chrono::steady_clock::duration total {};
+
+  for (auto k = 0; k < 24; k++)
+  {
+    IMidiMsg msg;
+    msg.MakeNoteOnMsg(36 + k * 2, 100, 0);
+    synth.AddMsg(msg);
+  }
+
+  for (auto b = 0; b < kSeconds * static_cast<int>(kSampleRate) / blockSize; b++)
+  {
+    for (auto s = 0; s < blockSize; s++)
+    {
+      if (rng() % 2400 == 0)
+      {
+        IMidiMsg msg;
+        const int key = 36 + static_cast<int>(rng() % 48);
+        if (rng() % 2)
+          msg.MakeNoteOnMsg(key, 100, s);
+        else
+          msg.MakeNoteOffMsg(key, s);
+        synth.AddMsg(msg);
+      }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    synth.Process(outputs, blockSize);
+    total += std::chrono::steady_clock::now() - start;
+  }
+
+  DoNotOptimize(left[0]);
+  return std::chrono::duration<double, std::micro>(total).count() / kSeconds;
+}
+
+struct BlockVoiceSynth
+{
+  BlockVoiceSynth(int blockSize, MidiSynth::ESlicingMode mode, int maxSliceSize)
+  {
+    for (auto& voice : mVoices)
+      mSynth.AddVoice(&voice, 0);
+
+    mSynth.SetSampleRateAndBlockSize(kSampleRate, blockSize);
+    mSynth.SetSlicingMode(mode, maxSliceSize);
+  }
+
+  void AddMsg(const IMidiMsg& msg) { mSynth.AddMidiMsgToQueue(msg); }
+
+  void Process(sample** outputs, int nFrames)
+  {
+    memset(outputs[0], 0, nFrames * sizeof(sample));
+    mSynth.ProcessBlock(nullptr, outputs, 0, 2, nFrames);
+  }
+
+  std::vector<BlockVoice> mVoices = std::vector<BlockVoice>(32);
+  MidiSynth mSynth {VoiceAllocator::kPolyModePoly, kSliceSize};
+};
+
+struct InstrumentSynth
+{
+  InstrumentSynth(int blockSize, MidiSynth::ESlicingMode mode, int maxSliceSize)
+  {
+    mDSP.Reset(kSampleRate, blockSize);
+    mDSP.mSynth.SetSlicingMode(mode, maxSliceSize);
+    mDSP.SetParam(kParamGain, 100.);
+    mDSP.SetParam(kParamSustain, 50.);
+    mDSP.SetParam(kParamAttack, 1.);
+    mDSP.SetParam(kParamDecay, 100.);
+    mDSP.SetParam(kParamRelease, 100.);
+  }
+
+  void AddMsg(const IMidiMsg& msg) { mDSP.ProcessMidiMsg(msg); }
+  void Process(sample** outputs, int nFrames) { mDSP.ProcessBlock(nullptr, outputs, 2, nFrames); }
+
+  IPlugInstrumentDSP<sample> mDSP {32};
+};
+
+template <class Synth>
+void BenchmarkModes(const char* name)
+{
+  constexpr int kBlockSizes[] = {32, 64, 128, 256, 512, 1024, 2048};
+
+  printf("%s, us per second of audio:\n", name);
+  printf("  %-24s", "host block size");
+  for (auto blockSize : kBlockSizes)
+    printf(" %6d", blockSize);
+  printf("\n");
+
+  for (auto maxSliceSize : {-1, 0, 128})
+  {
+    const auto mode = maxSliceSize < 0 ? MidiSynth::kSlicingFixed : MidiSynth::kSlicingEventDriven;
+    printf("  %-24s", maxSliceSize < 0 ? "fixed 32" : (maxSliceSize ? "event-driven, max 128" : "event-driven"));
+
+    for (auto blockSize : kBlockSizes)
+    {
+      double best = 1e30;
+      for (auto run = 0; run < 3; run++)
+      {
+        Synth synth(blockSize, mode, std::max(maxSliceSize, 0));
+        best = std::min(best, Benchmark(synth, blockSize));
+      }
+      printf(" %6.0f", best);
+    }
+
+    printf("\n");
+  }
+}
+
+} // namespace
+
+int main()
+{
+  TestSameOffsets();
+  TestNoteStart();
+
+  BenchmarkModes<BlockVoiceSynth>("32 block-oriented voices");
+  BenchmarkModes<InstrumentSynth>("32 IPlugInstrument voices");
+
+  return TestResult("MidiSynthTest");
+}
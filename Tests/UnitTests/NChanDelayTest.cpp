@@ -0,0 +1,254 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Checks NChanDelayLine against the per-sample delay line it replaced, and its taps against a direct reading of the
+// input history, then times both implementations for 2 to 64 channels with mixed block sizes.
+
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+#include "NChanDelay.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+/** The per-sample, modulo addressed delay line that NChanDelay.h shipped before the ring buffer rewrite */
+template<typename T>
+class ScalarNChanDelayLine
+{
+public:
+  ScalarNChanDelayLine(int nInputChans = 2, int nOutputChans = 2)
+  : mNInChans(nInputChans)
+  , mNOutChans(nOutputChans)
+  {}
+
+  void SetDelayTime(int delayTimeSamples)
+  {
+    mDTSamples = delayTimeSamples;
+    mBuffer.Resize(mNInChans * delayTimeSamples);
+    mWriteAddress = 0;
+    memset(mBuffer.Get(), 0, mNInChans * mDTSamples * sizeof(T));
+  }
+
+  void ProcessBlock(T** inputs, T** outputs, int nFrames)
+  {
+    T* buffer = mBuffer.Get();
+
+    for (auto s = 0 ; s < nFrames; ++s)
+    {
+      for (uint32_t c = 0; c < mNInChans; c++)
+      {
+        if (c < mNOutChans)
+        {
+          T input = inputs[c][s];
+          const uint32_t offset = c * mDTSamples;
+          outputs[c][s] = buffer[offset + mWriteAddress];
+          buffer[offset + mWriteAddress] = input;
+        }
+      }
+
+      mWriteAddress++;
+      mWriteAddress %= mDTSamples;
+    }
+  }
+
+private:
+  WDL_TypedBuf<T> mBuffer;
+  uint32_t mNInChans, mNOutChans;
+  uint32_t mWriteAddress = 0;
+  uint32_t mDTSamples = 0;
+};
+
+constexpr int kDelay = 347;
+constexpr int kMaxBlock = 512;
+
+struct Channels
+{
+  Channels(int nChans, int nFrames)
+  : data(static_cast<size_t>(nChans) * nFrames)
+  , ptrs(nChans)
+  {
+    for (auto c = 0; c < nChans; c++)
+      ptrs[c] = data.data() + c * nFrames;
+  }
+
+  std::vector<float> data;
+  std::vector<float*> ptrs;
+};
+
+/** Sample s of channel c of the test signal, a unique value per sample so that any misplaced sample shows */
+float Signal(int c, long s) { return static_cast<float>(c * 1000003 + s % 1000003) * 1e-3f; }
+
+void TestProcessBlock()
+{
+  for (auto nChans : {1, 2, 5})
+  {
+    NChanDelayLine<float> delay(nChans, nChans);
+    ScalarNChanDelayLine<float> reference(nChans, nChans);
+    // a max block smaller than some of the blocks, so that ProcessBlock() has to split them
+    delay.SetDelayTime(kDelay, 256);
+    reference.SetDelayTime(kDelay);
+
+    Channels in(nChans, kMaxBlock), out(nChans, kMaxBlock), outRef(nChans, kMaxBlock), inPlace(nChans, kMaxBlock);
+    std::mt19937 rng(7);
+    long pos = 0;
+    int nMismatches = 0;
+
+    for (auto block = 0; block < 200; block++)
+    {
+      const int nFrames = 1 + static_cast<int>(rng() % kMaxBlock);
+
+      for (auto c = 0; c < nChans; c++)
+        for (auto s = 0; s < nFrames; s++)
+          in.ptrs[c][s] = Signal(c, pos + s);
+
+      delay.ProcessBlock(in.ptrs.data(), out.ptrs.data(), nFrames);
+      reference.ProcessBlock(in.ptrs.data(), outRef.ptrs.data(), nFrames);
+
+      for (auto c = 0; c < nChans; c++)
+        nMismatches += memcmp(out.ptrs[c], outRef.ptrs[c], nFrames * sizeof(float)) != 0;
+
+      pos += nFrames;
+    }
+
+    IPLUG_CHECK(nMismatches == 0, "ProcessBlock %d channels: %d blocks differ from the reference", nChans, nMismatches);
+  }
+
+  // inputs and outputs may be the same buffers
+  {
+    NChanDelayLine<float> delay(2, 2);
+    ScalarNChanDelayLine<float> reference(2, 2);
+    delay.SetDelayTime(kDelay);
+    reference.SetDelayTime(kDelay);
+    Channels buf(2, kMaxBlock), in(2, kMaxBlock), outRef(2, kMaxBlock);
+    int nMismatches = 0;
+
+    for (auto block = 0; block < 20; block++)
+    {
+      for (auto c = 0; c < 2; c++)
+        for (auto s = 0; s < kMaxBlock; s++)
+          buf.ptrs[c][s] = in.ptrs[c][s] = Signal(c, block * kMaxBlock + s);
+
+      delay.ProcessBlock(buf.ptrs.data(), buf.ptrs.data(), kMaxBlock);
+      reference.ProcessBlock(in.ptrs.data(), outRef.ptrs.data(), kMaxBlock);
+      nMismatches += memcmp(buf.data.data(), outRef.data.data(), buf.data.size() * sizeof(float)) != 0;
+    }
+
+    IPLUG_CHECK(nMismatches == 0, "in place ProcessBlock: %d blocks differ from the reference", nMismatches);
+  }
+}
+
+void TestTaps()
+{
+  constexpr int nChans = 2;
+  constexpr int nFrames = 128;
+  constexpr int nBlocks = 40;
+  constexpr int offset = 32; // taps are read into the middle of larger output buffers
+
+  NChanDelayLine<float> delay(nChans, nChans);
+  delay.SetDelayTime(kDelay, nFrames);
+
+  Channels in(nChans, nFrames), out(nChans, nFrames + offset), mod(nChans, nFrames + offset);
+  std::vector<float> delays(nFrames);
+  double maxModError = 0.;
+  int nMismatches = 0;
+
+  for (auto block = 0; block < nBlocks; block++)
+  {
+    const long pos = static_cast<long>(block) * nFrames;
+
+    for (auto c = 0; c < nChans; c++)
+      for (auto s = 0; s < nFrames; s++)
+        in.ptrs[c][s] = std::sin(0.01f * (pos + s) * (c + 1));
+
+    for (auto s = 0; s < nFrames; s++)
+      delays[s] = 10.f + 300.f * (0.5f + 0.5f * std::sin(0.003f * (pos + s)));
+
+    delay.WriteBlock(in.ptrs.data(), nFrames);
+    delay.ReadBlock(out.ptrs.data(), 100, nFrames, offset);
+    delay.ReadModulatedBlock(mod.ptrs.data(), delays.data(), nFrames, offset);
+    delay.Advance(nFrames);
+
+    // once the delay line is full, compare against the signal itself
+    if (pos < kDelay + nFrames)
+      continue;
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      for (auto s = 0; s < nFrames; s++)
+      {
+        nMismatches += out.ptrs[c][offset + s] != std::sin(0.01f * (pos + s - 100) * (c + 1));
+
+        const double t = static_cast<double>(pos + s) - delays[s];
+        const double i0 = std::floor(t);
+        const double y0 = std::sin(0.01f * static_cast<float>(i0) * (c + 1));
+        const double y1 = std::sin(0.01f * static_cast<float>(i0 + 1) * (c + 1));
+        const double expected = y0 + (y1 - y0) * (t - i0);
+        maxModError = std::max(maxModError, std::abs(mod.ptrs[c][offset + s] - expected));
+      }
+    }
+  }
+
+  IPLUG_CHECK(nMismatches == 0, "ReadBlock with offset: %d samples differ", nMismatches);
+  IPLUG_CHECK(maxModError < 1e-5, "ReadModulatedBlock with offset: max error %g", maxModError);
+}
+
+void Benchmark()
+{
+  printf("ProcessBlock, delay %d, 2000 blocks of 100-512 frames:\n", kDelay);
+
+  std::vector<int> blockSizes(2000);
+  std::mt19937 rng(3);
+  for (auto& n : blockSizes)
+    n = 100 + static_cast<int>(rng() % 413);
+
+  for (auto nChans : {2, 8, 16, 32, 64})
+  {
+    NChanDelayLine<float> delay(nChans, nChans);
+    ScalarNChanDelayLine<float> reference(nChans, nChans);
+    delay.SetDelayTime(kDelay);
+    reference.SetDelayTime(kDelay);
+    Channels in(nChans, kMaxBlock), out(nChans, kMaxBlock);
+
+    for (auto& v : in.data)
+      v = static_cast<float>(rng() % 1000);
+
+    const double tBlock = TimeMicroseconds([&]() {
+      for (auto n : blockSizes)
+        delay.ProcessBlock(in.ptrs.data(), out.ptrs.data(), n);
+      DoNotOptimize(out.data[0]);
+    });
+
+    const double tScalar = TimeMicroseconds([&]() {
+      for (auto n : blockSizes)
+        reference.ProcessBlock(in.ptrs.data(), out.ptrs.data(), n);
+      DoNotOptimize(out.data[0]);
+    });
+
+    printf("  %2d ch: per sample %8.2f ms, ring buffer %8.2f ms (x%.1f)\n", nChans, tScalar * 1e-3, tBlock * 1e-3, tScalar / tBlock);
+  }
+}
+
+} // namespace
+
+int main()
+{
+  TestProcessBlock();
+  TestTaps();
+  Benchmark();
+  return TestResult("NChanDelayTest");
+}
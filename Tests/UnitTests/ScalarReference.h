@@ -0,0 +1,390 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief The scalar, one channel at a time, SVF, DCBlocker and NoiseGate that IPlug/Extras shipped before they were
+ * rewritten to process channels in SIMDLane lanes. DSPLanesTest compares the current classes against these.
+ * Only the class names were changed (and PlotResponse() dropped), so that both can be used in one test.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "IPlugPlatform.h"
+#include "IPlugUtilities.h"
+#include "denormal.h"
+
+namespace iplugtest
+{
+using namespace iplug;
+
+template<typename T = double, int NC = 1>
+class ScalarSVF
+{
+public:
+
+  enum EMode
+  {
+    kLowPass = 0,
+    kHighPass,
+    kBandPass,
+    kNotch,
+    kPeak,
+    kBell,
+    kLowPassShelf,
+    kHighPassShelf,
+    kNumModes
+  };
+
+  ScalarSVF(EMode mode = kLowPass, double freqCPS = 1000.)
+  {
+    mNewState.mode = mState.mode = mode;
+    mNewState.freq = mState.freq = freqCPS;
+    UpdateCoefficients();
+  }
+
+  void SetFreqCPS(double freqCPS) { mNewState.freq = Clip(freqCPS, 10.0, 20000.); }
+
+  void SetQ(double Q) { mNewState.Q = Clip(Q, 0.1, 100.0); }
+
+  void SetGain(double gainDB) { mNewState.gain = Clip(gainDB, -36.0, 36.0); }
+
+  void SetMode(EMode mode) { mNewState.mode = mode; }
+  
+  void SetSampleRate(double sampleRate) { mNewState.sampleRate = sampleRate; }
+
+  void ProcessBlock(T** inputs, T** outputs, int nChans, int nFrames)
+  {
+    assert(nChans <= NC);
+
+    if(mState != mNewState)
+      UpdateCoefficients();
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      for (auto s = 0; s < nFrames; s++)
+      {
+        const double v0 = static_cast<double>(inputs[c][s]);
+
+        mV3[c] = v0 - mIc2eq[c];
+        mV1[c] = m_a1 * mIc1eq[c] + m_a2*mV3[c];
+        mV2[c] = mIc2eq[c] + m_a2 * mIc1eq[c] + m_a3 * mV3[c];
+        mIc1eq[c] = 2.0 * mV1[c] - mIc1eq[c];
+        mIc2eq[c] = 2.0 * mV2[c] - mIc2eq[c];
+
+        outputs[c][s] = static_cast<T>(m_m0) * static_cast<T>(v0) + 
+                       static_cast<T>(m_m1) * static_cast<T>(mV1[c]) + 
+                       static_cast<T>(m_m2) * static_cast<T>(mV2[c]);
+      }
+    }
+  }
+
+  void Reset()
+  {
+    for (auto c = 0; c < NC; c++)
+    {
+      mV1[c] = 0.;
+      mV2[c] = 0.;
+      mV3[c] = 0.;
+      mIc1eq[c] = 0.;
+      mIc2eq[c] = 0.;
+    }
+  }
+
+private:
+  void UpdateCoefficients()
+  {
+    mState = mNewState;
+
+    const double w = std::tan(PI * mState.freq/mState.sampleRate);
+
+    switch(mState.mode)
+    {
+      case kLowPass:
+      {
+        const double g = w;
+        const double k = 1. / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = 0;
+        m_m1 = 0;
+        m_m2 = 1.;
+        break;
+      }
+      case kHighPass:
+      {
+        const double g = w;
+        const double k = 1. / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = 1.;
+        m_m1 = -k;
+        m_m2 = -1.;
+        break;
+      }
+      case kBandPass:
+      {
+        const double g = w;
+        const double k = 1. / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = 0.;
+        m_m1 = 1.;
+        m_m2 = 0.;
+        break;
+      }
+      case kNotch:
+      {
+        const double g = w;
+        const double k = 1. / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = 1.;
+        m_m1 = -k;
+        m_m2 = 0.;
+        break;
+      }
+      case kPeak:
+      {
+        const double g = w;
+        const double k = 1. / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = 1.;
+        m_m1 = -k;
+        m_m2 = -2.;
+        break;
+      }
+      case kBell:
+      {
+        const double A = std::pow(10., mState.gain/40.);
+        const double g = w;
+        const double k = 1 / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = 1.;
+        m_m1 = k * (A * A - 1.);
+        m_m2 = 0.;
+        break;
+      }
+      case kLowPassShelf:
+      {
+        const double A = std::pow(10., mState.gain/40.);
+        const double g = w / std::sqrt(A);
+        const double k = 1. / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = 1.;
+        m_m1 = k * (A - 1.);
+        m_m2 = (A * A - 1.);
+        break;
+      }
+      case kHighPassShelf:
+      {
+        const double A = std::pow(10., mState.gain/40.);
+        const double g = w / std::sqrt(A);
+        const double k = 1. / mState.Q;
+        m_a1 = 1./(1. + g * (g + k));
+        m_a2 = g * m_a1;
+        m_a3 = g * m_a2;
+        m_m0 = A*A;
+        m_m1 = k*(1. - A)*A;
+        m_m2 = (1. - A*A);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+private:
+  double mV1[NC] = {};
+  double mV2[NC] = {};
+  double mV3[NC] = {};
+  double mIc1eq[NC] = {};
+  double mIc2eq[NC] = {};
+  double m_a1 = 0.;
+  double m_a2 = 0.;
+  double m_a3 = 0.;
+  double m_m0 = 0.;
+  double m_m1 = 0.;
+  double m_m2 = 0.;
+
+  struct Settings
+  {
+    EMode mode;
+    double freq = 1000.;
+    double Q = 0.1;
+    double gain = 1.;
+    double sampleRate = 44100.;
+
+    bool operator != (const Settings &other) const
+    {
+      return !(mode == other.mode && freq == other.freq && Q == other.Q && gain == other.gain && sampleRate == other.sampleRate);
+    }
+  } WDL_FIXALIGN;
+
+  Settings mState, mNewState;
+} WDL_FIXALIGN;
+
+template<typename T, int NC = 1>
+class ScalarDCBlocker
+{
+private:
+  // one pole IIR
+  // y[n] = x[n] + a[n] * y[n-1]
+  class rpole {
+    T y_m1 = 0;
+  public:
+    inline T process(T x, T a) { 
+      const T y = y_m1 = x + a * y_m1;
+      denormal_fix(&y_m1);
+      return y;
+    }
+  };
+
+  // one zero FIR
+  // y[n] = x[n] - b[n] * x[n-1]
+  class rzero {
+    T x_m1 = 0;
+  public:
+    inline T process(T x, T b) {
+      const T y = x - b * x_m1;
+      x_m1 = x;
+      denormal_fix(&x_m1);
+      return y;
+    }
+  };
+
+  rpole mPole[NC];
+  rzero mZero[NC];
+
+public:
+
+  void ProcessBlock(T** inputs, T** outputs, int nChans, int nFrames)
+  {
+    assert(nChans <= NC);
+
+    for (auto s=0; s<nFrames; s++)
+    {
+      for (auto c = 0; c < nChans; c++)
+      {
+        const auto x = inputs[c][s];
+        outputs[c][s] = mPole[c].process(mZero[c].process(x, T(1.0)), T(0.995));
+      }
+    }
+  }
+
+} WDL_FIXALIGN;
+
+template<typename T, int NC = 1>
+class ScalarNoiseGate
+{
+public:
+  void SetThreshold(double thresholdDB)
+  {
+    mThreshold = DBToAmp(thresholdDB);
+  }
+  
+  void SetSampleRate(double sampleRate)
+  {
+    mSampleRate = sampleRate;
+  }
+  
+  void SetAttackTime(double attackTime)
+  {
+    mAttackTime = std::max(attackTime, (1.0 / mSampleRate));
+    mMinRate = std::min(mAttackTime, mReleaseTime);
+  }
+  
+  void SetHoldTime(double holdTime)
+  {
+    mHoldTime = std::max(holdTime, (1.0 / mSampleRate));
+  }
+  
+  void SetReleaseTime(double releaseTime)
+  {
+    mReleaseTime = std::max(releaseTime, (1.0 / mSampleRate));
+    mMinRate = std::min(mAttackTime, mReleaseTime);
+  }
+
+  void ProcessBlock(T** inputs, T** outputs, T* sidechain, int nChans, int nFrames)
+  {
+    assert(nChans <= NC);
+
+    for (auto s=0; s <nFrames; s++)
+    {
+      auto trigger = sidechain[s];
+      auto gain = processSample(trigger);
+      for (auto c=0; c<nChans; c++)
+      {
+        outputs[c][s] = inputs[c][s] * gain;
+      }
+    }
+  }
+
+private:
+  inline T processSample(T sample) 
+  {
+    auto ampFollower = [](T x, T& y, double att, double rel, double sr) {
+      auto tau2pole = [](double tau, double sr) {
+        return std::exp(-1.0 / (tau * sr));
+      };
+      const auto absX = std::abs(x);
+      const auto coeff = (absX > y) ? T(tau2pole(att, sr)) : T(tau2pole(rel, sr));
+      y = (T(1) - coeff) * absX + coeff * y;
+      return y;
+    };
+    
+    auto rawGate = ampFollower(sample, mHistory2, mMinRate, mMinRate, mSampleRate) > mThreshold;
+    
+    if (rawGate < mPrevGate)
+    {
+      mHoldCounter = int(mHoldTime * mSampleRate);
+    }
+    else 
+    {
+      if (mHoldCounter > 0)
+      {
+        mHoldCounter--;
+      }
+    }
+    
+    const auto heldGate = std::max(rawGate, mHoldCounter > 0);
+    const auto smoothed = ampFollower(T(heldGate), mHistory1, mAttackTime, mReleaseTime, mSampleRate);
+
+    mPrevGate = rawGate;
+    
+    return smoothed;
+  }
+
+  double mThreshold = 0.5;
+  double mSampleRate = 48000.0;
+  double mAttackTime = 0.01f;
+  double mHoldTime = 0.01f;
+  double mReleaseTime = 0.01f;
+  double mMinRate = mAttackTime;
+  T mHistory1 = 0.0f, mHistory2 = 0.0f; // mHistory1 was left uninitialised
+  bool mPrevGate = false;
+  int mHoldCounter = 0;
+};
+
+} // namespace iplugtest
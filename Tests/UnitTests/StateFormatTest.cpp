@@ -0,0 +1,242 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Round trips IPluginBase state through SerializeParams() and the compact state format (SerializeParamsCompact()) with
+// each combination of flags, checks that damaged compact chunks are rejected, then times both formats and prints
+// their sizes. Built with IPLUG_ZLIB and WDL's zlib, and again without, where kStateFormatCompressed is ignored.
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "TestUtils.h"
+#include "IPlugPluginBase.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr int kNParams = 1024;
+constexpr int kAllFlags[] = {kStateFormatDefault, kStateFormatDeltaFromDefault, kStateFormatCompressed, kStateFormatDeltaFromDefault | kStateFormatCompressed};
+
+class TestPlugin : public IPluginBase
+{
+public:
+  TestPlugin()
+  : IPluginBase(kNParams, 0)
+  {
+    for (auto i = 0; i < kNParams; i++)
+      GetParam(i)->InitDouble("Param", 0.5, 0., 1., 0.001);
+  }
+
+  void BeginInformHostOfParamChangeFromUI(int paramIdx) override {}
+  void EndInformHostOfParamChangeFromUI(int paramIdx) override {}
+
+  /** Move every changeEvery-th parameter away from its default, the others to their default */
+  void SetValues(int changeEvery, int seed)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(0., 1.);
+
+    for (auto i = 0; i < kNParams; i++)
+      GetParam(i)->Set(i % changeEvery ? 0.5 : dist(rng));
+  }
+
+  bool ValuesEqual(const TestPlugin& other) const
+  {
+    for (auto i = 0; i < kNParams; i++)
+    {
+      if (GetParam(i)->Value() != other.GetParam(i)->Value())
+        return false;
+    }
+
+    return true;
+  }
+};
+
+/** Sample-like custom state: a noisy decaying sine, as 32 bit floats */
+IByteChunk MakeCustomState(int nSamples)
+{
+  std::mt19937 rng(42);
+  std::normal_distribution<float> noise(0.f, 0.01f);
+  std::vector<float> samples(nSamples);
+
+  for (auto i = 0; i < nSamples; i++)
+    samples[i] = std::exp(-i / 48000.f) * std::sin(i * 0.03f) + noise(rng);
+
+  IByteChunk chunk;
+  chunk.PutBytes(samples.data(), nSamples * static_cast<int>(sizeof(float)));
+  return chunk;
+}
+
+const char* FlagsName(int flags)
+{
+  switch (flags)
+  {
+    case kStateFormatDefault: return "compact";
+    case kStateFormatDeltaFromDefault: return "compact delta";
+    case kStateFormatCompressed: return "compact deflated";
+    default: return "compact delta deflated";
+  }
+}
+
+void TestRoundTrip(int flags, const IByteChunk* pCustomState)
+{
+  TestPlugin src, dst;
+  src.SetValues(10, flags);
+  dst.SetValues(3, 100 + flags); // nothing in common with src, so that defaults must be restored
+
+  IByteChunk chunk, custom;
+  const int prefix = 7; // the state doesn't have to start at 0
+  chunk.Resize(prefix);
+  IPLUG_CHECK(src.SerializeParamsCompact(chunk, flags, pCustomState), "%s: serialization failed", FlagsName(flags));
+
+  const int endPos = dst.UnserializeParamsCompact(chunk, prefix, &custom);
+  IPLUG_CHECK(endPos == chunk.Size(), "%s: end position %d, chunk size %d", FlagsName(flags), endPos, chunk.Size());
+  IPLUG_CHECK(src.ValuesEqual(dst), "%s: parameter values differ", FlagsName(flags));
+
+  const int customSize = pCustomState ? pCustomState->Size() : 0;
+  IPLUG_CHECK(custom.Size() == customSize && (!customSize || !memcmp(custom.GetData(), pCustomState->GetData(), customSize)), "%s: custom state differs", FlagsName(flags));
+
+  int storedFlags = 0;
+  memcpy(&storedFlags, chunk.GetData() + prefix + 2 * sizeof(int32_t), sizeof(int32_t));
+#if defined IPLUG_ZLIB
+  IPLUG_CHECK(storedFlags == flags, "%s: stored flags %d", FlagsName(flags), storedFlags);
+#else
+  IPLUG_CHECK(storedFlags == (flags & ~kStateFormatCompressed), "%s: stored flags %d, compression needs IPLUG_ZLIB", FlagsName(flags), storedFlags);
+#endif
+}
+
+/** Chunks written by SerializeParams() still load */
+void TestLegacyChunk()
+{
+  TestPlugin src, dst;
+  src.SetValues(2, 7);
+  IByteChunk chunk;
+  src.SerializeParams(chunk);
+
+  IPLUG_CHECK(dst.UnserializeParamsCompact(chunk, 0) == chunk.Size(), "legacy chunk: wrong end position");
+  IPLUG_CHECK(src.ValuesEqual(dst), "legacy chunk: parameter values differ");
+}
+
+/** Every truncation, and header sizes that claim more than is there, must be rejected without reading past the chunk */
+void TestDamagedChunks(int flags)
+{
+  TestPlugin src, dst;
+  src.SetValues(4, 3);
+  IByteChunk custom = MakeCustomState(1000), chunk;
+  src.SerializeParamsCompact(chunk, flags, &custom);
+
+  int nAccepted = 0;
+
+  for (auto size = sizeof(int32_t); size < static_cast<size_t>(chunk.Size()); size++)
+  {
+    // a copy of exactly size bytes, so that ASan catches any read past it
+    IByteChunk truncated;
+    truncated.PutBytes(chunk.GetData(), static_cast<int>(size));
+    nAccepted += dst.UnserializeParamsCompact(truncated, 0) >= 0;
+  }
+
+  IPLUG_CHECK(nAccepted == 0, "%s: %d truncated chunks accepted", FlagsName(flags), nAccepted);
+
+  // payload size (header word 3) and stored size (header word 4)
+  for (auto word : {3, 4})
+  {
+    for (auto value : {-1, 0x7fffffff, chunk.Size()})
+    {
+      IByteChunk bad;
+      bad.PutChunk(&chunk);
+      memcpy(bad.GetData() + word * sizeof(int32_t), &value, sizeof(int32_t));
+      IPLUG_CHECK(dst.UnserializeParamsCompact(bad, 0) < 0, "%s: header word %d = %d accepted", FlagsName(flags), word, value);
+    }
+  }
+
+  // a newer format version
+  IByteChunk newer;
+  newer.PutChunk(&chunk);
+  const int version = IPLUG_COMPACT_STATE_VERSION + 1;
+  memcpy(newer.GetData() + sizeof(int32_t), &version, sizeof(int32_t));
+  IPLUG_CHECK(dst.UnserializeParamsCompact(newer, 0) < 0, "%s: version %d accepted", FlagsName(flags), version);
+}
+
+void Benchmark(const char* name, int changeEvery, const IByteChunk* pCustomState)
+{
+  TestPlugin plug;
+  plug.SetValues(changeEvery, 1);
+  const int customSize = pCustomState ? pCustomState->Size() : 0;
+
+  printf("%s, %d params, 1 in %d changed, %d bytes of custom state:\n", name, kNParams, changeEvery, customSize);
+
+  // what a plug-in's SerializeState() does today: the values, then the custom data appended raw
+  {
+    IByteChunk chunk;
+    auto serialize = [&]() {
+      chunk.Clear();
+      plug.SerializeParams(chunk);
+      chunk.Put(&customSize);
+      if (customSize)
+        chunk.PutChunk(pCustomState);
+    };
+
+    IByteChunk custom;
+    auto unserialize = [&]() {
+      int pos = plug.UnserializeParams(chunk, 0), size = 0;
+      pos = chunk.Get(&size, pos);
+      custom.Clear();
+      custom.PutBytes(chunk.GetData() + pos, size);
+    };
+
+    const double tSave = TimeMicroseconds(serialize);
+    const double tLoad = TimeMicroseconds(unserialize);
+    printf("  %-24s %9d bytes  save %9.1f us  load %9.1f us\n", "SerializeParams()", chunk.Size(), tSave, tLoad);
+  }
+
+  for (auto flags : kAllFlags)
+  {
+#if !defined IPLUG_ZLIB
+    if (flags & kStateFormatCompressed)
+      continue;
+#endif
+    IByteChunk chunk, custom;
+    const double tSave = TimeMicroseconds([&]() { chunk.Clear(); plug.SerializeParamsCompact(chunk, flags, pCustomState); });
+    const double tLoad = TimeMicroseconds([&]() { plug.UnserializeParamsCompact(chunk, 0, &custom); });
+    printf("  %-24s %9d bytes  save %9.1f us  load %9.1f us\n", FlagsName(flags), chunk.Size(), tSave, tLoad);
+  }
+}
+
+} // namespace
+
+int main()
+{
+  const IByteChunk custom = MakeCustomState(48000);
+
+  for (auto flags : kAllFlags)
+  {
+    TestRoundTrip(flags, nullptr);
+    TestRoundTrip(flags, &custom);
+    TestDamagedChunks(flags);
+  }
+
+  TestLegacyChunk();
+
+#if defined IPLUG_ZLIB
+  printf("With IPLUG_ZLIB\n");
+#else
+  printf("Without IPLUG_ZLIB, kStateFormatCompressed is ignored\n");
+#endif
+  Benchmark("Parameters only", 10, nullptr);
+  const IByteChunk sample = MakeCustomState(1 << 20);
+  Benchmark("With a sample", 10, &sample);
+
+  return TestResult("StateFormatTest");
+}
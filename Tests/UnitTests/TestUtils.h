@@ -0,0 +1,80 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Minimal helpers shared by the console tests: checks that count failures, and a timer for the benchmarks.
+ * A test's main() returns TestResult(), which is non-zero if any check failed, so that CTest reports it.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace iplugtest
+{
+
+inline int& NumFailures()
+{
+  static int sNumFailures = 0;
+  return sNumFailures;
+}
+
+#define IPLUG_CHECK(cond, ...)                                      \
+  do {                                                              \
+    if (!(cond))                                                    \
+    {                                                               \
+      iplugtest::NumFailures()++;                                   \
+      printf("FAILED %s:%d: %s: ", __FILE__, __LINE__, #cond);      \
+      printf(__VA_ARGS__);                                          \
+      printf("\n");                                                 \
+    }                                                               \
+  } while (0)
+
+/** @return The exit code for main(), after printing a summary */
+inline int TestResult(const char* name)
+{
+  printf("%s: %s (%d failures)\n", name, NumFailures() ? "FAILED" : "passed", NumFailures());
+  return NumFailures() ? 1 : 0;
+}
+
+/** Run func repeatedly for at least minMs and return the mean time per call in microseconds */
+template <typename F>
+double TimeMicroseconds(F&& func, double minMs = 50.)
+{
+  using clock = std::chrono::steady_clock;
+  func(); // warm up
+
+  int nRuns = 0;
+  const auto start = clock::now();
+  double elapsedMs = 0.;
+
+  do
+  {
+    func();
+    nRuns++;
+    elapsedMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  } while (elapsedMs < minMs);
+
+  return elapsedMs * 1000. / nRuns;
+}
+
+/** Keep the optimiser from discarding a result that is only used for timing */
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+  static volatile T sSink;
+  sSink = value;
+  (void) sSink;
+}
+
+} // namespace iplugtest
@@ -0,0 +1,433 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Drives MidiSynth's VoiceAllocator with 10k random note on, note off and pitch bend events per second, plain and MPE,
+// checking after every block that each note on triggered exactly one voice and that only voices of held notes have
+// their gate on. Checks level tracking (SetLevelTracking()) with voices that decay after their release: a voice is culled
+// only once it has been silent for the silence time, also when it was loud earlier in a long slice, the culled and
+// stolen counters count each voice once, and the quietest released voice is stolen first.
+// Then times the note traffic for 16 to 254 voices, and prints the time per second of audio.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "TestUtils.h"
+#include "MidiSynth.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+constexpr double kSampleRate = 48000.;
+constexpr int kBlockSize = 512;
+constexpr double kEventsPerSecond = 10000.;
+
+/** A voice that sounds until 1500 samples after its release, and does almost nothing else, so that the allocator dominates */
+class StressVoice : public SynthVoice
+{
+public:
+  bool GetBusy() const override { return mGateOn || mReleaseSamples > 0; }
+
+  void Trigger(double level, bool isRetrigger) override
+  {
+    mGateOn = true;
+    mReleaseSamples = 0;
+    mNumTriggers++;
+  }
+
+  void Release() override
+  {
+    if (mGateOn)
+    {
+      mGateOn = false;
+      mReleaseSamples = 1500;
+    }
+  }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    if (!mGateOn)
+      mReleaseSamples -= nFrames;
+
+    outputs[0][startIdx] += mInputs[kVoiceControlPitchBend].endValue;
+  }
+
+  std::pair<int, int> GetChannelAndKey() const { return {mChannel, mKey}; }
+
+  bool mGateOn = false;
+  int mReleaseSamples = 0;
+  int mNumTriggers = 0;
+};
+
+/** Random note traffic: 40% note ons of keys not already held, 40% note offs of held keys, 20% pitch bends */
+class EventGenerator
+{
+public:
+  EventGenerator(bool mpe, unsigned seed)
+  : mMPE(mpe)
+  , mRNG(seed)
+  {
+  }
+
+  /** Queue the events of the next block, @return the number of note ons */
+  int AddBlock(MidiSynth& synth)
+  {
+    int nNoteOns = 0;
+
+    for (auto s = 0; s < kBlockSize; s++)
+    {
+      for (mEventsDue += kEventsPerSecond / kSampleRate; mEventsDue >= 1.; mEventsDue -= 1.)
+      {
+        IMidiMsg msg;
+        const int channel = mMPE ? 1 + static_cast<int>(mRNG() % 15) : 0;
+        const int r = static_cast<int>(mRNG() % 10);
+
+        if (r < 4 || mHeld.empty())
+        {
+          const int key = 24 + static_cast<int>(mRNG() % 80);
+          if (!mHeld.insert({channel, key}).second)
+            continue;
+
+          msg.MakeNoteOnMsg(key, 1 + static_cast<int>(mRNG() % 127), s, channel);
+          nNoteOns++;
+        }
+        else if (r < 8)
+        {
+          auto it = std::next(mHeld.begin(), mRNG() % mHeld.size());
+          msg.MakeNoteOffMsg(it->second, s, it->first);
+          mHeld.erase(it);
+        }
+        else
+          msg.MakePitchWheelMsg(static_cast<int>(mRNG() % 1000) / 500. - 1., channel, s);
+
+        synth.AddMidiMsgToQueue(msg);
+      }
+    }
+
+    return nNoteOns;
+  }
+
+  const std::set<std::pair<int, int>>& GetHeld() const { return mHeld; }
+
+private:
+  bool mMPE;
+  std::mt19937 mRNG;
+  double mEventsDue = 0.;
+  std::set<std::pair<int, int>> mHeld; // channel, key
+};
+
+struct StressSynth
+{
+  StressSynth(int nVoices, bool mpe)
+  {
+    for (auto v = 0; v < nVoices; v++)
+    {
+      mVoices.push_back(new StressVoice);
+      mSynth.AddVoice(mVoices.back(), 0);
+    }
+
+    mSynth.SetSampleRateAndBlockSize(kSampleRate, kBlockSize);
+
+    if (mpe)
+      mSynth.InitBasicMPE();
+  }
+
+  ~StressSynth()
+  {
+    for (auto* pVoice : mVoices)
+      delete pVoice;
+  }
+
+  bool ProcessBlock()
+  {
+    return mSynth.ProcessBlock(nullptr, mOutputs, 0, 2, kBlockSize);
+  }
+
+  MidiSynth mSynth {VoiceAllocator::kPolyModePoly, MidiSynth::kDefaultBlockSize};
+  std::vector<StressVoice*> mVoices;
+  std::vector<sample> mLeft = std::vector<sample>(kBlockSize), mRight = std::vector<sample>(kBlockSize);
+  sample* mOutputs[2] = {mLeft.data(), mRight.data()};
+};
+
+void TestAllocation(int nVoices, bool mpe)
+{
+  StressSynth synth(nVoices, mpe);
+  EventGenerator events(mpe, 1);
+  int nNoteOns = 0, nBadGates = 0;
+
+  for (auto b = 0; b < 5 * static_cast<int>(kSampleRate) / kBlockSize; b++)
+  {
+    nNoteOns += events.AddBlock(synth.mSynth);
+    synth.ProcessBlock();
+
+    for (auto* pVoice : synth.mVoices)
+      nBadGates += pVoice->mGateOn && !events.GetHeld().count(pVoice->GetChannelAndKey());
+  }
+
+  int nTriggers = 0;
+  for (auto* pVoice : synth.mVoices)
+    nTriggers += pVoice->mNumTriggers;
+
+  const char* name = mpe ? "MPE" : "plain";
+  IPLUG_CHECK(nTriggers == nNoteOns, "%d voices %s: %d note ons triggered %d voices", nVoices, name, nNoteOns, nTriggers);
+  IPLUG_CHECK(nBadGates == 0, "%d voices %s: %d gates on without a held note", nVoices, name, nBadGates);
+  IPLUG_CHECK(nVoices > 64 || synth.mSynth.GetNumVoicesStolen() > 0, "%d voices %s: no voices stolen", nVoices, name);
+}
+
+int64_t gBlockStart = 0; // the sample time of the host block being processed
+
+/** After its release a DecayVoice stays at full level for holdSamples, then decays by a factor of decay per sample,
+ * down to an inaudible tail that lasts for a second. It records when it went below the silence threshold and when it
+ * was culled */
+class DecayVoice : public SynthVoice
+{
+public:
+  static constexpr double kSilenceThresholdDB = -60.;
+  static constexpr double kSilenceThreshold = 1e-3;
+  static constexpr int kTailSamples = 48000;
+
+  DecayVoice(int holdSamples, double decay)
+  : mHoldSamples(holdSamples)
+  , mDecay(decay)
+  , mReleasedFor(holdSamples + kTailSamples) // idle until triggered
+  {
+  }
+
+  bool GetBusy() const override { return mGateOn || mReleasedFor < mHoldSamples + kTailSamples; }
+
+  void Trigger(double level, bool isRetrigger) override
+  {
+    mGateOn = true;
+    mLevel = 1.;
+    mReleasedFor = 0;
+    mSilentFrom = mCulledAt = -1;
+    mCulled = false;
+  }
+
+  void Release() override { mGateOn = false; }
+
+  void Cull() override
+  {
+    mCulled = true;
+    mCulledAt = mSliceEnd;
+    mNumCulls++;
+  }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    mProcessedWhileCulled |= mCulled;
+
+    for (auto s = startIdx; s < startIdx + nFrames; s++)
+    {
+      if (!mGateOn)
+      {
+        if (mReleasedFor++ >= mHoldSamples)
+          mLevel = std::max(mLevel * mDecay, 1e-9);
+
+        if (mLevel < kSilenceThreshold && mSilentFrom < 0)
+          mSilentFrom = gBlockStart + s;
+      }
+
+      outputs[0][s] += mLevel;
+    }
+
+    mSliceEnd = gBlockStart + startIdx + nFrames;
+  }
+
+  int GetKey() const { return mKey; }
+  double GetLevel() const { return mLevel; }
+
+  int64_t mSilentFrom = -1;
+  int64_t mCulledAt = -1;
+  int mNumCulls = 0;
+  bool mProcessedWhileCulled = false;
+
+private:
+  int mHoldSamples;
+  double mDecay;
+  int mReleasedFor;
+  bool mGateOn = false;
+  bool mCulled = false;
+  double mLevel = 0.;
+  int64_t mSliceEnd = 0;
+};
+
+/** Play msgs, at sample times from the start, in host blocks of blockSize samples for nFrames */
+void Play(MidiSynth& synth, const std::vector<std::pair<int, IMidiMsg>>& msgs, int blockSize, int nFrames)
+{
+  std::vector<sample> left(blockSize), right(blockSize);
+  sample* outputs[2] = {left.data(), right.data()};
+  auto msgIt = msgs.begin();
+
+  for (gBlockStart = 0; gBlockStart < nFrames; gBlockStart += blockSize)
+  {
+    for (; msgIt != msgs.end() && msgIt->first < gBlockStart + blockSize; ++msgIt)
+    {
+      IMidiMsg msg = msgIt->second;
+      msg.mOffset = static_cast<int>(msgIt->first - gBlockStart);
+      synth.AddMidiMsgToQueue(msg);
+    }
+
+    synth.ProcessBlock(nullptr, outputs, 0, 2, blockSize);
+  }
+}
+
+/** One note, released at releaseAt, must be culled once, and not before it has been silent for the silence time */
+void TestCullTime(MidiSynth::ESlicingMode mode, int blockSize, int releaseAt, int holdSamples, double decay)
+{
+  constexpr int kSilenceTime = 1024;
+  DecayVoice voice(holdSamples, decay);
+  MidiSynth synth(VoiceAllocator::kPolyModePoly, MidiSynth::kDefaultBlockSize);
+  synth.AddVoice(&voice, 0);
+  synth.SetSampleRateAndBlockSize(kSampleRate, blockSize);
+  synth.SetSlicingMode(mode);
+  synth.SetLevelTracking(true, DecayVoice::kSilenceThresholdDB, kSilenceTime);
+
+  IMidiMsg on, off;
+  on.MakeNoteOnMsg(60, 100, 0);
+  off.MakeNoteOffMsg(60, 0);
+  Play(synth, {{0, on}, {releaseAt, off}}, blockSize, 32768);
+
+  const char* name = mode == MidiSynth::kSlicingFixed ? "fixed" : "event-driven";
+  const int64_t silentFor = voice.mCulledAt - voice.mSilentFrom;
+  IPLUG_CHECK(voice.mNumCulls == 1 && synth.GetNumVoicesCulled() == 1, "%s slicing, host block %d, hold %d: culled %d times, counted %d", name, blockSize, holdSamples, voice.mNumCulls, static_cast<int>(synth.GetNumVoicesCulled()));
+  IPLUG_CHECK(voice.mSilentFrom >= 0 && silentFor >= kSilenceTime, "%s slicing, host block %d, hold %d: culled at %d, silent from %d", name, blockSize, holdSamples, static_cast<int>(voice.mCulledAt), static_cast<int>(voice.mSilentFrom));
+  IPLUG_CHECK(!voice.mProcessedWhileCulled, "%s slicing, host block %d, hold %d: processed after it was culled", name, blockSize, holdSamples);
+
+  // with slices no longer than the measured samples, no later than one slice after the silence time
+  if (mode == MidiSynth::kSlicingFixed)
+    IPLUG_CHECK(silentFor <= kSilenceTime + 2 * MidiSynth::kDefaultBlockSize, "%s slicing, host block %d, hold %d: culled %d samples after it went silent", name, blockSize, holdSamples, static_cast<int>(silentFor));
+}
+
+/** Without level tracking, a voice plays its whole tail and nothing is counted */
+void TestNoLevelTracking()
+{
+  DecayVoice voice(0, 0.99);
+  MidiSynth synth(VoiceAllocator::kPolyModePoly, MidiSynth::kDefaultBlockSize);
+  synth.AddVoice(&voice, 0);
+  synth.SetSampleRateAndBlockSize(kSampleRate, kBlockSize);
+
+  IMidiMsg on, off;
+  on.MakeNoteOnMsg(60, 100, 0);
+  off.MakeNoteOffMsg(60, 0);
+  Play(synth, {{0, on}, {100, off}}, kBlockSize, 32768);
+
+  IPLUG_CHECK(voice.mNumCulls == 0 && synth.GetNumVoicesCulled() == 0, "without level tracking: culled %d times, counted %d", voice.mNumCulls, static_cast<int>(synth.GetNumVoicesCulled()));
+  IPLUG_CHECK(voice.GetBusy(), "without level tracking: the tail ended early");
+}
+
+/** With four voices, two released and decaying at different rates, new notes steal the quietest released voice, then
+ * the other released one, then a held one, and each steal is counted once */
+void TestSteal()
+{
+  std::vector<DecayVoice> voices {{0, 0.999}, {0, 0.99}, {0, 0.999}, {0, 0.999}};
+  MidiSynth synth(VoiceAllocator::kPolyModePoly, MidiSynth::kDefaultBlockSize);
+
+  for (auto& voice : voices)
+    synth.AddVoice(&voice, 0);
+
+  synth.SetSampleRateAndBlockSize(kSampleRate, kBlockSize);
+  synth.SetLevelTracking(true, -120., 48000); // no culling while this runs
+
+  std::vector<std::pair<int, IMidiMsg>> msgs;
+  auto add = [&msgs](int time, bool noteOn, int key) {
+    IMidiMsg msg;
+    if (noteOn)
+      msg.MakeNoteOnMsg(key, 100, 0);
+    else
+      msg.MakeNoteOffMsg(key, 0);
+    msgs.push_back({time, msg});
+  };
+
+  for (auto k = 0; k < 4; k++)
+    add(0, true, 60 + k); // voice k plays key 60 + k
+
+  add(100, false, 60);
+  add(100, false, 61); // voice 1 decays faster than voice 0
+  add(2048, true, 70);
+  add(2560, true, 71);
+  Play(synth, msgs, kBlockSize, 3072);
+
+  IPLUG_CHECK(voices[1].GetKey() == 70, "the quietest released voice was not stolen first, voice 1 plays %d", voices[1].GetKey());
+  IPLUG_CHECK(voices[0].GetKey() == 71, "the other released voice was not stolen next, voice 0 plays %d", voices[0].GetKey());
+
+  msgs.clear();
+  add(0, true, 72);
+  Play(synth, msgs, kBlockSize, kBlockSize);
+
+  const int nPlaying72 = static_cast<int>(std::count_if(voices.begin(), voices.end(), [](const DecayVoice& voice) { return voice.GetKey() == 72; }));
+  IPLUG_CHECK(nPlaying72 == 1, "a held voice was not stolen, %d voices play the new note", nPlaying72);
+  IPLUG_CHECK(synth.GetNumVoicesStolen() == 3, "%d steals counted, not 3", static_cast<int>(synth.GetNumVoicesStolen()));
+  IPLUG_CHECK(synth.GetNumVoicesCulled() == 0, "%d voices culled", static_cast<int>(synth.GetNumVoicesCulled()));
+
+  synth.ResetVoiceCounters();
+  IPLUG_CHECK(synth.GetNumVoicesStolen() == 0 && synth.GetNumVoicesCulled() == 0, "counters not reset");
+}
+
+/** @return The time taken per second of audio, in microseconds */
+double Benchmark(int nVoices, bool mpe)
+{
+  constexpr int kSeconds = 5;
+  StressSynth synth(nVoices, mpe);
+  EventGenerator events(mpe, 1);
+  std::chrono::steady_clock::duration total {};
+
+  // each block once, as its events are only queued once, timing only the synth
+  for (auto b = 0; b < kSeconds * static_cast<int>(kSampleRate) / kBlockSize; b++)
+  {
+    events.AddBlock(synth.mSynth);
+    const auto start = std::chrono::steady_clock::now();
+    synth.ProcessBlock();
+    total += std::chrono::steady_clock::now() - start;
+  }
+
+  DoNotOptimize(synth.mLeft[0]);
+  return std::chrono::duration<double, std::micro>(total).count() / kSeconds;
+}
+
+} // namespace
+
+int main()
+{
+  for (auto nVoices : {16, 128})
+  {
+    TestAllocation(nVoices, false);
+    TestAllocation(nVoices, true);
+  }
+
+  for (auto blockSize : {32, 512, 1024})
+  {
+    for (auto mode : {MidiSynth::kSlicingFixed, MidiSynth::kSlicingEventDriven})
+    {
+      TestCullTime(mode, blockSize, 1000, 200, 0.99);
+      // loud for the first 960 samples of a slice that starts with the release, when slices are 1024 samples
+      TestCullTime(mode, blockSize, 1024, 960, 0.);
+    }
+  }
+
+  TestNoLevelTracking();
+  TestSteal();
+
+  printf("%g note events per second, %d sample blocks, us per second of audio:\n", kEventsPerSecond, kBlockSize);
+  printf("  voices      plain        MPE\n");
+
+  for (auto nVoices : {16, 64, 128, 254})
+    printf("  %6d %10.0f %10.0f\n", nVoices, Benchmark(nVoices, false), Benchmark(nVoices, true));
+
+  return TestResult("VoiceAllocatorTest");
+}
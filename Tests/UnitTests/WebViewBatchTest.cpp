@@ -0,0 +1,426 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Round trips every record type of the batched WebView transport through WebViewBatchWriter and WebViewBatchReader,
+// directly and through the base64 script of GetScript(), and checks that payloads start on 4 byte boundaries with
+// zeroed padding. Every truncation of a frame must either fail or end on a record boundary with the records before it
+// intact, and data lengths that are negative or run past the frame must be rejected. Frames are copied to buffers of
+// exactly their size, so that a build with -fsanitize=address catches any read past the end.
+// Then times writing and reading a typical editor tick.
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "IPlugWebViewBatch.h"
+
+using namespace iplug;
+using namespace iplugtest;
+
+namespace
+{
+
+/** A record of any type, with the fields that type uses */
+struct Record
+{
+  uint32_t type = 0;
+  int32_t a = 0, b = 0;
+  double value = 0.;
+  uint8_t bytes[4] = {};
+  std::vector<uint8_t> data;
+
+  bool operator==(const Record& other) const
+  {
+    return type == other.type && a == other.a && b == other.b && !memcmp(&value, &other.value, sizeof(value))
+      && !memcmp(bytes, other.bytes, 4) && data == other.data;
+  }
+};
+
+void Write(WebViewBatchWriter& writer, const Record& rec)
+{
+  writer.PutType(static_cast<EWebViewBatchMsg>(rec.type));
+
+  switch (rec.type)
+  {
+    case kBatchSCVFD:
+    case kBatchSPVFD:
+    case kBatchSPVFUI:
+      writer.PutInt32(rec.a);
+      writer.PutDouble(rec.value);
+      break;
+    case kBatchBPCFUI:
+    case kBatchEPCFUI:
+      writer.PutInt32(rec.a);
+      break;
+    case kBatchSCMFD:
+    case kBatchSAMFUI:
+      writer.PutInt32(rec.a);
+      writer.PutInt32(rec.b);
+      writer.PutData(rec.data.data(), static_cast<int>(rec.data.size()));
+      break;
+    case kBatchSAMFD:
+      writer.PutInt32(rec.a);
+      writer.PutData(rec.data.data(), static_cast<int>(rec.data.size()));
+      break;
+    case kBatchSMMFD:
+    case kBatchSMMFUI:
+      writer.PutBytes4(rec.bytes[0], rec.bytes[1], rec.bytes[2], rec.bytes[3]);
+      break;
+  }
+}
+
+/** Read records until the end of the frame, as WebViewEditorDelegate::OnBatchFromWebView() does.
+ * @return \c true if the frame ended on a record boundary, \c false if a record or its type was incomplete */
+bool Read(const uint8_t* pFrame, int size, std::vector<Record>& records)
+{
+  WebViewBatchReader reader(pFrame, size);
+  uint32_t type;
+  records.clear();
+
+  while (!reader.AtEnd())
+  {
+    if (!reader.GetType(type))
+      return false;
+
+    Record rec;
+    rec.type = type;
+    const uint8_t* pData = nullptr;
+    int dataSize = 0;
+    bool complete = false;
+
+    switch (type)
+    {
+      case kBatchSCVFD:
+      case kBatchSPVFD:
+      case kBatchSPVFUI:
+        complete = reader.GetInt32(rec.a) && reader.GetDouble(rec.value);
+        break;
+      case kBatchBPCFUI:
+      case kBatchEPCFUI:
+        complete = reader.GetInt32(rec.a);
+        break;
+      case kBatchSCMFD:
+      case kBatchSAMFUI:
+        complete = reader.GetInt32(rec.a) && reader.GetInt32(rec.b) && reader.GetData(pData, dataSize);
+        break;
+      case kBatchSAMFD:
+        complete = reader.GetInt32(rec.a) && reader.GetData(pData, dataSize);
+        break;
+      case kBatchSMMFD:
+      case kBatchSMMFUI:
+        complete = reader.GetBytes4(rec.bytes);
+        break;
+    }
+
+    if (!complete)
+    {
+      IPLUG_CHECK(reader.AtEnd() && !reader.GetType(type), "a failed read left the reader inside the frame");
+      return false;
+    }
+
+    if (pData)
+    {
+      IPLUG_CHECK(pData >= pFrame && pData + dataSize <= pFrame + size, "payload of %d bytes outside the frame", dataSize);
+      rec.data.assign(pData, pData + dataSize);
+    }
+
+    records.push_back(rec);
+  }
+
+  return true;
+}
+
+/** One record of each type, payloads of every size up to 9 bytes and one of 2 KB, and awkward values */
+std::vector<Record> MakeRecords()
+{
+  std::vector<Record> records;
+  const double values[] = {0., -0., 1., 0.123456789, std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::quiet_NaN()};
+  const int32_t ints[] = {0, -1, 7, INT_MAX, INT_MIN};
+
+  for (auto type : {kBatchSCVFD, kBatchSPVFD, kBatchSPVFUI})
+  {
+    for (auto i = 0; i < 6; i++)
+    {
+      Record rec;
+      rec.type = type;
+      rec.a = ints[i % 5];
+      rec.value = values[i];
+      records.push_back(rec);
+    }
+  }
+
+  for (auto type : {kBatchBPCFUI, kBatchEPCFUI})
+  {
+    Record rec;
+    rec.type = type;
+    rec.a = 42;
+    records.push_back(rec);
+  }
+
+  for (auto type : {kBatchSCMFD, kBatchSAMFD, kBatchSAMFUI})
+  {
+    for (auto size : {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 2048})
+    {
+      Record rec;
+      rec.type = type;
+      rec.a = size;
+      rec.b = type == kBatchSAMFD ? 0 : -size; // SAMFD has no second field
+      for (auto i = 0; i < size; i++)
+        rec.data.push_back(static_cast<uint8_t>(i * 37 + size));
+      records.push_back(rec);
+    }
+  }
+
+  for (auto type : {kBatchSMMFD, kBatchSMMFUI})
+  {
+    Record rec;
+    rec.type = type;
+    rec.bytes[0] = 0x90;
+    rec.bytes[1] = 60;
+    rec.bytes[2] = 127;
+    records.push_back(rec);
+  }
+
+  return records;
+}
+
+/** The offset of each record's end in the frame, found by writing the records one at a time */
+std::vector<int> RecordEnds(const std::vector<Record>& records)
+{
+  WebViewBatchWriter writer;
+  std::vector<int> ends;
+
+  for (auto& rec : records)
+  {
+    Write(writer, rec);
+    ends.push_back(writer.Size());
+  }
+
+  return ends;
+}
+
+void TestRoundTrip()
+{
+  const auto records = MakeRecords();
+  WebViewBatchWriter writer;
+
+  // twice, as the writer keeps its buffer between frames
+  for (auto pass = 0; pass < 2; pass++)
+  {
+    writer.Clear();
+    IPLUG_CHECK(writer.Empty() && writer.Size() == 0, "pass %d: Clear() left %d bytes", pass, writer.Size());
+
+    for (auto& rec : records)
+      Write(writer, rec);
+
+    IPLUG_CHECK(writer.Size() % 4 == 0, "pass %d: frame of %d bytes is not a multiple of 4", pass, writer.Size());
+
+    const std::vector<uint8_t> frame(writer.Data(), writer.Data() + writer.Size());
+    std::vector<Record> read;
+    IPLUG_CHECK(Read(frame.data(), static_cast<int>(frame.size()), read), "pass %d: round trip failed", pass);
+    IPLUG_CHECK(read == records, "pass %d: read %d records that differ from the %d written", pass, static_cast<int>(read.size()), static_cast<int>(records.size()));
+  }
+
+  // payloads are aligned and the padding is zeroed
+  for (auto size = 0; size <= 9; size++)
+  {
+    std::vector<uint8_t> payload(size, 0xff);
+    writer.Clear();
+    writer.PutType(kBatchSAMFD);
+    writer.PutInt32(1);
+    writer.PutData(payload.data(), size);
+    const int padded = (size + 3) & ~3;
+
+    IPLUG_CHECK(writer.Size() == 12 + padded, "payload of %d bytes: frame of %d bytes", size, writer.Size());
+    for (auto i = 12 + size; i < writer.Size(); i++)
+      IPLUG_CHECK(writer.Data()[i] == 0, "payload of %d bytes: padding byte %d is %d", size, i, writer.Data()[i]);
+  }
+}
+
+/** The frame as the page receives it: base64 in the IPlugBatchFD() call of GetScript() */
+void TestScript()
+{
+  const auto records = MakeRecords();
+  WebViewBatchWriter writer;
+  for (auto& rec : records)
+    Write(writer, rec);
+
+  WDL_String script;
+  writer.GetScript(script);
+
+  const char* pCall = strstr(script.Get(), "IPlugBatchFD('");
+  IPLUG_CHECK(pCall && !strncmp(script.Get(), "typeof IPlugBatchFD === 'function'", 34), "script: %.60s", script.Get());
+  if (!pCall)
+    return;
+
+  const char* pBase64 = pCall + strlen("IPlugBatchFD('");
+  const int encodedLen = static_cast<int>(strlen(pBase64)) - 2;
+  IPLUG_CHECK(encodedLen == writer.EncodedSize() && !strcmp(pBase64 + encodedLen, "')"), "script: base64 of %d characters, EncodedSize() %d", encodedLen, writer.EncodedSize());
+
+  const std::string base64(pBase64, encodedLen);
+  std::vector<uint8_t> frame(writer.Size() + 3);
+  const int size = wdl_base64decode(base64.c_str(), frame.data(), static_cast<int>(frame.size()));
+  IPLUG_CHECK(size == writer.Size() && !memcmp(frame.data(), writer.Data(), size), "script: decoded %d bytes, wrote %d", size, writer.Size());
+
+  std::vector<Record> read;
+  IPLUG_CHECK(Read(frame.data(), size, read) && read == records, "script: the decoded frame reads back differently");
+
+  writer.Clear();
+  writer.GetScript(script);
+  IPLUG_CHECK(!strcmp(script.Get(), "typeof IPlugBatchFD === 'function' && IPlugBatchFD('')"), "empty script: %s", script.Get());
+}
+
+/** Every truncation either fails or ends on a record boundary, with the records before it intact */
+void TestTruncated()
+{
+  const auto records = MakeRecords();
+  const auto ends = RecordEnds(records);
+  WebViewBatchWriter writer;
+  for (auto& rec : records)
+    Write(writer, rec);
+
+  int nBadAccepts = 0, nBadRejects = 0;
+  std::vector<Record> read;
+
+  for (auto size = 0; size < writer.Size(); size++)
+  {
+    // a copy of exactly size bytes, so that ASan catches any read past it
+    std::unique_ptr<uint8_t[]> truncated(new uint8_t[size > 0 ? size : 1]);
+    memcpy(truncated.get(), writer.Data(), size);
+
+    const bool ok = Read(truncated.get(), size, read);
+    int nComplete = 0;
+    while (nComplete < static_cast<int>(ends.size()) && ends[nComplete] <= size)
+      nComplete++;
+
+    const bool atBoundary = size == 0 || (nComplete > 0 && ends[nComplete - 1] == size);
+    nBadAccepts += ok && !atBoundary;
+    nBadRejects += !ok && atBoundary;
+
+    const bool prefixIntact = static_cast<int>(read.size()) == nComplete && std::equal(read.begin(), read.end(), records.begin());
+    IPLUG_CHECK(prefixIntact, "truncated to %d bytes: read %d records, %d are complete", size, static_cast<int>(read.size()), nComplete);
+  }
+
+  IPLUG_CHECK(nBadAccepts == 0, "%d frames truncated inside a record accepted", nBadAccepts);
+  IPLUG_CHECK(nBadRejects == 0, "%d frames truncated on a record boundary rejected", nBadRejects);
+}
+
+/** Data lengths that are negative, or whose payload or padding runs past the end of the frame */
+void TestBadLengths()
+{
+  for (auto payloadSize : {0, 3, 8})
+  {
+    WebViewBatchWriter writer;
+    std::vector<uint8_t> payload(payloadSize, 0x55);
+    writer.PutType(kBatchSAMFUI);
+    writer.PutInt32(1);
+    writer.PutInt32(2);
+    writer.PutData(payload.data(), payloadSize);
+
+    constexpr int kLengthPos = 12;
+    const int available = writer.Size() - kLengthPos - 4; // the payload and its padding
+
+    for (auto len : {-1, -4, INT_MIN, available + 1, available + 4, INT_MAX - 2, INT_MAX})
+    {
+      std::unique_ptr<uint8_t[]> frame(new uint8_t[writer.Size()]);
+      memcpy(frame.get(), writer.Data(), writer.Size());
+      memcpy(frame.get() + kLengthPos, &len, sizeof(len));
+
+      std::vector<Record> read;
+      IPLUG_CHECK(!Read(frame.get(), writer.Size(), read) && read.empty(), "payload of %d bytes: length %d accepted", payloadSize, len);
+    }
+
+    // the right length, but the frame ends after the payload, inside its padding
+    if (payloadSize % 4)
+    {
+      const int size = kLengthPos + 4 + payloadSize;
+      std::unique_ptr<uint8_t[]> frame(new uint8_t[size]);
+      memcpy(frame.get(), writer.Data(), size);
+
+      WebViewBatchReader reader(frame.get(), size);
+      uint32_t type;
+      int32_t tag;
+      const uint8_t* pData;
+      int dataSize;
+      const bool ok = reader.GetType(type) && reader.GetInt32(tag) && reader.GetInt32(tag) && reader.GetData(pData, dataSize);
+      IPLUG_CHECK(!ok && reader.AtEnd(), "payload of %d bytes: frame ending in the padding accepted", payloadSize);
+    }
+  }
+}
+
+/** A tick of a typical editor: a 2 KB spectrum, 16 meters and 8 control values, written, encoded, decoded and read */
+void Benchmark()
+{
+  std::vector<uint8_t> spectrum(2048, 0x3f);
+  std::vector<float> meter(2, 0.5f);
+  WebViewBatchWriter writer;
+  WDL_String script;
+
+  const double tWrite = TimeMicroseconds([&]() {
+    writer.Clear();
+    writer.PutType(kBatchSCMFD);
+    writer.PutInt32(100);
+    writer.PutInt32(0);
+    writer.PutData(spectrum.data(), static_cast<int>(spectrum.size()));
+
+    for (auto i = 0; i < 16; i++)
+    {
+      writer.PutType(kBatchSCMFD);
+      writer.PutInt32(200 + i);
+      writer.PutInt32(0);
+      writer.PutData(meter.data(), static_cast<int>(meter.size() * sizeof(float)));
+    }
+
+    for (auto i = 0; i < 8; i++)
+    {
+      writer.PutType(kBatchSPVFD);
+      writer.PutInt32(i);
+      writer.PutDouble(i / 8.);
+    }
+
+    writer.GetScript(script);
+    DoNotOptimize(script.GetLength());
+  }, 100.);
+
+  std::vector<uint8_t> frame(writer.Size());
+  std::vector<Record> read;
+  const char* pBase64 = strstr(script.Get(), "('") + 2;
+  const std::string base64(pBase64, writer.EncodedSize());
+
+  const double tRead = TimeMicroseconds([&]() {
+    const int size = wdl_base64decode(base64.c_str(), frame.data(), static_cast<int>(frame.size()));
+    Read(frame.data(), size, read);
+    DoNotOptimize(read.size());
+  }, 100.);
+
+  printf("Editor tick, 25 records, %d byte frame, %d byte script:\n", writer.Size(), script.GetLength());
+  printf("  write and encode %8.2f us\n", tWrite);
+  printf("  decode and read  %8.2f us\n", tRead);
+}
+
+} // namespace
+
+int main()
+{
+  TestRoundTrip();
+  TestScript();
+  TestTruncated();
+  TestBadLengths();
+
+  Benchmark();
+
+  return TestResult("WebViewBatchTest");
+}